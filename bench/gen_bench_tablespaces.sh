@@ -0,0 +1,180 @@
+#!/bin/bash
+
+# Generate the benchmark tablespaces.
+#
+# Creates one table per scenario in a local MySQL/Percona server, fills it
+# with deterministic rows (a recursive CTE; no RAND()), exports it with
+# FLUSH TABLES ... FOR EXPORT and copies the .ibd plus its ibd2sdi JSON to
+# $BENCH_DIR. bench/run_bench.sh reads the manifest.tsv written there.
+#
+# Scenarios (skipped ones are reported, e.g. encryption without a keyring):
+#   wide         60 columns of mixed types
+#   lob          TEXT, BLOB and JSON columns stored off-page
+#   zip1..zip8   ROW_FORMAT=COMPRESSED, KEY_BLOCK_SIZE=1/2/4/8
+#   encrypted    ENCRYPTION='Y'
+#   secondary    8 secondary indexes (the parse reads the PRIMARY)
+#
+# Environment: BENCH_ROWS (default 200000), BENCH_DIR (default
+# bench/data), DB_USER, MYSQL_DATA_DIR, VERBOSE=1.
+
+set -e
+
+VERBOSE=${VERBOSE:-0}
+log_verbose() {
+    if [ "$VERBOSE" = "1" ]; then
+        echo -e "\033[0;36m  [SQL] $1\033[0m"
+    fi
+}
+
+DB_USER=${DB_USER:-root}
+DB_NAME="ib_bench"
+MYSQL_DATA_DIR=${MYSQL_DATA_DIR:-/var/lib/mysql}
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PARSER_DIR="$(dirname "$SCRIPT_DIR")"
+BENCH_DIR=${BENCH_DIR:-$SCRIPT_DIR/data}
+BENCH_ROWS=${BENCH_ROWS:-200000}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+KEYRING_FILE="/var/lib/mysql-keyring/keyring"
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+mkdir -p "$BENCH_DIR"
+MANIFEST="$BENCH_DIR/manifest.tsv"
+: > "$MANIFEST"
+
+sql() {
+    log_verbose "$1"
+    mysql -u"$DB_USER" "$DB_NAME" -e "$1"
+}
+
+sql_root() {
+    mysql -u"$DB_USER" -e "$1"
+}
+
+# Seeded rows n = 1..BENCH_ROWS; every column below is a function of n.
+seq_cte() {
+    echo "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < $BENCH_ROWS)"
+}
+
+# Fill a table by INSERT ... SELECT from the sequence.
+fill() {
+    local table=$1 columns=$2 values=$3
+    log_verbose "INSERT INTO $table ($BENCH_ROWS rows)"
+    mysql -u"$DB_USER" "$DB_NAME" <<EOF
+SET SESSION cte_max_recursion_depth = $((BENCH_ROWS + 1));
+INSERT INTO $table ($columns)
+$(seq_cte)
+SELECT $values FROM seq;
+EOF
+}
+
+# Export table, copy it out and record it in the manifest.
+export_table() {
+    local scenario=$1 table=$2 extra=$3
+    local out_ibd="$BENCH_DIR/${scenario}.ibd"
+    local out_sdi="$BENCH_DIR/${scenario}_sdi.json"
+    log_verbose "FLUSH TABLES $table FOR EXPORT"
+    # The copy must happen while the export lock is held, in the same session.
+    mysql -u"$DB_USER" "$DB_NAME" <<EOF
+FLUSH TABLES $table FOR EXPORT;
+system sudo cp "$MYSQL_DATA_DIR/$DB_NAME/${table}.ibd" "$out_ibd"
+UNLOCK TABLES;
+EOF
+    sudo chown "$(whoami)":"$(whoami)" "$out_ibd"
+    if [ -n "$extra" ]; then
+        # ibd2sdi cannot read encrypted SDI pages; decrypt a copy first.
+        "$IB_PARSER" 1 $extra "$out_ibd" "$BENCH_DIR/${scenario}_plain.ibd" >/dev/null
+        ibd2sdi "$BENCH_DIR/${scenario}_plain.ibd" > "$out_sdi"
+        rm -f "$BENCH_DIR/${scenario}_plain.ibd"
+    else
+        ibd2sdi "$out_ibd" > "$out_sdi"
+    fi
+    printf '%s\t%s\t%s\t%s\n' "$scenario" "$out_ibd" "$out_sdi" "$extra" >> "$MANIFEST"
+    echo -e "${GREEN}$scenario: $(du -h "$out_ibd" | cut -f1)${NC}"
+}
+
+echo -e "${YELLOW}Creating database $DB_NAME ($BENCH_ROWS rows per table)${NC}"
+sql_root "DROP DATABASE IF EXISTS $DB_NAME; CREATE DATABASE $DB_NAME;"
+
+# --- wide: 60 columns -------------------------------------------------------
+cols="id INT PRIMARY KEY"
+names=""
+values=""
+for i in $(seq 1 59); do
+    case $((i % 6)) in
+        0) cols="$cols, c$i INT";            v="n * $i" ;;
+        1) cols="$cols, c$i BIGINT";         v="n * 1000003 + $i" ;;
+        2) cols="$cols, c$i VARCHAR(32)";    v="CONCAT('v', n, '_', $i)" ;;
+        3) cols="$cols, c$i DECIMAL(12,2)";  v="(n % 100000) / 100 + $i" ;;
+        4) cols="$cols, c$i DATETIME";       v="TIMESTAMP('2020-01-01') + INTERVAL (n * $i) SECOND" ;;
+        5) cols="$cols, c$i DOUBLE";         v="n / $i" ;;
+    esac
+    names="$names, c$i"
+    values="$values, $v"
+done
+sql "CREATE TABLE wide ($cols) ENGINE=InnoDB"
+fill wide "id$names" "n$values"
+export_table wide wide ""
+
+# --- lob: off-page TEXT, BLOB and JSON ---------------------------------------
+sql "CREATE TABLE lob (id INT PRIMARY KEY, body TEXT, payload BLOB, doc JSON) ENGINE=InnoDB"
+fill lob "id, body, payload, doc" \
+    "n, REPEAT(CONCAT('text ', n, ' '), 1 + n % 2000), REPEAT(UNHEX(LPAD(HEX(n % 65536), 4, '0')), 4000 + n % 8000), JSON_OBJECT('id', n, 'tags', JSON_ARRAY('a', n % 7, n % 11), 'note', REPEAT('j', n % 9000))"
+export_table lob lob ""
+
+# --- zip1..zip8: ROW_FORMAT=COMPRESSED ----------------------------------------
+for kbs in 1 2 4 8; do
+    sql "CREATE TABLE zip$kbs (id INT PRIMARY KEY, a VARCHAR(64), b INT, c DATETIME) ROW_FORMAT=COMPRESSED KEY_BLOCK_SIZE=$kbs"
+    fill zip$kbs "id, a, b, c" \
+        "n, CONCAT('compressed row ', n % 1000), n % 977, TIMESTAMP('2021-06-01') + INTERVAL n MINUTE"
+    export_table zip$kbs zip$kbs ""
+done
+
+# --- encrypted ------------------------------------------------------------------
+if sql "CREATE TABLE encrypted (id INT PRIMARY KEY, a VARCHAR(64), b INT) ENCRYPTION='Y'" 2>/dev/null; then
+    fill encrypted "id, a, b" "n, CONCAT('secret ', n), n * 7"
+    SERVER_UUID=$(mysql -u"$DB_USER" -sN -e "SELECT @@server_uuid;")
+    if [ ! -f "$KEYRING_FILE" ]; then
+        KEYRING_FILE=$(find /var/lib/mysql* -name "keyring" -type f 2>/dev/null | head -1)
+    fi
+    sudo cp "$KEYRING_FILE" "$BENCH_DIR/keyring"
+    sudo chown "$(whoami)":"$(whoami)" "$BENCH_DIR/keyring"
+    # The master key id grows with every rotation; find the one in use.
+    FLUSHED=$(mktemp)
+    mysql -u"$DB_USER" "$DB_NAME" <<EOF
+FLUSH TABLES encrypted FOR EXPORT;
+system sudo cp "$MYSQL_DATA_DIR/$DB_NAME/encrypted.ibd" "$FLUSHED"
+UNLOCK TABLES;
+EOF
+    sudo chown "$(whoami)":"$(whoami)" "$FLUSHED"
+    MASTER_KEY_ID=""
+    for id in $(seq 1 20); do
+        if "$IB_PARSER" 6 "$FLUSHED" --keyring="$BENCH_DIR/keyring" \
+            --master-key-id=$id --server-uuid="$SERVER_UUID" >/dev/null 2>&1; then
+            MASTER_KEY_ID=$id
+            break
+        fi
+    done
+    rm -f "$FLUSHED"
+    if [ -n "$MASTER_KEY_ID" ]; then
+        export_table encrypted encrypted "$MASTER_KEY_ID $SERVER_UUID $BENCH_DIR/keyring"
+    else
+        echo -e "${RED}encrypted: no master key id in 1..20 opens the tablespace, skipped${NC}"
+    fi
+else
+    echo -e "${YELLOW}encrypted: skipped (keyring not configured)${NC}"
+fi
+
+# --- secondary: 8 secondary indexes ------------------------------------------------
+sql "CREATE TABLE secondary (id INT PRIMARY KEY, k1 INT, k2 INT, k3 VARCHAR(32), k4 BIGINT,
+     k5 DATE, k6 INT, k7 VARCHAR(16), k8 INT,
+     KEY i1 (k1), KEY i2 (k2), KEY i3 (k3), KEY i4 (k4), KEY i5 (k5), KEY i6 (k6),
+     KEY i7 (k7), KEY i8 (k8, k1)) ENGINE=InnoDB"
+fill secondary "id, k1, k2, k3, k4, k5, k6, k7, k8" \
+    "n, n % 1009, n % 7919, CONCAT('key', n % 5003), n * 31, DATE('2000-01-01') + INTERVAL (n % 9000) DAY, -n, LPAD(n % 100, 16, 'x'), n % 13"
+export_table secondary secondary ""
+
+echo -e "${GREEN}Manifest: $MANIFEST${NC}"
@@ -0,0 +1,712 @@
+/**
+ * ib_bench.cc
+ *
+ * Microbenchmarks for the hot paths of mode 3 and the C API:
+ * page_zip decompression, page decryption, record validation, row
+ * formatting, text transcoding, the binary JSON decoder and table definition
+ * loading (ibd2sdi JSON, SDI pages, schema cache). Each benchmark repeats its
+ * work until --min-time has passed and reports ns/op, ops/s and MB/s,
+ * as a table or (--json) one JSON object per line for tracking across
+ * releases. bench/run_bench.sh adds the end-to-end ib_parser scenarios.
+ *
+ * Build with `make ib_bench` (not part of the default target).
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <my_sys.h>
+#include <my_thread.h>
+#include "page0size.h"
+#include "fil0fil.h"
+#include "mach0data.h"
+#include "page0page.h"
+#include "rem0rec.h"
+
+#include "decrypt.h"
+#include "charset_convert.h"
+#include "decompress.h"
+#include "parser.h"
+#include "schema_cache.h"
+#include "tables_dict.h"
+#include "undrop_for_innodb.h"
+
+namespace {
+
+struct BenchOptions {
+  std::string ibd;         // table for the record benchmarks
+  std::string sdi;
+  std::string compressed;  // ROW_FORMAT=COMPRESSED tablespace
+  std::string filter;
+  std::string label;       // copied into every JSON line
+  double min_time = 1.0;
+  bool json = false;
+};
+
+struct BenchResult {
+  std::string name;
+  std::string input;
+  uint64_t ops = 0;
+  uint64_t bytes = 0;
+  double seconds = 0;
+};
+
+// Keeps the compiler from dropping work whose result is otherwise unused.
+volatile uint64_t g_sink = 0;
+
+std::string json_escape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+    }
+    out.push_back(c);
+  }
+  return out;
+}
+
+void report(const BenchOptions& opts, const BenchResult& r) {
+  const double ns_per_op = r.ops ? r.seconds * 1e9 / r.ops : 0;
+  const double ops_per_s = r.seconds > 0 ? r.ops / r.seconds : 0;
+  const double mb_per_s = r.seconds > 0 ? r.bytes / r.seconds / (1024.0 * 1024.0) : 0;
+  if (opts.json) {
+    std::printf("{\"bench\":\"%s\",\"input\":\"%s\",\"label\":\"%s\",\"ops\":%llu,"
+                "\"bytes\":%llu,\"seconds\":%.6f,\"ns_per_op\":%.1f,"
+                "\"ops_per_s\":%.1f,\"mb_per_s\":%.2f}\n",
+                r.name.c_str(), json_escape(r.input).c_str(),
+                json_escape(opts.label).c_str(),
+                static_cast<unsigned long long>(r.ops),
+                static_cast<unsigned long long>(r.bytes), r.seconds, ns_per_op,
+                ops_per_s, mb_per_s);
+  } else {
+    std::printf("%-22s %12.1f ns/op %14.0f ops/s %10.1f MB/s  %s\n",
+                r.name.c_str(), ns_per_op, ops_per_s, mb_per_s, r.input.c_str());
+  }
+  std::fflush(stdout);
+}
+
+/**
+ * Run round() (one pass over the benchmark's inputs, doing ops_per_round
+ * operations on bytes_per_round bytes) once to warm up, then until
+ * opts.min_time has elapsed.
+ */
+void run_bench(const BenchOptions& opts, const char* name, const std::string& input,
+               uint64_t ops_per_round, uint64_t bytes_per_round,
+               const std::function<void()>& round) {
+  if (!opts.filter.empty() && std::strstr(name, opts.filter.c_str()) == nullptr) {
+    return;
+  }
+  if (ops_per_round == 0) {
+    std::fprintf(stderr, "%s: no input in %s, skipped\n", name, input.c_str());
+    return;
+  }
+  round();
+  BenchResult r;
+  r.name = name;
+  r.input = input;
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed{0};
+  do {
+    round();
+    r.ops += ops_per_round;
+    r.bytes += bytes_per_round;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed.count() < opts.min_time);
+  r.seconds = elapsed.count();
+  report(opts, r);
+}
+
+/** Every page of path (physical size), plus the tablespace page sizes. */
+bool read_tablespace(const std::string& path, std::vector<unsigned char>* data,
+                     size_t* physical, size_t* logical) {
+  File fd = my_open(path.c_str(), O_RDONLY, MYF(0));
+  if (fd < 0) {
+    std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+    return false;
+  }
+  page_size_t pg_sz(0, 0, false);
+  const bool sized = determine_page_size(fd, pg_sz);
+  my_close(fd, MYF(0));
+  if (!sized) {
+    std::fprintf(stderr, "Cannot determine page size of %s\n", path.c_str());
+    return false;
+  }
+  *physical = pg_sz.physical();
+  *logical = pg_sz.logical();
+
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    return false;
+  }
+  data->clear();
+  std::vector<unsigned char> page(*physical);
+  while (std::fread(page.data(), 1, page.size(), f) == page.size()) {
+    data->insert(data->end(), page.begin(), page.end());
+  }
+  std::fclose(f);
+  return true;
+}
+
+void bench_decompress(const BenchOptions& opts) {
+  if (opts.compressed.empty()) {
+    return;
+  }
+  std::vector<unsigned char> data;
+  size_t physical = 0, logical = 0;
+  if (!read_tablespace(opts.compressed, &data, &physical, &logical)) {
+    return;
+  }
+  if (physical >= logical) {
+    std::fprintf(stderr, "decompress_page: %s is not ROW_FORMAT=COMPRESSED\n",
+                 opts.compressed.c_str());
+    return;
+  }
+  std::vector<const unsigned char*> pages;
+  for (size_t off = 0; off + physical <= data.size(); off += physical) {
+    if (mach_read_from_2(&data[off] + FIL_PAGE_TYPE) == FIL_PAGE_INDEX) {
+      pages.push_back(&data[off]);
+    }
+  }
+  std::vector<unsigned char> out(logical);
+  run_bench(opts, "decompress_page", opts.compressed, pages.size(),
+            pages.size() * logical, [&] {
+              for (const unsigned char* page : pages) {
+                size_t actual = 0;
+                decompress_page_inplace(page, physical, logical, out.data(),
+                                        out.size(), &actual);
+                g_sink += actual;
+              }
+            });
+}
+
+void bench_decrypt(const BenchOptions& opts) {
+  // AES cost does not depend on the bytes, so a random page marked
+  // FIL_PAGE_ENCRYPTED stands in for a real one. The copy back from the
+  // template (the page is decrypted in place) is a few % of the time.
+  const size_t kPageSize = 16384;
+  const size_t kPages = 64;
+  std::mt19937 rng(42);
+  std::vector<unsigned char> pristine(kPageSize * kPages);
+  for (auto& b : pristine) {
+    b = static_cast<unsigned char>(rng());
+  }
+  for (size_t i = 0; i < kPages; i++) {
+    unsigned char* page = &pristine[i * kPageSize];
+    mach_write_to_2(page + FIL_PAGE_TYPE, FIL_PAGE_ENCRYPTED);
+    mach_write_to_2(page + FIL_PAGE_ORIGINAL_TYPE_V1, FIL_PAGE_INDEX);
+  }
+  unsigned char key[32];
+  unsigned char iv[32];
+  for (auto& b : key) {
+    b = static_cast<unsigned char>(rng());
+  }
+  for (auto& b : iv) {
+    b = static_cast<unsigned char>(rng());
+  }
+  std::vector<unsigned char> work(pristine.size());
+  run_bench(opts, "decrypt_page", "synthetic 16KB pages", kPages, kPages * kPageSize, [&] {
+    std::memcpy(work.data(), pristine.data(), work.size());
+    for (size_t i = 0; i < kPages; i++) {
+      g_sink += decrypt_page_inplace(&work[i * kPageSize], kPageSize, key,
+                                     sizeof(key), iv, 512);
+    }
+  });
+}
+
+/** Leaf pages of the table's index and the user records on them. */
+struct RecordSet {
+  std::vector<std::vector<unsigned char>> pages;  // logical pages
+  std::vector<std::pair<size_t, ulint>> records;  // (page, offset)
+  uint64_t record_bytes = 0;
+  size_t page_size = 0;
+};
+
+bool load_records(const BenchOptions& opts, parser_context_t* ctx, RecordSet* set) {
+  std::string table_name;
+  if (load_ib2sdi_table_columns(opts.sdi.c_str(), table_name, ctx) != 0) {
+    std::fprintf(stderr, "Cannot load %s\n", opts.sdi.c_str());
+    return false;
+  }
+  if (has_sdi_index_definitions(ctx)) {
+    std::string err;
+    if (!select_index_for_parsing(ctx, "", &err)) {
+      std::fprintf(stderr, "Index selection failed: %s\n", err.c_str());
+      return false;
+    }
+  }
+  table_def_t* table = &table_definitions[0];
+  if (build_table_def_from_json(table, table_name.c_str(), ctx) != 0) {
+    return false;
+  }
+  table_definitions_cnt = 1;
+  init_table_defs(1);
+
+  std::vector<unsigned char> data;
+  size_t physical = 0, logical = 0;
+  if (!read_tablespace(opts.ibd, &data, &physical, &logical)) {
+    return false;
+  }
+  const int fd = ::open(opts.ibd.c_str(), O_RDONLY);
+  if (fd < 0) {
+    perror("open");
+    return false;
+  }
+  // The root's page header is stored uncompressed, even with page_zip.
+  const page_no_t root = selected_index_root(ctx);
+  if (!target_index_is_set(ctx) && root != FIL_NULL &&
+      (static_cast<size_t>(root) + 1) * physical <= data.size()) {
+    set_target_index_id_from_value(
+        ctx, mach_read_from_8(&data[root * physical] + PAGE_HEADER + PAGE_INDEX_ID));
+  }
+  if (!target_index_is_set(ctx) && discover_target_index_id(fd, ctx) != 0) {
+    std::fprintf(stderr, "Cannot find the index in %s\n", opts.ibd.c_str());
+    ::close(fd);
+    return false;
+  }
+
+  // Row formatting may follow LOB references back into the file.
+  LobReadContext lob;
+  lob.fd = fd;
+  lob.physical_page_size = physical;
+  lob.logical_page_size = logical;
+  lob.tablespace_compressed = physical < logical;
+  set_lob_read_context(lob);
+
+  set->page_size = logical;
+  std::vector<unsigned char> page(logical);
+  for (size_t off = 0; off + physical <= data.size(); off += physical) {
+    const unsigned char* raw = &data[off];
+    if (mach_read_from_2(raw + FIL_PAGE_TYPE) != FIL_PAGE_INDEX) {
+      continue;
+    }
+    if (physical < logical) {
+      size_t actual = 0;
+      if (!decompress_page_inplace(raw, physical, logical, page.data(), logical,
+                                   &actual) || actual != logical) {
+        continue;
+      }
+    } else {
+      std::memcpy(page.data(), raw, logical);
+    }
+    if (!page_is_comp(page.data()) || !is_target_index(page.data(), ctx) ||
+        mach_read_from_2(page.data() + PAGE_HEADER + PAGE_LEVEL) != 0) {
+      continue;
+    }
+    set->pages.push_back(page);
+    const unsigned char* p = set->pages.back().data();
+    ulint rec_off = PAGE_NEW_INFIMUM;
+    for (ulint steps = 0; steps < logical / (REC_N_NEW_EXTRA_BYTES + 1); steps++) {
+      const ulint next = (rec_off + static_cast<int16_t>(mach_read_from_2(
+                                        p + rec_off - REC_NEXT))) & (logical - 1);
+      if (next == rec_off || next < PAGE_NEW_SUPREMUM) {
+        break;
+      }
+      rec_off = next;
+      const rec_t* rec = reinterpret_cast<const rec_t*>(p + rec_off);
+      if (rec_get_status(rec) == REC_STATUS_SUPREMUM) {
+        break;
+      }
+      if (rec_get_status(rec) == REC_STATUS_ORDINARY) {
+        set->records.emplace_back(set->pages.size() - 1, rec_off);
+      }
+    }
+  }
+
+  // Keep only records that validate, so every benchmark sees the same set.
+  ulint offsets[MAX_TABLE_FIELDS + 2];
+  std::vector<std::pair<size_t, ulint>> valid;
+  for (const auto& r : set->records) {
+    unsigned char* p = set->pages[r.first].data();
+    if (check_for_a_record(p, p + r.second, table, offsets)) {
+      valid.push_back(r);
+    }
+  }
+  set->records.swap(valid);
+  return true;
+}
+
+/** Format every record of set once into out; returns the record bytes. */
+uint64_t format_records(RecordSet& set, table_def_t* table) {
+  ulint offsets[MAX_TABLE_FIELDS + 2];
+  uint64_t bytes = 0;
+  for (const auto& r : set.records) {
+    unsigned char* p = set.pages[r.first].data();
+    if (check_for_a_record(p, p + r.second, table, offsets)) {
+      bytes += process_ibrec(p, p + r.second, table, offsets, false, nullptr);
+    }
+  }
+  flush_row_output();
+  return bytes;
+}
+
+void bench_records(const BenchOptions& opts) {
+  parser_context_t ctx;
+  RecordSet set;
+  if (!load_records(opts, &ctx, &set)) {
+    return;
+  }
+  table_def_t* table = &table_definitions[0];
+  FILE* devnull = std::fopen("/dev/null", "wb");
+  if (!devnull) {
+    return;
+  }
+  RowOutputOptions out;
+  out.out = devnull;
+  set_row_output_options(out);
+  const uint64_t record_bytes = format_records(set, table);
+  const uint64_t n = set.records.size();
+
+  ulint offsets[MAX_TABLE_FIELDS + 2];
+  run_bench(opts, "check_for_a_record", opts.ibd, n, record_bytes, [&] {
+    for (const auto& r : set.records) {
+      unsigned char* p = set.pages[r.first].data();
+      g_sink += check_for_a_record(p, p + r.second, table, offsets);
+    }
+  });
+
+  // check_for_a_record() fills the offsets process_ibrec() decodes with, so
+  // these include it; subtract check_for_a_record for formatting alone.
+  run_bench(opts, "format_row_pipe", opts.ibd, n, record_bytes,
+            [&] { g_sink += format_records(set, table); });
+
+  out.format = ROW_OUTPUT_JSONL;
+  set_row_output_options(out);
+  run_bench(opts, "format_row_jsonl", opts.ibd, n, record_bytes,
+            [&] { g_sink += format_records(set, table); });
+
+  set_row_output_options(RowOutputOptions());
+  std::fclose(devnull);
+}
+
+// ---------------------------------------------------------------------------
+// Binary JSON documents, encoded the way the server stores a JSON column
+// (sql/json_binary.cc): small objects and arrays, inline small integers.
+// ---------------------------------------------------------------------------
+enum JsonbType : unsigned char {
+  kJsonbSmallObject = 0x00,
+  kJsonbSmallArray = 0x02,
+  kJsonbLiteral = 0x04,
+  kJsonbInt16 = 0x05,
+  kJsonbInt64 = 0x09,
+  kJsonbDouble = 0x0B,
+  kJsonbString = 0x0C,
+};
+
+struct JsonbValue {
+  JsonbType type = kJsonbLiteral;
+  int64_t number = 0;                           // ints, literal (0 null, 1 true)
+  double real = 0;
+  std::string str;
+  std::vector<std::string> keys;                // objects only
+  std::vector<JsonbValue> items;                // object values or array items
+};
+
+void put_u16(std::string& out, size_t pos, uint16_t v) {
+  out[pos] = static_cast<char>(v & 0xFF);
+  out[pos + 1] = static_cast<char>(v >> 8);
+}
+
+void put_varlen(std::string& out, size_t len) {
+  do {
+    unsigned char b = len & 0x7F;
+    len >>= 7;
+    if (len) {
+      b |= 0x80;
+    }
+    out.push_back(static_cast<char>(b));
+  } while (len);
+}
+
+bool jsonb_inlined(const JsonbValue& v) {
+  return v.type == kJsonbLiteral || v.type == kJsonbInt16;
+}
+
+// Body of v (without its type byte).
+std::string jsonb_body(const JsonbValue& v) {
+  std::string out;
+  switch (v.type) {
+    case kJsonbInt64:
+      for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<char>(static_cast<uint64_t>(v.number) >> (8 * i)));
+      }
+      return out;
+    case kJsonbDouble: {
+      char raw[8];
+      std::memcpy(raw, &v.real, sizeof(raw));  // little-endian hosts only
+      return std::string(raw, sizeof(raw));
+    }
+    case kJsonbString:
+      put_varlen(out, v.str.size());
+      return out + v.str;
+    case kJsonbSmallObject:
+    case kJsonbSmallArray: {
+      const bool object = v.type == kJsonbSmallObject;
+      const size_t n = v.items.size();
+      const size_t header = 4 + (object ? n * 4 : 0) + n * 3;
+      out.assign(header, '\0');
+      put_u16(out, 0, static_cast<uint16_t>(n));
+      if (object) {
+        for (size_t i = 0; i < n; i++) {
+          put_u16(out, 4 + i * 4, static_cast<uint16_t>(out.size()));
+          put_u16(out, 6 + i * 4, static_cast<uint16_t>(v.keys[i].size()));
+          out += v.keys[i];
+        }
+      }
+      const size_t entries = 4 + (object ? n * 4 : 0);
+      for (size_t i = 0; i < n; i++) {
+        const JsonbValue& item = v.items[i];
+        out[entries + i * 3] = static_cast<char>(item.type);
+        if (jsonb_inlined(item)) {
+          put_u16(out, entries + i * 3 + 1, static_cast<uint16_t>(item.number));
+        } else {
+          put_u16(out, entries + i * 3 + 1, static_cast<uint16_t>(out.size()));
+          out += jsonb_body(item);
+        }
+      }
+      put_u16(out, 2, static_cast<uint16_t>(out.size()));
+      return out;
+    }
+    default:
+      return out;
+  }
+}
+
+std::string jsonb_document(const JsonbValue& v) {
+  return std::string(1, static_cast<char>(v.type)) + jsonb_body(v);
+}
+
+JsonbValue jsonb_scalar(std::mt19937& rng, int i) {
+  JsonbValue v;
+  switch (rng() % 5) {
+    case 0:
+      v.type = kJsonbInt16;
+      v.number = static_cast<int16_t>(rng());
+      break;
+    case 1:
+      v.type = kJsonbInt64;
+      v.number = static_cast<int64_t>(rng()) << 20;
+      break;
+    case 2:
+      v.type = kJsonbDouble;
+      v.real = (rng() % 100000) / 100.0;
+      break;
+    case 3:
+      v.type = kJsonbLiteral;
+      v.number = rng() % 3;
+      break;
+    default:
+      v.type = kJsonbString;
+      v.str = "value \"" + std::to_string(i) + "\" " + std::string(rng() % 40, 'x');
+      break;
+  }
+  return v;
+}
+
+// An order-like document: a few scalars plus an array of line objects.
+JsonbValue jsonb_sample(std::mt19937& rng, int i) {
+  JsonbValue doc;
+  doc.type = kJsonbSmallObject;
+  static const char* const kKeys[] = {"active", "amount", "id", "lines", "note", "tags"};
+  for (const char* key : kKeys) {
+    doc.keys.push_back(key);
+    if (std::strcmp(key, "lines") == 0) {
+      JsonbValue lines;
+      lines.type = kJsonbSmallArray;
+      for (unsigned l = 0; l < 2 + rng() % 6; l++) {
+        JsonbValue line;
+        line.type = kJsonbSmallObject;
+        line.keys = {"price", "qty", "sku"};
+        line.items = {jsonb_scalar(rng, l), jsonb_scalar(rng, l), jsonb_scalar(rng, l)};
+        lines.items.push_back(line);
+      }
+      doc.items.push_back(lines);
+    } else {
+      doc.items.push_back(jsonb_scalar(rng, i));
+    }
+  }
+  return doc;
+}
+
+void bench_json(const BenchOptions& opts) {
+  std::mt19937 rng(7);
+  std::vector<std::string> docs;
+  uint64_t bytes = 0;
+  for (int i = 0; i < 256; i++) {
+    docs.push_back(jsonb_document(jsonb_sample(rng, i)));
+    bytes += docs.back().size();
+  }
+  std::string text;
+  for (const std::string& doc : docs) {
+    if (!json_binary_to_text(reinterpret_cast<const unsigned char*>(doc.data()),
+                             doc.size(), text)) {
+      std::fprintf(stderr, "json_decode: sample document rejected\n");
+      return;
+    }
+  }
+  run_bench(opts, "json_decode", "synthetic documents", docs.size(), bytes, [&] {
+    for (const std::string& doc : docs) {
+      text.clear();
+      json_binary_to_text(reinterpret_cast<const unsigned char*>(doc.data()),
+                          doc.size(), text);
+      g_sink += text.size();
+    }
+  });
+}
+
+// Text columns as the row formats print them, per source charset.
+void bench_text(const BenchOptions& opts) {
+  struct TextCase {
+    const char* name;
+    unsigned collation_id;
+    const char* accent;  // one non-ASCII character in that charset
+  };
+  const TextCase cases[] = {
+      {"text_utf8mb4_ascii", 255, nullptr},
+      {"text_utf8mb4_mixed", 255, "\xC3\xA9"},
+      {"text_utf8mb3_mixed", 33, "\xC3\xA9"},
+      {"text_latin1_mixed", 8, "\xE9"},
+  };
+  std::mt19937 rng(11);
+  for (const TextCase& c : cases) {
+    std::vector<std::string> values;
+    uint64_t bytes = 0;
+    for (int i = 0; i < 1024; i++) {
+      std::string v;
+      const size_t len = 8 + rng() % 200;
+      while (v.size() < len) {
+        if (c.accent && rng() % 16 == 0) {
+          v.append(c.accent);
+        } else {
+          v.push_back(static_cast<char>('a' + rng() % 26));
+        }
+      }
+      bytes += v.size();
+      values.push_back(v);
+    }
+    const TextConverter& conv = *text_converter(c.collation_id);
+    std::string out;
+    run_bench(opts, c.name, "synthetic values", values.size(), bytes, [&] {
+      for (const std::string& v : values) {
+        out.clear();
+        append_text_escaped(conv, reinterpret_cast<const unsigned char*>(v.data()),
+                            v.size(), 256, out);
+        g_sink += out.size();
+      }
+    });
+  }
+}
+
+// Startup cost per table: the definition from ibd2sdi JSON, from the
+// tablespace's SDI pages, and from a warm --sdi-cache artifact.
+void bench_schema(const BenchOptions& opts) {
+  struct stat st;
+  const uint64_t json_bytes =
+      stat(opts.sdi.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+  std::string table_name;
+  run_bench(opts, "schema_json", opts.sdi, 1, json_bytes, [&] {
+    parser_context_t ctx;
+    if (load_ib2sdi_table_columns(opts.sdi.c_str(), table_name, &ctx) == 0) {
+      g_sink += ctx.columns.size();
+    }
+  });
+  run_bench(opts, "schema_sdi_pages", opts.ibd, 1, 0, [&] {
+    parser_context_t ctx;
+    if (load_table_schema_from_ibd(opts.ibd.c_str(), nullptr, nullptr, table_name,
+                                   &ctx) == 0) {
+      g_sink += ctx.columns.size();
+    }
+  });
+
+  char cache_dir[] = "/tmp/ib_bench_schema.XXXXXX";
+  if (mkdtemp(cache_dir) == nullptr) {
+    std::fprintf(stderr, "schema_cached: cannot create a cache directory\n");
+    return;
+  }
+  run_bench(opts, "schema_cached", opts.ibd, 1, 0, [&] {
+    parser_context_t ctx;
+    if (load_table_schema_from_ibd(opts.ibd.c_str(), nullptr, cache_dir, table_name,
+                                   &ctx) == 0) {
+      g_sink += ctx.columns.size();
+    }
+  });
+  const std::string cleanup = std::string("rm -rf ") + cache_dir;
+  if (std::system(cleanup.c_str()) != 0) {
+    std::fprintf(stderr, "schema_cached: could not remove %s\n", cache_dir);
+  }
+}
+
+void usage(const char* prog) {
+  std::fprintf(stderr,
+               "Usage: %s [options]\n"
+               "  --ibd=PATH          Table for the record benchmarks\n"
+               "                      (default tests/types_test.ibd)\n"
+               "  --sdi=PATH          Its ibd2sdi JSON (default tests/types_test_sdi.json)\n"
+               "  --compressed=PATH   ROW_FORMAT=COMPRESSED tablespace for decompress_page\n"
+               "  --filter=SUBSTR     Only benchmarks whose name contains SUBSTR\n"
+               "  --min-time=SEC      Time per benchmark (default 1)\n"
+               "  --json              One JSON object per benchmark\n"
+               "  --label=STR         Copied into the JSON (e.g. a git revision)\n",
+               prog);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions opts;
+  opts.ibd = "tests/types_test.ibd";
+  opts.sdi = "tests/types_test_sdi.json";
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    auto value = [&](const char* name, std::string* out) {
+      const size_t n = std::strlen(name);
+      if (arg.compare(0, n, name) == 0 && arg.size() > n && arg[n] == '=') {
+        *out = arg.substr(n + 1);
+        return true;
+      }
+      return false;
+    };
+    std::string min_time;
+    if (value("--ibd", &opts.ibd) || value("--sdi", &opts.sdi) ||
+        value("--compressed", &opts.compressed) || value("--filter", &opts.filter) ||
+        value("--label", &opts.label)) {
+      continue;
+    }
+    if (value("--min-time", &min_time)) {
+      char* end = nullptr;
+      opts.min_time = std::strtod(min_time.c_str(), &end);
+      if (end == min_time.c_str() || *end != '\0' || opts.min_time <= 0) {
+        std::fprintf(stderr, "Invalid --min-time: %s\n", min_time.c_str());
+        return 1;
+      }
+    } else if (arg == "--json") {
+      opts.json = true;
+    } else if (arg == "-h" || arg == "--help") {
+      usage(argv[0]);
+      return 0;
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  my_init();
+  my_thread_init();
+  bench_decompress(opts);
+  bench_decrypt(opts);
+  bench_records(opts);
+  bench_text(opts);
+  bench_json(opts);
+  bench_schema(opts);
+  my_thread_end();
+  my_end(0);
+  return 0;
+}
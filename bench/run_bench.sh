@@ -0,0 +1,83 @@
+#!/bin/bash
+
+# Run the benchmark suite and print one JSON object per line.
+#
+# End to end: ib_parser 3 --stats=PATH over every tablespace in
+# $BENCH_DIR/manifest.tsv (see gen_bench_tablespaces.sh), once per output
+# format, best of $BENCH_REPEAT runs. Micro: ib_bench --json. Every line
+# carries the git revision (or $BENCH_LABEL), so results from different
+# releases can be appended to one file and compared:
+#
+#   bench/run_bench.sh >> bench/results.jsonl
+#
+# Environment: BENCH_DIR (default bench/data), BENCH_FORMATS (default
+# "pipe jsonl"), BENCH_THREADS (default 1), BENCH_REPEAT (default 3),
+# BENCH_MIN_TIME (ib_bench seconds per benchmark, default 1), BUILD_DIR.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PARSER_DIR="$(dirname "$SCRIPT_DIR")"
+BUILD_DIR=${BUILD_DIR:-$PARSER_DIR/build}
+BENCH_DIR=${BENCH_DIR:-$SCRIPT_DIR/data}
+BENCH_FORMATS=${BENCH_FORMATS:-"pipe jsonl"}
+BENCH_THREADS=${BENCH_THREADS:-1}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_MIN_TIME=${BENCH_MIN_TIME:-1}
+LABEL=${BENCH_LABEL:-$(git -C "$PARSER_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)}
+MANIFEST="$BENCH_DIR/manifest.tsv"
+
+if [ ! -x "$BUILD_DIR/ib_parser" ]; then
+    echo "No $BUILD_DIR/ib_parser; build first (cmake --build build)" >&2
+    exit 1
+fi
+
+STATS=$(mktemp)
+trap 'rm -f "$STATS"' EXIT
+
+if [ -f "$MANIFEST" ]; then
+    while IFS=$'\t' read -r scenario ibd sdi extra; do
+        key_args=()
+        if [ -n "$extra" ]; then
+            read -r key_id uuid keyring <<< "$extra"
+            key_args=(--keyring="$keyring" --master-key-id="$key_id" --server-uuid="$uuid")
+        fi
+        for format in $BENCH_FORMATS; do
+            best=""
+            for _ in $(seq 1 "$BENCH_REPEAT"); do
+                "$BUILD_DIR/ib_parser" 3 "$ibd" "$sdi" --format="$format" \
+                    --output=/dev/null --threads="$BENCH_THREADS" \
+                    "${key_args[@]}" --stats="$STATS" >/dev/null 2>&1 </dev/null
+                best=$(python3 - "$STATS" "$best" <<'EOF'
+import json, sys
+run = json.load(open(sys.argv[1]))
+best = json.loads(sys.argv[2]) if sys.argv[2] else None
+print(json.dumps(run if best is None or run["elapsed_s"] < best["elapsed_s"] else best))
+EOF
+)
+            done
+            python3 - "$best" "$scenario" "$format" "$BENCH_THREADS" "$LABEL" <<'EOF'
+import json, sys
+stats = json.loads(sys.argv[1])
+print(json.dumps({"bench": "e2e", "input": sys.argv[2], "format": sys.argv[3],
+                  "threads": int(sys.argv[4]), "label": sys.argv[5],
+                  "seconds": stats["elapsed_s"], "rows": stats["rows"],
+                  "rows_per_s": stats["rows_per_s"],
+                  "mb_per_s": stats["read_mib_per_s"], "stats": stats}))
+EOF
+        done
+    done < "$MANIFEST"
+else
+    echo "No $MANIFEST; run bench/gen_bench_tablespaces.sh for the e2e scenarios" >&2
+fi
+
+if [ -x "$BUILD_DIR/ib_bench" ]; then
+    compressed=""
+    if [ -f "$BENCH_DIR/zip8.ibd" ]; then
+        compressed="--compressed=$BENCH_DIR/zip8.ibd"
+    fi
+    cd "$PARSER_DIR"
+    "$BUILD_DIR/ib_bench" --json --label="$LABEL" --min-time="$BENCH_MIN_TIME" $compressed
+else
+    echo "No $BUILD_DIR/ib_bench; build it with: cmake --build build --target ib_bench" >&2
+fi
@@ -0,0 +1,409 @@
+/**
+ * charset_convert.cc
+ *
+ * Cached per-collation UTF-8 converters (see charset_convert.h).
+ */
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "my_sys.h"
+#include "m_string.h"
+#include "m_ctype.h"
+
+#include "charset_convert.h"
+
+namespace {
+
+// MY_ALL_CHARSETS_SIZE: collation ids are below this.
+const unsigned kMaxCollationId = 2048;
+
+std::atomic<const TextConverter*> g_converters[kMaxCollationId];
+std::mutex g_converters_mutex;
+
+const char kHexDigits[] = "0123456789ABCDEF";
+
+#if defined(__SSE2__)
+inline unsigned unprintable_mask16(const unsigned char* p) {
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  // Signed compare: bytes >= 0x80 are negative and fail the first test.
+  const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+                                          _mm_cmplt_epi8(v, _mm_set1_epi8(0x7F)));
+  return ~static_cast<unsigned>(_mm_movemask_epi8(printable)) & 0xFFFFu;
+}
+
+inline unsigned non_ascii_mask16(const unsigned char* p) {
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  return static_cast<unsigned>(_mm_movemask_epi8(v));
+}
+#elif defined(__ARM_NEON)
+inline unsigned neon_movemask(uint8x16_t m) {
+  // Narrow each 0x00/0xFF lane to one nibble, then find the first set one.
+  const uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+  const uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(nib), 0);
+  if (bits == 0) {
+    return 0;
+  }
+  return 1u << (__builtin_ctzll(bits) >> 2);
+}
+
+inline unsigned unprintable_mask16(const unsigned char* p) {
+  const uint8x16_t v = vld1q_u8(p);
+  return neon_movemask(vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)),
+                                vcgtq_u8(v, vdupq_n_u8(0x7E))));
+}
+
+inline unsigned non_ascii_mask16(const unsigned char* p) {
+  const uint8x16_t v = vld1q_u8(p);
+  return neon_movemask(vcgeq_u8(v, vdupq_n_u8(0x80)));
+}
+#endif
+
+inline void append_hex_escape(unsigned char c, std::string& out) {
+  const char esc[4] = {'\\', 'x', kHexDigits[c >> 4], kHexDigits[c & 0xF]};
+  out.append(esc, sizeof(esc));
+}
+
+// Copy p, escaping control bytes (and bytes >= 0x80 if escape_high).
+void append_escaped_bytes(const unsigned char* p, size_t n, bool escape_high,
+                          std::string& out) {
+  size_t i = 0;
+  while (i < n) {
+    const size_t run = find_text_unprintable(p + i, n - i);
+    out.append(reinterpret_cast<const char*>(p + i), run);
+    i += run;
+    if (i == n) {
+      break;
+    }
+    const unsigned char c = p[i++];
+    if (c >= 0x80 && !escape_high) {
+      out.push_back(static_cast<char>(c));
+    } else {
+      append_hex_escape(c, out);
+    }
+  }
+}
+
+// Length of the well-formed UTF-8 sequence at p (lead byte >= 0x80), or 0.
+// Stricter than MySQL's own decoder (no surrogates), so whatever passes
+// here converts to exactly the same bytes.
+size_t utf8_sequence(const unsigned char* p, size_t n, unsigned max_seq) {
+  const unsigned char c = p[0];
+  if (c < 0xC2) {
+    return 0;  // continuation byte or overlong lead
+  }
+  if (c < 0xE0) {
+    return (n >= 2 && (p[1] & 0xC0) == 0x80) ? 2 : 0;
+  }
+  if (c < 0xF0) {
+    if (max_seq < 3 || n < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) {
+      return 0;
+    }
+    if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] >= 0xA0)) {
+      return 0;  // overlong or surrogate
+    }
+    return 3;
+  }
+  if (max_seq < 4 || c > 0xF4 || n < 4 || (p[1] & 0xC0) != 0x80 ||
+      (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) {
+    return 0;
+  }
+  if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] >= 0x90)) {
+    return 0;  // overlong or above U+10FFFF
+  }
+  return 4;
+}
+
+// Bytes my_convert() looks at for the character starting with c: the
+// length a lead byte announces, 1 for anything it rejects on sight.
+size_t utf8_lead_length(unsigned char c, unsigned max_seq) {
+  if (c < 0xC2) {
+    return 1;
+  }
+  if (c < 0xE0) {
+    return 2;
+  }
+  if (c < 0xF0) {
+    return 3;
+  }
+  return (max_seq >= 4 && c < 0xF5) ? 4 : 1;
+}
+
+// Longest prefix of p that no character (well-formed or not) reaches past;
+// converting [0, cut) and the rest separately changes nothing.
+size_t utf8_safe_cut(const unsigned char* p, size_t n, unsigned max_seq) {
+  size_t cut = n;
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (size_t i = cut > 3 ? cut - 3 : 0; i < cut; i++) {
+      if (i + utf8_lead_length(p[i], max_seq) > cut) {
+        cut = i;
+        moved = true;
+        break;
+      }
+    }
+  }
+  return cut;
+}
+
+void convert_generic(const CHARSET_INFO* cs, const unsigned char* p, size_t len,
+                     std::string& out) {
+  const CHARSET_INFO* to_cs = &my_charset_utf8mb4_bin;
+  const size_t start = out.size();
+  const size_t cap = len * to_cs->mbmaxlen + 1;
+  out.resize(start + cap);
+  uint errors = 0;
+  const size_t n = my_convert(&out[start], cap, to_cs,
+                              reinterpret_cast<const char*>(p), len, cs, &errors);
+  out.resize(start + n);
+}
+
+void convert_generic_escaped(const CHARSET_INFO* cs, const unsigned char* p,
+                             size_t len, std::string& out) {
+  thread_local std::string converted;
+  converted.clear();
+  convert_generic(cs, p, len, converted);
+  append_escaped_bytes(reinterpret_cast<const unsigned char*>(converted.data()),
+                       converted.size(), false, out);
+}
+
+// false if a byte does not fit an Entry (never for real charsets).
+bool build_single_byte_tables(TextConverter* conv) {
+  conv->ascii_identity = true;
+  for (unsigned b = 0; b < 256; b++) {
+    const unsigned char in = static_cast<unsigned char>(b);
+    char buf[16];
+    uint errors = 0;
+    const size_t n = my_convert(buf, sizeof(buf), &my_charset_utf8mb4_bin,
+                                reinterpret_cast<const char*>(&in), 1, conv->cs,
+                                &errors);
+    std::string escaped;
+    append_escaped_bytes(reinterpret_cast<const unsigned char*>(buf), n, false,
+                         escaped);
+    TextConverter::Entry& plain = conv->utf8[b];
+    TextConverter::Entry& esc = conv->escaped[b];
+    if (n > sizeof(plain.bytes) || escaped.size() > sizeof(esc.bytes)) {
+      return false;
+    }
+    plain.len = static_cast<uint8_t>(n);
+    std::memcpy(plain.bytes, buf, n);
+    esc.len = static_cast<uint8_t>(escaped.size());
+    std::memcpy(esc.bytes, escaped.data(), escaped.size());
+    if (b < 0x80 && (n != 1 || static_cast<unsigned char>(buf[0]) != b)) {
+      conv->ascii_identity = false;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<TextConverter> build_converter(unsigned collation_id) {
+  std::unique_ptr<TextConverter> conv(new TextConverter());
+  conv->cs = get_charset(collation_id, MYF(0));
+  if (conv->cs == nullptr) {
+    return conv;
+  }
+  const char* csname = conv->cs->csname ? conv->cs->csname : "";
+  if (conv->cs->mbmaxlen == 1) {
+    conv->kind = build_single_byte_tables(conv.get()) ? TEXT_CONV_SINGLE_BYTE
+                                                      : TEXT_CONV_GENERIC;
+  } else if (std::strcmp(csname, "utf8mb4") == 0) {
+    conv->kind = TEXT_CONV_UTF8;
+    conv->max_seq = 4;
+  } else if (std::strcmp(csname, "utf8mb3") == 0 || std::strcmp(csname, "utf8") == 0) {
+    conv->kind = TEXT_CONV_UTF8;
+    conv->max_seq = 3;
+  } else {
+    conv->kind = TEXT_CONV_GENERIC;
+  }
+  return conv;
+}
+
+template <bool kEscape>
+void append_utf8_source(const TextConverter& conv, const unsigned char* p,
+                        size_t len, std::string& out) {
+  const size_t start = out.size();
+  size_t i = 0;
+  while (i < len) {
+    const size_t run = kEscape ? find_text_unprintable(p + i, len - i)
+                               : find_text_non_ascii(p + i, len - i);
+    out.append(reinterpret_cast<const char*>(p + i), run);
+    i += run;
+    if (i == len) {
+      return;
+    }
+    if (p[i] < 0x80) {
+      append_hex_escape(p[i++], out);  // only reached when escaping
+      continue;
+    }
+    const size_t seq = utf8_sequence(p + i, len - i, conv.max_seq);
+    if (seq == 0) {
+      // Malformed or cut short: let my_convert() decide, as it always did.
+      out.resize(start);
+      if (kEscape) {
+        convert_generic_escaped(conv.cs, p, len, out);
+      } else {
+        convert_generic(conv.cs, p, len, out);
+      }
+      return;
+    }
+    out.append(reinterpret_cast<const char*>(p + i), seq);
+    i += seq;
+  }
+}
+
+template <bool kEscape>
+void append_single_byte_source(const TextConverter& conv, const unsigned char* p,
+                               size_t len, std::string& out) {
+  const TextConverter::Entry* table = kEscape ? conv.escaped : conv.utf8;
+  size_t i = 0;
+  while (i < len) {
+    if (conv.ascii_identity) {
+      const size_t run = kEscape ? find_text_unprintable(p + i, len - i)
+                                 : find_text_non_ascii(p + i, len - i);
+      out.append(reinterpret_cast<const char*>(p + i), run);
+      i += run;
+      if (i == len) {
+        return;
+      }
+    }
+    const TextConverter::Entry& e = table[p[i++]];
+    out.append(e.bytes, e.len);
+  }
+}
+
+}  // namespace
+
+size_t find_text_unprintable(const unsigned char* p, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    const unsigned mask = unprintable_mask16(p + i);
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (p[i] < 0x20 || p[i] > 0x7E) {
+      return i;
+    }
+  }
+  return n;
+}
+
+size_t find_text_non_ascii(const unsigned char* p, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    const unsigned mask = non_ascii_mask16(p + i);
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (p[i] >= 0x80) {
+      return i;
+    }
+  }
+  return n;
+}
+
+const TextConverter* text_converter(unsigned collation_id) {
+  static const TextConverter raw{};
+  if (collation_id == 0 || collation_id >= kMaxCollationId) {
+    return &raw;
+  }
+  const TextConverter* conv = g_converters[collation_id].load(std::memory_order_acquire);
+  if (conv != nullptr) {
+    return conv;
+  }
+  std::lock_guard<std::mutex> lock(g_converters_mutex);
+  conv = g_converters[collation_id].load(std::memory_order_relaxed);
+  if (conv == nullptr) {
+    // Kept for the process: field definitions hold on to it.
+    conv = build_converter(collation_id).release();
+    g_converters[collation_id].store(conv, std::memory_order_release);
+  }
+  return conv;
+}
+
+void append_text_escaped(const TextConverter& conv, const unsigned char* p,
+                         size_t len, size_t max_len, std::string& out) {
+  const size_t n = len < max_len ? len : max_len;
+  if (n == 0) {
+    return;
+  }
+  out.reserve(out.size() + n + 16);
+  switch (conv.kind) {
+    case TEXT_CONV_RAW:
+      append_escaped_bytes(p, n, true, out);
+      break;
+    case TEXT_CONV_UTF8:
+      append_utf8_source<true>(conv, p, n, out);
+      break;
+    case TEXT_CONV_SINGLE_BYTE:
+      append_single_byte_source<true>(conv, p, n, out);
+      break;
+    case TEXT_CONV_GENERIC:
+      convert_generic_escaped(conv.cs, p, n, out);
+      break;
+  }
+  if (len > max_len) {
+    out.append("...(truncated)");
+  }
+}
+
+void TextEscapeStream::append(const unsigned char* p, size_t len,
+                              std::string& out) {
+  if (conv_.kind != TEXT_CONV_UTF8) {
+    append_text_escaped(conv_, p, len, len, out);  // one byte, one character
+    return;
+  }
+  const bool held = !pending_.empty();
+  if (held) {
+    pending_.append(reinterpret_cast<const char*>(p), len);
+    p = reinterpret_cast<const unsigned char*>(pending_.data());
+    len = pending_.size();
+  }
+  const size_t cut = utf8_safe_cut(p, len, conv_.max_seq);
+  append_text_escaped(conv_, p, cut, cut, out);
+  if (held) {
+    pending_.erase(0, cut);
+  } else {
+    pending_.assign(reinterpret_cast<const char*>(p + cut), len - cut);
+  }
+}
+
+void TextEscapeStream::finish(std::string& out) {
+  append_text_escaped(conv_, reinterpret_cast<const unsigned char*>(pending_.data()),
+                      pending_.size(), pending_.size(), out);
+  pending_.clear();
+}
+
+void append_text_utf8(const TextConverter& conv, const unsigned char* p,
+                      size_t len, std::string& out) {
+  out.reserve(out.size() + len);
+  switch (conv.kind) {
+    case TEXT_CONV_RAW:
+      out.append(reinterpret_cast<const char*>(p), len);
+      break;
+    case TEXT_CONV_UTF8:
+      append_utf8_source<false>(conv, p, len, out);
+      break;
+    case TEXT_CONV_SINGLE_BYTE:
+      append_single_byte_source<false>(conv, p, len, out);
+      break;
+    case TEXT_CONV_GENERIC:
+      convert_generic(conv.cs, p, len, out);
+      break;
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef CHARSET_CONVERT_H
+#define CHARSET_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct CHARSET_INFO;
+
+/**
+ * Character data to UTF-8 for the row formats.
+ *
+ * One TextConverter per collation, built on first use and kept for the
+ * process, so field_def_t can cache a pointer (compile_record_plan() sets
+ * text_conv) and copies of a table definition share it. Output is what
+ * my_convert() to utf8mb4 produces, but most values never reach it:
+ *
+ *   - runs of ASCII are found 16 bytes at a time (SSE2 / NEON) and copied
+ *   - utf8mb4 / utf8mb3 values are validated and copied as they are; the
+ *     encodings are identical, so only malformed input needs my_convert()
+ *   - latin1 and the other single-byte charsets go through a 256-entry
+ *     table of each byte's UTF-8, built from my_convert() itself
+ *
+ * Anything else (multi-byte charsets, malformed UTF-8, a value cut in the
+ * middle of a character) falls back to my_convert() with the cached
+ * CHARSET_INFO, so the result never depends on which path ran.
+ */
+enum TextConvKind {
+  TEXT_CONV_RAW = 0,      // no or unknown collation: bytes as stored
+  TEXT_CONV_UTF8,         // utf8mb4, utf8mb3
+  TEXT_CONV_SINGLE_BYTE,  // latin1, cp1250, ... (mbmaxlen == 1)
+  TEXT_CONV_GENERIC,      // everything else: my_convert()
+};
+
+struct TextConverter {
+  struct Entry {
+    uint8_t len;
+    char bytes[7];
+  };
+
+  TextConvKind kind = TEXT_CONV_RAW;
+  const CHARSET_INFO* cs = nullptr;
+  unsigned max_seq = 4;         // TEXT_CONV_UTF8: longest sequence (3 for utf8mb3)
+  bool ascii_identity = false;  // TEXT_CONV_SINGLE_BYTE: 0x00-0x7F map to themselves
+  Entry utf8[256];              // TEXT_CONV_SINGLE_BYTE: UTF-8 of each byte
+  Entry escaped[256];           // the same with control bytes as \xNN
+};
+
+// Converter for collation_id; never null. 0 and unknown ids give RAW.
+const TextConverter* text_converter(unsigned collation_id);
+
+/**
+ * Append up to max_len bytes of p as UTF-8 with control bytes escaped as
+ * \xNN (RAW also escapes bytes >= 0x80), then "...(truncated)" if len was
+ * longer. This is the text the pipe/CSV/JSONL formats print.
+ */
+void append_text_escaped(const TextConverter& conv, const unsigned char* p,
+                         size_t len, size_t max_len, std::string& out);
+
+/**
+ * append_text_escaped() for a value that arrives in pieces (a LOB read page
+ * by page). Each piece is converted up to the last point no character
+ * straddles and the few bytes after it wait for the next piece, so the
+ * output is exactly that of one call on the whole value. GENERIC
+ * converters have no cheap character boundary and are not supported.
+ */
+class TextEscapeStream {
+ public:
+  explicit TextEscapeStream(const TextConverter& conv) : conv_(conv) {}
+  static bool supported(const TextConverter& conv) {
+    return conv.kind != TEXT_CONV_GENERIC;
+  }
+
+  void append(const unsigned char* p, size_t len, std::string& out);
+  // End of the value: converts whatever is still held back.
+  void finish(std::string& out);
+
+ private:
+  const TextConverter& conv_;
+  std::string pending_;
+};
+
+// Append all of p as UTF-8, unescaped (typed output). RAW copies the bytes.
+void append_text_utf8(const TextConverter& conv, const unsigned char* p,
+                      size_t len, std::string& out);
+
+// Length of the leading bytes in [0x20, 0x7E], and of the leading bytes < 0x80.
+size_t find_text_unprintable(const unsigned char* p, size_t n);
+size_t find_text_non_ascii(const unsigned char* p, size_t n);
+
+#endif  // CHARSET_CONVERT_H
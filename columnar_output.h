@@ -0,0 +1,92 @@
+#ifndef COLUMNAR_OUTPUT_H
+#define COLUMNAR_OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Typed columnar output for mode 3 (--format=arrow|parquet).
+ *
+ * The record decoder appends native values (integers, decimals, epoch
+ * timestamps, raw bytes) column by column instead of formatting text;
+ * every row_group_rows rows the buffered columns are written out as one
+ * Arrow record batch or Parquet row group.
+ *
+ * Needs Apache Arrow (and Parquet) at build time: configure with
+ * -DWITH_ARROW=ON. Without it create() fails with an explanatory error.
+ * Not thread-safe; one writer per output file.
+ */
+enum ColumnarFormat {
+  COLUMNAR_ARROW = 0,   // Arrow IPC file (.arrow / Feather v2)
+  COLUMNAR_PARQUET
+};
+
+enum ColumnKind {
+  COLUMN_INT64 = 0,
+  COLUMN_UINT64,
+  COLUMN_FLOAT,
+  COLUMN_DOUBLE,
+  COLUMN_BOOL,
+  COLUMN_DECIMAL,       // decimal128(precision, scale)
+  COLUMN_DATE,          // date32, days since 1970-01-01
+  COLUMN_DATETIME,      // timestamp[us], no time zone
+  COLUMN_TIMESTAMP,     // timestamp[us, UTC]
+  COLUMN_UTF8,
+  COLUMN_BINARY
+};
+
+struct ColumnSpec {
+  std::string name;
+  ColumnKind kind = COLUMN_UTF8;
+  int precision = 0;    // COLUMN_DECIMAL only
+  int scale = 0;
+};
+
+class ColumnarWriter {
+ public:
+  ~ColumnarWriter();
+  ColumnarWriter(const ColumnarWriter&) = delete;
+  ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+  /** Whether this build can write columnar output at all. */
+  static bool available();
+
+  /** Open path for writing; nullptr (with *err set) on failure. */
+  static std::unique_ptr<ColumnarWriter> create(ColumnarFormat format,
+                                                const std::vector<ColumnSpec>& columns,
+                                                const std::string& path,
+                                                size_t row_group_rows,
+                                                std::string* err);
+
+  // One call per column, in schema order, then end_row().
+  void append_null(size_t col);
+  void append_int(size_t col, int64_t value);      // INT64, DATE, DATETIME, TIMESTAMP
+  void append_uint(size_t col, uint64_t value);
+  void append_double(size_t col, double value);    // FLOAT, DOUBLE
+  void append_bool(size_t col, bool value);
+  /** Decimal text such as "-12.50"; rescaled to the column scale. */
+  void append_decimal(size_t col, const std::string& text);
+  void append_bytes(size_t col, const void* data, size_t len);  // UTF8, BINARY
+
+  /** Close the row; writes a batch when row_group_rows are buffered. */
+  bool end_row();
+
+  /** Write the last partial batch and the file footer. */
+  bool finish();
+
+  uint64_t rows() const { return rows_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  struct Impl;
+  explicit ColumnarWriter(std::unique_ptr<Impl> impl);
+
+  std::unique_ptr<Impl> impl_;
+  uint64_t rows_ = 0;
+  std::string error_;
+};
+
+#endif  // COLUMNAR_OUTPUT_H
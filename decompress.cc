@@ -30,11 +30,15 @@
 #include <string.h>
 #include <algorithm>
 #include <cctype>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <zlib.h>
@@ -45,6 +49,7 @@
 #include "my_getopt.h"
 #include "my_io.h"
 #include "my_sys.h"
+#include "my_thread.h"
 #include "mysql_com.h"
 //#include "mysys.h"
 #include "print_version.h"
@@ -79,7 +84,11 @@ namespace rapidjson { typedef ::std::size_t SizeType; }
 #include "univ.i"
 #include "ut0byte.h"
 #include "ut0crc32.h"
+#include "mysql_crc32c.h"
 #include "m_ctype.h"
+#include "page_pipeline.h"
+#include "parser_log.h"
+#include "sdi_reader.h"
 //#include "page/zipdecompress.h" // Has page_zip_decompress_low()
 
 /*
@@ -400,11 +409,11 @@ bool should_decompress_page(const unsigned char* page_data,
   if (page_type == FIL_PAGE_INDEX ||
       page_type == FIL_PAGE_RTREE ||
       page_type == FIL_PAGE_SDI) {
-    fprintf(stderr, "  [DEBUG] Page should be decompressed (type=%u in compressed tablespace)\n", page_type);
+    PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Page should be decompressed (type=%u in compressed tablespace)\n", page_type);
     return true;
   }
   
-  fprintf(stderr, "  [DEBUG] Page type %u in compressed tablespace - metadata page, no decompression needed\n", page_type);
+  PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Page type %u in compressed tablespace - metadata page, no decompression needed\n", page_type);
   return false;
 }
 
@@ -480,8 +489,8 @@ static bool sdi_read_uint64(const rapidjson::Value& val, uint64_t* out) {
   return false;
 }
 
-static bool load_sdi_json_entries(const char* json_path,
-                                  std::vector<SdiEntry>& entries) {
+// Parse an ibd2sdi JSON file (a top-level array) into *doc.
+static bool parse_sdi_json_file(const char* json_path, rapidjson::Document* doc) {
   std::ifstream ifs(json_path);
   if (!ifs.is_open()) {
     fprintf(stderr, "Error: cannot open SDI JSON file: %s\n", json_path);
@@ -489,20 +498,47 @@ static bool load_sdi_json_entries(const char* json_path,
   }
 
   rapidjson::IStreamWrapper isw(ifs);
-  rapidjson::Document doc;
-  doc.ParseStream(isw);
-  if (doc.HasParseError()) {
+  doc->ParseStream(isw);
+  if (doc->HasParseError()) {
     fprintf(stderr, "Error: SDI JSON parse error: %s at offset %zu\n",
-            rapidjson::GetParseError_En(doc.GetParseError()),
-            doc.GetErrorOffset());
+            rapidjson::GetParseError_En(doc->GetParseError()),
+            doc->GetErrorOffset());
     return false;
   }
 
-  if (!doc.IsArray()) {
+  if (!doc->IsArray()) {
     fprintf(stderr, "Error: SDI JSON top-level is not an array.\n");
     return false;
   }
+  return true;
+}
+
+// The same document built from the SDI pages of the tablespace on fd.
+static bool parse_sdi_from_tablespace(File fd, rapidjson::Document* doc) {
+  std::vector<SdiRecord> records;
+  std::string json;
+  std::string err;
+  if (!read_tablespace_sdi(fd, nullptr, &records, &err) ||
+      !sdi_records_to_json(records, &json, &err)) {
+    fprintf(stderr, "Error: cannot read SDI from the input tablespace: %s\n",
+            err.c_str());
+    return false;
+  }
+  doc->Parse(json.data(), json.size());
+  if (doc->HasParseError() || !doc->IsArray()) {
+    fprintf(stderr, "Error: tablespace SDI is not valid JSON: %s at offset %zu\n",
+            rapidjson::GetParseError_En(doc->GetParseError()),
+            doc->GetErrorOffset());
+    return false;
+  }
+  fprintf(stderr, "Read %zu SDI records from the input tablespace\n",
+          records.size());
+  return true;
+}
 
+static bool sdi_entries_from_document(const rapidjson::Document& doc,
+                                      const char* source,
+                                      std::vector<SdiEntry>& entries) {
   entries.clear();
   for (const auto& elem : doc.GetArray()) {
     if (elem.IsString()) {
@@ -532,7 +568,7 @@ static bool load_sdi_json_entries(const char* json_path,
   }
 
   if (entries.empty()) {
-    fprintf(stderr, "Error: no SDI records found in %s\n", json_path);
+    fprintf(stderr, "Error: no SDI records found in %s\n", source);
     return false;
   }
 
@@ -1099,32 +1135,12 @@ static bool load_index_id_map_file(
   return true;
 }
 
-static bool load_sdi_metadata(const char* json_path, SdiMetadata* meta) {
+static bool sdi_metadata_from_document(const rapidjson::Document& doc,
+                                       SdiMetadata* meta) {
   if (meta == nullptr) {
     return false;
   }
 
-  std::ifstream ifs(json_path);
-  if (!ifs.is_open()) {
-    fprintf(stderr, "Error: cannot open SDI JSON file: %s\n", json_path);
-    return false;
-  }
-
-  rapidjson::IStreamWrapper isw(ifs);
-  rapidjson::Document doc;
-  doc.ParseStream(isw);
-  if (doc.HasParseError()) {
-    fprintf(stderr, "Error: SDI JSON parse error: %s at offset %zu\n",
-            rapidjson::GetParseError_En(doc.GetParseError()),
-            doc.GetErrorOffset());
-    return false;
-  }
-
-  if (!doc.IsArray()) {
-    fprintf(stderr, "Error: SDI JSON top-level is not an array.\n");
-    return false;
-  }
-
   meta->has_table = false;
   meta->has_tablespace = false;
 
@@ -1299,6 +1315,12 @@ static bool load_sdi_metadata(const char* json_path, SdiMetadata* meta) {
   return true;
 }
 
+static bool load_sdi_metadata(const char* json_path, SdiMetadata* meta) {
+  rapidjson::Document doc;
+  return parse_sdi_json_file(json_path, &doc) &&
+         sdi_metadata_from_document(doc, meta);
+}
+
 bool validate_index_id_remap(const char* source_sdi_json_path,
                              const char* target_sdi_json_path,
                              const char* index_id_map_path) {
@@ -3165,19 +3187,23 @@ bool decompress_page_inplace(
     if (!should_decompress) {
         // For non-compressed tablespaces OR metadata pages in compressed tablespaces:
         // Copy as-is at physical size (metadata pages are naturally at physical size)
-        fprintf(stderr, "  [DEBUG] Copying page as-is at physical size (type=%u, size=%zu)\n", page_type, physical_size);
+        PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Copying page as-is at physical size (type=%u, size=%zu)\n", page_type, physical_size);
         memcpy(out_buf, src_buf, physical_size);
         *actual_size = physical_size;
         return true;
     }
 
     // This is an INDEX or RTREE page in a compressed tablespace - decompress it
-    fprintf(stderr, "  [DEBUG] Decompressing page (type=%u, phys=%zu->logical=%zu)\n",
-            page_type, physical_size, logical_size);
+    PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Decompressing page (type=%u, phys=%zu->logical=%zu)\n",
+               page_type, physical_size, logical_size);
 
-    // Allocate temporary buffer for decompressed data
-    unsigned char* temp = (unsigned char*)ut::malloc(2 * logical_size);
-    unsigned char* aligned_temp = (unsigned char*)ut_align(temp, logical_size);
+    // page_zip_decompress_low() needs a page-aligned frame; one per thread,
+    // grown to the largest page size seen, instead of a malloc per page.
+    thread_local std::vector<unsigned char> temp;
+    if (temp.size() < 2 * logical_size) {
+        temp.resize(2 * logical_size);
+    }
+    unsigned char* aligned_temp = (unsigned char*)ut_align(temp.data(), logical_size);
     memset(aligned_temp, 0, logical_size);
 
     // Set up the page_zip descriptor
@@ -3191,47 +3217,48 @@ bool decompress_page_inplace(
     if (page_type == FIL_PAGE_INDEX) {
         success = page_zip_decompress_low(&page_zip, aligned_temp, true);
         if (success) {
-            fprintf(stderr, "  [DEBUG] Successfully decompressed INDEX page\n");
+            PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Successfully decompressed INDEX page\n");
             memcpy(out_buf, aligned_temp, logical_size);
             *actual_size = logical_size;
         } else {
-            fprintf(stderr, "  [ERROR] Failed to decompress INDEX page\n");
+            PARSER_LOG(LOG_LEVEL_ERROR, "  [ERROR] Failed to decompress INDEX page\n");
         }
     } else if (page_type == FIL_PAGE_RTREE) {
         // FIL_PAGE_RTREE - treat similarly to INDEX
-        fprintf(stderr, "  [DEBUG] Attempting RTREE decompression (experimental)\n");
+        PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Attempting RTREE decompression (experimental)\n");
         success = page_zip_decompress_low(&page_zip, aligned_temp, true);
         if (success) {
             memcpy(out_buf, aligned_temp, logical_size);
             *actual_size = logical_size;
         } else {
-            fprintf(stderr, "  [WARNING] RTREE decompression failed, copying as-is\n");
+            PARSER_LOG(LOG_LEVEL_WARN, "  [WARNING] RTREE decompression failed, copying as-is\n");
             memcpy(out_buf, src_buf, physical_size);
             *actual_size = physical_size;
             success = true; // Don't fail the whole operation
         }
     } else {
         // FIL_PAGE_SDI - treat like INDEX
-        fprintf(stderr, "  [DEBUG] Decompressing SDI page\n");
+        PARSER_LOG(LOG_LEVEL_TRACE, "  [DEBUG] Decompressing SDI page\n");
         success = page_zip_decompress_low(&page_zip, aligned_temp, true);
         if (success) {
             memcpy(out_buf, aligned_temp, logical_size);
             *actual_size = logical_size;
         } else {
-            fprintf(stderr, "  [ERROR] Failed to decompress SDI page\n");
+            PARSER_LOG(LOG_LEVEL_ERROR, "  [ERROR] Failed to decompress SDI page\n");
         }
     }
 
-    ut::free(temp);
     return success;
 }
 
+// Same value as buf_calc_page_crc32(); goes through the dispatched
+// (hardware, 3-way interleaved) mysql_crc32c.
 static uint32_t calc_page_crc32(const unsigned char* page, size_t page_size) {
-  const uint32_t c1 = ut_crc32(page + FIL_PAGE_OFFSET,
-                               FIL_PAGE_FILE_FLUSH_LSN - FIL_PAGE_OFFSET);
-  const uint32_t c2 = ut_crc32(page + FIL_PAGE_DATA,
-                               page_size - FIL_PAGE_DATA -
-                                   FIL_PAGE_END_LSN_OLD_CHKSUM);
+  const uint32_t c1 = mysql_crc32c(page + FIL_PAGE_OFFSET,
+                                   FIL_PAGE_FILE_FLUSH_LSN - FIL_PAGE_OFFSET);
+  const uint32_t c2 = mysql_crc32c(page + FIL_PAGE_DATA,
+                                   page_size - FIL_PAGE_DATA -
+                                       FIL_PAGE_END_LSN_OLD_CHKSUM);
   return (c1 ^ c2);
 }
 
@@ -3328,11 +3355,12 @@ static const char* get_page_type_name(uint16_t page_type) {
 }
 
 // ----------------------------------------------------------------
-// fetch_page() calls decompress_page_inplace() to get the final
-// processed data into 'uncompressed_buf' and returns actual size used
+// fetch_page() calls decompress_page_inplace() on the raw page handed
+// over by the read-ahead queue to get the final processed data into
+// 'uncompressed_buf' and returns actual size used
 // ----------------------------------------------------------------
 static bool fetch_page(
-    File file_in,
+    const unsigned char *disk_buf,
     page_no_t page_no,
     const page_size_t &page_sz,
     unsigned char *uncompressed_buf,
@@ -3345,25 +3373,6 @@ static bool fetch_page(
     fprintf(stderr, "[Page %u] Reading page (physical size=%zu, logical size=%zu)\n", 
             page_no, psize, logical_sz);
 
-    // Allocate a buffer for the raw on-disk page (psize bytes).
-    unsigned char* disk_buf = (unsigned char*)malloc(psize);
-    if (!disk_buf) {
-        fprintf(stderr, "Out of memory for disk_buf\n");
-        return false;
-    }
-
-    // 1) Read the page from disk
-    if (!seek_page(file_in, page_sz, page_no)) {
-        free(disk_buf);
-        return false;
-    }
-    size_t r = my_read(file_in, disk_buf, psize, MYF(0));
-    if (r != psize) {
-        fprintf(stderr, "Could not read physical page %u correctly.\n", page_no);
-        free(disk_buf);
-        return false;
-    }
-
     // Get page type for debug info
     uint16_t page_type = mach_read_from_2(disk_buf + FIL_PAGE_TYPE);
     fprintf(stderr, "[Page %u] Page type: %u (%s)\n", 
@@ -3385,7 +3394,6 @@ static bool fetch_page(
         fprintf(stderr, "[Page %u] Processing failed!\n", page_no);
     }
 
-    free(disk_buf);
     return ok;
 }
 
@@ -3427,7 +3435,8 @@ bool decompress_ibd(File in_fd, File out_fd)
           page_physical != page_logical ? (double)page_logical/page_physical : 1.0);
   fprintf(stderr, "========================================\n\n");
 
-  // 4) For each page, fetch + decompress, then write out
+  // 4) For each page, fetch + decompress, then write out. Reads run ahead
+  //    and writes trail behind on their own queues.
   size_t buf_size = std::max(pg_sz.physical(), pg_sz.logical());
   unsigned char* page_buf = (unsigned char*)malloc(buf_size);
   if (!page_buf) {
@@ -3436,6 +3445,16 @@ bool decompress_ibd(File in_fd, File out_fd)
     return false;
   }
 
+  const PageIoOptions io_opts = page_io_options_from_env();
+  PageReadAhead reader;
+  PageWriteBehind writer;
+  if (!reader.start(in_fd, pg_sz.physical(), num_pages, io_opts) ||
+      !writer.start(out_fd, io_opts.batch_pages * buf_size, io_opts)) {
+    fprintf(stderr, "Cannot start page I/O: %s\n", reader.error().c_str());
+    free(page_buf);
+    return false;
+  }
+
   // Statistics counters
   uint64_t pages_processed = 0;
   uint64_t pages_compressed = 0;
@@ -3443,8 +3462,15 @@ bool decompress_ibd(File in_fd, File out_fd)
   uint64_t pages_written = 0;
 
   for (uint64_t i = 0; i < num_pages; i++) {
+    uint64_t read_page_no = 0;
+    const unsigned char* disk_page = reader.next(&read_page_no);
+    if (disk_page == nullptr) {
+      fprintf(stderr, "[ERROR] %s\n", reader.error().c_str());
+      pages_failed += num_pages - i;
+      break;
+    }
     size_t actual_page_size = 0;
-    if (!fetch_page(in_fd, (page_no_t)i, pg_sz, page_buf, buf_size, &actual_page_size)) {
+    if (!fetch_page(disk_page, (page_no_t)i, pg_sz, page_buf, buf_size, &actual_page_size)) {
       fprintf(stderr, "[ERROR] Failed to process page %llu.\n",
               (unsigned long long)i);
       pages_failed++;
@@ -3459,10 +3485,9 @@ bool decompress_ibd(File in_fd, File out_fd)
       }
       
       // Write out the processed page at its actual size
-      size_t w = my_write(out_fd, (uchar*)page_buf, actual_page_size, MYF(0));
-      if (w != actual_page_size) {
-        fprintf(stderr, "[ERROR] Write failed on page %llu (wrote %zu of %zu bytes).\n", 
-                (unsigned long long)i, w, actual_page_size);
+      if (!writer.write(page_buf, actual_page_size)) {
+        fprintf(stderr, "[ERROR] Write failed at or before page %llu: %s\n",
+                (unsigned long long)i, writer.error().c_str());
         free(page_buf);
         return false;
       }
@@ -3478,6 +3503,12 @@ bool decompress_ibd(File in_fd, File out_fd)
     }
   }
 
+  if (!writer.finish()) {
+    fprintf(stderr, "[ERROR] Write failed: %s\n", writer.error().c_str());
+    free(page_buf);
+    return false;
+  }
+
   // Final summary
   fprintf(stderr, "\n========================================\n");
   fprintf(stderr, "DECOMPRESSION COMPLETE\n");
@@ -3502,11 +3533,143 @@ bool decompress_ibd(File in_fd, File out_fd)
   return pages_failed == 0;
 }
 
+// ----------------------------------------------------------------
+// RebuildPool: mode 5 page transforms on worker threads
+// ----------------------------------------------------------------
+// Pages a worker claims at a time; keeps the shared counter off the hot path.
+static const size_t kRebuildClaimPages = 8;
+
+/**
+ * Runs one transform over every page of a batch on n_threads workers, the
+ * way PageDecryptPool does for mode 1. submit() returns at once so the
+ * caller can read the next batch; wait() blocks until this one is done.
+ * Each page is written only by the worker that claimed it, so the batch
+ * comes back in file order whatever the thread count.
+ */
+class RebuildPool {
+ public:
+  // Transform page i of the current batch; false marks it failed.
+  using PageFn = std::function<bool(size_t)>;
+
+  explicit RebuildPool(unsigned n_threads) {
+    if (n_threads == 0) {
+      n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < n_threads; i++) {
+      workers_.emplace_back(&RebuildPool::worker_loop, this);
+    }
+  }
+  RebuildPool(const RebuildPool&) = delete;
+  RebuildPool& operator=(const RebuildPool&) = delete;
+
+  ~RebuildPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& t : workers_) {
+      t.join();
+    }
+  }
+
+  void submit(size_t n_pages, const PageFn* fn) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      fn_ = fn;
+      n_pages_ = n_pages;
+      next_page_ = 0;
+      done_pages_ = 0;
+      bad_page_ = SIZE_MAX;
+    }
+    work_cv_.notify_all();
+  }
+
+  /** false if a page failed; *bad_page is the first such index. */
+  bool wait(size_t* bad_page) {
+    std::unique_lock<std::mutex> lock(mu_);
+    done_cv_.wait(lock, [&] { return done_pages_ == n_pages_; });
+    *bad_page = bad_page_;
+    return bad_page_ == SIZE_MAX;
+  }
+
+  unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+
+ private:
+  void worker_loop() {
+    my_thread_init();
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      work_cv_.wait(lock, [&] { return stopping_ || next_page_ < n_pages_; });
+      if (stopping_) {
+        break;
+      }
+      const size_t first = next_page_;
+      const size_t count = std::min(kRebuildClaimPages, n_pages_ - first);
+      next_page_ += count;
+      const PageFn* fn = fn_;
+      lock.unlock();
+
+      size_t bad = SIZE_MAX;
+      for (size_t i = first; i < first + count; i++) {
+        if (!(*fn)(i) && bad == SIZE_MAX) {
+          bad = i;
+        }
+      }
+
+      lock.lock();
+      if (bad < bad_page_) {
+        bad_page_ = bad;
+      }
+      done_pages_ += count;
+      if (done_pages_ == n_pages_) {
+        done_cv_.notify_all();
+      }
+    }
+    lock.unlock();
+    my_thread_end();
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+
+  // Current batch, guarded by mu_
+  const PageFn* fn_ = nullptr;
+  size_t n_pages_ = 0;
+  size_t next_page_ = 0;
+  size_t done_pages_ = 0;
+  size_t bad_page_ = SIZE_MAX;
+};
+
+// Index-id remap, space id and checksum: the part of a page's rebuild that
+// comes after any SDI fix-up.
+static void finish_rebuilt_page(
+    unsigned char* page, size_t page_size, space_id_t space_id,
+    const std::unordered_map<uint64_t, uint64_t>& index_id_remap) {
+  if (!index_id_remap.empty()) {
+    const uint16_t page_type = mach_read_from_2(page + FIL_PAGE_TYPE);
+    if (page_type == FIL_PAGE_INDEX || page_type == FIL_PAGE_RTREE) {
+      const uint64_t old_id = mach_read_from_8(page + PAGE_HEADER + PAGE_INDEX_ID);
+      auto it = index_id_remap.find(old_id);
+      if (it != index_id_remap.end()) {
+        mach_write_to_8(page + PAGE_HEADER + PAGE_INDEX_ID, it->second);
+      }
+    }
+  }
+
+  mach_write_to_4(page + FIL_PAGE_ARCH_LOG_NO_OR_SPACE_ID, space_id);
+  stamp_page_lsn_and_crc32(page, page_size, 0);
+}
+
 // ----------------------------------------------------------------
 // Experimental: rebuild compressed tablespace into 16KB pages
 // ----------------------------------------------------------------
 bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
                               const char* source_sdi_json_path,
+                              bool source_sdi_from_ibd,
                               const char* target_sdi_json_path,
                               const char* index_id_map_path,
                               const char* cfg_out_path,
@@ -3518,7 +3681,8 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
                               bool use_target_space_id,
                               bool use_source_space_id,
                               bool target_space_id_override_set,
-                              uint32_t target_space_id_override)
+                              uint32_t target_space_id_override,
+                              unsigned n_threads)
 {
   MY_STAT stat_info;
   if (my_fstat(in_fd, &stat_info) != 0) {
@@ -3551,18 +3715,20 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
   }
 
   ut_crc32_init();
+  mysql_crc32c_init();
 
   const uint64_t total_bytes = stat_info.st_size;
   const uint64_t num_pages = total_bytes / physical_size;
 
-  std::unique_ptr<unsigned char[]> in_buf(new unsigned char[physical_size]);
   std::unique_ptr<unsigned char[]> out_buf(new unsigned char[logical_size]);
 
+  const char* source_sdi_label =
+      source_sdi_from_ibd ? "(input tablespace)" : source_sdi_json_path;
   const char* output_sdi_json_path =
       (target_sdi_json_path != nullptr) ? target_sdi_json_path
-                                        : source_sdi_json_path;
+                                        : source_sdi_label;
   const bool have_output_sdi_json = (output_sdi_json_path != nullptr);
-  const bool have_source_sdi_json = (source_sdi_json_path != nullptr);
+  const bool have_source_sdi_json = (source_sdi_label != nullptr);
   const bool have_target_sdi_json = (target_sdi_json_path != nullptr);
 
   std::vector<SdiEntry> sdi_entries;
@@ -3586,22 +3752,31 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
   bool have_source_meta = false;
   bool have_target_meta = false;
 
+  // Each SDI source is parsed once, for its metadata and its records.
+  rapidjson::Document source_doc;
+  rapidjson::Document target_doc;
+
   if (have_source_sdi_json) {
-    if (!load_sdi_metadata(source_sdi_json_path, &source_meta)) {
+    const bool parsed = source_sdi_from_ibd
+                            ? parse_sdi_from_tablespace(in_fd, &source_doc)
+                            : parse_sdi_json_file(source_sdi_json_path, &source_doc);
+    if (!parsed || !sdi_metadata_from_document(source_doc, &source_meta)) {
       return false;
     }
     have_source_meta = true;
   }
 
   if (have_target_sdi_json) {
-    if (!load_sdi_metadata(target_sdi_json_path, &target_meta)) {
+    if (!parse_sdi_json_file(target_sdi_json_path, &target_doc) ||
+        !sdi_metadata_from_document(target_doc, &target_meta)) {
       return false;
     }
     have_target_meta = true;
   }
 
   if (have_output_sdi_json) {
-    if (!load_sdi_json_entries(output_sdi_json_path, sdi_entries)) {
+    if (!sdi_entries_from_document(have_target_sdi_json ? target_doc : source_doc,
+                                   output_sdi_json_path, sdi_entries)) {
       return false;
     }
     if (!collect_sdi_blob_pages(in_fd, pg_sz, num_pages, &sdi_blob_pages)) {
@@ -3747,6 +3922,7 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
   }
 
   space_id_t space_id = SPACE_UNKNOWN;
+  RebuildPool pool(n_threads);
 
   fprintf(stderr, "\n========================================\n");
   fprintf(stderr, "REBUILD STARTING (EXPERIMENTAL)\n");
@@ -3756,204 +3932,283 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
   fprintf(stderr, "Physical page size: %zu, Logical page size: %zu\n",
           physical_size, logical_size);
   fprintf(stderr, "Total pages: %llu\n", (unsigned long long)num_pages);
+  fprintf(stderr, "Rebuild threads: %u\n", pool.threads());
   fprintf(stderr, "========================================\n\n");
 
-  for (uint64_t page_no = 0; page_no < num_pages; ++page_no) {
-    if (!seek_page(in_fd, pg_sz, static_cast<page_no_t>(page_no))) {
-      return false;
-    }
+  // Page 0 is rebuilt here first: it decides the space id every other page
+  // is stamped with. The rest go through the pool in batches, two of them
+  // in flight: while workers expand one, the next is read. The SDI root is
+  // fixed up on this thread once its batch is back, and batches are written
+  // in file order, so the output does not depend on the thread count.
+  const PageIoOptions io_opts = page_io_options_from_env();
+  const size_t batch_pages = std::max<size_t>(io_opts.batch_pages, 1) * 4;
+  PageReadAhead reader;
+  PageWriteBehind writer;
+  if (!reader.start(in_fd, physical_size, num_pages, io_opts) ||
+      !writer.start(out_fd, batch_pages * logical_size, io_opts)) {
+    fprintf(stderr, "Cannot start page I/O: %s\n", reader.error().c_str());
+    return false;
+  }
 
-    size_t r = my_read(in_fd, in_buf.get(), physical_size, MYF(0));
-    if (r != physical_size) {
-      fprintf(stderr, "Failed to read page %llu.\n",
-              (unsigned long long)page_no);
+  {
+    uint64_t read_page_no = 0;
+    const unsigned char* in_page = reader.next(&read_page_no);
+    if (in_page == nullptr) {
+      fprintf(stderr, "Failed to read page 0: %s\n", reader.error().c_str());
       return false;
     }
 
     size_t actual_size = 0;
-    if (!decompress_page_inplace(in_buf.get(), physical_size, logical_size,
+    if (!decompress_page_inplace(in_page, physical_size, logical_size,
                                  out_buf.get(), logical_size, &actual_size)) {
-      fprintf(stderr, "Failed to decompress page %llu.\n",
-              (unsigned long long)page_no);
+      fprintf(stderr, "Failed to decompress page 0.\n");
       return false;
     }
 
-    if (page_no == 0) {
-      if (have_output_sdi_json) {
-        const uint32_t old_flags = fsp_header_get_flags(in_buf.get());
-        if (!FSP_FLAGS_HAS_SDI(old_flags)) {
-          fprintf(stderr,
-                  "Error: SDI JSON provided but tablespace has no SDI flag.\n");
-          return false;
-        }
-        const page_size_t old_page_size(old_flags);
-        const ulint sdi_offset = fsp_header_get_sdi_offset(old_page_size);
-        const uint32_t sdi_version =
-            mach_read_from_4(in_buf.get() + sdi_offset);
-        source_sdi_root_page = mach_read_from_4(in_buf.get() + sdi_offset + 4);
-        sdi_root_page = source_sdi_root_page;
-        if (target_sdi_root_set &&
-            (target_sdi_root_page == 0 || target_sdi_root_page == FIL_NULL)) {
-          fprintf(stderr,
-                  "Warning: target SDI root page is invalid (%u); ignoring.\n",
-                  static_cast<unsigned int>(target_sdi_root_page));
-          target_sdi_root_set = false;
-        }
-        if (target_sdi_root_set &&
-            target_sdi_root_page != source_sdi_root_page) {
-          fprintf(stderr,
-                  "Warning: SDI root mismatch (source=%u target=%u).\n",
-                  static_cast<unsigned int>(source_sdi_root_page),
-                  static_cast<unsigned int>(target_sdi_root_page));
-          if (use_target_sdi_root) {
-            sdi_root_page = target_sdi_root_page;
-            fprintf(stderr,
-                    "         Using target SDI root page as requested.\n");
-          } else {
-            fprintf(stderr,
-                    "         Using source SDI root page (default).\n");
-          }
-        } else if (use_target_sdi_root && target_sdi_root_set) {
-          sdi_root_page = target_sdi_root_page;
-        }
-        if (use_source_sdi_root) {
-          sdi_root_page = source_sdi_root_page;
-        }
-        sdi_root_set = (sdi_root_page != 0 && sdi_root_page != FIL_NULL);
+    if (have_output_sdi_json) {
+      const uint32_t old_flags = fsp_header_get_flags(in_page);
+      if (!FSP_FLAGS_HAS_SDI(old_flags)) {
         fprintf(stderr,
-                "SDI header: version=%u root_page=%u (json=%s)\n",
-                sdi_version, sdi_root_page,
-                output_sdi_json_path ? output_sdi_json_path : "(none)");
-      }
-
-      if (!update_tablespace_header_for_uncompressed(out_buf.get(),
-                                                     logical_size,
-                                                     &source_space_id)) {
+                "Error: SDI JSON provided but tablespace has no SDI flag.\n");
         return false;
       }
-      space_id = source_space_id;
-
-      if (target_space_id_set &&
-          (target_space_id == 0 || target_space_id == SPACE_UNKNOWN)) {
+      const page_size_t old_page_size(old_flags);
+      const ulint sdi_offset = fsp_header_get_sdi_offset(old_page_size);
+      const uint32_t sdi_version =
+          mach_read_from_4(in_page + sdi_offset);
+      source_sdi_root_page = mach_read_from_4(in_page + sdi_offset + 4);
+      sdi_root_page = source_sdi_root_page;
+      if (target_sdi_root_set &&
+          (target_sdi_root_page == 0 || target_sdi_root_page == FIL_NULL)) {
         fprintf(stderr,
-                "Warning: target space_id is invalid (%u); ignoring.\n",
-                static_cast<unsigned int>(target_space_id));
-        target_space_id_set = false;
+                "Warning: target SDI root page is invalid (%u); ignoring.\n",
+                static_cast<unsigned int>(target_sdi_root_page));
+        target_sdi_root_set = false;
       }
-
-      if (target_space_id_set && target_space_id != source_space_id) {
+      if (target_sdi_root_set &&
+          target_sdi_root_page != source_sdi_root_page) {
         fprintf(stderr,
-                "Warning: space_id mismatch (source=%u target=%u).\n",
-                static_cast<unsigned int>(source_space_id),
-                static_cast<unsigned int>(target_space_id));
-        if (use_target_space_id) {
-          space_id = target_space_id;
+                "Warning: SDI root mismatch (source=%u target=%u).\n",
+                static_cast<unsigned int>(source_sdi_root_page),
+                static_cast<unsigned int>(target_sdi_root_page));
+        if (use_target_sdi_root) {
+          sdi_root_page = target_sdi_root_page;
           fprintf(stderr,
-                  "         Using target space_id as requested.\n");
+                  "         Using target SDI root page as requested.\n");
         } else {
           fprintf(stderr,
-                  "         Using source space_id (default).\n");
+                  "         Using source SDI root page (default).\n");
         }
-      } else if (use_target_space_id && target_space_id_set) {
-        space_id = target_space_id;
+      } else if (use_target_sdi_root && target_sdi_root_set) {
+        sdi_root_page = target_sdi_root_page;
       }
-
-      if (use_source_space_id) {
-        space_id = source_space_id;
+      if (use_source_sdi_root) {
+        sdi_root_page = source_sdi_root_page;
       }
+      sdi_root_set = (sdi_root_page != 0 && sdi_root_page != FIL_NULL);
+      fprintf(stderr,
+              "SDI header: version=%u root_page=%u (json=%s)\n",
+              sdi_version, sdi_root_page,
+              output_sdi_json_path ? output_sdi_json_path : "(none)");
+    }
+
+    if (!update_tablespace_header_for_uncompressed(out_buf.get(),
+                                                   logical_size,
+                                                   &source_space_id)) {
+      return false;
+    }
+    space_id = source_space_id;
+
+    if (target_space_id_set &&
+        (target_space_id == 0 || target_space_id == SPACE_UNKNOWN)) {
+      fprintf(stderr,
+              "Warning: target space_id is invalid (%u); ignoring.\n",
+              static_cast<unsigned int>(target_space_id));
+      target_space_id_set = false;
+    }
 
-      if (space_id != source_space_id) {
-        fsp_header_set_field(out_buf.get(), FSP_SPACE_ID, space_id);
+    if (target_space_id_set && target_space_id != source_space_id) {
+      fprintf(stderr,
+              "Warning: space_id mismatch (source=%u target=%u).\n",
+              static_cast<unsigned int>(source_space_id),
+              static_cast<unsigned int>(target_space_id));
+      if (use_target_space_id) {
+        space_id = target_space_id;
+        fprintf(stderr,
+                "         Using target space_id as requested.\n");
+      } else {
+        fprintf(stderr,
+                "         Using source space_id (default).\n");
       }
+    } else if (use_target_space_id && target_space_id_set) {
+      space_id = target_space_id;
+    }
 
-      space_flags = fsp_header_get_flags(out_buf.get());
-      space_flags_set = true;
+    if (use_source_space_id) {
+      space_id = source_space_id;
+    }
 
-      if (have_output_sdi_json) {
-        if (!sdi_root_set || sdi_root_page >= num_pages) {
-          fprintf(stderr,
-                  "Error: invalid SDI root page (%u) for %llu pages\n",
-                  sdi_root_page, (unsigned long long)num_pages);
-          return false;
-        }
-        const uint32_t new_flags = fsp_header_get_flags(out_buf.get());
-        const page_size_t new_page_size(new_flags);
-        const ulint sdi_offset = fsp_header_get_sdi_offset(new_page_size);
-        mach_write_to_4(out_buf.get() + sdi_offset, SDI_VERSION);
-        mach_write_to_4(out_buf.get() + sdi_offset + 4, sdi_root_page);
+    if (space_id != source_space_id) {
+      fsp_header_set_field(out_buf.get(), FSP_SPACE_ID, space_id);
+    }
+
+    space_flags = fsp_header_get_flags(out_buf.get());
+    space_flags_set = true;
+
+    if (have_output_sdi_json) {
+      if (!sdi_root_set || sdi_root_page >= num_pages) {
+        fprintf(stderr,
+                "Error: invalid SDI root page (%u) for %llu pages\n",
+                sdi_root_page, (unsigned long long)num_pages);
+        return false;
       }
+      const uint32_t new_flags = fsp_header_get_flags(out_buf.get());
+      const page_size_t new_page_size(new_flags);
+      const ulint sdi_offset = fsp_header_get_sdi_offset(new_page_size);
+      mach_write_to_4(out_buf.get() + sdi_offset, SDI_VERSION);
+      mach_write_to_4(out_buf.get() + sdi_offset + 4, sdi_root_page);
     }
+  }
 
-    if (space_id == SPACE_UNKNOWN) {
-      fprintf(stderr, "Space id not set after page 0 processing.\n");
+  if (space_id == SPACE_UNKNOWN) {
+    fprintf(stderr, "Space id not set after page 0 processing.\n");
+    return false;
+  }
+
+  finish_rebuilt_page(out_buf.get(), logical_size, space_id, index_id_remap);
+  if (!writer.write(out_buf.get(), logical_size)) {
+    fprintf(stderr, "Failed to write page 0: %s\n", writer.error().c_str());
+    return false;
+  }
+
+  const bool fix_sdi_root = have_output_sdi_json && sdi_root_set;
+  // Replaces the SDI root's records with sdi_entries, keeping its segment
+  // headers; long records are queued in sdi_blob_output.
+  auto rebuild_sdi_root = [&](unsigned char* page) -> bool {
+    byte fseg_leaf[FSEG_HEADER_SIZE];
+    byte fseg_top[FSEG_HEADER_SIZE];
+    memcpy(fseg_leaf, page + FIL_PAGE_DATA + PAGE_BTR_SEG_LEAF,
+           FSEG_HEADER_SIZE);
+    memcpy(fseg_top, page + FIL_PAGE_DATA + PAGE_BTR_SEG_TOP,
+           FSEG_HEADER_SIZE);
+
+    init_empty_sdi_page(page, logical_size, sdi_root_page);
+    memcpy(page + FIL_PAGE_DATA + PAGE_BTR_SEG_LEAF, fseg_leaf,
+           FSEG_HEADER_SIZE);
+    memcpy(page + FIL_PAGE_DATA + PAGE_BTR_SEG_TOP, fseg_top,
+           FSEG_HEADER_SIZE);
+
+    SdiBlobAlloc blob_alloc;
+    SdiBlobAlloc* blob_alloc_ptr = nullptr;
+    if (!sdi_blob_pages.empty()) {
+      blob_alloc.pages = &sdi_blob_pages;
+      blob_alloc.next = 0;
+      blob_alloc.page_size = logical_size;
+      blob_alloc.space_id = space_id;
+      blob_alloc.out_pages = &sdi_blob_output;
+      blob_alloc_ptr = &blob_alloc;
+    }
+
+    if (!populate_sdi_root_page(page, logical_size, sdi_entries,
+                                blob_alloc_ptr)) {
+      fprintf(stderr, "Error: SDI root page rebuild failed.\n");
       return false;
     }
+    return true;
+  };
 
-    if (have_output_sdi_json && sdi_root_set && page_no == sdi_root_page) {
-      byte fseg_leaf[FSEG_HEADER_SIZE];
-      byte fseg_top[FSEG_HEADER_SIZE];
-      memcpy(fseg_leaf,
-             out_buf.get() + FIL_PAGE_DATA + PAGE_BTR_SEG_LEAF,
-             FSEG_HEADER_SIZE);
-      memcpy(fseg_top,
-             out_buf.get() + FIL_PAGE_DATA + PAGE_BTR_SEG_TOP,
-             FSEG_HEADER_SIZE);
-
-      init_empty_sdi_page(out_buf.get(), logical_size,
-                          static_cast<page_no_t>(page_no));
-      memcpy(out_buf.get() + FIL_PAGE_DATA + PAGE_BTR_SEG_LEAF, fseg_leaf,
-             FSEG_HEADER_SIZE);
-      memcpy(out_buf.get() + FIL_PAGE_DATA + PAGE_BTR_SEG_TOP, fseg_top,
-             FSEG_HEADER_SIZE);
-
-      SdiBlobAlloc blob_alloc;
-      SdiBlobAlloc* blob_alloc_ptr = nullptr;
-      if (!sdi_blob_pages.empty()) {
-        blob_alloc.pages = &sdi_blob_pages;
-        blob_alloc.next = 0;
-        blob_alloc.page_size = logical_size;
-        blob_alloc.space_id = space_id;
-        blob_alloc.out_pages = &sdi_blob_output;
-        blob_alloc_ptr = &blob_alloc;
-      }
-
-      if (!populate_sdi_root_page(out_buf.get(), logical_size, sdi_entries,
-                                  blob_alloc_ptr)) {
-        fprintf(stderr, "Error: SDI root page rebuild failed.\n");
+  // Copies the next n pages from the read-ahead into buf.
+  auto read_batch = [&](unsigned char* buf, uint64_t first, size_t n) -> bool {
+    for (size_t i = 0; i < n; i++) {
+      uint64_t read_page_no = 0;
+      const unsigned char* in_page = reader.next(&read_page_no);
+      if (in_page == nullptr) {
+        fprintf(stderr, "Failed to read page %llu: %s\n",
+                (unsigned long long)(first + i), reader.error().c_str());
         return false;
       }
+      memcpy(buf + i * physical_size, in_page, physical_size);
     }
+    return true;
+  };
 
-    if (!index_id_remap.empty()) {
-      const uint16_t page_type =
-          mach_read_from_2(out_buf.get() + FIL_PAGE_TYPE);
-      if (page_type == FIL_PAGE_INDEX || page_type == FIL_PAGE_RTREE) {
-        const uint64_t old_id =
-            mach_read_from_8(out_buf.get() + PAGE_HEADER + PAGE_INDEX_ID);
-        auto it = index_id_remap.find(old_id);
-        if (it != index_id_remap.end()) {
-          mach_write_to_8(out_buf.get() + PAGE_HEADER + PAGE_INDEX_ID,
-                          it->second);
-        }
+  std::unique_ptr<unsigned char[]> in_batches[2] = {
+      std::unique_ptr<unsigned char[]>(new unsigned char[batch_pages * physical_size]),
+      std::unique_ptr<unsigned char[]>(new unsigned char[batch_pages * physical_size])};
+  std::unique_ptr<unsigned char[]> out_batch(
+      new unsigned char[batch_pages * logical_size]);
+
+  uint64_t batch_first = 1;
+  size_t batch_n = static_cast<size_t>(
+      std::min<uint64_t>(batch_pages, num_pages - 1));
+  int cur = 0;
+  if (!read_batch(in_batches[cur].get(), batch_first, batch_n)) {
+    return false;
+  }
+  while (batch_n > 0) {
+    const unsigned char* in_batch = in_batches[cur].get();
+    const uint64_t first = batch_first;
+    const RebuildPool::PageFn transform = [&, in_batch, first](size_t i) {
+      unsigned char* out_page = out_batch.get() + i * logical_size;
+      size_t actual_size = 0;
+      if (!decompress_page_inplace(in_batch + i * physical_size, physical_size,
+                                   logical_size, out_page, logical_size,
+                                   &actual_size)) {
+        return false;
       }
-    }
+      if (fix_sdi_root && first + i == sdi_root_page) {
+        return true;  // finished below, on this thread
+      }
+      finish_rebuilt_page(out_page, logical_size, space_id, index_id_remap);
+      return true;
+    };
+    pool.submit(batch_n, &transform);
 
-    mach_write_to_4(out_buf.get() + FIL_PAGE_ARCH_LOG_NO_OR_SPACE_ID, space_id);
-    stamp_page_lsn_and_crc32(out_buf.get(), logical_size, 0);
+    const uint64_t next_first = first + batch_n;
+    const size_t next_n = static_cast<size_t>(
+        std::min<uint64_t>(batch_pages, num_pages - next_first));
+    const bool read_ok = read_batch(in_batches[cur ^ 1].get(), next_first, next_n);
 
-    size_t w = my_write(out_fd, (uchar*)out_buf.get(), logical_size, MYF(0));
-    if (w != logical_size) {
-      fprintf(stderr, "Failed to write page %llu.\n",
-              (unsigned long long)page_no);
+    size_t bad_page = 0;
+    if (!pool.wait(&bad_page)) {
+      fprintf(stderr, "Failed to decompress page %llu.\n",
+              (unsigned long long)(first + bad_page));
+      return false;
+    }
+    if (!read_ok) {
       return false;
     }
 
-    if ((page_no + 1) % 100 == 0 || (page_no + 1) == num_pages) {
-      fprintf(stderr, "[PROGRESS] Rebuilt %llu/%llu pages (%.1f%%)\n",
-              (unsigned long long)(page_no + 1),
-              (unsigned long long)num_pages,
-              100.0 * (page_no + 1) / num_pages);
+    if (fix_sdi_root && sdi_root_page >= first && sdi_root_page < next_first) {
+      unsigned char* page = out_batch.get() + (sdi_root_page - first) * logical_size;
+      if (!rebuild_sdi_root(page)) {
+        return false;
+      }
+      finish_rebuilt_page(page, logical_size, space_id, index_id_remap);
+    }
+
+    if (!writer.write(out_batch.get(), batch_n * logical_size)) {
+      fprintf(stderr, "Failed to write pages %llu-%llu: %s\n",
+              (unsigned long long)first, (unsigned long long)(next_first - 1),
+              writer.error().c_str());
+      return false;
     }
+
+    fprintf(stderr, "[PROGRESS] Rebuilt %llu/%llu pages (%.1f%%)\n",
+            (unsigned long long)next_first,
+            (unsigned long long)num_pages,
+            100.0 * next_first / num_pages);
+
+    batch_first = next_first;
+    batch_n = next_n;
+    cur ^= 1;
+  }
+
+  // SDI blob pages below are patched in with my_seek(); drain first.
+  if (!writer.finish()) {
+    fprintf(stderr, "Failed to write rebuilt pages: %s\n",
+            writer.error().c_str());
+    return false;
   }
 
   if (!sdi_blob_output.empty()) {
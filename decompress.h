@@ -44,7 +44,8 @@ bool validate_index_id_remap(const char* source_sdi_json_path,
  *   Experimental converter: reads a compressed tablespace (physical < logical),
  *   expands all pages to logical size, clears ZIP_SSIZE in FSP flags, updates
  *   space_id fields, and writes CRC32 checksums for 16KB pages.
- *   If source_sdi_json_path is provided, it is used for index-id mapping.
+ *   If source_sdi_json_path is provided, it is used for index-id mapping;
+ *   source_sdi_from_ibd reads the same from the input's own SDI pages instead.
  *   If target_sdi_json_path is provided, SDI output/.cfg metadata is rebuilt from it.
  *   If index_id_map_path is provided, it is merged into the remap table.
  *   If target_sdi_root_override is provided, compare with source SDI root and warn.
@@ -52,9 +53,12 @@ bool validate_index_id_remap(const char* source_sdi_json_path,
  *   If target_space_id_override is provided, compare with source space_id and warn.
  *   use_target_space_id/use_source_space_id control which space_id is written.
  *   If cfg_out_path is provided, writes a .cfg file from SDI metadata.
+ *   Pages after page 0 are expanded on n_threads workers (0 = one per core);
+ *   the output is the same for any thread count.
  */
 bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
                               const char* source_sdi_json_path,
+                              bool source_sdi_from_ibd,
                               const char* target_sdi_json_path,
                               const char* index_id_map_path,
                               const char* cfg_out_path,
@@ -66,7 +70,8 @@ bool rebuild_uncompressed_ibd(File in_fd, File out_fd,
                               bool use_target_space_id,
                               bool use_source_space_id,
                               bool target_space_id_override_set,
-                              uint32_t target_space_id_override);
+                              uint32_t target_space_id_override,
+                              unsigned n_threads = 0);
 
 bool determine_page_size(File file_in, page_size_t &page_sz);
 
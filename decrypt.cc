@@ -11,6 +11,8 @@
 #include "plugin/keyring/common/keys_container.h"
 
 #include <openssl/evp.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -20,6 +22,8 @@
 #include <memory>
 #include <stdexcept>
 #include <cstdint>         // for uint16_t, etc.
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <my_sys.h>
 #include <my_thread.h>
@@ -32,6 +36,7 @@
 
 // Custom
 #include "decrypt.h"
+#include "page_pipeline.h"
 #include "ibd_enc_reader.h" // for decode_ibd_encryption_info()
 
 // Note: Compression struct is already defined in os/file.h which is included
@@ -166,9 +171,84 @@ bool is_encrypted_page(const unsigned char* page_data) {
           page_type == FIL_PAGE_ENCRYPTED_RTREE);
 }
 
+namespace {
+
+/**
+ * One AES-256-CBC context per thread, keyed once and reused for every
+ * page: only the IV is reset per call, so the key schedule and the
+ * EVP_CIPHER_CTX allocation that my_aes_decrypt() redoes each time are
+ * paid once. EVP picks AES-NI / ARMv8 AES by itself.
+ */
+class PageDecryptor {
+ public:
+  PageDecryptor() = default;
+  PageDecryptor(const PageDecryptor&) = delete;
+  PageDecryptor& operator=(const PageDecryptor&) = delete;
+  ~PageDecryptor() {
+    if (ctx_) {
+      EVP_CIPHER_CTX_free(ctx_);
+    }
+  }
+
+  bool decrypt(unsigned char* page_data, size_t page_len,
+               const unsigned char* key, size_t key_len,
+               const unsigned char* iv, size_t block_size);
+
+ private:
+  bool set_key(const unsigned char* key, size_t key_len);
+  bool cbc(const unsigned char* src, size_t len, unsigned char* dst,
+           const unsigned char* iv);
+
+  EVP_CIPHER_CTX* ctx_ = nullptr;
+  unsigned char key_[32] = {};
+  size_t key_len_ = 0;
+  std::vector<unsigned char> tmp_;
+};
+
+bool PageDecryptor::set_key(const unsigned char* key, size_t key_len) {
+  if (ctx_ && key_len == key_len_ && memcmp(key, key_, key_len) == 0) {
+    return true;
+  }
+  if (key_len != sizeof(key_)) {
+    // my_aes_256_cbc only; my_aes_create_key() is the identity for 32 bytes.
+    return false;
+  }
+  if (!ctx_ && (ctx_ = EVP_CIPHER_CTX_new()) == nullptr) {
+    return false;
+  }
+  if (EVP_DecryptInit_ex(ctx_, EVP_aes_256_cbc(), nullptr, key, nullptr) != 1) {
+    key_len_ = 0;
+    return false;
+  }
+  memcpy(key_, key, key_len);
+  key_len_ = key_len;
+  return true;
+}
+
+bool PageDecryptor::cbc(const unsigned char* src, size_t len,
+                        unsigned char* dst, const unsigned char* iv) {
+  int out_len = 0;
+  int final_len = 0;
+  if (EVP_DecryptInit_ex(ctx_, nullptr, nullptr, nullptr, iv) != 1 ||
+      EVP_CIPHER_CTX_set_padding(ctx_, 0) != 1 ||
+      EVP_DecryptUpdate(ctx_, dst, &out_len, src, static_cast<int>(len)) != 1 ||
+      EVP_DecryptFinal_ex(ctx_, dst + out_len, &final_len) != 1) {
+    return false;
+  }
+  return static_cast<size_t>(out_len + final_len) == len;
+}
+
+static PageDecryptor& thread_page_decryptor() {
+  thread_local PageDecryptor decryptor;
+  return decryptor;
+}
+
+}  // namespace
+
 /**
  * @brief Offline function that decrypts a single uncompressed page in-place
- *        using MySQL's partial-block approach, calling `my_aes_decrypt()`.
+ *        using MySQL's partial-block approach (same output as
+ *        `my_aes_decrypt()`), on the calling thread's cached AES context.
  *
  * @param page_data Pointer to the full page buffer.
  * @param page_len  Size of the full page (e.g. 16 KB).
@@ -185,6 +265,14 @@ bool decrypt_page_inplace(
     size_t               key_len,
     const unsigned char* iv,
     size_t               block_size) 
+{
+    return thread_page_decryptor().decrypt(page_data, page_len, key, key_len,
+                                           iv, block_size);
+}
+
+bool PageDecryptor::decrypt(unsigned char* page_data, size_t page_len,
+                            const unsigned char* key, size_t key_len,
+                            const unsigned char* iv, size_t block_size)
 {
     // 1) Check if it’s even an encrypted page
     if (!is_encrypted_page(page_data)) {
@@ -229,6 +317,13 @@ bool decrypt_page_inplace(
         if (src_len < MIN_ENCRYPTION_LEN) {
             src_len = MIN_ENCRYPTION_LEN;
         }
+        if (src_len > page_len) {
+            return false;
+        }
+    }
+
+    if (!set_key(key, key_len)) {
+        return false;
     }
 
     // Now the data portion to decrypt:
@@ -239,10 +334,11 @@ bool decrypt_page_inplace(
     size_t main_len   = (data_len / MY_AES_BLOCK_SIZE) * MY_AES_BLOCK_SIZE;
     size_t remain_len = data_len - main_len;
 
-    // We need a temp buffer for partial-block decrypt
-    // or for the entire chunk if we want to replicate MySQL exactly.
-    // In real MySQL code, 'tmp' might be allocated from a block pool.
-    unsigned char* tmp_buf = new unsigned char[data_len];
+    // Temp buffer for the partial-block decrypt, kept across pages.
+    if (tmp_.size() < data_len) {
+        tmp_.resize(data_len);
+    }
+    unsigned char* tmp_buf = tmp_.data();
     unsigned char  remain_buf[MY_AES_BLOCK_SIZE * 2];
 
     // 4) If there's a remainder, MySQL decrypts the last 2 blocks first
@@ -257,21 +353,8 @@ bool decrypt_page_inplace(
       size_t offset_of_last_2 = data_len - remain_len; // from ptr
       memcpy(remain_buf, ptr + offset_of_last_2, remain_len);
 
-      // my_aes_decrypt(src, src_len, dest, key, key_len, mode, iv, pad)
-      // using mode = my_aes_256_cbc, pad=false
       // Decrypt the 2-block chunk into tmp_buf + offset_of_last_2
-      int elen = my_aes_decrypt(
-          remain_buf,
-      static_cast<uint32>(remain_len),
-          tmp_buf + offset_of_last_2,
-          key,
-      static_cast<uint32>(key_len),
-      my_aes_256_cbc,
-          iv,
-          false /* no padding */);
-
-      if (elen == MY_AES_BAD_DATA) {
-          delete[] tmp_buf;
+      if (!cbc(remain_buf, remain_len, tmp_buf + offset_of_last_2, iv)) {
           return false;
       }
 
@@ -284,21 +367,8 @@ bool decrypt_page_inplace(
 
     // 5) Decrypt the “main” portion from tmp_buf => ptr
     //    (which is the portion except those last 2 blocks, if any)
-    {
-        int elen = my_aes_decrypt(
-            tmp_buf,
-        static_cast<uint32>(main_len), // only main_len portion
-        ptr,                           // output in-place in the page
-            key,
-        static_cast<uint32>(key_len),
-        my_aes_256_cbc,
-            iv,
-            false /* no padding */);
-
-        if (elen == MY_AES_BAD_DATA) {
-            delete[] tmp_buf;
-            return false;
-        }
+    if (!cbc(tmp_buf, main_len, ptr, iv)) {
+        return false;
     }
 
     // 6) If remain_len != 0, copy the decrypted tail from tmp_buf to ptr
@@ -319,78 +389,227 @@ bool decrypt_page_inplace(
         // We might also want to clear FIL_PAGE_ORIGINAL_TYPE_V1, etc.
     }
 
-    // Cleanup
-    delete[] tmp_buf;
     return true;
 }
 
+bool PageCipher::decrypt(unsigned char* page, size_t page_len) const {
+  return decrypt_page_inplace(page, page_len, key_iv.key, 32, key_iv.iv,
+                              8 * 1024);
+}
+
+// ----------------------------------------------------------------
+// PageDecryptPool
+// ----------------------------------------------------------------
+// Pages a worker claims at a time; keeps the shared counter off the hot path.
+static const size_t kDecryptClaimPages = 8;
+
+PageDecryptPool::PageDecryptPool(unsigned n_threads) {
+  if (n_threads == 0) {
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < n_threads; i++) {
+    workers_.emplace_back(&PageDecryptPool::worker_loop, this);
+  }
+}
+
+PageDecryptPool::~PageDecryptPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& t : workers_) {
+    t.join();
+  }
+}
+
+void PageDecryptPool::submit(unsigned char* pages, size_t n_pages,
+                             size_t page_size,
+                             const Tablespace_key_iv& key_iv) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    pages_ = pages;
+    n_pages_ = n_pages;
+    page_size_ = page_size;
+    key_iv_ = &key_iv;
+    next_page_ = 0;
+    done_pages_ = 0;
+    bad_page_ = SIZE_MAX;
+  }
+  work_cv_.notify_all();
+}
+
+bool PageDecryptPool::wait(size_t* bad_page) {
+  std::unique_lock<std::mutex> lock(mu_);
+  done_cv_.wait(lock, [&] { return done_pages_ == n_pages_; });
+  if (bad_page) {
+    *bad_page = bad_page_;
+  }
+  return bad_page_ == SIZE_MAX;
+}
+
+void PageDecryptPool::worker_loop() {
+  my_thread_init();
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    work_cv_.wait(lock, [&] { return stopping_ || next_page_ < n_pages_; });
+    if (stopping_) {
+      break;
+    }
+    const size_t first = next_page_;
+    const size_t count = std::min(kDecryptClaimPages, n_pages_ - first);
+    next_page_ += count;
+    unsigned char* base = pages_ + first * page_size_;
+    const size_t page_size = page_size_;
+    const Tablespace_key_iv* key_iv = key_iv_;
+    lock.unlock();
+
+    size_t bad = SIZE_MAX;
+    for (size_t i = 0; i < count; i++) {
+      if (!decrypt_page_inplace(base + i * page_size, page_size,
+                                key_iv->key, 32, key_iv->iv, 8 * 1024) &&
+          bad == SIZE_MAX) {
+        bad = first + i;
+      }
+    }
+
+    lock.lock();
+    if (bad < bad_page_) {
+      bad_page_ = bad;
+    }
+    done_pages_ += count;
+    if (done_pages_ == n_pages_) {
+      done_cv_.notify_all();
+    }
+  }
+  lock.unlock();
+  my_thread_end();
+}
+
+/** Read up to len bytes at offset; short only at EOF or on error (-1). */
+static ssize_t pread_full(int fd, unsigned char* buf, size_t len, off_t offset) {
+  size_t got = 0;
+  while (got < len) {
+    const ssize_t rd = pread(fd, buf + got, len - got,
+                             offset + static_cast<off_t>(got));
+    if (rd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (rd == 0) {
+      break;
+    }
+    got += static_cast<size_t>(rd);
+  }
+  return static_cast<ssize_t>(got);
+}
+
 // ----------------------------------------------------------------
 // decrypt_ibd_file(): read the entire .ibd, decrypt, write out
+//
+// Double-buffered: while the pool decrypts one batch, the next one is
+// read, and decrypted batches go to a write-behind thread.
 // ----------------------------------------------------------------
 bool decrypt_ibd_file(const char* src_ibd_path,
                       const char* dst_path,
                       const Tablespace_key_iv& ts_key_iv,
-                      const bool compressed)
+                      const bool compressed,
+                      unsigned n_threads)
 {
   // 1) Open source file
-  FILE* f_in = std::fopen(src_ibd_path, "rb");
-  if (!f_in) {
+  int in_fd = ::open(src_ibd_path, O_RDONLY);
+  if (in_fd < 0) {
     std::cerr << "Cannot open source .ibd for reading: " << src_ibd_path << "\n";
     return false;
   }
 
   // 2) Open destination file
-  FILE* f_out = std::fopen(dst_path, "wb");
-  if (!f_out) {
+  int out_fd = ::open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out_fd < 0) {
     std::cerr << "Cannot open destination file for writing: " << dst_path << "\n";
-    std::fclose(f_in);
+    ::close(in_fd);
     return false;
   }
 
-  // 3) Read page by page, decrypt, write
+  // 3) Read batches, decrypt them in parallel, write
   const size_t PAGE_SIZE = compressed ? 8192 : 16384;
-  std::vector<unsigned char> page_buf(PAGE_SIZE);
-
-  uint64_t page_number = 0;
-  while (true) {
-    size_t read_bytes = fread(page_buf.data(), 1, PAGE_SIZE, f_in);
-    if (read_bytes == 0) {
-      // Probably end of file
-      break;
+  const PageIoOptions io_opts = page_io_options_from_env();
+  const size_t batch_pages = std::max<size_t>(io_opts.batch_pages, 1) * 4;
+  const size_t batch_bytes = batch_pages * PAGE_SIZE;
+  std::unique_ptr<unsigned char[]> bufs[2] = {
+      std::unique_ptr<unsigned char[]>(new unsigned char[batch_bytes]),
+      std::unique_ptr<unsigned char[]>(new unsigned char[batch_bytes])};
+
+  PageDecryptPool pool(n_threads);
+  PageWriteBehind writer;
+  writer.start(out_fd, batch_bytes, io_opts);
+
+  bool ok = true;
+  uint64_t page_number = 0;  // first page of the current batch
+  off_t offset = 0;
+  int cur = 0;
+  ssize_t cur_bytes = pread_full(in_fd, bufs[cur].get(), batch_bytes, offset);
+  while (cur_bytes > 0) {
+    const size_t full_pages = static_cast<size_t>(cur_bytes) / PAGE_SIZE;
+    if (static_cast<size_t>(cur_bytes) % PAGE_SIZE != 0) {
+      // Trailing partial page: copied through as-is.
+      std::cerr << "Warning: partial page read! offset="
+                << (page_number + full_pages) * PAGE_SIZE
+                << " read=" << (static_cast<size_t>(cur_bytes) % PAGE_SIZE) << "\n";
     }
-    if (read_bytes < PAGE_SIZE) {
-      // If we got partial page, that's up to your logic whether to handle it
-      std::cerr << "Warning: partial page read! offset=" << (page_number * PAGE_SIZE)
-                << " read=" << read_bytes << "\n";
-      // We'll just decrypt the partial chunk for demonstration, though
-      // that might fail if your encryption logic expects a full block.
+    pool.submit(bufs[cur].get(), full_pages, PAGE_SIZE, ts_key_iv);
+
+    offset += cur_bytes;
+    const ssize_t next_bytes =
+        static_cast<size_t>(cur_bytes) == batch_bytes
+            ? pread_full(in_fd, bufs[cur ^ 1].get(), batch_bytes, offset)
+            : 0;
+
+    size_t bad_page = 0;
+    if (!pool.wait(&bad_page)) {
+      std::cerr << "Failed to decrypt page #" << (page_number + bad_page) << "\n";
+      ok = false;
+      break;
     }
-
-    // Decrypt in place
-    if (!decrypt_page_inplace(page_buf.data(), PAGE_SIZE,
-                              ts_key_iv.key, 32,
-                              ts_key_iv.iv, 8*1024)) {
-      std::cerr << "Failed to decrypt page #" << page_number << "\n";
-      std::fclose(f_in);
-      std::fclose(f_out);
-      return false;
+    if (!writer.write(bufs[cur].get(), static_cast<size_t>(cur_bytes))) {
+      std::cerr << "Failed to write page #" << page_number << ": "
+                << writer.error() << "\n";
+      ok = false;
+      break;
     }
-
-    // Write the decrypted page
-    size_t written = fwrite(page_buf.data(), 1, PAGE_SIZE, f_out);
-    if (written < PAGE_SIZE) {
-      std::cerr << "Failed to write page #" << page_number << "\n";
-      std::fclose(f_in);
-      std::fclose(f_out);
-      return false;
+    if (next_bytes < 0) {
+      std::cerr << "Read error after page #" << (page_number + full_pages)
+                << ": " << strerror(errno) << "\n";
+      ok = false;
+      break;
     }
 
-    page_number++;
+    page_number += full_pages;
+    cur ^= 1;
+    cur_bytes = next_bytes;
+  }
+  if (cur_bytes < 0) {
+    std::cerr << "Read error at page #" << page_number << ": "
+              << strerror(errno) << "\n";
+    ok = false;
   }
 
-  std::fclose(f_in);
-  std::fclose(f_out);
+  if (!writer.finish() && ok) {
+    std::cerr << "Failed to write " << dst_path << ": " << writer.error() << "\n";
+    ok = false;
+  }
+  ::close(in_fd);
+  if (::close(out_fd) != 0 && ok) {
+    std::cerr << "Failed to close " << dst_path << ": " << strerror(errno) << "\n";
+    ok = false;
+  }
+  if (!ok) {
+    return false;
+  }
 
-  std::cout << "Successfully decrypted .ibd -> " << dst_path << "\n";
+  std::cout << "Successfully decrypted .ibd -> " << dst_path << " ("
+            << page_number << " pages, " << pool.threads() << " threads)\n";
   return true;
-}
\ No newline at end of file
+}
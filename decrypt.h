@@ -1,8 +1,15 @@
 // ---------------
 // Declarations from decrypt.cc
 // ---------------
+#ifndef DECRYPT_H
+#define DECRYPT_H
+
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include "ibd_enc_reader.h"
 
@@ -27,8 +34,65 @@ extern bool decrypt_page_inplace(
     size_t               block_size
 );
 
-// Decrypt file
+// Decrypt file; pages are decrypted on n_threads workers (0 = one per core)
 bool decrypt_ibd_file(const char* src_ibd_path,
                       const char* dst_path,
                       const Tablespace_key_iv &ts_key_iv,
-                      const bool compressed);
\ No newline at end of file
+                      const bool compressed,
+                      unsigned n_threads = 0);
+
+/**
+ * Unwrapped tablespace key for decrypting pages as they are read, so mode 3
+ * can parse an encrypted tablespace without a decrypted copy on disk.
+ */
+struct PageCipher {
+  Tablespace_key_iv key_iv;
+
+  /** Decrypt one physical page in place; pages that are not encrypted
+   *  (page 0, or ones already decrypted) are left untouched. */
+  bool decrypt(unsigned char* page, size_t page_len) const;
+};
+
+/**
+ * Worker pool that decrypts a batch of contiguous pages in parallel.
+ * decrypt_page_inplace() keeps one AES context per thread, so each worker
+ * sets the key up once for the lifetime of the pool.
+ *
+ * submit() returns at once so the caller can read the next batch while
+ * this one is decrypted; wait() blocks until it is done.
+ */
+class PageDecryptPool {
+ public:
+  explicit PageDecryptPool(unsigned n_threads);  // 0 = one per core
+  PageDecryptPool(const PageDecryptPool&) = delete;
+  PageDecryptPool& operator=(const PageDecryptPool&) = delete;
+  ~PageDecryptPool();
+
+  void submit(unsigned char* pages, size_t n_pages, size_t page_size,
+              const Tablespace_key_iv& key_iv);
+
+  /** false if a page failed to decrypt; *bad_page is the first such index. */
+  bool wait(size_t* bad_page);
+
+  unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+
+ private:
+  void worker_loop();
+
+  std::vector<std::thread> workers_;
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+
+  // Current batch, guarded by mu_
+  unsigned char* pages_ = nullptr;
+  size_t n_pages_ = 0;
+  size_t page_size_ = 0;
+  const Tablespace_key_iv* key_iv_ = nullptr;
+  size_t next_page_ = 0;
+  size_t done_pages_ = 0;
+  size_t bad_page_ = SIZE_MAX;
+};
+
+#endif  // DECRYPT_H
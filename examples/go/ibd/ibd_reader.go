@@ -276,3 +276,205 @@ func IsPageCompressed(pageData []byte, physicalSize, logicalSize int) bool {
 func GetPageTypeName(pageType uint16) string {
 	return C.GoString(C.ibd_get_page_type_name(C.uint16_t(pageType)))
 }
+
+// Table is an open table for row reading
+type Table struct {
+	handle C.ibd_table_t
+	batch  C.ibd_batch_t
+}
+
+// OpenTable opens an .ibd file with its ibd2sdi JSON for reading rows
+func (r *Reader) OpenTable(ibdPath, sdiJSONPath string) (*Table, error) {
+	if r.handle == nil {
+		return nil, errors.New("reader is closed")
+	}
+
+	cIbd := C.CString(ibdPath)
+	cSdi := C.CString(sdiJSONPath)
+	defer C.free(unsafe.Pointer(cIbd))
+	defer C.free(unsafe.Pointer(cSdi))
+
+	var handle C.ibd_table_t
+	result := C.ibd_open_table(r.handle, cIbd, cSdi, &handle)
+	if result != Success {
+		return nil, fmt.Errorf("open table failed: %s (code %d)", r.GetError(), result)
+	}
+
+	return &Table{handle: handle}, nil
+}
+
+// SetColumns limits rows to the named columns; call before the first read
+func (t *Table) SetColumns(names []string) error {
+	if t.handle == nil {
+		return errors.New("table is closed")
+	}
+
+	cNames := make([]*C.char, len(names))
+	for i, name := range names {
+		cNames[i] = C.CString(name)
+		defer C.free(unsafe.Pointer(cNames[i]))
+	}
+	var first **C.char
+	if len(cNames) > 0 {
+		// Go memory holding only C pointers may be passed to C
+		first = &cNames[0]
+	}
+
+	result := C.ibd_table_set_columns(t.handle, first, C.uint32_t(len(names)))
+	if result != Success {
+		return fmt.Errorf("set columns failed: code %d", result)
+	}
+	return nil
+}
+
+// LoadPageMap reads the page map sidecar (the default one when path is
+// empty) or builds and saves it, so that reads skip the pages holding no
+// leaf of the table's index and Split balances ranges by leaves
+func (t *Table) LoadPageMap(path string) error {
+	if t.handle == nil {
+		return errors.New("table is closed")
+	}
+
+	var cPath *C.char
+	if path != "" {
+		cPath = C.CString(path)
+		defer C.free(unsafe.Pointer(cPath))
+	}
+	result := C.ibd_table_load_page_map(t.handle, cPath)
+	if result != Success {
+		return fmt.Errorf("load page map failed: %s (code %d)",
+			C.GoString(C.ibd_table_get_error(t.handle)), result)
+	}
+	return nil
+}
+
+// ScanRange is a span of pages [FirstPage, EndPage) of a table
+type ScanRange struct {
+	FirstPage uint64
+	EndPage   uint64
+}
+
+// Split divides the table into up to n disjoint page ranges for OpenScan
+func (t *Table) Split(n int) ([]ScanRange, error) {
+	if t.handle == nil {
+		return nil, errors.New("table is closed")
+	}
+	if n <= 0 {
+		return nil, errors.New("split needs n > 0")
+	}
+
+	cRanges := make([]C.ibd_scan_range_t, n)
+	var count C.uint32_t
+	result := C.ibd_table_split(t.handle, C.uint32_t(n), &cRanges[0], &count)
+	if result != Success {
+		return nil, fmt.Errorf("split failed: code %d", result)
+	}
+
+	ranges := make([]ScanRange, int(count))
+	for i := range ranges {
+		ranges[i] = ScanRange{uint64(cRanges[i].first_page), uint64(cRanges[i].end_page)}
+	}
+	return ranges, nil
+}
+
+// Shard returns the extent-aligned range of shard index (0-based) of
+// count, as ib_parser --shard=index/count sweeps it
+func (t *Table) Shard(index, count int) (ScanRange, error) {
+	if t.handle == nil {
+		return ScanRange{}, errors.New("table is closed")
+	}
+	if index < 0 || index >= count {
+		return ScanRange{}, errors.New("shard needs 0 <= index < count")
+	}
+
+	var cRange C.ibd_scan_range_t
+	result := C.ibd_table_shard(t.handle, C.uint32_t(index), C.uint32_t(count), &cRange)
+	if result != Success {
+		return ScanRange{}, fmt.Errorf("shard failed: code %d", result)
+	}
+	return ScanRange{uint64(cRange.first_page), uint64(cRange.end_page)}, nil
+}
+
+// OpenScan opens an independent cursor over one range of the table; each
+// cursor may be read from its own goroutine and must be closed separately
+func (t *Table) OpenScan(r ScanRange) (*Table, error) {
+	if t.handle == nil {
+		return nil, errors.New("table is closed")
+	}
+
+	cRange := C.ibd_scan_range_t{first_page: C.uint64_t(r.FirstPage), end_page: C.uint64_t(r.EndPage)}
+	var handle C.ibd_table_t
+	result := C.ibd_open_scan(t.handle, &cRange, &handle)
+	if result != Success {
+		return nil, fmt.Errorf("open scan failed: %s (code %d)",
+			C.GoString(C.ibd_table_get_error(t.handle)), result)
+	}
+	return &Table{handle: handle}, nil
+}
+
+// Close frees the table and its batch buffers
+func (t *Table) Close() {
+	if t.handle != nil {
+		C.ibd_free_batch(&t.batch)
+		C.ibd_close_table(t.handle)
+		t.handle = nil
+	}
+}
+
+// Batch is a view of the rows returned by one ReadBatch call. It points
+// into library memory and is only valid until the next ReadBatch or Close.
+type Batch struct {
+	Rows    int
+	columns []C.ibd_batch_column_t
+	data    []byte
+}
+
+// ReadBatch reads up to maxRows rows with a single cgo call; it returns
+// nil at the end of the table
+func (t *Table) ReadBatch(maxRows int) (*Batch, error) {
+	if t.handle == nil {
+		return nil, errors.New("table is closed")
+	}
+
+	result := C.ibd_read_batch(t.handle, C.uint32_t(maxRows), &t.batch)
+	if result == EndOfStream {
+		return nil, nil
+	}
+	if result != Success {
+		return nil, fmt.Errorf("read batch failed: code %d", result)
+	}
+
+	b := &Batch{Rows: int(t.batch.row_count)}
+	b.columns = unsafe.Slice(t.batch.columns, int(t.batch.column_count))
+	if t.batch.data_size > 0 {
+		b.data = unsafe.Slice((*byte)(unsafe.Pointer(t.batch.data)), int(t.batch.data_size))
+	}
+	return b, nil
+}
+
+// Columns returns the number of columns in the batch
+func (b *Batch) Columns() int {
+	return len(b.columns)
+}
+
+// ColumnName returns the name of column col
+func (b *Batch) ColumnName(col int) string {
+	return C.GoString(b.columns[col].name)
+}
+
+// IsNull reports whether (row, col) is NULL
+func (b *Batch) IsNull(row, col int) bool {
+	return unsafe.Slice(b.columns[col].nulls, b.Rows)[row] != 0
+}
+
+// Int returns the value of an integer column
+func (b *Batch) Int(row, col int) int64 {
+	v := unsafe.Slice(b.columns[col].values, b.Rows)[row]
+	return *(*int64)(unsafe.Pointer(&v))
+}
+
+// Text returns the formatted value of (row, col) without copying it
+func (b *Batch) Text(row, col int) []byte {
+	span := unsafe.Slice(b.columns[col].text, b.Rows)[row]
+	return b.data[span.offset : span.offset+C.uint64_t(span.length)]
+}
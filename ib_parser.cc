@@ -18,7 +18,21 @@
 #include <memory>
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <cerrno>
+#include <cinttypes>
+#include <dirent.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 // MySQL/Percona, OpenSSL, etc.
 #include <my_sys.h>
@@ -46,6 +60,17 @@
 #include "decompress.h"  // Contains e.g. decompress_page_inplace(), etc.
 #include "parser.h"      // Contains parser logic
 #include "undrop_for_innodb.h"
+#include "page_pipeline.h"
+#include "page_checksum.h"
+#include "parse_stats.h"
+#include "parser_log.h"
+#include "schema_cache.h"
+#include "parse_checkpoint.h"
+#include "inflate_backend.h"
+#include "page_map.h"
+#include "output_file.h"
+#include "row_output_sink.h"
+#include "mysql_crc32c.h"
 
 struct XdesCache {
   page_no_t page_no = FIL_NULL;
@@ -78,7 +103,9 @@ struct XdesCache {
   }
 };
 
-static bool read_index_id_from_root(int fd, page_no_t root, uint64_t* out) {
+static bool read_index_id_from_root(int fd, page_no_t root, uint64_t* out,
+                                    const TablespaceMap* map,
+                                    const PageCipher* cipher) {
   if (root == FIL_NULL || out == nullptr) {
     return false;
   }
@@ -99,17 +126,31 @@ static bool read_index_id_from_root(int fd, page_no_t root, uint64_t* out) {
     logical_buf.resize(logical_size);
   }
 
-  const off_t offset = static_cast<off_t>(root) *
-                       static_cast<off_t>(physical_size);
-  if (pread(fd, page_buf.data(), physical_size, offset) !=
-      static_cast<ssize_t>(physical_size)) {
-    return false;
+  const unsigned char* raw = map ? map->page(root, physical_size) : nullptr;
+  if (raw == nullptr) {
+    const off_t offset = static_cast<off_t>(root) *
+                         static_cast<off_t>(physical_size);
+    if (pread(fd, page_buf.data(), physical_size, offset) !=
+        static_cast<ssize_t>(physical_size)) {
+      return false;
+    }
+    raw = page_buf.data();
+  }
+  if (cipher) {
+    // Decrypt a private copy; the mapping stays as it is on disk.
+    if (raw != page_buf.data()) {
+      std::memcpy(page_buf.data(), raw, physical_size);
+      raw = page_buf.data();
+    }
+    if (!cipher->decrypt(page_buf.data(), physical_size)) {
+      return false;
+    }
   }
 
-  const unsigned char* page_data = page_buf.data();
+  const unsigned char* page_data = raw;
   if (tablespace_compressed) {
     size_t actual_size = 0;
-    if (!decompress_page_inplace(page_buf.data(), physical_size, logical_size,
+    if (!decompress_page_inplace(raw, physical_size, logical_size,
                                  logical_buf.data(), logical_size, &actual_size)) {
       return false;
     }
@@ -166,6 +207,93 @@ static bool is_table_compressed(File in_fd)
     return compressed;
 }
 
+/**
+ * Tablespace key/IV of ibd_path, unwrapped with an already fetched master
+ * key (mode 7 fetches it once for every table).
+ */
+static bool load_tablespace_cipher(const char* ibd_path,
+                                   const std::vector<unsigned char>& master_key,
+                                   PageCipher* out)
+{
+  File in_fd = my_open(ibd_path, O_RDONLY, MYF(0));
+  if (in_fd < 0) {
+    std::cerr << "Cannot open file " << ibd_path << std::endl;
+    return false;
+  }
+  bool compressed = is_table_compressed(in_fd);
+  my_close(in_fd, MYF(0));
+
+  // Same key/IV offsets as modes 1 and 4.
+  long offset = compressed ? 5270 : 10390;
+  if (!read_tablespace_key_iv(ibd_path, offset, master_key, out->key_iv)) {
+    std::cerr << "Could not read tablespace key\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Master key -> tablespace key/IV for ibd_path, the same steps as modes 1
+ * and 4, so mode 3 can decrypt pages as it reads them.
+ */
+static bool load_page_cipher(const char* ibd_path, uint32_t master_id,
+                             const std::string& srv_uuid,
+                             const char* keyring_path, PageCipher* out)
+{
+  std::vector<unsigned char> master_key;
+  if (!get_master_key(master_id, srv_uuid, keyring_path, master_key)) {
+    std::cerr << "Could not get master key\n";
+    return false;
+  }
+  return load_tablespace_cipher(ibd_path, master_key, out);
+}
+
+/** --keyring / --master-key-id / --server-uuid, shared by modes 3 and 6. */
+struct KeyringArgs {
+  const char* keyring_path = nullptr;
+  std::string master_key_id;
+  std::string srv_uuid;
+
+  /** True if argv[i] was one of the keyring options. */
+  bool consume(const char* arg) {
+    if (std::strncmp(arg, "--keyring=", 10) == 0) {
+      keyring_path = arg + 10;
+      return true;
+    }
+    if (std::strncmp(arg, "--master-key-id=", 16) == 0) {
+      master_key_id = arg + 16;
+      return true;
+    }
+    if (std::strncmp(arg, "--server-uuid=", 14) == 0) {
+      srv_uuid = arg + 14;
+      return true;
+    }
+    return false;
+  }
+
+  bool given() const {
+    return keyring_path != nullptr || !master_key_id.empty() || !srv_uuid.empty();
+  }
+
+  /** Check the three options were given together; parses the key id. */
+  bool validate(uint32_t* master_id) const {
+    if (keyring_path == nullptr || !*keyring_path || master_key_id.empty() ||
+        srv_uuid.empty()) {
+      std::cerr << "--keyring, --master-key-id and --server-uuid must be "
+                   "given together\n";
+      return false;
+    }
+    char* end = nullptr;
+    unsigned long id = std::strtoul(master_key_id.c_str(), &end, 10);
+    if (*end != '\0' || id > std::numeric_limits<uint32_t>::max()) {
+      std::cerr << "Invalid --master-key-id value: " << master_key_id << "\n";
+      return false;
+    }
+    *master_id = static_cast<uint32_t>(id);
+    return true;
+  }
+};
+
 /** 
  * Minimal usage print 
  */
@@ -177,16 +305,32 @@ static void usage() {
             << "  2 = Decompress only\n"
             << "  3 = Parse only\n"
             << "  4 = Decrypt then Decompress in a single pass\n"
-            << "  5 = Rebuild to uncompressed (experimental)\n\n"
+            << "  5 = Rebuild to uncompressed (experimental)\n"
+            << "  6 = Verify page checksums (also: --verify-checksums)\n"
+            << "  7 = Batch parse (a directory or manifest of tablespaces)\n\n"
             << "Examples:\n"
             << "  ib_parser 1 <master_key_id> <server_uuid> <keyring_file> <ibd_path> <dest_path>\n"
+            << "    [--threads=N]\n"
             << "  ib_parser 2 <in_file.ibd> <out_file>\n"
-            << "  ib_parser 3 <in_file.ibd> <table_def.json> [--index=NAME|ID] [--list-indexes]\n"
-            << "    [--format=pipe|csv|jsonl] [--output=PATH] [--with-meta] [--lob-max-bytes=N]\n"
-            << "    [--raw-integers] [--skip-xdes] [--skip-page-check] [--debug]\n"
+            << "  ib_parser 3 <in_file.ibd> [<table_def.json>] [--sdi-cache=DIR]\n"
+            << "    [--index=NAME|ID] [--list-indexes]\n"
+            << "    [--format=pipe|csv|jsonl|arrow|parquet] [--output=PATH] [--with-meta]\n"
+            << "    [--columns=a,b,c] [--where=EXPR] [--row-group-rows=N] [--lob-max-bytes=N]\n"
+            << "    [--raw-integers] [--skip-xdes] [--skip-page-check] [--threads=N] [--unordered]\n"
+            << "    [--scan=sweep|btree] [--lob-cache-mb=N] [--mmap] [--recover-deleted]\n"
+            << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n"
+            << "    [--stats[=PATH.json]] [--progress[=SECONDS]]\n"
+            << "    [--since-lsn=N] [--checkpoint[=PATH]] [--checkpoint-interval=SECONDS] [--resume]\n"
+            << "    [--log-level=error|warn|info|debug|trace] [--debug]\n"
             << "  ib_parser 4 <master_key_id> <server_uuid> <keyring_file> <ibd_path> <dest_path>\n"
-            << "  ib_parser 5 <in_file.ibd> <out_file> [--sdi-json=PATH]\n"
-            << "    [--target-sdi-json=PATH] [--index-id-map=PATH] [--cfg-out=PATH]\n"
+            << "  ib_parser 5 <in_file.ibd> <out_file> [--sdi-json=PATH|--sdi-from-ibd]\n"
+            << "    [--target-sdi-json=PATH] [--index-id-map=PATH] [--cfg-out=PATH] [--threads=N]\n"
+            << "  ib_parser 6 <in_file.ibd> [--threads=N]\n"
+            << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n"
+            << "  ib_parser 7 <manifest|dir> --output-dir=DIR [--threads=N]\n"
+            << "    [--format=pipe|csv|jsonl] [--with-meta] [--sdi-cache=DIR]\n"
+            << "    [--report=PATH] [--skip-xdes] [--skip-page-check] [--lob-cache-mb=N]\n"
+            << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n"
             << std::endl;
 }
 
@@ -200,7 +344,8 @@ static int do_decrypt_main(int argc, char** argv)
 {
   if (argc < 6) {
     std::cerr << "Usage for mode=1 (decrypt):\n"
-              << "  ib_parser 1 <master_key_id> <server_uuid> <keyring_file> <ibd_path> <dest_path>\n";
+              << "  ib_parser 1 <master_key_id> <server_uuid> <keyring_file> <ibd_path> <dest_path>\n"
+              << "    [--threads=N]\n";
     return 1;
   }
 
@@ -209,6 +354,23 @@ static int do_decrypt_main(int argc, char** argv)
   const char* keyring_path = argv[3];
   const char* ibd_path     = argv[4];
   const char* dest_path    = argv[5];
+  unsigned n_threads       = 0;  // one decrypt worker per core
+
+  for (int i = 6; i < argc; i++) {
+    if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+      const char* value = argv[i] + 10;
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n > 1024) {
+        std::cerr << "Invalid --threads value: " << value << "\n";
+        return 1;
+      }
+      n_threads = static_cast<unsigned>(n);
+      continue;
+    }
+    std::cerr << "Unknown argument: " << argv[i] << "\n";
+    return 1;
+  }
 
   // 1) Global MySQL init
   my_init();
@@ -244,7 +406,7 @@ static int do_decrypt_main(int argc, char** argv)
   }
 
   // 4) Decrypt the entire .ibd
-  if (!decrypt_ibd_file(ibd_path, dest_path, ts_key_iv, compressed)) {
+  if (!decrypt_ibd_file(ibd_path, dest_path, ts_key_iv, compressed, n_threads)) {
     std::cerr << "Decrypt failed.\n";
     return 1;
   }
@@ -301,11 +463,11 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
 {
   if (argc < 3) {
     std::cerr << "Usage for mode=5 (rebuild-uncompressed):\n"
-              << "  ib_parser 5 <in_file> <out_file> [--sdi-json=PATH]\n"
+              << "  ib_parser 5 <in_file> <out_file> [--sdi-json=PATH|--sdi-from-ibd]\n"
               << "    [--target-sdi-json=PATH] [--index-id-map=PATH]\n"
               << "    [--target-sdi-root=N] [--use-target-sdi-root|--use-source-sdi-root]\n"
               << "    [--target-space-id=N] [--use-target-space-id|--use-source-space-id]\n"
-              << "    [--target-ibd=PATH] [--cfg-out=PATH] [--validate-remap]\n";
+              << "    [--target-ibd=PATH] [--cfg-out=PATH] [--validate-remap] [--threads=N]\n";
     return 1;
   }
 
@@ -316,6 +478,7 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
   const char* in_file  = argv[1];
   const char* out_file = argv[2];
   const char* source_sdi_json = nullptr;
+  bool source_sdi_from_ibd = false;
   const char* target_sdi_json = nullptr;
   const char* index_id_map = nullptr;
   const char* cfg_out = nullptr;
@@ -329,6 +492,7 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
   bool target_space_id_override_set = false;
   uint32_t target_space_id_override = 0;
   bool validate_remap = false;
+  unsigned n_threads = 0;  // one rebuild worker per core
 
   for (int i = 3; i < argc; ++i) {
     const char* arg = argv[i];
@@ -336,6 +500,10 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
       source_sdi_json = arg + 11;
       continue;
     }
+    if (strcmp(arg, "--sdi-from-ibd") == 0) {
+      source_sdi_from_ibd = true;
+      continue;
+    }
     if (strcmp(arg, "--sdi-json") == 0 && i + 1 < argc) {
       source_sdi_json = argv[++i];
       continue;
@@ -432,6 +600,17 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
       cfg_out = arg + 10;
       continue;
     }
+    if (strncmp(arg, "--threads=", 10) == 0) {
+      const char* value = arg + 10;
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n > 1024) {
+        std::cerr << "Invalid --threads value: " << value << "\n";
+        return 1;
+      }
+      n_threads = static_cast<unsigned>(n);
+      continue;
+    }
     if (strcmp(arg, "--cfg-out") == 0 && i + 1 < argc) {
       cfg_out = argv[++i];
       continue;
@@ -440,8 +619,14 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
     return 1;
   }
 
-  if (target_sdi_json != nullptr && source_sdi_json == nullptr) {
-    std::cerr << "Error: --target-sdi-json requires --sdi-json (source).\n";
+  if (source_sdi_from_ibd && source_sdi_json != nullptr) {
+    std::cerr << "Error: --sdi-json and --sdi-from-ibd are mutually exclusive.\n";
+    return 1;
+  }
+  const bool have_source_sdi = source_sdi_json != nullptr || source_sdi_from_ibd;
+
+  if (target_sdi_json != nullptr && !have_source_sdi) {
+    std::cerr << "Error: --target-sdi-json requires --sdi-json or --sdi-from-ibd (source).\n";
     return 1;
   }
 
@@ -454,9 +639,8 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
     return 1;
   }
 
-  if (cfg_out != nullptr &&
-      (target_sdi_json == nullptr && source_sdi_json == nullptr)) {
-    std::cerr << "Error: --cfg-out requires --sdi-json or --target-sdi-json.\n";
+  if (cfg_out != nullptr && target_sdi_json == nullptr && !have_source_sdi) {
+    std::cerr << "Error: --cfg-out requires --sdi-json, --sdi-from-ibd or --target-sdi-json.\n";
     return 1;
   }
 
@@ -484,404 +668,2855 @@ static int do_rebuild_uncompressed_main(int argc, char** argv)
   }
 
   bool ok = rebuild_uncompressed_ibd(in_fd, out_fd, source_sdi_json,
-                                     target_sdi_json, index_id_map, cfg_out,
+                                     source_sdi_from_ibd, target_sdi_json,
+                                     index_id_map, cfg_out,
                                      use_target_sdi_root, use_source_sdi_root,
                                      target_sdi_root_override_set,
                                      target_sdi_root_override, target_ibd,
                                      use_target_space_id, use_source_space_id,
                                      target_space_id_override_set,
-                                     target_space_id_override);
+                                     target_space_id_override, n_threads);
   my_close(in_fd, MYF(0));
   my_close(out_fd, MYF(0));
   return ok ? 0 : 1;
 }
 
 /**
- * (C) The "parse only" routine (unencrypted + uncompressed).
- *     Illustrative minimal example based on undrop-for-innodb code.
+ * Read-only settings shared by every page parsed in mode 3, whether the
+ * sweep runs on the main thread or on --threads workers.
  */
-static int do_parse_main(int argc, char** argv)
-{
-  if (argc < 3) {
-    std::cerr << "Usage for mode=3 (parse-only):\n"
-              << "  ib_parser 3 <in_file.ibd> <table_def.json> [--index=NAME|ID] [--list-indexes]\n"
-              << "    [--format=pipe|csv|jsonl] [--output=PATH] [--with-meta] [--lob-max-bytes=N]\n"
-              << "    [--raw-integers] [--skip-xdes] [--debug]\n";
-    return 1;
-  }
-
-  const char* in_file = argv[1];
-  const char* json_file = argv[2];
-  const char* out_path = nullptr;
-  std::string index_selector;
-  bool index_selector_explicit = false;
-  bool list_indexes = false;
+struct ParseScanConfig {
+  const parser_context_t* parser_ctx = nullptr;
+  const page_size_t* pg_sz = nullptr;
+  int fd = -1;
+  size_t physical_page_size = 0;
+  size_t logical_page_size = 0;
+  bool tablespace_compressed = false;
   bool skip_xdes = false;
   bool skip_page_check = false;
-  bool debug_mode = false;
-  RowOutputOptions output_opts;
-  output_opts.format = ROW_OUTPUT_PIPE;
-  output_opts.include_meta = false;
-  output_opts.out = nullptr;
+  // --since-lsn: INDEX pages whose FIL_PAGE_LSN is not above it are skipped.
+  uint64_t since_lsn = 0;
+  // --page-map: pages that cannot hold rows of the index in page_map_slot
+  // are not read at all (may be null).
+  const PageMap* page_map = nullptr;
+  uint32_t page_map_slot = PageMap::kNoSlot;
+  // Pages already emitted by an aborted --scan=btree walk (may be null).
+  const std::vector<bool>* skip_pages = nullptr;
+  // --mmap: read pages in place from this mapping instead of pread().
+  const TablespaceMap* map = nullptr;
+  // --keyring: decrypt each page as it is read (never inside the mapping).
+  const PageCipher* cipher = nullptr;
+  // --stats: workers collect their own ParseStats (stage times too when
+  // stats_timing) and merge them into *stats; --progress reports here.
+  ParseStats* stats = nullptr;
+  bool stats_timing = false;
+  ProgressMeter* progress = nullptr;
+};
 
-  for (int i = 3; i < argc; i++) {
-    std::string arg = argv[i];
-    if (arg == "--with-meta") {
-      output_opts.include_meta = true;
-      continue;
-    }
-    if (arg == "--list-indexes") {
-      list_indexes = true;
-      continue;
+/** Per-thread page buffers and XDES cache for the mode 3 sweep. */
+struct ParsePageScratch {
+  std::unique_ptr<unsigned char[]> page_buf;
+  std::unique_ptr<unsigned char[]> logical_buf;
+  std::unique_ptr<unsigned char[]> xdes_scratch;
+  XdesCache xdes_cache;
+  uint64_t rows_reported = 0;  // rows already passed to cfg.progress
+
+  explicit ParsePageScratch(const ParseScanConfig& cfg)
+      : page_buf(new unsigned char[cfg.physical_page_size]),
+        xdes_scratch(new unsigned char[cfg.physical_page_size]) {
+    if (cfg.tablespace_compressed) {
+      logical_buf.reset(new unsigned char[cfg.logical_page_size]);
     }
-    if (arg.rfind("--index=", 0) == 0) {
-      index_selector = arg.substr(std::strlen("--index="));
-      index_selector_explicit = true;
-      continue;
+  }
+
+  /** Physical page page_no (mapped or pread into page_buf); nullptr on failure. */
+  const unsigned char* read_page(const ParseScanConfig& cfg, page_no_t page_no) {
+    StageTimer timer(STAGE_READ);
+    if (ParseStats* stats = current_parse_stats()) {
+      stats->bytes_read += cfg.physical_page_size;
     }
-    if (arg == "--index") {
-      if (i + 1 >= argc) {
-        std::cerr << "--index requires a value\n";
-        return 1;
+    if (cfg.map) {
+      const unsigned char* mapped = cfg.map->page(page_no, cfg.physical_page_size);
+      if (!mapped || !cfg.cipher) {
+        return mapped;
       }
-      index_selector = argv[++i];
-      index_selector_explicit = true;
-      continue;
-    }
-    if (arg.rfind("--format=", 0) == 0) {
-      std::string fmt = arg.substr(std::strlen("--format="));
-      if (fmt == "pipe") {
-        output_opts.format = ROW_OUTPUT_PIPE;
-      } else if (fmt == "csv") {
-        output_opts.format = ROW_OUTPUT_CSV;
-      } else if (fmt == "jsonl") {
-        output_opts.format = ROW_OUTPUT_JSONL;
-      } else {
-        std::cerr << "Unknown format: " << fmt << "\n";
-        return 1;
+      std::memcpy(page_buf.get(), mapped, cfg.physical_page_size);
+    } else {
+      const off_t offset = static_cast<off_t>(page_no) *
+                           static_cast<off_t>(cfg.physical_page_size);
+      if (pread(cfg.fd, page_buf.get(), cfg.physical_page_size, offset) !=
+          static_cast<ssize_t>(cfg.physical_page_size)) {
+        return nullptr;
       }
-      continue;
     }
-    if (arg == "--format") {
-      if (i + 1 >= argc) {
-        std::cerr << "--format requires a value\n";
-        return 1;
-      }
-      std::string fmt = argv[++i];
-      if (fmt == "pipe") {
-        output_opts.format = ROW_OUTPUT_PIPE;
-      } else if (fmt == "csv") {
-        output_opts.format = ROW_OUTPUT_CSV;
-      } else if (fmt == "jsonl") {
-        output_opts.format = ROW_OUTPUT_JSONL;
-      } else {
-        std::cerr << "Unknown format: " << fmt << "\n";
-        return 1;
-      }
-      continue;
+    decrypt_page_buf(cfg, page_no);
+    return page_buf.get();
+  }
+
+  /**
+   * Decrypt page_buf in place when --keyring is set. A page that fails to
+   * decrypt keeps its encrypted page type, so the INDEX filter drops it.
+   */
+  void decrypt_page_buf(const ParseScanConfig& cfg, uint64_t page_no) {
+    if (cfg.cipher &&
+        !cfg.cipher->decrypt(page_buf.get(), cfg.physical_page_size)) {
+      PARSER_LOG_LIMITED(LOG_LEVEL_WARN, "Warning: decrypt failed at page %llu\n",
+                         static_cast<unsigned long long>(page_no));
     }
-    if (arg.rfind("--output=", 0) == 0) {
-      out_path = argv[i] + std::strlen("--output=");
-      continue;
+  }
+
+  /** Read page_no and decompress it if needed; nullptr on failure. */
+  const unsigned char* fetch_page(const ParseScanConfig& cfg,
+                                  page_no_t page_no,
+                                  size_t* size) {
+    const unsigned char* raw = read_page(cfg, page_no);
+    if (raw == nullptr) {
+      return nullptr;
     }
-    if (arg == "--output") {
-      if (i + 1 >= argc) {
-        std::cerr << "--output requires a path\n";
-        return 1;
-      }
-      out_path = argv[++i];
-      continue;
+    if (!cfg.tablespace_compressed) {
+      *size = cfg.physical_page_size;
+      return raw;
     }
-    if (arg.rfind("--lob-max-bytes=", 0) == 0) {
-      const char* value = argv[i] + std::strlen("--lob-max-bytes=");
-      output_opts.lob_max_bytes = static_cast<size_t>(std::strtoull(value, nullptr, 10));
-      continue;
+    StageTimer timer(STAGE_DECOMPRESS);
+    size_t actual_size = 0;
+    if (!decompress_page_inplace(raw, cfg.physical_page_size,
+                                 cfg.logical_page_size, logical_buf.get(),
+                                 cfg.logical_page_size, &actual_size) ||
+        actual_size != cfg.logical_page_size) {
+      return nullptr;
+    }
+    *size = cfg.logical_page_size;
+    return logical_buf.get();
+  }
+
+  void load_xdes_page(const ParseScanConfig& cfg, page_no_t target) {
+    const page_no_t xdes_page = xdes_calc_descriptor_page(*cfg.pg_sz, target);
+    if (xdes_page == FIL_NULL || xdes_cache.page_no == xdes_page) {
+      return;
     }
-    if (arg == "--lob-max-bytes") {
-      if (i + 1 >= argc) {
-        std::cerr << "--lob-max-bytes requires a value\n";
-        return 1;
+    if (cfg.map && !cfg.cipher) {
+      const unsigned char* mapped = cfg.map->page(xdes_page, cfg.physical_page_size);
+      if (mapped) {
+        xdes_cache.update(xdes_page, mapped, cfg.physical_page_size);
       }
-      output_opts.lob_max_bytes =
-          static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
-      continue;
-    }
-    if (arg == "--raw-integers") {
-      output_opts.raw_integers = true;
-      continue;
-    }
-    if (arg == "--skip-xdes") {
-      skip_xdes = true;
-      continue;
-    }
-    if (arg == "--skip-page-check") {
-      skip_page_check = true;
-      continue;
+      return;
     }
-    if (arg == "--debug") {
-      debug_mode = true;
-      continue;
+    // Shares the LOB page cache, so descriptor pages that keep coming back
+    // as the sweep crosses extents are read once.
+    if (read_raw_page_cached(xdes_page, xdes_scratch.get())) {
+      xdes_cache.update(xdes_page, xdes_scratch.get(), cfg.physical_page_size);
     }
-    std::cerr << "Unknown argument: " << arg << "\n";
-    return 1;
   }
 
-  parser_context_t parser_ctx;
+  /** Pass one finished page (and the rows it produced) to --progress. */
+  void report_progress(const ParseScanConfig& cfg) {
+    if (cfg.progress == nullptr) {
+      return;
+    }
+    const ParseStats* stats = current_parse_stats();
+    const uint64_t rows = stats ? stats->rows : 0;
+    cfg.progress->add(1, rows - rows_reported);
+    rows_reported = rows;
+  }
+};
 
-  // 0) Load table definition and extract table name
-  std::string table_name;
-  if (load_ib2sdi_table_columns(json_file, table_name, &parser_ctx) != 0) {
-    std::cerr << "Failed to load table columns from JSON.\n";
-    return 1;
+/**
+ * --page-map: true (counted in pages_skipped) when page_no cannot hold
+ * rows of the selected index, so the sweep need not read it.
+ */
+static bool page_map_skips(const ParseScanConfig& cfg, uint64_t page_no)
+{
+  if (cfg.page_map == nullptr ||
+      cfg.page_map->wanted(page_no, cfg.page_map_slot, cfg.skip_xdes)) {
+    return false;
+  }
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->pages_skipped++;
   }
+  return true;
+}
 
-  if (list_indexes) {
-    print_sdi_indexes(&parser_ctx, stdout);
-    return 0;
+/**
+ * Filter and parse one physical page (in scratch.page_buf or the mapping).
+ * Rows and chatter go to the row context bound to the calling thread.
+ */
+static void parse_page_buffer(const ParseScanConfig& cfg,
+                              ParsePageScratch& scratch,
+                              const unsigned char* page,
+                              uint64_t page_no)
+{
+  if (cfg.skip_pages && page_no < cfg.skip_pages->size() &&
+      (*cfg.skip_pages)[page_no]) {
+    return;
   }
 
-  if (has_sdi_index_definitions(&parser_ctx)) {
-    std::string err;
-    if (!select_index_for_parsing(&parser_ctx, index_selector, &err)) {
-      std::cerr << "Index selection failed: " << err << "\n";
-      return 1;
+  ParseStats* stats = current_parse_stats();
+  if (page == nullptr) {
+    if (stats) {
+      stats->pages_bad++;
     }
-  } else if (index_selector_explicit) {
-    std::cerr << "Index selection requires SDI index metadata.\n";
-    return 1;
+    return;
   }
-
-  // Build a table_def_t from parser context columns
-  static table_def_t my_table;
-  if (build_table_def_from_json(&my_table, table_name.c_str(), &parser_ctx) != 0) {
-    std::cerr << "Failed to build table_def_t from JSON.\n";
-    return 1;
+  const uint32_t on_disk_page_no = mach_read_from_4(page + FIL_PAGE_OFFSET);
+  const uint16_t page_type = mach_read_from_2(page + FIL_PAGE_TYPE);
+  if (stats) {
+    stats->pages[page_class_of(page_type)]++;
   }
-
-  // If your code uses the n_nullable field in ibrec_init_offsets_new():
-  my_table.n_nullable = 0;
-  for (int i = 0; i < my_table.fields_count; i++) {
-    if (my_table.fields[i].can_be_null) my_table.n_nullable++;
+  if (!cfg.skip_page_check && on_disk_page_no != page_no) {
+    return;
+  }
+  const uint64_t page_lsn = mach_read_from_8(page + FIL_PAGE_LSN);
+  if (stats && page_lsn > stats->max_lsn) {
+    stats->max_lsn = page_lsn;
   }
-    // 1) MySQL init
-  my_init();
-  my_thread_init();
 
-  // 2) Resolve selected index ID using system "open + pread" approach
-  int sys_fd = ::open(in_file, O_RDONLY);
-  if (sys_fd < 0) {
-    perror("open");
-    return 1;
+  PARSER_LOG(LOG_LEVEL_TRACE, "DEBUG: page=%lu, type=%u, FIL_PAGE_INDEX=%u\n",
+             (unsigned long)page_no, page_type, (unsigned)FIL_PAGE_INDEX);
+  if (page_type == FIL_PAGE_TYPE_XDES ||
+      page_type == FIL_PAGE_TYPE_FSP_HDR) {
+    scratch.xdes_cache.update(page_no, page, cfg.physical_page_size);
   }
 
-  if (!target_index_is_set(&parser_ctx)) {
-    page_no_t root = selected_index_root(&parser_ctx);
-    uint64_t idx_id = 0;
-    if (root != FIL_NULL && read_index_id_from_root(sys_fd, root, &idx_id)) {
-      set_target_index_id_from_value(&parser_ctx, idx_id);
+  bool free_page = false;
+  {
+    StageTimer timer(STAGE_XDES);
+    scratch.load_xdes_page(cfg, page_no);
+    free_page = !cfg.skip_xdes && scratch.xdes_cache.is_free(page_no, *cfg.pg_sz);
+  }
+  if (free_page) {
+    if (stats) {
+      stats->pages_xdes_free++;
     }
+    PARSER_LOG(LOG_LEVEL_TRACE, "DEBUG: page=%lu marked free by xdes\n",
+               (unsigned long)page_no);
+    return;
   }
 
-  if (!target_index_is_set(&parser_ctx)) {
-    if (index_selector_explicit && has_sdi_index_definitions(&parser_ctx)) {
-      std::cerr << "Could not resolve index id for selected index '"
-                << selected_index_name(&parser_ctx) << "'.\n";
-      ::close(sys_fd);
-      my_thread_end();
-      my_end(0);
-      return 1;
-    }
-    if (discover_target_index_id(sys_fd, &parser_ctx) != 0) {
-      std::cerr << "Could not discover index from " << in_file << std::endl;
-      ::close(sys_fd);
-      my_thread_end();
-      my_end(0);
-      return 1;
+  if (page_type != FIL_PAGE_INDEX) {
+    PARSER_LOG(LOG_LEVEL_TRACE, "DEBUG: page=%lu skipped - not INDEX type\n",
+               (unsigned long)page_no);
+    return;
+  }
+  if (cfg.since_lsn != 0 && page_lsn <= cfg.since_lsn) {
+    // Not modified since the LSN: its rows are in the earlier extraction.
+    if (stats) {
+      stats->pages_unchanged++;
     }
+    return;
   }
 
-  // 3) Now open the file with MySQL's my_open
-  File in_fd = my_open(in_file, O_RDONLY, MYF(0));
-  if (in_fd < 0) {
-    std::cerr << "Cannot open file " << in_file << std::endl;
-    ::close(sys_fd);
-    my_thread_end();
-    my_end(0);
-    return 1;
+  const unsigned char* parse_buf = page;
+  size_t parse_size = cfg.physical_page_size;
+  if (cfg.tablespace_compressed) {
+    StageTimer timer(STAGE_DECOMPRESS);
+    size_t actual_size = 0;
+    if (!decompress_page_inplace(page,
+                                 cfg.physical_page_size,
+                                 cfg.logical_page_size,
+                                 scratch.logical_buf.get(),
+                                 cfg.logical_page_size,
+                                 &actual_size) ||
+        actual_size != cfg.logical_page_size) {
+      if (stats) {
+        stats->pages_bad++;
+      }
+      return;
+    }
+    parse_buf = scratch.logical_buf.get();
+    parse_size = cfg.logical_page_size;
   }
 
-  // 4) Determine page size (for 8KB,16KB, etc.)
-  page_size_t pg_sz(0, 0, false);
-  if (!determine_page_size(in_fd, pg_sz)) {
-    std::cerr << "Could not determine page size from " << in_file << "\n";
-    my_close(in_fd, MYF(0));
-    ::close(sys_fd);
-    my_thread_end();
-    my_end(0);
-    return 1;
+  if (!page_is_comp(parse_buf)) {
+    return;
+  }
+
+  PARSER_LOG(LOG_LEVEL_TRACE,
+             "DEBUG: page_no=%lu, target_index_set=%d, target_index_id=%lu\n",
+             (unsigned long)page_no, (int)cfg.parser_ctx->target_index_set,
+             (unsigned long)cfg.parser_ctx->target_index_id);
+
+  parse_records_on_page(parse_buf, parse_size, page_no, cfg.parser_ctx);
+}
+
+/**
+ * --scan=btree: descend from the selected index root to the leftmost leaf
+ * and parse the leaves along FIL_PAGE_NEXT. Only this index's pages are
+ * read and rows come out in key order.
+ *
+ * With a --where range on the index's first column the descent follows
+ * the node pointers to the first leaf that can hold range.lo instead, and
+ * the leaf walk ends at the first record above range.hi, so only the
+ * subtrees overlapping the range are read.
+ *
+ * Returns false as soon as the tree looks corrupt (unreadable page, wrong
+ * index id or level, FIL_PAGE_PREV not pointing back, a cycle); *why says
+ * what was wrong and parsed[] marks the leaves already written so the
+ * sweep fallback can skip them.
+ */
+static bool run_btree_scan(const ParseScanConfig& cfg,
+                           uint64_t total_pages,
+                           page_no_t root,
+                           bool clustered,
+                           std::vector<bool>* parsed,
+                           uint64_t* pages_read,
+                           std::string* why)
+{
+  ParsePageScratch scratch(cfg);
+  const table_def_t* table = current_row_table();
+  const parser_context_t* ctx = cfg.parser_ctx;
+  const RowOutputOptions& row_opts = current_row_worker_context().output;
+  const KeyRange* leading = row_opts.where.range_for(0);
+  ParseStats* stats = current_parse_stats();
+  parsed->assign(total_pages, false);
+  *pages_read = 0;
+
+  auto count_page = [&](const unsigned char* page) {
+    if (stats) {
+      if (page == nullptr) {
+        stats->pages_bad++;
+      } else {
+        stats->pages[page_class_of(fil_page_get_type(page))]++;
+        stats->max_lsn = std::max(stats->max_lsn, mach_read_from_8(page + FIL_PAGE_LSN));
+      }
+    }
+  };
+
+  auto fail = [&](page_no_t page_no, const char* what) {
+    *why = std::string(what) + " at page " + std::to_string(page_no);
+    return false;
+  };
+
+  // Fetch page_no and check it is a COMPACT page of our index at `level`.
+  auto fetch_index_page = [&](page_no_t page_no, ulint level,
+                              size_t* size) -> const unsigned char* {
+    if (page_no == FIL_NULL || page_no >= total_pages) {
+      return nullptr;
+    }
+    const unsigned char* page = scratch.fetch_page(cfg, page_no, size);
+    (*pages_read)++;
+    count_page(page);
+    if (page == nullptr ||
+        mach_read_from_4(page + FIL_PAGE_OFFSET) != page_no ||
+        fil_page_get_type(page) != FIL_PAGE_INDEX ||
+        !page_is_comp(page) ||
+        !is_target_index(page, ctx) ||
+        mach_read_from_2(page + PAGE_HEADER + PAGE_LEVEL) != level) {
+      return nullptr;
+    }
+    return page;
+  };
+
+  size_t size = 0;
+  const unsigned char* page = scratch.fetch_page(cfg, root, &size);
+  (*pages_read)++;
+  count_page(page);
+  if (page == nullptr || fil_page_get_type(page) != FIL_PAGE_INDEX ||
+      !is_target_index(page, ctx)) {
+    return fail(root, "root is not a page of the selected index");
+  }
+  ulint level = mach_read_from_2(page + PAGE_HEADER + PAGE_LEVEL);
+  // Real trees are a handful of levels deep; anything else is garbage.
+  if (level > 64) {
+    return fail(root, "implausible root level");
+  }
+
+  // 1) Descend along the first node pointer to the leftmost leaf, or the
+  //    one covering the start of the --where range
+  page_no_t page_no = root;
+  while (level > 0) {
+    const page_no_t child =
+        leading ? range_node_ptr_child(page, size, table, clustered, *leading,
+                                       row_opts.raw_integers)
+                : first_node_ptr_child(page, size, table, clustered);
+    PARSER_LOG(LOG_LEVEL_DEBUG, "DEBUG: btree level=%lu page=%lu -> child=%lu\n",
+               (unsigned long)level, (unsigned long)page_no, (unsigned long)child);
+    level--;
+    page = fetch_index_page(child, level, &size);
+    if (page == nullptr) {
+      return fail(page_no, "bad node pointer");
+    }
+    page_no = child;
+  }
+  if (!leading && mach_read_from_4(page + FIL_PAGE_PREV) != FIL_NULL) {
+    return fail(page_no, "leftmost leaf has a left sibling");
+  }
+
+  // 2) Walk the leaf chain
+  page_no_t prev = mach_read_from_4(page + FIL_PAGE_PREV);
+  while (true) {
+    if ((*parsed)[page_no]) {
+      return fail(page_no, "leaf chain cycle");
+    }
+    if (mach_read_from_4(page + FIL_PAGE_PREV) != prev) {
+      return fail(page_no, "broken FIL_PAGE_PREV link");
+    }
+    bool past_range = false;
+    if (cfg.since_lsn != 0 && mach_read_from_8(page + FIL_PAGE_LSN) <= cfg.since_lsn) {
+      if (stats) {
+        stats->pages_unchanged++;
+      }
+    } else {
+      past_range = parse_records_on_page(page, size, page_no, ctx);
+    }
+    (*parsed)[page_no] = true;
+    scratch.report_progress(cfg);
+
+    const page_no_t next = mach_read_from_4(page + FIL_PAGE_NEXT);
+    if (next == FIL_NULL || past_range) {
+      break;
+    }
+    prev = page_no;
+    page = fetch_index_page(next, 0, &size);
+    if (page == nullptr) {
+      return fail(prev, "bad FIL_PAGE_NEXT link");
+    }
+    page_no = next;
+  }
+  return true;
+}
+
+// Pages per work unit for --threads. Small enough to balance well, large
+// enough that the per-chunk stream setup is noise. IB_PARSER_CHUNK_PAGES
+// overrides it (tests use 1 to force many chunks on small fixtures).
+static const uint64_t kParseChunkPages = 256;
+
+static uint64_t parse_chunk_pages() {
+  const char* env = std::getenv("IB_PARSER_CHUNK_PAGES");
+  if (env && *env) {
+    char* end = nullptr;
+    unsigned long long val = std::strtoull(env, &end, 10);
+    if (end != env && val > 0) {
+      return static_cast<uint64_t>(val);
+    }
+  }
+  return kParseChunkPages;
+}
+
+// A chunk's rows stay in memory up to this size and go on in a temporary
+// file after it, so that chunks waiting for their turn (up to 4 per
+// thread) do not hold wide rows or streamed LOB values in RAM. The
+// environment variable IB_PARSER_CHUNK_SPILL_BYTES overrides it (tests use
+// 1 to spill every chunk).
+static const size_t kChunkSpillBytes = 8 << 20;
+// Read size when copying a spilled chunk to the output.
+static const size_t kChunkCopyBytes = 1 << 20;
+
+static size_t chunk_spill_bytes() {
+  const char* env = std::getenv("IB_PARSER_CHUNK_SPILL_BYTES");
+  if (env && *env) {
+    char* end = nullptr;
+    unsigned long long val = std::strtoull(env, &end, 10);
+    if (end != env && val > 0) {
+      return static_cast<size_t>(val);
+    }
+  }
+  return kChunkSpillBytes;
+}
+
+/**
+ * Where a --threads chunk's rows are written: a stdio stream over memory
+ * that moves to an unlinked file in $TMPDIR (or /tmp) once it passes
+ * spill_bytes.
+ */
+class ChunkRows {
+ public:
+  explicit ChunkRows(size_t spill_bytes) : spill_bytes_(spill_bytes) {}
+  ChunkRows(const ChunkRows&) = delete;
+  ChunkRows& operator=(const ChunkRows&) = delete;
+  ~ChunkRows() {
+    if (spill_ >= 0) {
+      ::close(spill_);
+    }
+  }
+
+  /** A stream writing here (ftell() works on it); nullptr on failure. */
+  FILE* open_stream() {
+    cookie_io_functions_t io;
+    std::memset(&io, 0, sizeof(io));
+    io.write = cookie_write;
+    io.seek = cookie_seek;
+    return fopencookie(this, "w", io);
+  }
+
+  uint64_t size() const { return size_; }
+  const std::string& error() const { return error_; }
+
+  /** Bytes [from, to) to out; false (with error()) if they cannot be read. */
+  bool copy(uint64_t from, uint64_t to, FILE* out) {
+    if (spill_ < 0) {
+      std::fwrite(mem_.data() + from, 1, static_cast<size_t>(to - from), out);
+      return true;
+    }
+    std::unique_ptr<char[]> buf(new char[kChunkCopyBytes]);
+    while (from < to) {
+      const size_t want =
+          static_cast<size_t>(std::min<uint64_t>(to - from, kChunkCopyBytes));
+      const ssize_t rd = pread(spill_, buf.get(), want, static_cast<off_t>(from));
+      if (rd <= 0) {
+        if (rd < 0 && errno == EINTR) {
+          continue;
+        }
+        error_ = std::string("cannot read back a spilled chunk: ") +
+                 (rd < 0 ? std::strerror(errno) : "short file");
+        return false;
+      }
+      std::fwrite(buf.get(), 1, static_cast<size_t>(rd), out);
+      from += static_cast<uint64_t>(rd);
+    }
+    return true;
+  }
+
+ private:
+  bool write(const char* p, size_t n) {
+    if (spill_ < 0 && mem_.size() + n > spill_bytes_) {
+      if (!start_spill()) {
+        return false;
+      }
+    }
+    if (spill_ < 0) {
+      mem_.append(p, n);
+    } else if (!write_fd(p, n)) {
+      return false;
+    }
+    size_ += n;
+    return true;
+  }
+
+  bool start_spill() {
+    const char* tmpdir = std::getenv("TMPDIR");
+    std::string name = std::string(tmpdir && *tmpdir ? tmpdir : "/tmp") +
+                       "/ib_parser_chunk.XXXXXX";
+    spill_ = mkstemp(&name[0]);
+    if (spill_ < 0) {
+      error_ = "cannot create a file in " + name.substr(0, name.rfind('/')) +
+               " to spill a chunk to: " + std::strerror(errno);
+      return false;
+    }
+    ::unlink(name.c_str());
+    const bool ok = write_fd(mem_.data(), mem_.size());
+    std::string().swap(mem_);
+    return ok;
+  }
+
+  bool write_fd(const char* p, size_t n) {
+    while (n > 0) {
+      const ssize_t wr = ::write(spill_, p, n);
+      if (wr < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        error_ = std::string("cannot spill a chunk to disk: ") + std::strerror(errno);
+        return false;
+      }
+      p += wr;
+      n -= static_cast<size_t>(wr);
+    }
+    return true;
+  }
+
+  static ssize_t cookie_write(void* cookie, const char* buf, size_t size) {
+    auto* rows = static_cast<ChunkRows*>(cookie);
+    return rows->write(buf, size) ? static_cast<ssize_t>(size) : -1;
+  }
+
+  // Only ftell(): the position is the number of bytes written.
+  static int cookie_seek(void* cookie, off64_t* pos, int whence) {
+    auto* rows = static_cast<ChunkRows*>(cookie);
+    if (whence != SEEK_CUR || *pos != 0) {
+      errno = ESPIPE;
+      return -1;
+    }
+    *pos = static_cast<off64_t>(rows->size_);
+    return 0;
+  }
+
+  size_t spill_bytes_;
+  std::string mem_;
+  int spill_ = -1;
+  uint64_t size_ = 0;
+  std::string error_;
+};
+
+/** Buffered output of one chunk, waiting to be emitted in page order. */
+struct ParseChunkOutput {
+  std::unique_ptr<ChunkRows> rows;
+  char* log = nullptr;
+  size_t log_len = 0;
+  long header_begin = -1;
+  long header_end = -1;
+  ParseStats stats;  // counters of this chunk's pages
+  bool ready = false;
+};
+
+/**
+ * Write out a finished chunk, its diagnostics to stderr and its rows to
+ * rows_out, dropping its column header if an earlier chunk wrote one
+ * (*header_done). Frees the chunk's buffers. false (with *err) if rows
+ * spilled to disk cannot be read back.
+ */
+static bool emit_parse_chunk(ParseChunkOutput& chunk, FILE* rows_out,
+                             bool* header_done, std::string* err,
+                             OutputFileWriter* file_writer = nullptr)
+{
+  if (chunk.log_len > 0) {
+    std::fwrite(chunk.log, 1, chunk.log_len, stderr);
+  }
+  std::free(chunk.log);
+  chunk.log = nullptr;
+  std::unique_ptr<ChunkRows> rows(std::move(chunk.rows));
+  const uint64_t rows_len = rows ? rows->size() : 0;
+  if (rows_len == 0) {
+    return true;
+  }
+  bool ok;
+  if (chunk.header_begin >= 0 && *header_done) {
+    // Another chunk already wrote the column header; drop this copy.
+    ok = rows->copy(0, static_cast<uint64_t>(chunk.header_begin), rows_out) &&
+         rows->copy(static_cast<uint64_t>(chunk.header_end), rows_len, rows_out);
+  } else if (chunk.header_begin == 0 && file_writer) {
+    ok = rows->copy(0, static_cast<uint64_t>(chunk.header_end), rows_out);
+    file_writer->header_end();
+    ok = ok && rows->copy(static_cast<uint64_t>(chunk.header_end), rows_len, rows_out);
+  } else {
+    ok = rows->copy(0, rows_len, rows_out);
+  }
+  if (!ok) {
+    *err = rows->error();
+    return false;
+  }
+  if (chunk.header_begin >= 0) {
+    *header_done = true;
+  }
+  // A chunk holds whole rows, so the output may be split after it.
+  if (file_writer) {
+    file_writer->row_end();
+  }
+  return true;
+}
+
+/**
+ * Parse pages [first, last) into result's buffers (memory, spilling to a
+ * temporary file past chunk_spill_bytes()): rows through wctx (bound to the
+ * calling thread), diagnostics in page order with them, counters in
+ * result->stats. false, with *err and nothing buffered, if the rows
+ * cannot be kept.
+ */
+static bool parse_chunk_to_memory(const ParseScanConfig& cfg,
+                                  ParsePageScratch& scratch,
+                                  RowWorkerContext& wctx,
+                                  uint64_t first, uint64_t last,
+                                  ParseChunkOutput* result,
+                                  std::string* err)
+{
+  std::unique_ptr<ChunkRows> rows(new ChunkRows(chunk_spill_bytes()));
+  FILE* rows_stream = rows->open_stream();
+  FILE* log_stream = open_memstream(&result->log, &result->log_len);
+  if (!rows_stream || !log_stream) {
+    if (rows_stream) {
+      std::fclose(rows_stream);
+    }
+    if (log_stream) {
+      std::fclose(log_stream);
+    }
+    std::free(result->log);
+    result->log = nullptr;
+    *err = "cannot allocate output buffers";
+    return false;
+  }
+  wctx.output.out = rows_stream;
+  wctx.printed_header = false;
+  wctx.header_begin = -1;
+  wctx.header_end = -1;
+  // Per-chunk counters, merged as the chunk is written out, so the totals
+  // always match the output so far.
+  result->stats.timing = cfg.stats_timing;
+  ParseStatsScope stats_scope(&result->stats);
+  scratch.rows_reported = 0;
+
+  {
+    LogStreamScope log_scope(log_stream);
+    for (uint64_t page_no = first; page_no < last; page_no++) {
+      if (page_map_skips(cfg, page_no)) {
+        scratch.report_progress(cfg);
+        continue;
+      }
+      const unsigned char* page = scratch.read_page(cfg, page_no);
+      if (page == nullptr) {
+        PARSER_LOG_LIMITED(LOG_LEVEL_WARN, "Warning: read failed at page %llu\n",
+                           static_cast<unsigned long long>(page_no));
+        // Counted and skipped, as the single-threaded loops do.
+        if (ParseStats* stats = current_parse_stats()) {
+          stats->pages_bad++;
+        }
+        scratch.report_progress(cfg);
+        continue;
+      }
+      parse_page_buffer(cfg, scratch, page, page_no);
+      scratch.report_progress(cfg);
+    }
+  }
+
+  flush_row_output();
+  wctx.output.out = nullptr;
+  result->header_begin = wctx.header_begin;
+  result->header_end = wctx.header_end;
+  std::fclose(log_stream);
+  const bool rows_ok = !std::ferror(rows_stream);
+  if (std::fclose(rows_stream) != 0 || !rows_ok) {
+    *err = rows->error().empty() ? "cannot buffer the chunk's rows" : rows->error();
+    std::free(result->log);
+    result->log = nullptr;
+    return false;
+  }
+  result->rows = std::move(rows);
+  result->ready = true;
+  return true;
+}
+
+/**
+ * First page of each --threads chunk of [first_page, total_pages), then
+ * total_pages. Chunks are parse_chunk_pages() pages long; with --page-map
+ * they hold that many of the pages the map keeps instead, so that sparse
+ * and dense stretches of the tablespace make equal work.
+ */
+static std::vector<uint64_t> parse_chunk_bounds(const ParseScanConfig& cfg,
+                                                uint64_t first_page,
+                                                uint64_t total_pages)
+{
+  const uint64_t chunk_pages = parse_chunk_pages();
+  std::vector<uint64_t> bounds;
+  if (cfg.page_map == nullptr) {
+    for (uint64_t page_no = first_page; page_no < total_pages; page_no += chunk_pages) {
+      bounds.push_back(page_no);
+    }
+  } else if (first_page < total_pages) {
+    // Pages before the first kept one go with the first chunk.
+    bounds.push_back(first_page);
+    uint64_t kept = 0;
+    for (uint64_t page_no = first_page; page_no < total_pages; page_no++) {
+      if (!cfg.page_map->wanted(page_no, cfg.page_map_slot, cfg.skip_xdes)) {
+        continue;
+      }
+      if (kept > 0 && kept % chunk_pages == 0) {
+        bounds.push_back(page_no);
+      }
+      kept++;
+    }
+  }
+  bounds.push_back(total_pages);
+  return bounds;
+}
+
+/**
+ * Page-parallel mode 3 sweep of pages [first_page, total_pages). Workers
+ * pread and parse the chunks of parse_chunk_bounds() into private memory
+ * streams; the chunks are then written out in page order (or completion
+ * order with --unordered), so the result matches the single-threaded run
+ * byte for byte. In page order, chunk_written (if set) is called with the
+ * page after each chunk once it is written, for --checkpoint.
+ */
+static bool run_parallel_parse(const ParseScanConfig& cfg,
+                               uint64_t first_page,
+                               uint64_t total_pages,
+                               unsigned n_threads,
+                               bool unordered,
+                               const RowOutputOptions& output_opts,
+                               const LobReadContext& lob_ctx,
+                               const table_def_t& table,
+                               FILE* out_file,
+                               PageCacheCounters* cache_totals,
+                               const std::function<void(uint64_t)>& chunk_written)
+{
+  const std::vector<uint64_t> bounds =
+      parse_chunk_bounds(cfg, first_page, total_pages);
+  const uint64_t n_chunks = bounds.size() - 1;
+  if (n_threads > n_chunks) {
+    n_threads = static_cast<unsigned>(std::max<uint64_t>(n_chunks, 1));
+  }
+  // Bound how far workers may run ahead of the writer in ordered mode; the
+  // chunks in flight then fit a ring of `window` slots.
+  const uint64_t window = static_cast<uint64_t>(n_threads) * 4;
+
+  std::vector<ParseChunkOutput> chunks(unordered ? 0 : window);
+  // mu guards the ring, next_emit and failed; write_mu serialises the
+  // output (only needed with --unordered, where workers write). Chunks are
+  // taken out of the ring under mu and written without it, so workers
+  // never wait on disk I/O to publish a chunk.
+  std::mutex mu;
+  std::mutex write_mu;
+  std::condition_variable cv;
+  std::atomic<uint64_t> next_chunk{0};
+  uint64_t next_emit = 0;
+  // A --scan=btree attempt may already have written the header (and rows
+  // still sitting in this thread's sink).
+  flush_row_output();
+  bool header_done = current_row_worker_context().printed_header;
+  bool failed = false;
+  FILE* rows_out = out_file ? out_file : stdout;
+
+  // Caller holds write_mu, or is the ordered writer.
+  auto emit_chunk = [&](ParseChunkOutput& chunk, uint64_t idx) {
+    if (cfg.stats) {
+      cfg.stats->merge(chunk.stats);
+    }
+    StageTimer timer(STAGE_WRITE);
+    std::string err;
+    if (!emit_parse_chunk(chunk, rows_out, &header_done, &err, output_opts.file_writer)) {
+      std::cerr << "Cannot write chunk " << idx << ": " << err << "\n";
+      return false;
+    }
+    return true;
+  };
+
+  auto worker = [&]() {
+    my_thread_init();
+    RowWorkerContext wctx;
+    wctx.output = output_opts;
+    wctx.lob = lob_ctx;
+    if (lob_ctx.cache) {
+      wctx.lob.cache = std::make_shared<PageCache>(lob_ctx.cache->capacity());
+    }
+    // table_def_t is read-only while parsing and far too large (the field
+    // limits embed enum/set tables) to copy per worker, so share it.
+    wctx.table = const_cast<table_def_t*>(&table);
+    bind_row_worker_context(&wctx);
+    ParsePageScratch scratch(cfg);
+
+    while (true) {
+      const uint64_t idx = next_chunk.fetch_add(1);
+      if (idx >= n_chunks) {
+        break;
+      }
+      if (!unordered) {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return failed || idx < next_emit + window; });
+        if (failed) {
+          break;
+        }
+      }
+
+      ParseChunkOutput result;
+      std::string err;
+      if (!parse_chunk_to_memory(cfg, scratch, wctx, bounds[idx], bounds[idx + 1],
+                                 &result, &err)) {
+        std::cerr << "Cannot buffer the output of chunk " << idx << ": " << err << "\n";
+        std::lock_guard<std::mutex> lock(mu);
+        failed = true;
+        cv.notify_all();
+        break;
+      }
+
+      if (unordered) {
+        bool written;
+        {
+          std::lock_guard<std::mutex> lock(write_mu);
+          written = emit_chunk(result, idx);
+        }
+        if (!written) {
+          std::lock_guard<std::mutex> lock(mu);
+          failed = true;
+          cv.notify_all();
+          break;
+        }
+      } else {
+        std::lock_guard<std::mutex> lock(mu);
+        chunks[idx % window] = std::move(result);
+        cv.notify_all();
+      }
+    }
+
+    if (wctx.lob.cache && cache_totals) {
+      std::lock_guard<std::mutex> lock(mu);
+      cache_totals->hits += wctx.lob.cache->hits();
+      cache_totals->misses += wctx.lob.cache->misses();
+    }
+    bind_row_worker_context(nullptr);
+    my_thread_end();
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(n_threads);
+  for (unsigned i = 0; i < n_threads; i++) {
+    pool.emplace_back(worker);
+  }
+
+  if (!unordered) {
+    std::unique_lock<std::mutex> lock(mu);
+    while (next_emit < n_chunks && !failed) {
+      ParseChunkOutput& slot = chunks[next_emit % window];
+      cv.wait(lock, [&] { return failed || slot.ready; });
+      if (failed) {
+        break;
+      }
+      ParseChunkOutput chunk = std::move(slot);
+      slot = ParseChunkOutput();
+      lock.unlock();
+      const bool written = emit_chunk(chunk, next_emit);
+      if (written && chunk_written) {
+        chunk_written(bounds[next_emit + 1]);
+      }
+      lock.lock();
+      if (!written) {
+        failed = true;
+        cv.notify_all();
+        break;
+      }
+      // Only now may a worker start the chunk that reuses the slot, so
+      // the chunks held in memory stay within the window.
+      next_emit++;
+      cv.notify_all();
+    }
+  }
+
+  for (auto& t : pool) {
+    t.join();
+  }
+  for (auto& chunk : chunks) {
+    std::free(chunk.log);
+  }
+  std::fflush(rows_out);
+  return !failed;
+}
+
+// --format value: one of the text formats, or arrow/parquet (*columnar).
+static bool parse_row_format(const std::string& fmt, RowOutputFormat* text,
+                             bool* columnar, ColumnarFormat* columnar_format) {
+  *columnar = false;
+  if (fmt == "pipe") {
+    *text = ROW_OUTPUT_PIPE;
+  } else if (fmt == "csv") {
+    *text = ROW_OUTPUT_CSV;
+  } else if (fmt == "jsonl") {
+    *text = ROW_OUTPUT_JSONL;
+  } else if (fmt == "arrow") {
+    *columnar = true;
+    *columnar_format = COLUMNAR_ARROW;
+  } else if (fmt == "parquet") {
+    *columnar = true;
+    *columnar_format = COLUMNAR_PARQUET;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// --page-range=START:END (END empty: to the end of the tablespace).
+static bool parse_page_range(const char* value, uint64_t* first, uint64_t* end) {
+  char* stop = nullptr;
+  errno = 0;
+  *first = std::strtoull(value, &stop, 10);
+  if (stop == value || *stop != ':' || errno != 0) {
+    return false;
+  }
+  const char* tail = stop + 1;
+  if (*tail == '\0') {
+    *end = UINT64_MAX;
+    return true;
+  }
+  *end = std::strtoull(tail, &stop, 10);
+  return stop != tail && *stop == '\0' && errno == 0 && *first <= *end;
+}
+
+// --shard=I/N, 0 <= I < N.
+static bool parse_shard(const char* value, uint64_t* index, uint64_t* count) {
+  char* stop = nullptr;
+  errno = 0;
+  *index = std::strtoull(value, &stop, 10);
+  if (stop == value || *stop != '/' || errno != 0) {
+    return false;
+  }
+  const char* tail = stop + 1;
+  *count = std::strtoull(tail, &stop, 10);
+  return stop != tail && *stop == '\0' && errno == 0 && *index < *count;
+}
+
+/**
+ * --output-split value: bytes, with an optional K, M or G suffix (powers
+ * of 1024).
+ */
+static bool parse_byte_size(const char* value, uint64_t* bytes)
+{
+  char* stop = nullptr;
+  errno = 0;
+  const unsigned long long n = std::strtoull(value, &stop, 10);
+  if (stop == value || errno != 0) {
+    return false;
+  }
+  unsigned shift = 0;
+  switch (*stop) {
+    case '\0': break;
+    case 'k': case 'K': shift = 10; stop++; break;
+    case 'm': case 'M': shift = 20; stop++; break;
+    case 'g': case 'G': shift = 30; stop++; break;
+    default: return false;
+  }
+  if (*stop != '\0' || n == 0 || n > (UINT64_MAX >> shift)) {
+    return false;
+  }
+  *bytes = static_cast<uint64_t>(n) << shift;
+  return true;
+}
+
+/**
+ * (C) The "parse only" routine (unencrypted + uncompressed).
+ *     Illustrative minimal example based on undrop-for-innodb code.
+ */
+static int do_parse_main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage for mode=3 (parse-only):\n"
+              << "  ib_parser 3 <in_file.ibd> [<table_def.json>] [--sdi-cache=DIR]\n"
+              << "    [--index=NAME|ID] [--list-indexes]\n"
+              << "    [--format=pipe|csv|jsonl|arrow|parquet] [--output=PATH] [--with-meta]\n"
+              << "    [--output-compress=zstd|lz4] [--output-split=SIZE] [--output-threads=N]\n"
+              << "    [--columns=a,b,c] [--where=EXPR] [--row-group-rows=N] [--lob-max-bytes=N]\n"
+              << "    [--raw-integers] [--skip-xdes] [--skip-page-check] [--threads=N] [--unordered]\n"
+              << "    [--scan=sweep|btree] [--lob-cache-mb=N] [--mmap] [--page-map[=PATH]]\n"
+              << "    [--page-range=START:END | --shard=I/N] [--shard-manifest[=PATH]]\n"
+              << "    [--recover-deleted]\n"
+              << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n"
+              << "    [--stats[=PATH.json]] [--progress[=SECONDS]]\n"
+              << "    [--since-lsn=N] [--checkpoint[=PATH]] [--checkpoint-interval=SECONDS] [--resume]\n"
+              << "    [--log-level=error|warn|info|debug|trace] [--debug]\n";
+    return 1;
+  }
+
+  const char* in_file = argv[1];
+  // No JSON argument: read the definition from the tablespace itself.
+  const char* json_file =
+      (argc > 2 && std::strncmp(argv[2], "--", 2) != 0) ? argv[2] : nullptr;
+  std::string sdi_cache_dir;
+  const char* out_path = nullptr;
+  std::string index_selector;
+  bool index_selector_explicit = false;
+  bool list_indexes = false;
+  bool skip_xdes = false;
+  bool skip_page_check = false;
+  unsigned n_threads = 1;
+  bool unordered = false;
+  bool btree_scan = false;
+  size_t lob_cache_mb = 16;
+  bool use_mmap = false;
+  bool use_page_map = false;
+  std::string page_map_path;
+  std::string range_spec;  // --page-range or --shard, as given
+  uint64_t range_first = 0;
+  uint64_t range_end = UINT64_MAX;
+  uint64_t shard_index = 0;
+  uint64_t shard_count = 0;
+  bool shard_manifest = false;
+  std::string manifest_path;
+  KeyringArgs keyring;
+  bool columnar = false;
+  ColumnarFormat columnar_format = COLUMNAR_ARROW;
+  size_t row_group_rows = 65536;
+  std::string column_list;
+  std::string where_expr;
+  bool stats_enabled = false;
+  std::string stats_path;
+  unsigned progress_s = 0;
+  uint64_t since_lsn = 0;
+  bool checkpoint = false;
+  bool resume = false;
+  std::string checkpoint_path;
+  unsigned checkpoint_interval_s = 60;
+  OutputFileOptions file_opts;
+  unsigned output_threads = 0;
+  std::string format_name = "pipe";
+  RowOutputOptions output_opts;
+  output_opts.format = ROW_OUTPUT_PIPE;
+  output_opts.include_meta = false;
+  output_opts.out = nullptr;
+
+  for (int i = json_file ? 3 : 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--with-meta") {
+      output_opts.include_meta = true;
+      continue;
+    }
+    if (arg == "--recover-deleted") {
+      output_opts.recover_deleted = true;
+      continue;
+    }
+    if (arg == "--list-indexes") {
+      list_indexes = true;
+      continue;
+    }
+    if (arg.rfind("--sdi-cache=", 0) == 0) {
+      sdi_cache_dir = arg.substr(std::strlen("--sdi-cache="));
+      if (sdi_cache_dir.empty()) {
+        std::cerr << "--sdi-cache requires a directory\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--index=", 0) == 0) {
+      index_selector = arg.substr(std::strlen("--index="));
+      index_selector_explicit = true;
+      continue;
+    }
+    if (arg == "--index") {
+      if (i + 1 >= argc) {
+        std::cerr << "--index requires a value\n";
+        return 1;
+      }
+      index_selector = argv[++i];
+      index_selector_explicit = true;
+      continue;
+    }
+    if (arg.rfind("--format=", 0) == 0 || arg == "--format") {
+      std::string fmt;
+      if (arg == "--format") {
+        if (i + 1 >= argc) {
+          std::cerr << "--format requires a value\n";
+          return 1;
+        }
+        fmt = argv[++i];
+      } else {
+        fmt = arg.substr(std::strlen("--format="));
+      }
+      if (!parse_row_format(fmt, &output_opts.format, &columnar,
+                            &columnar_format)) {
+        std::cerr << "Unknown format: " << fmt << "\n";
+        return 1;
+      }
+      format_name = fmt;
+      continue;
+    }
+    if (arg.rfind("--columns=", 0) == 0) {
+      column_list = arg.substr(std::strlen("--columns="));
+      continue;
+    }
+    if (arg.rfind("--where=", 0) == 0 || arg == "--where") {
+      if (arg == "--where") {
+        if (i + 1 >= argc) {
+          std::cerr << "--where requires a value\n";
+          return 1;
+        }
+        where_expr = argv[++i];
+      } else {
+        where_expr = arg.substr(std::strlen("--where="));
+      }
+      continue;
+    }
+    if (arg.rfind("--row-group-rows=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--row-group-rows=");
+      char* end = nullptr;
+      unsigned long long n = std::strtoull(value, &end, 10);
+      if (end == value || *end != '\0' || n == 0) {
+        std::cerr << "Invalid --row-group-rows value: " << value << "\n";
+        return 1;
+      }
+      row_group_rows = static_cast<size_t>(n);
+      continue;
+    }
+    if (arg.rfind("--output=", 0) == 0) {
+      out_path = argv[i] + std::strlen("--output=");
+      continue;
+    }
+    if (arg == "--output") {
+      if (i + 1 >= argc) {
+        std::cerr << "--output requires a path\n";
+        return 1;
+      }
+      out_path = argv[++i];
+      continue;
+    }
+    if (arg.rfind("--output-compress=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--output-compress=");
+      if (!OutputFileWriter::parse_compression(value, &file_opts.compression)) {
+        std::cerr << "Unknown --output-compress value: " << value
+                  << " (expected zstd or lz4)\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--output-split=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--output-split=");
+      if (!parse_byte_size(value, &file_opts.split_bytes)) {
+        std::cerr << "Invalid --output-split value: " << value << "\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--output-threads=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--output-threads=");
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n == 0 || n > 1024) {
+        std::cerr << "Invalid --output-threads value: " << value << "\n";
+        return 1;
+      }
+      output_threads = static_cast<unsigned>(n);
+      continue;
+    }
+    if (arg.rfind("--lob-max-bytes=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--lob-max-bytes=");
+      output_opts.lob_max_bytes = static_cast<size_t>(std::strtoull(value, nullptr, 10));
+      continue;
+    }
+    if (arg == "--lob-max-bytes") {
+      if (i + 1 >= argc) {
+        std::cerr << "--lob-max-bytes requires a value\n";
+        return 1;
+      }
+      output_opts.lob_max_bytes =
+          static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+      continue;
+    }
+    if (arg == "--raw-integers") {
+      output_opts.raw_integers = true;
+      continue;
+    }
+    if (arg == "--skip-xdes") {
+      skip_xdes = true;
+      continue;
+    }
+    if (arg == "--skip-page-check") {
+      skip_page_check = true;
+      continue;
+    }
+    if (arg.rfind("--threads=", 0) == 0 || arg == "--threads") {
+      const char* value = nullptr;
+      if (arg == "--threads") {
+        if (i + 1 >= argc) {
+          std::cerr << "--threads requires a value\n";
+          return 1;
+        }
+        value = argv[++i];
+      } else {
+        value = argv[i] + std::strlen("--threads=");
+      }
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n > 1024) {
+        std::cerr << "Invalid --threads value: " << value << "\n";
+        return 1;
+      }
+      // 0 => one worker per hardware thread
+      n_threads = (n == 0) ? std::max(1u, std::thread::hardware_concurrency())
+                           : static_cast<unsigned>(n);
+      continue;
+    }
+    if (arg.rfind("--scan=", 0) == 0 || arg == "--scan") {
+      std::string scan;
+      if (arg == "--scan") {
+        if (i + 1 >= argc) {
+          std::cerr << "--scan requires a value\n";
+          return 1;
+        }
+        scan = argv[++i];
+      } else {
+        scan = arg.substr(std::strlen("--scan="));
+      }
+      if (scan == "btree") {
+        btree_scan = true;
+      } else if (scan == "sweep") {
+        btree_scan = false;
+      } else {
+        std::cerr << "Unknown scan mode: " << scan << "\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--lob-cache-mb=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--lob-cache-mb=");
+      char* end = nullptr;
+      unsigned long long mb = std::strtoull(value, &end, 10);
+      if (end == value || *end != '\0' || mb > (1ULL << 20)) {
+        std::cerr << "Invalid --lob-cache-mb value: " << value << "\n";
+        return 1;
+      }
+      lob_cache_mb = static_cast<size_t>(mb);
+      continue;
+    }
+    if (arg == "--mmap") {
+      use_mmap = true;
+      continue;
+    }
+    if (arg == "--page-map") {
+      use_page_map = true;
+      continue;
+    }
+    if (arg.rfind("--page-map=", 0) == 0) {
+      use_page_map = true;
+      page_map_path = arg.substr(std::strlen("--page-map="));
+      if (page_map_path.empty()) {
+        std::cerr << "--page-map= requires a path\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--page-range=", 0) == 0 || arg.rfind("--shard=", 0) == 0) {
+      const bool is_shard = arg[2] == 's';
+      const char* value = std::strchr(argv[i], '=') + 1;
+      if (!range_spec.empty()) {
+        std::cerr << "Give one --page-range or --shard\n";
+        return 1;
+      }
+      if (is_shard ? !parse_shard(value, &shard_index, &shard_count)
+                   : !parse_page_range(value, &range_first, &range_end)) {
+        std::cerr << "Invalid " << (is_shard ? "--shard" : "--page-range")
+                  << " value: " << value << "\n";
+        return 1;
+      }
+      range_spec = arg.substr(2);
+      continue;
+    }
+    if (arg == "--shard-manifest") {
+      shard_manifest = true;
+      continue;
+    }
+    if (arg.rfind("--shard-manifest=", 0) == 0) {
+      shard_manifest = true;
+      manifest_path = arg.substr(std::strlen("--shard-manifest="));
+      if (manifest_path.empty()) {
+        std::cerr << "--shard-manifest= requires a path\n";
+        return 1;
+      }
+      continue;
+    }
+    if (keyring.consume(argv[i])) {
+      continue;
+    }
+    if (arg == "--unordered") {
+      unordered = true;
+      continue;
+    }
+    if (arg == "--stats") {
+      stats_enabled = true;
+      continue;
+    }
+    if (arg.rfind("--stats=", 0) == 0) {
+      stats_enabled = true;
+      stats_path = arg.substr(std::strlen("--stats="));
+      continue;
+    }
+    if (arg == "--progress") {
+      progress_s = 60;
+      continue;
+    }
+    if (arg.rfind("--progress=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--progress=");
+      char* end = nullptr;
+      unsigned long secs = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || secs == 0 || secs > 86400) {
+        std::cerr << "Invalid --progress value: " << value << "\n";
+        return 1;
+      }
+      progress_s = static_cast<unsigned>(secs);
+      continue;
+    }
+    if (arg.rfind("--since-lsn=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--since-lsn=");
+      char* end = nullptr;
+      errno = 0;
+      unsigned long long lsn = std::strtoull(value, &end, 10);
+      if (end == value || *end != '\0' || errno != 0) {
+        std::cerr << "Invalid --since-lsn value: " << value << "\n";
+        return 1;
+      }
+      since_lsn = static_cast<uint64_t>(lsn);
+      continue;
+    }
+    if (arg == "--checkpoint") {
+      checkpoint = true;
+      continue;
+    }
+    if (arg.rfind("--checkpoint=", 0) == 0) {
+      checkpoint = true;
+      checkpoint_path = arg.substr(std::strlen("--checkpoint="));
+      if (checkpoint_path.empty()) {
+        std::cerr << "--checkpoint= requires a path\n";
+        return 1;
+      }
+      continue;
+    }
+    if (arg.rfind("--checkpoint-interval=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--checkpoint-interval=");
+      char* end = nullptr;
+      unsigned long secs = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || secs > 86400) {
+        std::cerr << "Invalid --checkpoint-interval value: " << value << "\n";
+        return 1;
+      }
+      checkpoint_interval_s = static_cast<unsigned>(secs);
+      continue;
+    }
+    if (arg == "--resume") {
+      checkpoint = true;
+      resume = true;
+      continue;
+    }
+    if (arg == "--debug") {
+      if (log_level() < LOG_LEVEL_DEBUG) {
+        set_log_level(LOG_LEVEL_DEBUG);
+      }
+      continue;
+    }
+    if (arg.rfind("--log-level=", 0) == 0) {
+      LogLevel level;
+      const char* value = argv[i] + std::strlen("--log-level=");
+      if (!parse_log_level(value, &level)) {
+        std::cerr << "Invalid --log-level value: " << value
+                  << " (expected error, warn, info, debug or trace)\n";
+        return 1;
+      }
+      set_log_level(level);
+      continue;
+    }
+    std::cerr << "Unknown argument: " << arg << "\n";
+    return 1;
+  }
+
+  const bool decrypt_pages = keyring.given();
+  uint32_t master_id = 0;
+  if (decrypt_pages && !keyring.validate(&master_id)) {
+    return 1;
+  }
+
+  if (columnar) {
+    if (!ColumnarWriter::available()) {
+      std::cerr << "--format=arrow|parquet: this ib_parser was built without "
+                   "Apache Arrow (configure with -DWITH_ARROW=ON)\n";
+      return 1;
+    }
+    if (!out_path || !*out_path) {
+      std::cerr << "--format=arrow|parquet requires --output=PATH\n";
+      return 1;
+    }
+    if (n_threads > 1) {
+      // One writer fed in page order; the parse workers would need their
+      // own record batches merged back together.
+      std::cerr << "Warning: columnar output is written by one thread; "
+                   "ignoring --threads=" << n_threads << "\n";
+      n_threads = 1;
+    }
+  }
+
+  if (checkpoint) {
+    if (!out_path || !*out_path) {
+      std::cerr << "--checkpoint and --resume require --output=PATH\n";
+      return 1;
+    }
+    if (columnar || btree_scan || unordered) {
+      // Resuming appends to the output in page order.
+      std::cerr << "--checkpoint and --resume need a text --format, "
+                   "--scan=sweep and ordered output\n";
+      return 1;
+    }
+    if (checkpoint_path.empty()) {
+      checkpoint_path = std::string(out_path) + ".ckpt";
+    }
+  }
+  const bool output_file_writer =
+      file_opts.compression != OUTPUT_COMPRESS_NONE || file_opts.split_bytes > 0;
+  if (output_file_writer) {
+    if (!OutputFileWriter::available(file_opts.compression)) {
+      std::cerr << "--output-compress: this ib_parser was built without "
+                << (file_opts.compression == OUTPUT_COMPRESS_ZSTD ? "libzstd" : "liblz4")
+                << "\n";
+      return 1;
+    }
+    if (!out_path || !*out_path) {
+      std::cerr << "--output-compress and --output-split require --output=PATH\n";
+      return 1;
+    }
+    if (columnar) {
+      std::cerr << "--output-compress and --output-split need a text --format\n";
+      return 1;
+    }
+    if (checkpoint || shard_manifest) {
+      // Both cut or hash the output as one plain file.
+      std::cerr << "--output-compress and --output-split cannot be combined with "
+                   "--checkpoint, --resume or --shard-manifest\n";
+      return 1;
+    }
+    // Compress alongside the parse workers unless told otherwise.
+    file_opts.threads = output_threads > 0 ? output_threads : std::max(2u, n_threads);
+  }
+  if (!range_spec.empty() && btree_scan) {
+    // The walk follows the tree wherever its pages are.
+    std::cerr << "--page-range and --shard need --scan=sweep\n";
+    return 1;
+  }
+  if (shard_manifest) {
+    if (!out_path || !*out_path) {
+      std::cerr << "--shard-manifest requires --output=PATH\n";
+      return 1;
+    }
+    if (columnar || unordered) {
+      // The merge joins shards' text outputs; keys need page order.
+      std::cerr << "--shard-manifest needs a text --format and ordered output\n";
+      return 1;
+    }
+    if (manifest_path.empty()) {
+      manifest_path = std::string(out_path) + ".manifest";
+    }
+  }
+  // What shards must agree on, and a resumed run repeat, to write the
+  // same bytes.
+  const std::string output_options =
+      std::string("json=") + (json_file ? json_file : "") +
+      " index=" + index_selector + " format=" + format_name +
+      " meta=" + (output_opts.include_meta ? "1" : "0") +
+      " recover=" + (output_opts.recover_deleted ? "1" : "0") +
+      " columns=" + column_list + " where=" + where_expr +
+      " lob_max=" + std::to_string(output_opts.lob_max_bytes) +
+      " raw=" + (output_opts.raw_integers ? "1" : "0") +
+      " skip_xdes=" + (skip_xdes ? "1" : "0") +
+      " skip_page_check=" + (skip_page_check ? "1" : "0") +
+      " since_lsn=" + std::to_string(since_lsn);
+  // The pages swept are added once known (--shard ranges depend on the
+  // page map).
+  std::string checkpoint_options = output_options;
+
+  // 0) MySQL init
+  my_init();
+  my_thread_init();
+
+  // 0a) Encrypted tablespace: fetch the key once, decrypt pages as read
+  // (the SDI pages too, when the definition comes from the tablespace)
+  PageCipher page_cipher;
+  const PageCipher* cipher = nullptr;
+  if (decrypt_pages) {
+    OpenSSL_add_all_algorithms();
+    if (!load_page_cipher(in_file, master_id, keyring.srv_uuid,
+                          keyring.keyring_path, &page_cipher)) {
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    cipher = &page_cipher;
+  }
+
+  parser_context_t parser_ctx;
+
+  // 1) Load table definition and extract table name: from the ibd2sdi
+  // JSON when given, otherwise from the tablespace's own SDI pages
+  std::string table_name;
+  if (json_file != nullptr) {
+    if (load_ib2sdi_table_columns(json_file, table_name, &parser_ctx) != 0) {
+      std::cerr << "Failed to load table columns from JSON.\n";
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+  } else if (load_table_schema_from_ibd(in_file, cipher,
+                                        sdi_cache_dir.empty() ? nullptr
+                                                              : sdi_cache_dir.c_str(),
+                                        table_name, &parser_ctx) != 0) {
+    std::cerr << "Failed to load the table definition from " << in_file
+              << "'s SDI.\n";
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  if (list_indexes) {
+    print_sdi_indexes(&parser_ctx, stdout);
+    my_thread_end();
+    my_end(0);
+    return 0;
+  }
+
+  if (has_sdi_index_definitions(&parser_ctx)) {
+    std::string err;
+    if (!select_index_for_parsing(&parser_ctx, index_selector, &err)) {
+      std::cerr << "Index selection failed: " << err << "\n";
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+  } else if (index_selector_explicit) {
+    std::cerr << "Index selection requires SDI index metadata.\n";
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  // Build a table_def_t from parser context columns, in place: the struct
+  // is a few hundred MB of fixed arrays, too big to copy around.
+  table_def_t& my_table = table_definitions[0];
+  if (build_table_def_from_json(&my_table, table_name.c_str(), &parser_ctx) != 0) {
+    std::cerr << "Failed to build table_def_t from JSON.\n";
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  // If your code uses the n_nullable field in ibrec_init_offsets_new():
+  my_table.n_nullable = 0;
+  for (int i = 0; i < my_table.fields_count; i++) {
+    if (my_table.fields[i].can_be_null) my_table.n_nullable++;
+  }
+
+  if (!column_list.empty()) {
+    std::string err;
+    if (!parse_column_selection(&my_table, column_list, &output_opts.column_mask, &err)) {
+      std::cerr << "--columns: " << err << "\n";
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+  }
+  if (shard_manifest) {
+    output_opts.key_fields = static_cast<unsigned>(
+        index_key_fields(&my_table, selected_index_is_clustered(&parser_ctx)));
+  }
+  if (!where_expr.empty()) {
+    std::string err;
+    if (!parse_row_filter(&my_table, where_expr, &output_opts.where, &err)) {
+      std::cerr << "--where: " << err << "\n";
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    if (output_opts.where.unsatisfiable()) {
+      std::cerr << "Warning: --where matches no rows\n";
+    }
+    if (btree_scan && !output_opts.where.range_for(0)) {
+      std::cerr << "Note: --where does not limit the first column of index '"
+                << selected_index_name(&parser_ctx)
+                << "'; the B-tree scan reads every leaf.\n";
+    }
+    if (log_enabled(LOG_LEVEL_DEBUG)) {
+      std::cerr << "DEBUG: --where " << describe_row_filter(&my_table, output_opts.where)
+                << "\n";
+    }
+  }
+  // 2) Resolve selected index ID using system "open + pread" approach
+  int sys_fd = ::open(in_file, O_RDONLY);
+  if (sys_fd < 0) {
+    perror("open");
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  // One mapping for index discovery, the sweep, XDES and LOB reads.
+  TablespaceMap ts_map;
+  if (use_mmap) {
+    std::string err;
+    if (!ts_map.open(sys_fd, &err)) {
+      std::cerr << "Cannot mmap " << in_file << " (" << err
+                << "); using pread.\n";
+    }
+  }
+  const TablespaceMap* map = ts_map.mapped() ? &ts_map : nullptr;
+
+  if (!target_index_is_set(&parser_ctx)) {
+    page_no_t root = selected_index_root(&parser_ctx);
+    uint64_t idx_id = 0;
+    if (root != FIL_NULL && read_index_id_from_root(sys_fd, root, &idx_id, map, cipher)) {
+      set_target_index_id_from_value(&parser_ctx, idx_id);
+    }
+  }
+
+  if (!target_index_is_set(&parser_ctx)) {
+    if (index_selector_explicit && has_sdi_index_definitions(&parser_ctx)) {
+      std::cerr << "Could not resolve index id for selected index '"
+                << selected_index_name(&parser_ctx) << "'.\n";
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    if (discover_target_index_id(sys_fd, &parser_ctx, map, cipher) != 0) {
+      std::cerr << "Could not discover index from " << in_file << std::endl;
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+  }
+
+  // 3) Now open the file with MySQL's my_open
+  File in_fd = my_open(in_file, O_RDONLY, MYF(0));
+  if (in_fd < 0) {
+    std::cerr << "Cannot open file " << in_file << std::endl;
+    ::close(sys_fd);
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  // 4) Determine page size (for 8KB,16KB, etc.)
+  page_size_t pg_sz(0, 0, false);
+  if (!determine_page_size(in_fd, pg_sz)) {
+    std::cerr << "Could not determine page size from " << in_file << "\n";
+    my_close(in_fd, MYF(0));
+    ::close(sys_fd);
+    my_thread_end();
+    my_end(0);
+    return 1;
   }
   const size_t physical_page_size = pg_sz.physical();
   const size_t logical_page_size = pg_sz.logical();
   const bool tablespace_compressed = (physical_page_size < logical_page_size);
+  if (tablespace_compressed) {
+    PARSER_LOG(LOG_LEVEL_INFO, "Compressed tablespace: %zu byte pages, inflate backend %s\n",
+               physical_page_size, inflate_backend_name());
+  }
 
   LobReadContext lob_ctx;
   lob_ctx.fd = sys_fd;
   lob_ctx.physical_page_size = physical_page_size;
   lob_ctx.logical_page_size = logical_page_size;
   lob_ctx.tablespace_compressed = tablespace_compressed;
+  lob_ctx.map = map;
+  lob_ctx.cipher = cipher;
+  if (lob_cache_mb > 0) {
+    lob_ctx.cache = std::make_shared<PageCache>(lob_cache_mb << 20);
+  }
   set_lob_read_context(lob_ctx);
 
-  // 5) Rewind
-  if (my_seek(in_fd, 0, MY_SEEK_SET, MYF(0)) == MY_FILEPOS_ERROR) {
-    std::cerr << "Cannot seek to start of " << in_file << "\n";
-    my_close(in_fd, MYF(0));
-    ::close(sys_fd);
-    my_thread_end();
-    my_end(0);
-    return 1;
+  // 5) Rewind
+  if (my_seek(in_fd, 0, MY_SEEK_SET, MYF(0)) == MY_FILEPOS_ERROR) {
+    std::cerr << "Cannot seek to start of " << in_file << "\n";
+    my_close(in_fd, MYF(0));
+    ::close(sys_fd);
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  // 6) table_definitions[0] holds the new table; init table defs
+  table_definitions_cnt = 1;
+  init_table_defs(1);
+  if (log_enabled(LOG_LEVEL_DEBUG)) {
+    debug_print_table_def(&my_table);
+  }
+
+  FILE* out_file = nullptr;
+  std::unique_ptr<OutputFileWriter> output_writer;
+  std::unique_ptr<ColumnarWriter> columnar_writer;
+  if (columnar) {
+    std::string err;
+    columnar_writer = ColumnarWriter::create(
+        columnar_format,
+        columnar_schema(&table_definitions[0], output_opts),
+        out_path, row_group_rows, &err);
+    if (!columnar_writer) {
+      std::cerr << "Cannot create " << out_path << ": " << err << "\n";
+      my_close(in_fd, MYF(0));
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    output_opts.columnar = columnar_writer.get();
+  } else if (output_file_writer) {
+    std::string err;
+    output_writer = OutputFileWriter::create(out_path, file_opts, &err);
+    if (!output_writer) {
+      std::cerr << "Cannot create " << out_path << ": " << err << "\n";
+      my_close(in_fd, MYF(0));
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    out_file = output_writer->stream();
+    output_opts.out = out_file;
+    output_opts.file_writer = output_writer.get();
+  } else if (out_path && *out_path) {
+    // --resume keeps what the last checkpoint covers (cut to size below).
+    out_file = std::fopen(out_path, resume ? "r+b" : "wb");
+    if (!out_file) {
+      std::cerr << "Cannot open output file " << out_path << "\n";
+      my_close(in_fd, MYF(0));
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    output_opts.out = out_file;
+  }
+  set_row_output_options(output_opts);
+
+  ParseScanConfig scan_cfg;
+  scan_cfg.parser_ctx = &parser_ctx;
+  scan_cfg.pg_sz = &pg_sz;
+  scan_cfg.fd = sys_fd;
+  scan_cfg.physical_page_size = physical_page_size;
+  scan_cfg.logical_page_size = logical_page_size;
+  scan_cfg.tablespace_compressed = tablespace_compressed;
+  scan_cfg.skip_xdes = skip_xdes;
+  scan_cfg.skip_page_check = skip_page_check;
+  scan_cfg.since_lsn = since_lsn;
+  scan_cfg.map = map;
+  scan_cfg.cipher = cipher;
+
+  uint64_t page_no = 0;
+  bool scan_ok = true;
+  struct stat st;
+  if (fstat(sys_fd, &st) != 0) {
+    perror("fstat");
+    scan_ok = false;
+  }
+  const uint64_t file_size = scan_ok ? static_cast<uint64_t>(st.st_size) : 0;
+  const uint64_t total_pages = file_size / physical_page_size;
+
+  // --stats / --progress / --checkpoint: this thread's counters; --threads
+  // chunks keep their own and are merged in as they are written.
+  ParseStats parse_stats;
+  parse_stats.timing = stats_enabled;
+  const bool collect_stats = stats_enabled || progress_s > 0 || checkpoint ||
+                             since_lsn != 0 || shard_manifest;
+  ParseStatsScope stats_scope(collect_stats ? &parse_stats : nullptr);
+  const auto scan_start = std::chrono::steady_clock::now();
+
+  // 7) --page-map: which pages can hold rows of the index, from the
+  //    sidecar or one sequential prepass
+  PageMap page_map;
+  if (scan_ok && use_page_map) {
+    std::string err;
+    if (page_map_path.empty()) {
+      page_map_path = page_map_sidecar_path(in_file);
+    }
+    if (load_or_build_page_map(page_map_path, sys_fd, map, cipher,
+                               physical_page_size, logical_page_size,
+                               &page_map, &err)) {
+      scan_cfg.page_map = &page_map;
+      scan_cfg.page_map_slot = target_index_is_set(&parser_ctx)
+                                   ? page_map.slot_of(parser_ctx.target_index_id)
+                                   : PageMap::kNoSlot;
+    } else {
+      std::cerr << "Warning: no page map (" << err << "); reading every page\n";
+    }
+  }
+
+  // 7a) --page-range / --shard: the pages this run sweeps. Every row is
+  //     written by the shard holding its leaf page, so shards never share
+  //     a row; LOB chains are followed wherever their pages are.
+  uint64_t scan_first = 0;
+  uint64_t scan_end = total_pages;
+  if (shard_count > 0) {
+    shard_page_range(scan_cfg.page_map, scan_cfg.page_map_slot, true, total_pages,
+                     logical_page_size, shard_index, shard_count,
+                     &scan_first, &scan_end);
+  } else if (!range_spec.empty()) {
+    scan_first = range_first;
+    scan_end = std::min(range_end, total_pages);
+    if (scan_ok && scan_first > scan_end) {
+      std::cerr << "--page-range starts past the last page (" << total_pages
+                << " pages)\n";
+      scan_ok = false;
+    }
+  }
+  if (!range_spec.empty()) {
+    checkpoint_options += " pages=" + std::to_string(scan_first) + ":" +
+                          std::to_string(scan_end);
+    PARSER_LOG(LOG_LEVEL_INFO, "%s: pages %llu to %llu of %llu\n", range_spec.c_str(),
+               static_cast<unsigned long long>(scan_first),
+               static_cast<unsigned long long>(scan_end),
+               static_cast<unsigned long long>(total_pages));
+  }
+  // The pread() loop runs to EOF to report a trailing partial page.
+  const bool scan_to_eof = scan_end == total_pages;
+
+  // --resume: continue after the last checkpoint, cutting off whatever was
+  // written after it.
+  ParseCheckpoint ckpt;
+  uint64_t start_page = scan_first;
+  if (resume && scan_ok) {
+    std::string err;
+    struct stat out_st;
+    if (!read_parse_checkpoint(checkpoint_path, &ckpt, &err)) {
+      // err says why
+    } else if (ckpt.input != in_file || ckpt.input_size != file_size ||
+               ckpt.options != checkpoint_options) {
+      err = checkpoint_path + " was written for another tablespace or other options";
+    } else if (fstat(fileno(out_file), &out_st) != 0 ||
+               static_cast<uint64_t>(out_st.st_size) < ckpt.output_bytes) {
+      err = std::string(out_path) + " is shorter than its checkpoint";
+    } else if (ftruncate(fileno(out_file), static_cast<off_t>(ckpt.output_bytes)) != 0 ||
+               fseeko(out_file, static_cast<off_t>(ckpt.output_bytes), SEEK_SET) != 0) {
+      err = std::string("cannot cut ") + out_path + " back to its checkpoint";
+    }
+    if (!err.empty()) {
+      std::cerr << "Cannot resume: " << err << "\n";
+      std::fclose(out_file);
+      set_lob_read_context(LobReadContext());
+      my_close(in_fd, MYF(0));
+      ::close(sys_fd);
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    start_page = std::min(std::max(ckpt.next_page, scan_first), scan_end);
+    ckpt.restore_counters(&parse_stats);
+    // Text formats write the header before the first row.
+    current_row_worker_context().printed_header = ckpt.output_bytes > 0;
+    std::cerr << "Resuming at page " << start_page << " of " << scan_end
+              << " (" << ckpt.output_bytes << " output bytes kept)\n";
+  }
+
+  // Flush and sync the output up to next_page, then record it; a failed
+  // write only costs the checkpoint.
+  auto last_checkpoint = std::chrono::steady_clock::now();
+  bool checkpoint_warned = false;
+  auto save_checkpoint = [&](uint64_t next_page, bool done) {
+    flush_row_output();
+    std::fflush(out_file);
+    fdatasync(fileno(out_file));
+    ckpt.input = in_file;
+    ckpt.input_size = file_size;
+    ckpt.options = checkpoint_options;
+    ckpt.next_page = next_page;
+    ckpt.output_bytes = static_cast<uint64_t>(ftello(out_file));
+    ckpt.done = done;
+    ckpt.save_counters(parse_stats);
+    std::string err;
+    if (!write_parse_checkpoint(checkpoint_path, ckpt, &err) && !checkpoint_warned) {
+      std::cerr << "Warning: checkpoint not saved: " << err << "\n";
+      checkpoint_warned = true;
+    }
+  };
+  auto maybe_checkpoint = [&](uint64_t next_page) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_checkpoint >= std::chrono::seconds(checkpoint_interval_s)) {
+      last_checkpoint = now;
+      save_checkpoint(next_page, false);
+    }
+  };
+
+  std::unique_ptr<ProgressMeter> progress;
+  if (progress_s > 0) {
+    progress.reset(new ProgressMeter(scan_end - start_page, progress_s));
+  }
+  scan_cfg.stats = collect_stats ? &parse_stats : nullptr;
+  scan_cfg.stats_timing = stats_enabled;
+  scan_cfg.progress = progress.get();
+
+  // 7b) B-tree guided walk of the selected index; on corruption fall back to
+  //     the sweep below, skipping the leaves already written.
+  bool btree_done = false;
+  std::vector<bool> btree_parsed;
+  PageCacheCounters worker_cache;
+  if (scan_ok && btree_scan) {
+    const page_no_t root = selected_index_root(&parser_ctx);
+    if (root == FIL_NULL || !target_index_is_set(&parser_ctx)) {
+      std::cerr << "B-tree scan needs the index root from SDI; using sweep.\n";
+    } else {
+      std::string why;
+      uint64_t btree_pages = 0;
+      btree_done = run_btree_scan(scan_cfg, total_pages, root,
+                                  selected_index_is_clustered(&parser_ctx),
+                                  &btree_parsed, &btree_pages, &why);
+      page_no = btree_pages;
+      if (!btree_done) {
+        std::cerr << "B-tree scan aborted (" << why
+                  << "); sweeping remaining pages.\n";
+        scan_cfg.skip_pages = &btree_parsed;
+      }
+    }
+  }
+
+  if (!scan_ok || btree_done) {
+    // 7c) Nothing left to sweep
+  } else if (n_threads > 1) {
+    // 7c) Page-parallel sweep over pread(); rows come back in page order
+    if (map) {
+      map->advise(TablespaceMap::SEQUENTIAL);
+    }
+    page_no = scan_end;
+    if (scan_to_eof && file_size % physical_page_size != 0) {
+      std::cerr << "Warning: partial page read at page " << page_no << "\n";
+    }
+    std::function<void(uint64_t)> chunk_written;
+    if (checkpoint) {
+      chunk_written = maybe_checkpoint;
+    }
+    scan_ok = run_parallel_parse(scan_cfg, start_page, scan_end, n_threads,
+                                 unordered, output_opts, lob_ctx,
+                                 table_definitions[0], out_file, &worker_cache,
+                                 chunk_written);
+  } else if (map || scan_cfg.page_map) {
+    // 7c) Page-by-page loop, parsing straight out of the mapping (or
+    //     reading only the pages the page map keeps)
+    if (map) {
+      map->advise(TablespaceMap::SEQUENTIAL);
+    }
+    ParsePageScratch scratch(scan_cfg);
+    for (page_no = start_page; page_no < scan_end; page_no++) {
+      if (!page_map_skips(scan_cfg, page_no)) {
+        parse_page_buffer(scan_cfg, scratch,
+                          scratch.read_page(scan_cfg, page_no), page_no);
+      }
+      scratch.report_progress(scan_cfg);
+      if (checkpoint) {
+        maybe_checkpoint(page_no + 1);
+      }
+    }
+    if (scan_to_eof && file_size % physical_page_size != 0) {
+      std::cerr << "Warning: partial page read at page " << page_no << "\n";
+    }
+  } else {
+    // 7c) Page-by-page loop
+    page_no = start_page;
+    if (start_page > 0 &&
+        my_seek(in_fd, start_page * physical_page_size, MY_SEEK_SET, MYF(0)) ==
+            MY_FILEPOS_ERROR) {
+      std::cerr << "Cannot seek to page " << start_page << "\n";
+      scan_ok = false;
+    }
+    ParsePageScratch scratch(scan_cfg);
+    while (scan_ok && (scan_to_eof || page_no < scan_end)) {
+      size_t rd = 0;
+      {
+        StageTimer timer(STAGE_READ);
+        rd = my_read(in_fd, scratch.page_buf.get(), physical_page_size, MYF(0));
+        parse_stats.bytes_read += rd;
+        if (rd == physical_page_size) {
+          scratch.decrypt_page_buf(scan_cfg, page_no);
+        }
+      }
+      if (rd == 0) {
+        // EOF
+        break;
+      }
+      if (rd < physical_page_size) {
+        std::cerr << "Warning: partial page read at page " << page_no << "\n";
+        break;
+      }
+
+      parse_page_buffer(scan_cfg, scratch, scratch.page_buf.get(), page_no);
+      scratch.report_progress(scan_cfg);
+      page_no++;
+      if (checkpoint) {
+        maybe_checkpoint(page_no);
+      }
+    }
+  }
+
+  flush_row_output();
+  log_flush();
+  if (scan_cfg.page_map) {
+    // The pages it ruled out still count towards the highest LSN.
+    parse_stats.max_lsn = std::max(parse_stats.max_lsn, page_map.max_lsn);
+  }
+  if (checkpoint && scan_ok) {
+    save_checkpoint(scan_end, true);
+  }
+  if (output_writer) {
+    set_row_output_options(RowOutputOptions());
+    if (!output_writer->finish()) {
+      std::cerr << "Error writing " << out_path << ": " << output_writer->error() << "\n";
+      scan_ok = false;
+    } else {
+      PARSER_LOG(LOG_LEVEL_INFO, "%s: %zu file(s), %llu bytes written as %llu\n", out_path,
+                 output_writer->files().size(),
+                 static_cast<unsigned long long>(output_writer->bytes_in()),
+                 static_cast<unsigned long long>(output_writer->bytes_out()));
+    }
+  } else if (out_file) {
+    std::fclose(out_file);
+  }
+  if (columnar_writer) {
+    if (!columnar_writer->finish()) {
+      std::cerr << "Error writing " << out_path << ": "
+                << columnar_writer->error() << "\n";
+      scan_ok = false;
+    }
+    set_row_output_options(RowOutputOptions());
+  }
+  if (shard_manifest && scan_ok) {
+    ShardManifest manifest;
+    manifest.input = in_file;
+    manifest.input_size = file_size;
+    manifest.options = output_options;
+    manifest.total_pages = total_pages;
+    manifest.first_page = scan_first;
+    manifest.end_page = scan_end;
+    manifest.rows = parse_stats.rows;
+    manifest.first_key = parse_stats.first_key;
+    manifest.last_key = parse_stats.last_key;
+    std::string err;
+    if (!digest_shard_output(out_path, output_opts.format != ROW_OUTPUT_JSONL,
+                             &manifest, &err) ||
+        !write_shard_manifest(manifest_path, manifest, &err)) {
+      std::cerr << "Cannot write --shard-manifest " << manifest_path << ": " << err
+                << "\n";
+      scan_ok = false;
+    }
+  }
+  if (progress) {
+    progress->stop();
+  }
+  if (stats_enabled) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - scan_start;
+    const unsigned stats_threads = (btree_done || n_threads < 2) ? 1 : n_threads;
+    if (stats_path.empty()) {
+      print_parse_stats(stderr, parse_stats, elapsed.count(), stats_threads);
+    } else {
+      FILE* sf = std::fopen(stats_path.c_str(), "w");
+      if (!sf) {
+        std::cerr << "Cannot write --stats file " << stats_path << "\n";
+      } else {
+        const std::string json =
+            parse_stats_json(parse_stats, elapsed.count(), stats_threads);
+        std::fprintf(sf, "%s\n", json.c_str());
+        std::fclose(sf);
+      }
+    }
+  }
+  if (since_lsn != 0) {
+    std::cerr << "--since-lsn=" << since_lsn << ": " << parse_stats.pages_unchanged
+              << " index pages unchanged and skipped; highest page LSN "
+              << parse_stats.max_lsn << "\n";
+  }
+  if (log_enabled(LOG_LEVEL_DEBUG) && lob_ctx.cache) {
+    const PageCacheCounters main_cache = lob_ctx.cache->counters();
+    fprintf(stderr, "DEBUG: page cache %zu MB: %llu hits, %llu misses\n",
+            lob_cache_mb,
+            static_cast<unsigned long long>(main_cache.hits + worker_cache.hits),
+            static_cast<unsigned long long>(main_cache.misses + worker_cache.misses));
+  }
+
+  // The mapping and cache die with this frame; don't leave them bound.
+  set_lob_read_context(LobReadContext());
+  my_close(in_fd, MYF(0));
+  ::close(sys_fd);
+  my_thread_end();
+  my_end(0);
+
+  std::cout << "Parse-only complete. Pages read: " << page_no << "\n";
+  return scan_ok ? 0 : 1;
+}
+
+/**
+ * Mode 7 state of one tablespace. Tables are prepared (cipher, schema,
+ * index, output file) by whichever worker reaches them first and then
+ * parsed in chunks by every worker; chunks are written out in page order.
+ */
+enum BatchTableState {
+  BATCH_NEW,
+  BATCH_PREPARING,
+  BATCH_READY,
+  BATCH_DONE,
+  BATCH_FAILED
+};
+
+struct BatchTable {
+  std::string ibd_path;
+  std::string sdi_path;  // empty: definition from the tablespace's SDI pages
+  std::string out_path;
+  uint64_t file_size = 0;
+
+  std::atomic<int> state{BATCH_NEW};
+  parser_context_t parser_ctx;
+  table_def_t* def = nullptr;  // calloc'd, see free_batch_table_def()
+  PageCipher cipher;
+  int fd = -1;
+  page_size_t pg_sz{0, 0, false};
+  ParseScanConfig cfg;
+  LobReadContext lob;       // cache: each worker brings its own
+  RowOutputOptions output;  // out: each chunk's memory stream
+  FILE* out = nullptr;
+  uint64_t total_pages = 0;
+  uint64_t n_chunks = 0;
+  std::atomic<uint64_t> next_chunk{0};
+  std::atomic<uint64_t> next_emit{0};
+
+  // Guards the chunks, the output and the fields below once READY.
+  std::mutex mu;
+  std::vector<ParseChunkOutput> chunks;
+  bool header_done = false;
+  ParseStats stats;
+  std::string error;
+  std::chrono::steady_clock::time_point start;
+  double seconds = 0;
+};
+
+/** Settings shared by every table of a mode 7 run. */
+struct BatchOptions {
+  std::vector<unsigned char> master_key;  // empty: no --keyring
+  std::string sdi_cache_dir;
+  RowOutputOptions output;
+  bool skip_xdes = false;
+  bool skip_page_check = false;
+  size_t lob_cache_mb = 16;
+  uint64_t chunk_pages = kParseChunkPages;
+  // Ring of buffered chunks per table: the window workers may run ahead of
+  // its writer, plus one chunk per worker that passed the check at once.
+  uint64_t chunk_slots = 1;
+};
+
+/** Whether the FSP flags on page 0 say the tablespace is encrypted. */
+static bool is_tablespace_encrypted(int fd)
+{
+  unsigned char page0[FIL_PAGE_DATA + FSP_HEADER_SIZE];
+  if (pread(fd, page0, sizeof(page0), 0) != static_cast<ssize_t>(sizeof(page0))) {
+    return false;
+  }
+  const uint32_t flags = fsp_header_get_flags(page0);
+  return fsp_flags_is_valid(flags) && FSP_FLAGS_GET_ENCRYPTION(flags);
+}
+
+/** Free what build_table_def_from_json() allocated, then the table itself. */
+static void free_batch_table_def(table_def_t* def)
+{
+  if (def == nullptr) {
+    return;
+  }
+  std::free(def->name);
+  for (int i = 0; i < def->fields_count; i++) {
+    std::free(def->fields[i].name);
+  }
+  free_record_plan(def);
+  std::free(def);
+}
+
+/**
+ * Close the output and release the table's file and definition; the table
+ * ends DONE, or FAILED when error is set. Called once, by the thread that
+ * emitted the last chunk (or failed the preparation).
+ */
+static void finish_batch_table(BatchTable& t)
+{
+  if (t.out) {
+    if (std::ferror(t.out) && t.error.empty()) {
+      t.error = "write error on " + t.out_path;
+    }
+    if (std::fclose(t.out) != 0 && t.error.empty()) {
+      t.error = "cannot close " + t.out_path;
+    }
+    t.out = nullptr;
+  }
+  if (t.fd >= 0) {
+    ::close(t.fd);
+    t.fd = -1;
+  }
+  free_batch_table_def(t.def);
+  t.def = nullptr;
+  std::vector<ParseChunkOutput>().swap(t.chunks);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - t.start;
+  t.seconds = elapsed.count();
+  if (t.error.empty()) {
+    PARSER_LOG(LOG_LEVEL_INFO, "%s: %llu rows in %.3f s\n", t.ibd_path.c_str(),
+               static_cast<unsigned long long>(t.stats.rows), t.seconds);
+  } else {
+    PARSER_LOG(LOG_LEVEL_ERROR, "Error: %s: %s\n", t.ibd_path.c_str(),
+               t.error.c_str());
+  }
+  t.state.store(t.error.empty() ? BATCH_DONE : BATCH_FAILED);
+}
+
+/**
+ * Mode 3's setup for one table of a batch: tablespace key, definition (the
+ * JSON next to it or the SDI pages), primary index, page size and output
+ * file. Leaves the table READY, or FAILED with t.error set.
+ */
+static void prepare_batch_table(BatchTable& t, const BatchOptions& opts)
+{
+  t.start = std::chrono::steady_clock::now();
+  const char* ibd = t.ibd_path.c_str();
+  auto fail = [&](const std::string& why) {
+    t.error = why;
+    finish_batch_table(t);
+  };
+
+  t.fd = ::open(ibd, O_RDONLY);
+  if (t.fd < 0) {
+    return fail(std::string("cannot open: ") + std::strerror(errno));
   }
 
-  // 6) Overwrite table_definitions[] with your new table and init table defs
-  table_definitions[0] = my_table;
-  table_definitions_cnt = 1;
-  init_table_defs(1);
-  if (parser_debug_enabled()) {
-    debug_print_table_def(&my_table);
+  const PageCipher* cipher = nullptr;
+  if (is_tablespace_encrypted(t.fd)) {
+    if (opts.master_key.empty()) {
+      return fail("tablespace is encrypted; pass --keyring");
+    }
+    if (!load_tablespace_cipher(ibd, opts.master_key, &t.cipher)) {
+      return fail("cannot read the tablespace key");
+    }
+    cipher = &t.cipher;
   }
 
-  FILE* out_file = nullptr;
-  if (out_path && *out_path) {
-    out_file = std::fopen(out_path, "wb");
-    if (!out_file) {
-      std::cerr << "Cannot open output file " << out_path << "\n";
-      my_close(in_fd, MYF(0));
-      ::close(sys_fd);
-      my_thread_end();
-      my_end(0);
-      return 1;
+  std::string table_name;
+  if (!t.sdi_path.empty()) {
+    if (load_ib2sdi_table_columns(t.sdi_path.c_str(), table_name,
+                                  &t.parser_ctx) != 0) {
+      return fail("cannot load table columns from " + t.sdi_path);
+    }
+  } else if (load_table_schema_from_ibd(ibd, cipher,
+                                        opts.sdi_cache_dir.empty()
+                                            ? nullptr
+                                            : opts.sdi_cache_dir.c_str(),
+                                        table_name, &t.parser_ctx) != 0) {
+    return fail("cannot load the table definition from the SDI");
+  }
+  if (has_sdi_index_definitions(&t.parser_ctx)) {
+    std::string err;
+    if (!select_index_for_parsing(&t.parser_ctx, "", &err)) {
+      return fail("index selection failed: " + err);
     }
-    output_opts.out = out_file;
   }
-  set_row_output_options(output_opts);
 
-  // 7) Allocate buffers
-  std::unique_ptr<unsigned char[]> page_buf(new unsigned char[physical_page_size]);
-  std::unique_ptr<unsigned char[]> logical_buf;
-  if (tablespace_compressed) {
-    logical_buf.reset(new unsigned char[logical_page_size]);
+  // Zeroed lazily by the kernel: only the fields in use are ever touched.
+  t.def = static_cast<table_def_t*>(std::calloc(1, sizeof(table_def_t)));
+  if (t.def == nullptr) {
+    return fail("out of memory for the table definition");
   }
-  std::unique_ptr<unsigned char[]> xdes_scratch(new unsigned char[physical_page_size]);
-  XdesCache xdes_cache;
+  if (build_table_def_from_json(t.def, table_name.c_str(), &t.parser_ctx) != 0) {
+    return fail("cannot build the table definition");
+  }
+  init_table_def(t.def, false);
 
-  auto load_xdes_page = [&](page_no_t target) -> void {
-    const page_no_t xdes_page = xdes_calc_descriptor_page(pg_sz, target);
-    if (xdes_page == FIL_NULL || xdes_cache.page_no == xdes_page) {
-      return;
+  if (!target_index_is_set(&t.parser_ctx)) {
+    const page_no_t root = selected_index_root(&t.parser_ctx);
+    uint64_t idx_id = 0;
+    if (root != FIL_NULL &&
+        read_index_id_from_root(t.fd, root, &idx_id, nullptr, cipher)) {
+      set_target_index_id_from_value(&t.parser_ctx, idx_id);
     }
-    const off_t offset = static_cast<off_t>(xdes_page) *
-                         static_cast<off_t>(physical_page_size);
-    const ssize_t read_bytes = pread(sys_fd, xdes_scratch.get(),
-                                     physical_page_size, offset);
-    if (read_bytes == static_cast<ssize_t>(physical_page_size)) {
-      xdes_cache.update(xdes_page, xdes_scratch.get(), physical_page_size);
+  }
+  if (!target_index_is_set(&t.parser_ctx) &&
+      discover_target_index_id(t.fd, &t.parser_ctx, nullptr, cipher) != 0) {
+    return fail("cannot discover the index");
+  }
+
+  File in_fd = my_open(ibd, O_RDONLY, MYF(0));
+  if (in_fd < 0) {
+    return fail("cannot open");
+  }
+  const bool sized = determine_page_size(in_fd, t.pg_sz);
+  my_close(in_fd, MYF(0));
+  if (!sized) {
+    return fail("cannot determine the page size");
+  }
+
+  t.out = std::fopen(t.out_path.c_str(), "wb");
+  if (t.out == nullptr) {
+    return fail("cannot open output file " + t.out_path);
+  }
+
+  t.cfg.parser_ctx = &t.parser_ctx;
+  t.cfg.pg_sz = &t.pg_sz;
+  t.cfg.fd = t.fd;
+  t.cfg.physical_page_size = t.pg_sz.physical();
+  t.cfg.logical_page_size = t.pg_sz.logical();
+  t.cfg.tablespace_compressed = t.cfg.physical_page_size < t.cfg.logical_page_size;
+  t.cfg.skip_xdes = opts.skip_xdes;
+  t.cfg.skip_page_check = opts.skip_page_check;
+  t.cfg.cipher = cipher;
+
+  t.lob.fd = t.fd;
+  t.lob.physical_page_size = t.cfg.physical_page_size;
+  t.lob.logical_page_size = t.cfg.logical_page_size;
+  t.lob.tablespace_compressed = t.cfg.tablespace_compressed;
+  t.lob.cipher = cipher;
+  t.output = opts.output;
+
+  t.total_pages = t.file_size / t.cfg.physical_page_size;
+  t.n_chunks = (t.total_pages + opts.chunk_pages - 1) / opts.chunk_pages;
+  t.chunks.resize(std::min(t.n_chunks, opts.chunk_slots));
+  if (t.n_chunks == 0) {
+    return finish_batch_table(t);
+  }
+  t.state.store(BATCH_READY);
+}
+
+/** s as a JSON string literal. */
+static void append_report_string(std::string* out, const std::string& s)
+{
+  out->push_back('"');
+  size_t i = 0;
+  while (i < s.size()) {
+    const size_t n = find_json_special(s.data() + i, s.size() - i);
+    out->append(s, i, n);
+    i += n;
+    if (i < s.size()) {
+      char esc[6];
+      out->append(esc, json_escape_byte(static_cast<unsigned char>(s[i]), esc));
+      i++;
     }
-  };
+  }
+  out->push_back('"');
+}
 
-  // 8) Page-by-page loop
-  uint64_t page_no = 0;
-  while (true) {
-    size_t rd = my_read(in_fd, page_buf.get(), physical_page_size, MYF(0));
-    if (rd == 0) {
-      // EOF
-      break;
+/** --report: totals and one entry per table, in input order. */
+static bool write_batch_report(const std::string& path,
+                               const std::vector<std::unique_ptr<BatchTable>>& tables,
+                               double elapsed_s, unsigned n_threads)
+{
+  uint64_t failed = 0;
+  uint64_t rows = 0;
+  for (const auto& t : tables) {
+    failed += t->state.load() == BATCH_FAILED;
+    rows += t->stats.rows;
+  }
+  char buf[256];
+  std::snprintf(buf, sizeof(buf),
+                "{\"elapsed_s\":%.6f,\"threads\":%u,\"tables\":%zu,"
+                "\"failed\":%" PRIu64 ",\"rows\":%" PRIu64 ",\"results\":[",
+                elapsed_s, n_threads, tables.size(), failed, rows);
+  std::string out = buf;
+  for (size_t i = 0; i < tables.size(); i++) {
+    const BatchTable& t = *tables[i];
+    const bool ok = t.state.load() == BATCH_DONE;
+    out += i ? ",\n" : "\n";
+    out += "{\"ibd\":";
+    append_report_string(&out, t.ibd_path);
+    out += ",\"schema\":";
+    append_report_string(&out, t.sdi_path.empty() ? std::string("sdi") : t.sdi_path);
+    out += ",\"output\":";
+    append_report_string(&out, t.out_path);
+    out += ok ? ",\"status\":\"ok\"" : ",\"status\":\"failed\",\"error\":";
+    if (!ok) {
+      append_report_string(&out, t.error);
+    }
+    std::snprintf(buf, sizeof(buf),
+                  ",\"pages\":%" PRIu64 ",\"rows\":%" PRIu64
+                  ",\"records_invalid\":%" PRIu64 ",\"seconds\":%.6f}",
+                  t.total_pages, t.stats.rows, t.stats.records_invalid, t.seconds);
+    out += buf;
+  }
+  out += "\n]}\n";
+
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (f == nullptr) {
+    std::cerr << "Cannot write report " << path << "\n";
+    return false;
+  }
+  const bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+  return (std::fclose(f) == 0) && ok;
+}
+
+/** base/path unless path is absolute. */
+static std::string batch_join_path(const std::string& base, const std::string& path)
+{
+  if (path.empty() || path[0] == '/' || base.empty()) {
+    return path;
+  }
+  return base + "/" + path;
+}
+
+/** "dir/orders.ibd" -> "orders" */
+static std::string batch_table_stem(const std::string& ibd_path)
+{
+  const size_t slash = ibd_path.find_last_of('/');
+  std::string stem = slash == std::string::npos ? ibd_path : ibd_path.substr(slash + 1);
+  if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".ibd") == 0) {
+    stem.resize(stem.size() - 4);
+  }
+  return stem;
+}
+
+/**
+ * (ibd, sdi) pairs to parse: every *.ibd in a directory (with
+ * <name>_sdi.json beside it when there is one), or the lines of a manifest,
+ * "<file.ibd> [<sdi.json>]", relative to the manifest's directory.
+ */
+static bool list_batch_inputs(const std::string& input,
+                              std::vector<std::pair<std::string, std::string>>* out)
+{
+  struct stat st;
+  if (::stat(input.c_str(), &st) != 0) {
+    std::cerr << "Cannot stat " << input << ": " << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  if (S_ISDIR(st.st_mode)) {
+    DIR* dir = ::opendir(input.c_str());
+    if (dir == nullptr) {
+      std::cerr << "Cannot read directory " << input << "\n";
+      return false;
     }
-    if (rd < physical_page_size) {
-      std::cerr << "Warning: partial page read at page " << page_no << "\n";
-      break;
+    std::vector<std::string> names;
+    while (const struct dirent* ent = ::readdir(dir)) {
+      const std::string name = ent->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ibd") == 0) {
+        names.push_back(name);
+      }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+      const std::string ibd = batch_join_path(input, name);
+      std::string sdi = batch_join_path(input, batch_table_stem(name) + "_sdi.json");
+      if (::access(sdi.c_str(), R_OK) != 0) {
+        sdi.clear();
+      }
+      out->emplace_back(ibd, sdi);
     }
+    return true;
+  }
 
-    const uint32_t on_disk_page_no =
-        mach_read_from_4(page_buf.get() + FIL_PAGE_OFFSET);
-    if (!skip_page_check && on_disk_page_no != page_no) {
-      page_no++;
+  std::ifstream manifest(input);
+  if (!manifest) {
+    std::cerr << "Cannot open manifest " << input << "\n";
+    return false;
+  }
+  const size_t slash = input.find_last_of('/');
+  const std::string base = slash == std::string::npos ? "" : input.substr(0, slash);
+  std::string line;
+  unsigned line_no = 0;
+  while (std::getline(manifest, line)) {
+    line_no++;
+    const size_t hash = line.find('#');
+    if (hash != std::string::npos) {
+      line.resize(hash);
+    }
+    std::istringstream fields(line);
+    std::string ibd, sdi, extra;
+    if (!(fields >> ibd)) {
       continue;
     }
+    fields >> sdi;
+    if (fields >> extra) {
+      std::cerr << input << ":" << line_no
+                << ": expected \"<file.ibd> [<sdi.json>]\"\n";
+      return false;
+    }
+    out->emplace_back(batch_join_path(base, ibd),
+                      sdi.empty() ? sdi : batch_join_path(base, sdi));
+  }
+  return true;
+}
+
+/**
+ * (C2) Batch parse: many tablespaces in one process. my_init, the charset
+ * tables and the keyring master key are paid for once; the tables share
+ * one pool of workers, largest first, and each worker takes the next page
+ * chunk of whichever prepared table has one, so big tables are split
+ * across threads while the small ones fill in around them. Each table gets
+ * its own output file, identical to mode 3's, and the run one JSON report.
+ */
+static int do_batch_parse_main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage for mode=7 (batch parse):\n"
+              << "  ib_parser 7 <manifest|dir> --output-dir=DIR [--threads=N]\n"
+              << "    [--format=pipe|csv|jsonl] [--with-meta] [--sdi-cache=DIR]\n"
+              << "    [--report=PATH] [--skip-xdes] [--skip-page-check] [--lob-cache-mb=N]\n"
+              << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n"
+              << "    [--log-level=error|warn|info|debug|trace]\n";
+    return 1;
+  }
 
-    const uint16_t page_type = mach_read_from_2(page_buf.get() + FIL_PAGE_TYPE);
-    if (debug_mode) {
-      fprintf(stderr, "DEBUG: page=%lu, type=%u, FIL_PAGE_INDEX=%u\n",
-              (unsigned long)page_no, page_type, (unsigned)FIL_PAGE_INDEX);
+  const std::string input = argv[1];
+  std::string output_dir;
+  std::string report_path;
+  unsigned n_threads = std::max(1u, std::thread::hardware_concurrency());
+  KeyringArgs keyring;
+  BatchOptions opts;
+  opts.output.format = ROW_OUTPUT_PIPE;
+  opts.output.include_meta = false;
+  opts.output.out = nullptr;
+  opts.chunk_pages = parse_chunk_pages();
+
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--output-dir=", 0) == 0) {
+      output_dir = arg.substr(std::strlen("--output-dir="));
+      continue;
     }
-    if (page_type == FIL_PAGE_TYPE_XDES ||
-        page_type == FIL_PAGE_TYPE_FSP_HDR) {
-      xdes_cache.update(page_no, page_buf.get(), physical_page_size);
+    if (arg.rfind("--report=", 0) == 0) {
+      report_path = arg.substr(std::strlen("--report="));
+      continue;
     }
-
-    load_xdes_page(page_no);
-    if (!skip_xdes && xdes_cache.is_free(page_no, pg_sz)) {
-      if (debug_mode) {
-        fprintf(stderr, "DEBUG: page=%lu marked free by xdes\n", (unsigned long)page_no);
+    if (arg == "--with-meta") {
+      opts.output.include_meta = true;
+      continue;
+    }
+    if (arg.rfind("--format=", 0) == 0) {
+      const std::string fmt = arg.substr(std::strlen("--format="));
+      bool columnar = false;
+      ColumnarFormat columnar_format = COLUMNAR_ARROW;
+      if (!parse_row_format(fmt, &opts.output.format, &columnar, &columnar_format) ||
+          columnar) {
+        std::cerr << "Unknown format for mode 7: " << fmt
+                  << " (expected pipe, csv or jsonl)\n";
+        return 1;
       }
-      page_no++;
       continue;
     }
-
-    if (page_type != FIL_PAGE_INDEX) {
-      if (debug_mode) {
-        fprintf(stderr, "DEBUG: page=%lu skipped - not INDEX type\n", (unsigned long)page_no);
+    if (arg.rfind("--sdi-cache=", 0) == 0) {
+      opts.sdi_cache_dir = arg.substr(std::strlen("--sdi-cache="));
+      if (opts.sdi_cache_dir.empty()) {
+        std::cerr << "--sdi-cache requires a directory\n";
+        return 1;
       }
-      page_no++;
       continue;
     }
-
-    const unsigned char* parse_buf = page_buf.get();
-    size_t parse_size = physical_page_size;
-    if (tablespace_compressed) {
-      size_t actual_size = 0;
-      if (!decompress_page_inplace(page_buf.get(),
-                                   physical_page_size,
-                                   logical_page_size,
-                                   logical_buf.get(),
-                                   logical_page_size,
-                                   &actual_size)) {
-        page_no++;
-        continue;
+    if (arg.rfind("--threads=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--threads=");
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n > 1024) {
+        std::cerr << "Invalid --threads value: " << value << "\n";
+        return 1;
       }
-      if (actual_size != logical_page_size) {
-        page_no++;
-        continue;
+      if (n > 0) {
+        n_threads = static_cast<unsigned>(n);
       }
-      parse_buf = logical_buf.get();
-      parse_size = logical_page_size;
+      continue;
     }
-
-    if (!page_is_comp(parse_buf)) {
-      page_no++;
+    if (arg == "--skip-xdes") {
+      opts.skip_xdes = true;
       continue;
     }
-
-    if (debug_mode) {
-      fprintf(stderr, "DEBUG: page_no=%lu, target_index_set=%d, target_index_id=%lu\n",
-              (unsigned long)page_no, (int)parser_ctx.target_index_set,
-              (unsigned long)parser_ctx.target_index_id);
+    if (arg == "--skip-page-check") {
+      opts.skip_page_check = true;
+      continue;
+    }
+    if (arg.rfind("--lob-cache-mb=", 0) == 0) {
+      const char* value = argv[i] + std::strlen("--lob-cache-mb=");
+      char* end = nullptr;
+      unsigned long long mb = std::strtoull(value, &end, 10);
+      if (end == value || *end != '\0' || mb > (1ULL << 20)) {
+        std::cerr << "Invalid --lob-cache-mb value: " << value << "\n";
+        return 1;
+      }
+      opts.lob_cache_mb = static_cast<size_t>(mb);
+      continue;
     }
+    if (keyring.consume(argv[i])) {
+      continue;
+    }
+    if (arg.rfind("--log-level=", 0) == 0) {
+      LogLevel level;
+      const char* value = argv[i] + std::strlen("--log-level=");
+      if (!parse_log_level(value, &level)) {
+        std::cerr << "Invalid --log-level value: " << value
+                  << " (expected error, warn, info, debug or trace)\n";
+        return 1;
+      }
+      set_log_level(level);
+      continue;
+    }
+    std::cerr << "Unknown argument: " << arg << "\n";
+    return 1;
+  }
+
+  if (output_dir.empty()) {
+    std::cerr << "Mode 7 requires --output-dir=DIR\n";
+    return 1;
+  }
+  if (::mkdir(output_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    std::cerr << "Cannot create " << output_dir << ": " << std::strerror(errno) << "\n";
+    return 1;
+  }
+  if (report_path.empty()) {
+    report_path = output_dir + "/batch_report.json";
+  }
+  uint32_t master_id = 0;
+  if (keyring.given() && !keyring.validate(&master_id)) {
+    return 1;
+  }
 
-    parse_records_on_page(parse_buf, parse_size, page_no, &parser_ctx);
+  std::vector<std::pair<std::string, std::string>> inputs;
+  if (!list_batch_inputs(input, &inputs)) {
+    return 1;
+  }
+  const char* ext = opts.output.format == ROW_OUTPUT_CSV     ? ".csv"
+                    : opts.output.format == ROW_OUTPUT_JSONL ? ".jsonl"
+                                                             : ".txt";
+  std::vector<std::unique_ptr<BatchTable>> tables;
+  std::set<std::string> stems;
+  for (const auto& in : inputs) {
+    std::unique_ptr<BatchTable> t(new BatchTable());
+    t->ibd_path = in.first;
+    t->sdi_path = in.second;
+    const std::string stem = batch_table_stem(in.first);
+    t->out_path = output_dir + "/" + stem + ext;
+    struct stat st;
+    if (!stems.insert(stem).second) {
+      t->error = "another table already writes " + t->out_path;
+    } else if (::stat(in.first.c_str(), &st) != 0) {
+      t->error = std::string("cannot stat: ") + std::strerror(errno);
+    } else {
+      t->file_size = static_cast<uint64_t>(st.st_size);
+    }
+    if (!t->error.empty()) {
+      PARSER_LOG(LOG_LEVEL_ERROR, "Error: %s: %s\n", t->ibd_path.c_str(),
+                 t->error.c_str());
+      t->state.store(BATCH_FAILED);
+    }
+    tables.push_back(std::move(t));
+  }
 
-    page_no++;
+  // Largest first, so the long tail of small tables fills in at the end.
+  std::vector<BatchTable*> order;
+  for (const auto& t : tables) {
+    order.push_back(t.get());
   }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const BatchTable* a, const BatchTable* b) {
+                     return a->file_size > b->file_size;
+                   });
 
-  if (out_file) {
-    std::fclose(out_file);
+  my_init();
+  my_thread_init();
+  if (keyring.given()) {
+    OpenSSL_add_all_algorithms();
+    if (!get_master_key(master_id, keyring.srv_uuid, keyring.keyring_path,
+                        opts.master_key)) {
+      std::cerr << "Could not get master key\n";
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
   }
+  // Every table is COMPACT or DYNAMIC, as in mode 3.
+  set_record_format(1);
+
+  const auto start = std::chrono::steady_clock::now();
+  // Bound how far workers may run ahead of a table's writer.
+  const uint64_t window = static_cast<uint64_t>(n_threads) * 4;
+  opts.chunk_slots = window + n_threads;
+  std::mutex mu;
+  std::condition_variable cv;
+  // Bumped (under mu) whenever a table is prepared or a chunk written, so
+  // idle workers know to look again.
+  std::atomic<uint64_t> epoch{0};
+  // order[] below it is failed, finished or has every chunk claimed.
+  std::atomic<size_t> cursor{0};
+
+  auto wake = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      epoch++;
+    }
+    cv.notify_all();
+  };
+
+  auto worker = [&]() {
+    my_thread_init();
+    RowWorkerContext wctx;
+    bind_row_worker_context(&wctx);
+    std::shared_ptr<PageCache> cache;
+    if (opts.lob_cache_mb > 0) {
+      cache = std::make_shared<PageCache>(opts.lob_cache_mb << 20);
+    }
+    const BatchTable* bound = nullptr;
+    std::unique_ptr<ParsePageScratch> scratch;
+
+    while (true) {
+      const uint64_t seen = epoch.load();
+      BatchTable* t = nullptr;
+      uint64_t idx = 0;
+      bool pending = false;
+      for (size_t i = cursor.load(); i < order.size(); i++) {
+        BatchTable& bt = *order[i];
+        int st = bt.state.load();
+        if (st == BATCH_NEW && bt.state.compare_exchange_strong(st, BATCH_PREPARING)) {
+          prepare_batch_table(bt, opts);
+          wake();
+          st = bt.state.load();
+        }
+        if (st == BATCH_NEW || st == BATCH_PREPARING) {
+          pending = true;
+          continue;
+        }
+        if (st == BATCH_READY) {
+          if (bt.next_chunk.load() >= bt.next_emit.load() + window) {
+            pending = true;
+            continue;
+          }
+          idx = bt.next_chunk.fetch_add(1);
+          if (idx < bt.n_chunks) {
+            t = &bt;
+            break;
+          }
+        }
+        size_t expected = i;
+        cursor.compare_exchange_strong(expected, i + 1);
+      }
+      if (t == nullptr) {
+        if (!pending) {
+          break;
+        }
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return epoch.load() != seen; });
+        continue;
+      }
+
+      if (bound != t) {
+        // New table: its settings, and no pages cached from another file.
+        bound = t;
+        wctx.output = t->output;
+        wctx.lob = t->lob;
+        if (cache) {
+          cache->clear();
+          wctx.lob.cache = cache;
+        }
+        wctx.table = t->def;
+        scratch.reset(new ParsePageScratch(t->cfg));
+      }
+
+      ParseChunkOutput result;
+      const uint64_t first = idx * opts.chunk_pages;
+      const uint64_t last = std::min(first + opts.chunk_pages, t->total_pages);
+      std::string err;
+      const bool buffered =
+          parse_chunk_to_memory(t->cfg, *scratch, wctx, first, last, &result, &err);
+      result.ready = true;
+
+      bool finished = false;
+      {
+        std::lock_guard<std::mutex> lock(t->mu);
+        t->stats.merge(result.stats);
+        if (!buffered && t->error.empty()) {
+          t->error = "cannot buffer the output of chunk " + std::to_string(idx) + ": " + err;
+        }
+        const size_t slots = t->chunks.size();
+        t->chunks[idx % slots] = std::move(result);
+        uint64_t next = t->next_emit.load();
+        while (next < t->n_chunks && t->chunks[next % slots].ready) {
+          ParseChunkOutput& chunk = t->chunks[next % slots];
+          if (!emit_parse_chunk(chunk, t->out, &t->header_done, &err) &&
+              t->error.empty()) {
+            t->error = "cannot write chunk " + std::to_string(next) + ": " + err;
+          }
+          chunk = ParseChunkOutput();
+          next++;
+        }
+        t->next_emit.store(next);
+        finished = next == t->n_chunks;
+      }
+      if (finished) {
+        finish_batch_table(*t);
+      }
+      wake();
+    }
+
+    bind_row_worker_context(nullptr);
+    my_thread_end();
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(n_threads);
+  for (unsigned i = 0; i < n_threads; i++) {
+    pool.emplace_back(worker);
+  }
+  for (auto& th : pool) {
+    th.join();
+  }
+  log_flush();
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  uint64_t failed = 0;
+  uint64_t rows = 0;
+  for (const auto& t : tables) {
+    failed += t->state.load() == BATCH_FAILED;
+    rows += t->stats.rows;
+  }
+  const bool report_ok =
+      write_batch_report(report_path, tables, elapsed.count(), n_threads);
 
-  my_close(in_fd, MYF(0));
-  ::close(sys_fd);
   my_thread_end();
   my_end(0);
 
-  std::cout << "Parse-only complete. Pages read: " << page_no << "\n";
-  return 0;
+  std::cout << "Batch parse complete. Tables: " << tables.size()
+            << ", failed: " << failed << ", rows: " << rows
+            << ", report: " << report_path << "\n";
+  return (failed == 0 && report_ok) ? 0 : 1;
 }
 
 /**
@@ -984,33 +3619,61 @@ static int do_decrypt_then_decompress_main(int argc, char** argv)
   }
 
   // -----------------------------
-  // (F) Allocate buffers based on actual page size
+  // (F) Allocate buffers based on actual page size, and start the
+  //     read-ahead / write-behind queues around the per-page work
   // -----------------------------
-  std::unique_ptr<unsigned char[]> page_buf(new unsigned char[physical_page_size]);
   std::unique_ptr<unsigned char[]> final_buf(new unsigned char[logical_page_size]);
 
+  struct stat in_st;
+  if (fstat(fileno(fin), &in_st) != 0) {
+    perror("fstat");
+    std::fclose(fin);
+    std::fclose(fout);
+    return 1;
+  }
+  const uint64_t total_pages =
+      static_cast<uint64_t>(in_st.st_size) / physical_page_size;
+  const PageIoOptions io_opts = page_io_options_from_env();
+  PageReadAhead reader;
+  PageWriteBehind writer;
+  if (!reader.start(fileno(fin), physical_page_size, total_pages, io_opts) ||
+      !writer.start(fileno(fout), io_opts.batch_pages * logical_page_size,
+                    io_opts)) {
+    std::cerr << "Cannot start page I/O: " << reader.error() << "\n";
+    std::fclose(fin);
+    std::fclose(fout);
+    return 1;
+  }
+
   // -----------------------------
   // (G) Page-by-page loop
   // -----------------------------
+  // The writer must drain before its descriptor goes away.
+  auto close_files = [&]() {
+    writer.finish();
+    std::fclose(fin);
+    std::fclose(fout);
+  };
   uint64_t page_number = 0;
   while (true) {
-    // Read exactly 'physical_page_size' from the file
-    size_t rd = std::fread(page_buf.get(), 1, physical_page_size, fin);
-    if (rd == 0) {
+    uint64_t read_page_no = 0;
+    unsigned char* raw = reader.next(&read_page_no);
+    if (raw == nullptr) {
+      if (reader.failed()) {
+        std::cerr << "Read failed: " << reader.error() << "\n";
+        close_files();
+        return 1;
+      }
+      if (static_cast<uint64_t>(in_st.st_size) % physical_page_size != 0) {
+        std::cerr << "Warning: partial page read at page "
+                  << page_number << "\n";
+      }
       // EOF
       break;
     }
-    if (rd < physical_page_size) {
-      std::cerr << "Warning: partial page read at page " 
-                << page_number << "\n";
-      // We can either break or continue with partial data
-      // But usually we break because it's incomplete
-      break;
-    }
-
-    // 1) Decrypt in-place
+    // 1) Decrypt in-place, right in the read-ahead buffer
     bool dec_ok = decrypt_page_inplace(
-        page_buf.get(), 
+        raw, 
         physical_page_size,   // or logical_page_size, depends on your encryption
         ts_key_iv.key, 
         32, 
@@ -1018,15 +3681,14 @@ static int do_decrypt_then_decompress_main(int argc, char** argv)
         8 * 1024);
     if (!dec_ok) {
       std::cerr << "Decrypt failed on page " << page_number << "\n";
-      std::fclose(fin);
-      std::fclose(fout);
+      close_files();
       return 1;
     }
 
     // 2) Decompress in-place (if needed)
     size_t actual_page_size = 0;
     bool cmp_ok = decompress_page_inplace(
-        page_buf.get(),          /* src data        */
+        raw,                     /* src data        */
         physical_page_size,      /* physical_size   */
         logical_page_size,       /* logical_size    */
         final_buf.get(),         /* output buffer   */
@@ -1035,25 +3697,27 @@ static int do_decrypt_then_decompress_main(int argc, char** argv)
     );
     if (!cmp_ok) {
       std::cerr << "Decompress failed on page " << page_number << "\n";
-      std::fclose(fin);
-      std::fclose(fout);
+      close_files();
       return 1;
     }
 
     // 3) Write out the final processed page
-    size_t wr = std::fwrite(final_buf.get(), 1, actual_page_size, fout);
-    if (wr < actual_page_size) {
-      std::cerr << "Failed to write final page " << page_number << "\n";
-      std::fclose(fin);
-      std::fclose(fout);
+    if (!writer.write(final_buf.get(), actual_page_size)) {
+      std::cerr << "Failed to write final page " << page_number << ": "
+                << writer.error() << "\n";
+      close_files();
       return 1;
     }
 
     page_number++;
   }
 
-  std::fclose(fin);
-  std::fclose(fout);
+  if (!writer.finish()) {
+    std::cerr << "Failed to write output: " << writer.error() << "\n";
+    close_files();
+    return 1;
+  }
+  close_files();
 
   std::cout << "Decrypt+Decompress done. " << page_number 
             << " pages written.\n";
@@ -1062,6 +3726,126 @@ static int do_decrypt_then_decompress_main(int argc, char** argv)
   return 0;
 }
 
+/**
+ * (F) Verify every page checksum (crc32 / innodb / none) on N threads and
+ *     list the pages that fail, to triage a damaged file before recovery.
+ *     Exit status is 1 if any page is corrupt.
+ */
+static int do_verify_checksums_main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage for mode=6 (verify checksums):\n"
+              << "  ib_parser 6 <in_file.ibd> [--threads=N]\n"
+              << "    [--keyring=PATH --master-key-id=N --server-uuid=UUID]\n";
+    return 1;
+  }
+
+  const char* in_file = argv[1];
+  unsigned n_threads = std::max(1u, std::thread::hardware_concurrency());
+  KeyringArgs keyring;
+
+  for (int i = 2; i < argc; i++) {
+    if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+      const char* value = argv[i] + 10;
+      char* end = nullptr;
+      unsigned long n = std::strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || n > 1024) {
+        std::cerr << "Invalid --threads value: " << value << "\n";
+        return 1;
+      }
+      // 0 => one worker per hardware thread (the default)
+      if (n > 0) {
+        n_threads = static_cast<unsigned>(n);
+      }
+      continue;
+    }
+    if (keyring.consume(argv[i])) {
+      continue;
+    }
+    std::cerr << "Unknown argument: " << argv[i] << "\n";
+    return 1;
+  }
+
+  uint32_t master_id = 0;
+  if (keyring.given() && !keyring.validate(&master_id)) {
+    return 1;
+  }
+
+  my_init();
+  my_thread_init();
+
+  PageCipher page_cipher;
+  const PageCipher* cipher = nullptr;
+  if (keyring.given()) {
+    OpenSSL_add_all_algorithms();
+    if (!load_page_cipher(in_file, master_id, keyring.srv_uuid,
+                          keyring.keyring_path, &page_cipher)) {
+      my_thread_end();
+      my_end(0);
+      return 1;
+    }
+    cipher = &page_cipher;
+  }
+
+  File in_fd = my_open(in_file, O_RDONLY, MYF(0));
+  if (in_fd < 0) {
+    std::cerr << "Cannot open file " << in_file << std::endl;
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+  page_size_t pg_sz(0, 0, false);
+  if (!determine_page_size(in_fd, pg_sz)) {
+    std::cerr << "Could not determine page size from " << in_file << "\n";
+    my_close(in_fd, MYF(0));
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+  const size_t physical_page_size = pg_sz.physical();
+  const bool compressed = physical_page_size < pg_sz.logical();
+
+  PageChecksumReport report;
+  std::string err;
+  const bool ok = verify_tablespace_checksums(in_fd, physical_page_size,
+                                              compressed, n_threads, cipher,
+                                              &report, &err);
+  my_close(in_fd, MYF(0));
+  if (!ok) {
+    std::cerr << "Cannot verify " << in_file << ": " << err << "\n";
+    my_thread_end();
+    my_end(0);
+    return 1;
+  }
+
+  for (const auto& bad : report.corrupt) {
+    const PageChecksumInfo& info = bad.second;
+    fprintf(stdout,
+            "Page %llu: %s (stored %08x/%08x, crc32 %08x, innodb %08x)\n",
+            static_cast<unsigned long long>(bad.first),
+            page_checksum_status_name(info.status), info.stored,
+            info.stored_trailer, info.crc32, info.innodb);
+  }
+  fprintf(stdout, "Checked %llu pages of %zu bytes (crc32c: %s):",
+          static_cast<unsigned long long>(report.pages), physical_page_size,
+          mysql_crc32c_implementation());
+  for (int st = 0; st < PAGE_CHECKSUM_STATUS_COUNT; st++) {
+    if (report.counts[st] > 0) {
+      fprintf(stdout, " %s=%llu",
+              page_checksum_status_name(static_cast<PageChecksumStatus>(st)),
+              static_cast<unsigned long long>(report.counts[st]));
+    }
+  }
+  fprintf(stdout, "\n");
+  if (report.counts[PAGE_CHECKSUM_ENCRYPTED] > 0 && cipher == nullptr) {
+    std::cerr << "Note: encrypted pages are only checked with --keyring.\n";
+  }
+
+  my_thread_end();
+  my_end(0);
+  return report.corrupt_pages() > 0 ? 1 : 0;
+}
+
 /**
  * The single main() that decides which path to use based on "mode".
  */
@@ -1072,7 +3856,9 @@ int main(int argc, char** argv)
     return 1;
   }
 
-  int mode = std::atoi(argv[1]);
+  // "ib_parser --verify-checksums <file>" is spelled out for mode 6.
+  int mode = std::strcmp(argv[1], "--verify-checksums") == 0
+                 ? 6 : std::atoi(argv[1]);
   switch (mode) {
     case 1:  // decrypt only
       return do_decrypt_main(argc - 1, &argv[1]);
@@ -1084,6 +3870,10 @@ int main(int argc, char** argv)
       return do_decrypt_then_decompress_main(argc - 1, &argv[1]);
     case 5:  // rebuild to uncompressed
       return do_rebuild_uncompressed_main(argc - 1, &argv[1]);
+    case 6:  // verify page checksums
+      return do_verify_checksums_main(argc - 1, &argv[1]);
+    case 7:  // batch parse
+      return do_batch_parse_main(argc - 1, &argv[1]);
     default:
       std::cerr << "Error: invalid mode '" << mode << "'\n";
       usage();
@@ -0,0 +1,93 @@
+#include "inflate_backend.h"
+
+#include <cstring>
+
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+namespace {
+
+struct ThreadInflater {
+  z_stream strm;
+  bool ready = false;
+#ifdef HAVE_LIBDEFLATE
+  libdeflate_decompressor* deflate = nullptr;
+#endif
+
+  ThreadInflater() { std::memset(&strm, 0, sizeof(strm)); }
+  ThreadInflater(const ThreadInflater&) = delete;
+  ThreadInflater& operator=(const ThreadInflater&) = delete;
+
+  ~ThreadInflater() {
+    if (ready) {
+      inflateEnd(&strm);
+    }
+#ifdef HAVE_LIBDEFLATE
+    if (deflate != nullptr) {
+      libdeflate_free_decompressor(deflate);
+    }
+#endif
+  }
+};
+
+ThreadInflater& thread_inflater() {
+  thread_local ThreadInflater inflater;
+  return inflater;
+}
+
+}  // namespace
+
+const char* inflate_backend_name() {
+#if defined(HAVE_LIBDEFLATE)
+  return "libdeflate";
+#elif defined(ZLIBNG_VERSION)
+  return "zlib-ng";
+#else
+  return "zlib";
+#endif
+}
+
+z_stream* thread_inflate_stream() {
+  ThreadInflater& inflater = thread_inflater();
+  if (!inflater.ready) {
+    if (inflateInit(&inflater.strm) != Z_OK) {
+      return nullptr;
+    }
+    inflater.ready = true;
+  } else if (inflateReset(&inflater.strm) != Z_OK) {
+    return nullptr;
+  }
+  inflater.strm.next_in = Z_NULL;
+  inflater.strm.avail_in = 0;
+  inflater.strm.next_out = Z_NULL;
+  inflater.strm.avail_out = 0;
+  return &inflater.strm;
+}
+
+bool inflate_whole(const unsigned char* in, size_t in_len,
+                   unsigned char* out, size_t out_len, size_t* produced) {
+  *produced = 0;
+#ifdef HAVE_LIBDEFLATE
+  ThreadInflater& inflater = thread_inflater();
+  if (inflater.deflate == nullptr) {
+    inflater.deflate = libdeflate_alloc_decompressor();
+  }
+  if (inflater.deflate != nullptr) {
+    size_t used_in = 0;
+    return libdeflate_zlib_decompress_ex(inflater.deflate, in, in_len, out, out_len,
+                                         &used_in, produced) == LIBDEFLATE_SUCCESS;
+  }
+#endif
+  z_stream* strm = thread_inflate_stream();
+  if (strm == nullptr) {
+    return false;
+  }
+  strm->next_in = const_cast<Bytef*>(in);
+  strm->avail_in = static_cast<uInt>(in_len);
+  strm->next_out = out;
+  strm->avail_out = static_cast<uInt>(out_len);
+  const int ret = inflate(strm, Z_FINISH);
+  *produced = out_len - strm->avail_out;
+  return ret == Z_STREAM_END;
+}
@@ -0,0 +1,41 @@
+#ifndef INFLATE_BACKEND_H
+#define INFLATE_BACKEND_H
+
+#include <cstddef>
+
+#include <zlib.h>
+
+/**
+ * zlib inflate for the streams the parser decodes itself (ZLOB and ZBLOB
+ * chains, SDI records), with the inflate state and its 32KB window kept
+ * per thread instead of being set up again for every value.
+ *
+ * The backend is picked at configure time with -DINFLATE_BACKEND:
+ *   zlib        the system libz (default)
+ *   zlib-ng     zlib-ng's zlib-compatible build, linked in place of libz;
+ *               page_zip_decompress_low() calls zlib itself, so this is the
+ *               backend that speeds up ROW_FORMAT=COMPRESSED pages too
+ *   libdeflate  one-shot inflate of whole ZLOB streams; everything that
+ *               inflates page by page stays on zlib
+ * zlib-ng and libdeflate choose their SIMD kernels from the running CPU.
+ */
+
+/** Backend compiled in: "zlib", "zlib-ng" or "libdeflate". */
+const char* inflate_backend_name();
+
+/**
+ * This thread's z_stream, reset for a new zlib stream, or nullptr if the
+ * first inflateInit() failed. Finish one stream before asking for the
+ * next; the state is released when the thread exits.
+ */
+z_stream* thread_inflate_stream();
+
+/**
+ * Inflate the complete zlib stream in in[0, in_len) into out, which has
+ * room for out_len bytes; false if the stream is damaged or does not fit.
+ * Bytes after the end of the stream are ignored.
+ */
+bool inflate_whole(const unsigned char* in, size_t in_len,
+                   unsigned char* out, size_t out_len, size_t* produced);
+
+#endif  // INFLATE_BACKEND_H
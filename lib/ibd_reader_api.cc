@@ -3,7 +3,9 @@
  */
 
 #include "ibd_reader_api.h"
+#include <algorithm>
 #include <cstring>
+#include <new>
 #include <string>
 #include <memory>
 #include <queue>
@@ -25,12 +27,21 @@
 #include "../decrypt.h"
 #include "../parser.h"
 #include "../my_keyring_lookup.h"
+#include "../tablespace_map.h"
+#include "../parse_stats.h"
+#include "../schema_cache.h"
+#include "../page_map.h"
+
+static_assert(IBD_STAGE_COUNT == kParseStageCount &&
+              IBD_STAGE_LOB == STAGE_LOB && IBD_STAGE_WRITE == STAGE_WRITE,
+              "ibd_stage_t must follow ParseStage");
 
 static bool read_index_id_from_root_fd(int fd,
                                        page_no_t root,
                                        size_t physical_size,
                                        size_t logical_size,
                                        bool tablespace_compressed,
+                                       const TablespaceMap* map,
                                        uint64_t* out) {
     if (root == FIL_NULL || out == nullptr) {
         return false;
@@ -42,17 +53,21 @@ static bool read_index_id_from_root_fd(int fd,
         logical_buf.resize(logical_size);
     }
 
-    const off_t offset = static_cast<off_t>(root) *
-                         static_cast<off_t>(physical_size);
-    if (pread(fd, page_buf.data(), physical_size, offset) !=
-        static_cast<ssize_t>(physical_size)) {
-        return false;
+    const unsigned char* raw = map ? map->page(root, physical_size) : nullptr;
+    if (raw == nullptr) {
+        const off_t offset = static_cast<off_t>(root) *
+                             static_cast<off_t>(physical_size);
+        if (pread(fd, page_buf.data(), physical_size, offset) !=
+            static_cast<ssize_t>(physical_size)) {
+            return false;
+        }
+        raw = page_buf.data();
     }
 
-    const unsigned char* page_data = page_buf.data();
+    const unsigned char* page_data = raw;
     if (tablespace_compressed) {
         size_t actual_size = 0;
-        if (!decompress_page_inplace(page_buf.data(), physical_size, logical_size,
+        if (!decompress_page_inplace(raw, physical_size, logical_size,
                                      logical_buf.data(), logical_size, &actual_size)) {
             return false;
         }
@@ -74,8 +89,10 @@ static bool read_index_id_from_root_fd(int fd,
 struct ibd_reader {
     std::string last_error;
     bool debug_mode;
+    bool use_mmap;
+    unsigned threads;  // 0 = one per core
     
-    ibd_reader() : debug_mode(false) {}
+    ibd_reader() : debug_mode(false), use_mmap(false), threads(0) {}
     
     void set_error(const std::string& msg) {
         last_error = msg;
@@ -154,6 +171,18 @@ IBD_API void ibd_reader_set_debug(ibd_reader_t reader, int enable) {
     }
 }
 
+IBD_API void ibd_reader_set_mmap(ibd_reader_t reader, int enable) {
+    if (reader) {
+        reader->use_mmap = (enable != 0);
+    }
+}
+
+IBD_API void ibd_reader_set_threads(ibd_reader_t reader, int threads) {
+    if (reader) {
+        reader->threads = threads > 0 ? static_cast<unsigned>(threads) : 0;
+    }
+}
+
 /* ============================================================================
  * Decompression Functions
  * ============================================================================ */
@@ -282,7 +311,8 @@ IBD_API ibd_result_t ibd_decrypt_file(ibd_reader_t reader,
         }
         
         // Decrypt the file
-        if (!decrypt_ibd_file(input_path, output_path, ts_key_iv, false)) {
+        if (!decrypt_ibd_file(input_path, output_path, ts_key_iv, false,
+                              reader ? reader->threads : 0)) {
             if (reader) reader->set_error("File decryption failed");
             return IBD_ERROR_DECRYPTION;
         }
@@ -438,6 +468,7 @@ extern bool check_for_a_record(page_t *page, rec_t *rec, table_def_t *table, uli
 extern ulint my_rec_offs_nth_size(const ulint* offsets, ulint i);
 extern const unsigned char* my_rec_get_nth_field(const rec_t* rec, const ulint* offsets,
                                                   ulint i, ulint* len);
+extern void free_record_plan(table_def_t* table);
 
 // Column value storage for a row
 struct ibd_column_storage {
@@ -458,13 +489,43 @@ struct ibd_row_data {
     std::vector<ibd_column_storage> columns;
 };
 
-// Table iterator structure
-struct ibd_table_iterator {
-    ibd_reader_t reader;
+// Schema and file of an opened table; read-only once ibd_open_table()
+// returns, so the table and every cursor ibd_open_scan() makes from it
+// share one copy.
+struct ibd_table_shared {
     int fd;
+    std::string ibd_path;
     std::string table_name;
     table_def_t table_def;
     parser_context_t parser_ctx;
+    TablespaceMap map;                     // mapped when the reader asked for mmap
+
+    ibd_table_shared() : fd(-1) {
+        // build_table_def_from_json() fills the fields; clearing all of
+        // them here would touch the whole (several hundred MB) array.
+        table_def.name = nullptr;
+        table_def.fields_count = 0;
+        table_def.plan = nullptr;
+    }
+
+    ~ibd_table_shared() {
+        if (fd >= 0) {
+            close(fd);
+        }
+        // Free table_def name and field names
+        if (table_def.name) free(table_def.name);
+        for (int i = 0; i < table_def.fields_count; i++) {
+            if (table_def.fields[i].name) free(table_def.fields[i].name);
+        }
+        free_record_plan(&table_def);
+    }
+};
+
+// Table iterator structure: a cursor over pages [current_page, total_pages)
+// with its own page buffers, row queue and statistics.
+struct ibd_table_iterator {
+    ibd_reader_t reader;  // nullptr for ibd_open_scan() cursors
+    std::shared_ptr<ibd_table_shared> shared;
 
     // Page iteration state
     size_t physical_page_size;
@@ -476,21 +537,44 @@ struct ibd_table_iterator {
     // Page buffer
     std::vector<unsigned char> page_buf;
     std::vector<unsigned char> logical_buf;
+    const unsigned char* page_data;        // current leaf: page_buf, logical_buf or map
     bool at_end;
 
-    // Buffered rows from current page (parsed via callback)
+    // ibd_read_batch() filled up part-way through page_data: the page is
+    // parsed again on the next call, skipping rows already returned.
+    bool page_pending;
+    uint64_t page_rows_done;
+
+    // ibd_table_set_since_lsn(); 0 => parse every index page
+    uint64_t since_lsn;
+
+    // ibd_table_load_page_map(); pages it rules out are not read
+    std::shared_ptr<const PageMap> page_map;
+    uint32_t page_map_slot;
+
+    // ibd_table_set_columns(); empty => all columns
+    std::vector<bool> column_mask;
+
+    // Buffered rows from current page (parsed via callback): the page
+    // was queue_page and its first queue_rows live rows have been queued.
     std::queue<ibd_row_data*> row_queue;
+    uint64_t queue_page;
+    uint64_t queue_rows;
 
     // Statistics
     uint64_t rows_read;
+    ParseStats stats;  // bound while rows are read; see ibd_get_scan_stats()
 
     std::string last_error;
 
-    ibd_table_iterator() : reader(nullptr), fd(-1), physical_page_size(0),
+    ibd_table_iterator() : reader(nullptr), physical_page_size(0),
                            logical_page_size(0), tablespace_compressed(false),
                            total_pages(0), current_page(0),
-                           at_end(false), rows_read(0) {
-        memset(&table_def, 0, sizeof(table_def));
+                           page_data(nullptr), at_end(false),
+                           page_pending(false), page_rows_done(0), since_lsn(0),
+                           page_map_slot(PageMap::kNoSlot), queue_page(0),
+                           queue_rows(0), rows_read(0) {
+        stats.timing = true;
     }
 
     ~ibd_table_iterator() {
@@ -499,14 +583,6 @@ struct ibd_table_iterator {
             delete row_queue.front();
             row_queue.pop();
         }
-        if (fd >= 0) {
-            close(fd);
-        }
-        // Free table_def name and field names
-        if (table_def.name) free(table_def.name);
-        for (int i = 0; i < table_def.fields_count; i++) {
-            if (table_def.fields[i].name) free(table_def.fields[i].name);
-        }
     }
 };
 
@@ -565,31 +641,65 @@ static void compute_table_sizes(table_def_t* table, bool comp = true) {
 
 // Load next valid page for iteration
 static bool load_next_leaf_page(ibd_table_iterator* iter) {
+    ParseStats& stats = iter->stats;
     while (iter->current_page < iter->total_pages) {
-        off_t offset = static_cast<off_t>(iter->current_page) * iter->physical_page_size;
-        ssize_t rd = pread(iter->fd, iter->page_buf.data(), iter->physical_page_size, offset);
-        if (rd != static_cast<ssize_t>(iter->physical_page_size)) {
+        // The API does not consult the extent descriptors, so neither does
+        // the map (skip_xdes)
+        if (iter->page_map &&
+            !iter->page_map->wanted(iter->current_page, iter->page_map_slot, true)) {
+            stats.pages_skipped++;
             iter->current_page++;
             continue;
         }
 
+        const unsigned char* raw = nullptr;
+        {
+            StageTimer timer(STAGE_READ);
+            stats.bytes_read += iter->physical_page_size;
+            raw = iter->shared->map.page(iter->current_page, iter->physical_page_size);
+            if (raw == nullptr) {
+                off_t offset = static_cast<off_t>(iter->current_page) * iter->physical_page_size;
+                ssize_t rd = pread(iter->shared->fd, iter->page_buf.data(), iter->physical_page_size, offset);
+                if (rd == static_cast<ssize_t>(iter->physical_page_size)) {
+                    raw = iter->page_buf.data();
+                }
+            }
+        }
+        if (raw == nullptr) {
+            stats.pages_bad++;
+            iter->current_page++;
+            continue;
+        }
+        stats.pages[page_class_of(fil_page_get_type(raw))]++;
+        const uint64_t page_lsn = mach_read_from_8(raw + FIL_PAGE_LSN);
+        if (page_lsn > stats.max_lsn) stats.max_lsn = page_lsn;
+
         // Check if FIL_PAGE_INDEX
-        if (fil_page_get_type(iter->page_buf.data()) != FIL_PAGE_INDEX) {
+        if (fil_page_get_type(raw) != FIL_PAGE_INDEX) {
+            iter->current_page++;
+            continue;
+        }
+
+        // Not written since the previous scan
+        if (iter->since_lsn != 0 && page_lsn <= iter->since_lsn) {
+            stats.pages_unchanged++;
             iter->current_page++;
             continue;
         }
 
-        const unsigned char* page_data = iter->page_buf.data();
+        const unsigned char* page_data = raw;
 
         // Decompress if needed
         if (iter->tablespace_compressed) {
+            StageTimer timer(STAGE_DECOMPRESS);
             size_t actual_size = 0;
-            if (!decompress_page_inplace(iter->page_buf.data(),
+            if (!decompress_page_inplace(raw,
                                          iter->physical_page_size,
                                          iter->logical_page_size,
                                          iter->logical_buf.data(),
                                          iter->logical_page_size,
                                          &actual_size)) {
+                stats.pages_bad++;
                 iter->current_page++;
                 continue;
             }
@@ -603,7 +713,7 @@ static bool load_next_leaf_page(ibd_table_iterator* iter) {
         }
 
         // Check if target index
-        if (!is_target_index(page_data, &iter->parser_ctx)) {
+        if (!is_target_index(page_data, &iter->shared->parser_ctx)) {
             iter->current_page++;
             continue;
         }
@@ -615,11 +725,8 @@ static bool load_next_leaf_page(ibd_table_iterator* iter) {
             continue;
         }
 
-        // Found a valid leaf page - copy decompressed data if needed
-        if (iter->tablespace_compressed) {
-            memcpy(iter->page_buf.data(), iter->logical_buf.data(), iter->logical_page_size);
-        }
-
+        // Found a valid leaf page; parse it where it is
+        iter->page_data = page_data;
         return true;
     }
 
@@ -630,6 +737,8 @@ static bool load_next_leaf_page(ibd_table_iterator* iter) {
 struct row_parse_context {
     ibd_table_iterator* iter;
     int rows_parsed;
+    uint64_t skip;   // live rows at the start of the page already returned
+    uint64_t seen;
 };
 
 // Callback function that converts parsed_row_t to ibd_row_data and queues it
@@ -641,6 +750,9 @@ static bool row_parse_callback(const parsed_row_t* parsed_row, void* user_data)
     if (parsed_row->deleted) {
         return true;  // Continue parsing
     }
+    if (++ctx->seen <= ctx->skip) {
+        return true;
+    }
 
     // Skip internal columns (DB_TRX_ID, DB_ROLL_PTR)
     int user_col_count = 0;
@@ -711,6 +823,7 @@ static bool row_parse_callback(const parsed_row_t* parsed_row, void* user_data)
 
 // Read next record - uses callback-based parsing
 static ibd_row_t read_next_record(ibd_table_iterator* iter) {
+    ParseStatsScope stats_scope(&iter->stats);
     // If we have buffered rows, return from queue
     if (!iter->row_queue.empty()) {
         ibd_row_data* row = iter->row_queue.front();
@@ -721,8 +834,8 @@ static ibd_row_t read_next_record(ibd_table_iterator* iter) {
 
     // Need to parse more pages
     while (!iter->at_end) {
-        // Load next valid page
-        if (!load_next_leaf_page(iter)) {
+        // Load next valid page (or finish one ibd_read_batch() left open)
+        if (!iter->page_pending && !load_next_leaf_page(iter)) {
             iter->at_end = true;
             return nullptr;
         }
@@ -734,15 +847,21 @@ static ibd_row_t read_next_record(ibd_table_iterator* iter) {
         row_parse_context ctx;
         ctx.iter = iter;
         ctx.rows_parsed = 0;
+        ctx.skip = iter->page_pending ? iter->page_rows_done : 0;
+        ctx.seen = 0;
+        iter->page_pending = false;
 
         (void)parse_records_with_callback(
-            iter->page_buf.data(),
+            iter->page_data,
             page_size,
             iter->current_page,
-            &iter->table_def,
-            &iter->parser_ctx,
+            &iter->shared->table_def,
+            &iter->shared->parser_ctx,
             row_parse_callback,
-            &ctx);
+            &ctx,
+            iter->column_mask.empty() ? nullptr : &iter->column_mask);
+        iter->queue_page = iter->current_page;
+        iter->queue_rows = ctx.skip + ctx.rows_parsed;
 
         // Move to next page for next call
         iter->current_page++;
@@ -764,7 +883,7 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
                                      const char* ibd_path,
                                      const char* sdi_json_path,
                                      ibd_table_t* table_out) {
-    if (!ibd_path || !sdi_json_path || !table_out) {
+    if (!ibd_path || !table_out) {
         if (reader) reader->set_error("Invalid parameters");
         return IBD_ERROR_INVALID_PARAM;
     }
@@ -775,19 +894,28 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
         // Create iterator
         ibd_table_iterator* iter = new ibd_table_iterator();
         iter->reader = reader;
-
-        // Load schema from SDI JSON
-        if (load_ib2sdi_table_columns(sdi_json_path, iter->table_name, &iter->parser_ctx) != 0) {
-            iter->last_error = "Failed to load SDI JSON";
+        iter->shared = std::make_shared<ibd_table_shared>();
+        ibd_table_shared& sh = *iter->shared;
+        sh.ibd_path = ibd_path;
+
+        // Load schema from SDI JSON, or from the tablespace's own SDI
+        const int load_rc =
+            sdi_json_path
+                ? load_ib2sdi_table_columns(sdi_json_path, sh.table_name, &sh.parser_ctx)
+                : load_table_schema_from_ibd(ibd_path, nullptr, nullptr, sh.table_name,
+                                             &sh.parser_ctx);
+        if (load_rc != 0) {
+            iter->last_error = sdi_json_path ? "Failed to load SDI JSON"
+                                             : "Failed to read SDI from tablespace";
             if (reader) reader->set_error(iter->last_error);
             delete iter;
             return IBD_ERROR_INVALID_FORMAT;
         }
 
         // Build table definition
-        if (build_table_def_from_json(&iter->table_def,
-                                      iter->table_name.c_str(),
-                                      &iter->parser_ctx) != 0) {
+        if (build_table_def_from_json(&sh.table_def,
+                                      sh.table_name.c_str(),
+                                      &sh.parser_ctx) != 0) {
             iter->last_error = "Failed to build table definition";
             if (reader) reader->set_error(iter->last_error);
             delete iter;
@@ -795,11 +923,11 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
         }
 
         // Compute min/max sizes for record validation
-        compute_table_sizes(&iter->table_def);
+        compute_table_sizes(&sh.table_def);
 
         // Open the IBD file
-        iter->fd = open(ibd_path, O_RDONLY);
-        if (iter->fd < 0) {
+        sh.fd = open(ibd_path, O_RDONLY);
+        if (sh.fd < 0) {
             iter->last_error = std::string("Cannot open file: ") + ibd_path;
             if (reader) reader->set_error(iter->last_error);
             delete iter;
@@ -808,7 +936,7 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
 
         // Determine page size
         page_size_t pg_sz(0, 0, false);
-        if (!determine_page_size(static_cast<File>(iter->fd), pg_sz)) {
+        if (!determine_page_size(static_cast<File>(sh.fd), pg_sz)) {
             iter->last_error = "Cannot determine page size";
             if (reader) reader->set_error(iter->last_error);
             delete iter;
@@ -827,7 +955,7 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
 
         // Get file size and page count
         struct stat st;
-        if (fstat(iter->fd, &st) != 0) {
+        if (fstat(sh.fd, &st) != 0) {
             iter->last_error = "Cannot stat file";
             if (reader) reader->set_error(iter->last_error);
             delete iter;
@@ -835,24 +963,38 @@ IBD_API ibd_result_t ibd_open_table(ibd_reader_t reader,
         }
         iter->total_pages = st.st_size / iter->physical_page_size;
 
-        if (!target_index_is_set(&iter->parser_ctx)) {
-            page_no_t root = selected_index_root(&iter->parser_ctx);
+        // Optional mmap; on failure we just keep using pread()
+        const TablespaceMap* map = nullptr;
+        if (reader && reader->use_mmap) {
+            std::string map_err;
+            if (sh.map.open(sh.fd, &map_err)) {
+                sh.map.advise(TablespaceMap::SEQUENTIAL);
+                map = &sh.map;
+            } else if (reader->debug_mode) {
+                fprintf(stderr, "[IBD_READER] mmap failed (%s); using pread\n",
+                        map_err.c_str());
+            }
+        }
+
+        if (!target_index_is_set(&sh.parser_ctx)) {
+            page_no_t root = selected_index_root(&sh.parser_ctx);
             if (root != FIL_NULL) {
                 uint64_t idx_id = 0;
-                if (read_index_id_from_root_fd(iter->fd,
+                if (read_index_id_from_root_fd(sh.fd,
                                                root,
                                                iter->physical_page_size,
                                                iter->logical_page_size,
                                                iter->tablespace_compressed,
+                                               map,
                                                &idx_id)) {
-                    set_target_index_id_from_value(&iter->parser_ctx, idx_id);
+                    set_target_index_id_from_value(&sh.parser_ctx, idx_id);
                 }
             }
         }
 
         // Discover target index (fallback if SDI didn't provide one)
-        if (!target_index_is_set(&iter->parser_ctx)) {
-            if (discover_target_index_id(iter->fd, &iter->parser_ctx) != 0) {
+        if (!target_index_is_set(&sh.parser_ctx)) {
+            if (discover_target_index_id(sh.fd, &sh.parser_ctx, map) != 0) {
                 iter->last_error = "Cannot discover index ID";
                 if (reader) reader->set_error(iter->last_error);
                 delete iter;
@@ -879,12 +1021,12 @@ IBD_API ibd_result_t ibd_get_table_info(ibd_table_t table,
     if (!table) return IBD_ERROR_INVALID_PARAM;
 
     if (table_name && table_name_size > 0) {
-        strncpy(table_name, table->table_name.c_str(), table_name_size - 1);
+        strncpy(table_name, table->shared->table_name.c_str(), table_name_size - 1);
         table_name[table_name_size - 1] = '\0';
     }
 
     if (column_count) {
-        *column_count = static_cast<uint32_t>(table->table_def.fields_count);
+        *column_count = static_cast<uint32_t>(table->shared->table_def.fields_count);
     }
 
     return IBD_SUCCESS;
@@ -895,11 +1037,11 @@ IBD_API ibd_result_t ibd_get_column_info(ibd_table_t table,
                                           char* name,
                                           size_t name_size,
                                           ibd_column_type_t* type) {
-    if (!table || column_index >= static_cast<uint32_t>(table->table_def.fields_count)) {
+    if (!table || column_index >= static_cast<uint32_t>(table->shared->table_def.fields_count)) {
         return IBD_ERROR_INVALID_PARAM;
     }
 
-    const field_def_t* fld = &table->table_def.fields[column_index];
+    const field_def_t* fld = &table->shared->table_def.fields[column_index];
 
     if (name && name_size > 0 && fld->name) {
         strncpy(name, fld->name, name_size - 1);
@@ -913,6 +1055,221 @@ IBD_API ibd_result_t ibd_get_column_info(ibd_table_t table,
     return IBD_SUCCESS;
 }
 
+IBD_API ibd_result_t ibd_table_set_columns(ibd_table_t table,
+                                           const char* const* names,
+                                           uint32_t count) {
+    if (!table || (count > 0 && !names)) return IBD_ERROR_INVALID_PARAM;
+
+    if (table->rows_read > 0 || !table->row_queue.empty() || table->page_pending) {
+        table->last_error = "Columns must be selected before the first row is read";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_INVALID_PARAM;
+    }
+
+    if (count == 0) {
+        table->column_mask.clear();
+        return IBD_SUCCESS;
+    }
+
+    std::vector<bool> mask(static_cast<size_t>(table->shared->table_def.fields_count), false);
+    for (uint32_t n = 0; n < count; n++) {
+        int found = -1;
+        for (int i = 0; names[n] && i < table->shared->table_def.fields_count; i++) {
+            const char* field_name = table->shared->table_def.fields[i].name;
+            if (field_name && strcmp(field_name, names[n]) == 0) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0) {
+            table->last_error = std::string("Unknown column: ") + (names[n] ? names[n] : "(null)");
+            if (table->reader) table->reader->set_error(table->last_error);
+            return IBD_ERROR_INVALID_PARAM;
+        }
+        mask[static_cast<size_t>(found)] = true;
+    }
+    table->column_mask.swap(mask);
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_table_set_since_lsn(ibd_table_t table, uint64_t lsn) {
+    if (!table) return IBD_ERROR_INVALID_PARAM;
+
+    if (table->rows_read > 0 || !table->row_queue.empty() || table->page_pending) {
+        table->last_error = "The LSN must be set before the first row is read";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_INVALID_PARAM;
+    }
+    table->since_lsn = lsn;
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_table_get_position(ibd_table_t table,
+                                            ibd_table_position_t* pos) {
+    if (!table || !pos) return IBD_ERROR_INVALID_PARAM;
+
+    if (!table->row_queue.empty()) {
+        // Rows of queue_page still buffered by ibd_read_row()
+        pos->page = table->queue_page;
+        pos->rows_on_page = table->queue_rows - table->row_queue.size();
+    } else {
+        pos->page = table->current_page;
+        pos->rows_on_page = table->page_pending ? table->page_rows_done : 0;
+    }
+    pos->rows = table->rows_read;
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_table_seek(ibd_table_t table,
+                                    const ibd_table_position_t* pos) {
+    if (!table || !pos) return IBD_ERROR_INVALID_PARAM;
+
+    if (pos->page > table->total_pages) {
+        table->last_error = "Position is past the end of the tablespace";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_INVALID_PARAM;
+    }
+
+    while (!table->row_queue.empty()) {
+        delete table->row_queue.front();
+        table->row_queue.pop();
+    }
+    table->current_page = pos->page;
+    table->page_pending = false;
+    table->page_rows_done = 0;
+    table->at_end = false;
+    table->rows_read = pos->rows;
+    if (pos->rows_on_page == 0) return IBD_SUCCESS;
+
+    // Part of the page was returned: load it and skip those rows
+    ParseStatsScope stats_scope(&table->stats);
+    if (!load_next_leaf_page(table) || table->current_page != pos->page) {
+        table->current_page = pos->page;
+        table->last_error = "Position page is not a leaf page of the index";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_INVALID_FORMAT;
+    }
+    table->page_pending = true;
+    table->page_rows_done = pos->rows_on_page;
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_table_load_page_map(ibd_table_t table, const char* sidecar_path) {
+    if (!table) return IBD_ERROR_INVALID_PARAM;
+
+    try {
+        const ibd_table_shared& sh = *table->shared;
+        std::shared_ptr<PageMap> page_map = std::make_shared<PageMap>();
+        std::string err;
+        if (!load_or_build_page_map(sidecar_path ? std::string(sidecar_path)
+                                                 : page_map_sidecar_path(sh.ibd_path),
+                                    sh.fd, sh.map.mapped() ? &sh.map : nullptr, nullptr,
+                                    table->physical_page_size, table->logical_page_size,
+                                    page_map.get(), &err)) {
+            table->last_error = "Cannot build page map: " + err;
+            if (table->reader) table->reader->set_error(table->last_error);
+            return IBD_ERROR_FILE_READ;
+        }
+        table->page_map_slot = target_index_is_set(&sh.parser_ctx)
+                                   ? page_map->slot_of(sh.parser_ctx.target_index_id)
+                                   : PageMap::kNoSlot;
+        table->page_map = std::move(page_map);
+        return IBD_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        table->last_error = "Out of memory building page map";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_MEMORY;
+    }
+}
+
+IBD_API ibd_result_t ibd_table_split(ibd_table_t table, uint32_t n,
+                                     ibd_scan_range_t* ranges, uint32_t* count) {
+    if (!table || n == 0 || !ranges || !count) return IBD_ERROR_INVALID_PARAM;
+
+    const uint64_t pages = table->total_pages;
+    uint64_t parts = std::min<uint64_t>(n, pages);
+    if (!table->page_map || parts == 0) {
+        // Equal page spans, as mode 3 --threads hands out chunks; a span
+        // with no leaf of the index just returns no rows.
+        for (uint64_t i = 0; i < parts; i++) {
+            ranges[i].first_page = pages * i / parts;
+            ranges[i].end_page = pages * (i + 1) / parts;
+        }
+        *count = static_cast<uint32_t>(parts);
+        return IBD_SUCCESS;
+    }
+
+    // Equal numbers of leaves: range i starts at leaf leaves * i / parts.
+    const PageMap& pm = *table->page_map;
+    const uint32_t slot = table->page_map_slot;
+    const uint64_t leaves = pm.count_wanted(0, pages, slot, true);
+    parts = std::max<uint64_t>(std::min(parts, leaves), 1);
+    ranges[0].first_page = 0;
+    uint64_t seen = 0;
+    uint64_t next = 1;
+    for (uint64_t page_no = 0; page_no < pages && next < parts; page_no++) {
+        if (!pm.wanted(page_no, slot, true)) continue;
+        if (seen == leaves * next / parts) {
+            ranges[next - 1].end_page = page_no;
+            ranges[next].first_page = page_no;
+            next++;
+        }
+        seen++;
+    }
+    ranges[parts - 1].end_page = pages;
+    *count = static_cast<uint32_t>(parts);
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_table_shard(ibd_table_t table, uint32_t index, uint32_t count,
+                                     ibd_scan_range_t* range) {
+    if (!table || !range || index >= count) return IBD_ERROR_INVALID_PARAM;
+
+    shard_page_range(table->page_map.get(), table->page_map_slot, true,
+                     table->total_pages, table->logical_page_size, index, count,
+                     &range->first_page, &range->end_page);
+    return IBD_SUCCESS;
+}
+
+IBD_API ibd_result_t ibd_open_scan(ibd_table_t table, const ibd_scan_range_t* range,
+                                   ibd_table_t* scan_out) {
+    if (!table || !range || !scan_out) return IBD_ERROR_INVALID_PARAM;
+    *scan_out = nullptr;
+
+    if (range->first_page > range->end_page || range->end_page > table->total_pages) {
+        table->last_error = "Scan range is outside the tablespace";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_INVALID_PARAM;
+    }
+
+    try {
+        std::unique_ptr<ibd_table_iterator> scan(new ibd_table_iterator());
+        scan->shared = table->shared;
+        scan->physical_page_size = table->physical_page_size;
+        scan->logical_page_size = table->logical_page_size;
+        scan->tablespace_compressed = table->tablespace_compressed;
+        scan->page_buf.resize(table->page_buf.size());
+        scan->logical_buf.resize(table->logical_buf.size());
+        scan->current_page = range->first_page;
+        scan->total_pages = range->end_page;
+        scan->column_mask = table->column_mask;
+        scan->since_lsn = table->since_lsn;
+        scan->page_map = table->page_map;
+        scan->page_map_slot = table->page_map_slot;
+        *scan_out = scan.release();
+        return IBD_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        table->last_error = "Out of memory opening scan";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_MEMORY;
+    }
+}
+
+IBD_API const char* ibd_table_get_error(ibd_table_t table) {
+    if (!table) return "Invalid table handle";
+    return table->last_error.c_str();
+}
+
 IBD_API ibd_result_t ibd_read_row(ibd_table_t table, ibd_row_t* row_out) {
     if (!table || !row_out) return IBD_ERROR_INVALID_PARAM;
 
@@ -1002,6 +1359,221 @@ IBD_API void ibd_free_row(ibd_row_t row) {
     }
 }
 
+/* ============================================================================
+ * Batch Row API Implementation
+ * ============================================================================ */
+
+// Buffers behind an ibd_batch_t. Cell (column c, row r) lives at
+// c * stride + r; they only grow, so steady-state batches allocate nothing.
+struct ibd_batch_storage {
+    std::vector<ibd_batch_column_t> columns;
+    std::vector<uint8_t> nulls;
+    std::vector<ibd_batch_value_t> values;
+    std::vector<ibd_batch_span_t> text;
+    std::vector<char> data;
+    size_t data_size;
+    uint32_t stride;
+    uint32_t rows;
+
+    ibd_batch_storage() : data_size(0), stride(0), rows(0) {}
+
+    void reset(const table_def_t& table, const std::vector<bool>& mask,
+               uint32_t max_rows) {
+        columns.clear();
+        for (int i = 0; i < table.fields_count; i++) {
+            const field_def_t& fld = table.fields[i];
+            if (fld.type == FT_INTERNAL) {
+                continue;
+            }
+            if (!mask.empty() && !mask[static_cast<size_t>(i)]) {
+                continue;
+            }
+            ibd_batch_column_t col;
+            memset(&col, 0, sizeof(col));
+            col.name = fld.name ? fld.name : "";
+            col.type = map_field_type(fld.type);
+            columns.push_back(col);
+        }
+        const size_t cells = columns.size() * static_cast<size_t>(max_rows);
+        if (nulls.size() < cells) {
+            nulls.resize(cells);
+            values.resize(cells);
+            text.resize(cells);
+        }
+        stride = max_rows;
+        rows = 0;
+        data_size = 0;
+    }
+
+    void append_cell(size_t c, ibd_column_type_t type, bool is_null,
+                     int64_t int_val, uint64_t uint_val, double float_val,
+                     const char* str, size_t len) {
+        const size_t idx = c * stride + rows;
+        ibd_batch_value_t& v = values[idx];
+        v.uint_val = 0;
+        nulls[idx] = is_null ? 1 : 0;
+        text[idx].offset = data_size;
+        text[idx].length = 0;
+        if (is_null) {
+            return;
+        }
+        switch (type) {
+            case IBD_COL_INT:
+                v.int_val = int_val;
+                break;
+            case IBD_COL_UINT:
+                v.uint_val = uint_val;
+                break;
+            case IBD_COL_FLOAT:
+            case IBD_COL_DOUBLE:
+                v.float_val = float_val;
+                break;
+            default:
+                break;
+        }
+        if (data_size + len > data.size()) {
+            data.resize(std::max(data.size() * 2, data_size + len + 4096));
+        }
+        memcpy(data.data() + data_size, str, len);
+        data_size += len;
+        text[idx].length = static_cast<uint32_t>(len);
+    }
+
+    void publish(ibd_batch_t* batch) {
+        for (size_t c = 0; c < columns.size(); c++) {
+            const size_t base = c * stride;
+            columns[c].nulls = nulls.data() + base;
+            columns[c].values = values.data() + base;
+            columns[c].text = text.data() + base;
+        }
+        batch->row_count = rows;
+        batch->column_count = static_cast<uint32_t>(columns.size());
+        batch->columns = columns.data();
+        batch->data = data.data();
+        batch->data_size = data_size;
+    }
+};
+
+struct batch_fill_context {
+    ibd_batch_storage* st;
+    uint64_t skip;   // live rows at the start of the page already returned
+    uint64_t seen;
+    bool full;
+};
+
+static bool batch_fill_callback(const parsed_row_t* parsed_row, void* user_data) {
+    batch_fill_context* ctx = static_cast<batch_fill_context*>(user_data);
+    ibd_batch_storage* st = ctx->st;
+
+    if (parsed_row->deleted) {
+        return true;
+    }
+    if (++ctx->seen <= ctx->skip) {
+        return true;
+    }
+    if (st->rows == st->stride) {
+        ctx->full = true;
+        return false;
+    }
+
+    size_t c = 0;
+    for (int i = 0; i < parsed_row->column_count; i++) {
+        const parsed_column_t& pcol = parsed_row->columns[i];
+        if (pcol.is_internal) {
+            continue;
+        }
+        st->append_cell(c, st->columns[c].type, pcol.is_null,
+                        pcol.int_val, pcol.uint_val, pcol.double_val,
+                        pcol.formatted, strlen(pcol.formatted));
+        c++;
+    }
+    st->rows++;
+    return true;
+}
+
+IBD_API ibd_result_t ibd_read_batch(ibd_table_t table, uint32_t max_rows,
+                                    ibd_batch_t* batch) {
+    if (!table || !batch || max_rows == 0) return IBD_ERROR_INVALID_PARAM;
+
+    try {
+        ibd_batch_storage* st = static_cast<ibd_batch_storage*>(batch->internal);
+        if (!st) {
+            st = new ibd_batch_storage();
+            batch->internal = st;
+        }
+        st->reset(table->shared->table_def, table->column_mask, max_rows);
+        ParseStatsScope stats_scope(&table->stats);
+
+        // Rows ibd_read_row() already parsed from the current page go first
+        while (st->rows < max_rows && !table->row_queue.empty()) {
+            ibd_row_data* row = table->row_queue.front();
+            table->row_queue.pop();
+            for (size_t c = 0; c < row->columns.size() && c < st->columns.size(); c++) {
+                const ibd_column_storage& col = row->columns[c];
+                st->append_cell(c, col.type, col.is_null, col.num.int_val,
+                                col.num.uint_val, col.num.float_val,
+                                col.formatted.data(), col.formatted.size());
+            }
+            st->rows++;
+            delete row;
+        }
+
+        while (st->rows < max_rows && !table->at_end) {
+            if (!table->page_pending) {
+                if (!load_next_leaf_page(table)) {
+                    table->at_end = true;
+                    break;
+                }
+                table->page_rows_done = 0;
+            }
+
+            size_t page_size = table->tablespace_compressed ?
+                               table->logical_page_size : table->physical_page_size;
+
+            batch_fill_context ctx;
+            ctx.st = st;
+            ctx.skip = table->page_pending ? table->page_rows_done : 0;
+            ctx.seen = 0;
+            ctx.full = false;
+
+            (void)parse_records_with_callback(
+                table->page_data,
+                page_size,
+                table->current_page,
+                &table->shared->table_def,
+                &table->shared->parser_ctx,
+                batch_fill_callback,
+                &ctx,
+                table->column_mask.empty() ? nullptr : &table->column_mask);
+
+            if (ctx.full) {
+                // The row that did not fit is parsed again next time
+                table->page_pending = true;
+                table->page_rows_done = ctx.seen - 1;
+                break;
+            }
+            table->page_pending = false;
+            table->current_page++;
+        }
+
+        table->rows_read += st->rows;
+        st->publish(batch);
+        return st->rows > 0 ? IBD_SUCCESS : IBD_END_OF_STREAM;
+
+    } catch (const std::bad_alloc&) {
+        table->last_error = "Out of memory filling batch";
+        if (table->reader) table->reader->set_error(table->last_error);
+        return IBD_ERROR_MEMORY;
+    }
+}
+
+IBD_API void ibd_free_batch(ibd_batch_t* batch) {
+    if (batch) {
+        delete static_cast<ibd_batch_storage*>(batch->internal);
+        memset(batch, 0, sizeof(*batch));
+    }
+}
+
 IBD_API void ibd_close_table(ibd_table_t table) {
     if (table) {
         delete table;
@@ -1012,3 +1584,28 @@ IBD_API uint64_t ibd_get_row_count(ibd_table_t table) {
     if (!table) return 0;
     return table->rows_read;
 }
+
+IBD_API ibd_result_t ibd_get_scan_stats(ibd_table_t table, ibd_scan_stats_t* stats) {
+    if (!table || !stats) return IBD_ERROR_INVALID_PARAM;
+
+    const ParseStats& s = table->stats;
+    memset(stats, 0, sizeof(*stats));
+    stats->pages_read = s.pages_total();
+    stats->bytes_read = s.bytes_read;
+    stats->index_pages = s.pages[PAGE_CLASS_INDEX];
+    stats->leaf_pages = s.leaf_pages;
+    stats->pages_unreadable = s.pages_bad;
+    stats->lob_pages = s.lob_pages;
+    stats->records_valid = s.records_valid;
+    stats->records_invalid = s.records_invalid;
+    stats->records_deleted = s.records_deleted;
+    stats->rows = table->rows_read;
+    for (int i = 0; i < IBD_STAGE_COUNT; i++) {
+        stats->stage_wall_seconds[i] = s.stages[i].wall_ns / 1e9;
+        stats->stage_cpu_seconds[i] = s.stages[i].cpu_ns / 1e9;
+    }
+    stats->pages_unchanged = s.pages_unchanged;
+    stats->max_lsn = s.max_lsn;
+    stats->pages_skipped = s.pages_skipped;
+    return IBD_SUCCESS;
+}
@@ -137,6 +137,23 @@ IBD_API const char* ibd_reader_get_error(ibd_reader_t reader);
  */
 IBD_API void ibd_reader_set_debug(ibd_reader_t reader, int enable);
 
+/**
+ * Read tablespaces opened by ibd_open_table() through mmap() instead of
+ * pread(); uncompressed pages are then parsed in place. Falls back to
+ * pread() if the file cannot be mapped.
+ * @param reader Reader handle
+ * @param enable 1 to map tables opened afterwards, 0 to use pread()
+ */
+IBD_API void ibd_reader_set_mmap(ibd_reader_t reader, int enable);
+
+/**
+ * Set the number of worker threads for whole-file operations
+ * (ibd_decrypt_file() and ibd_decrypt_and_decompress_file()).
+ * @param reader Reader handle
+ * @param threads Worker count; 0 (the default) uses one per CPU core
+ */
+IBD_API void ibd_reader_set_threads(ibd_reader_t reader, int threads);
+
 /* ============================================================================
  * Decompression Functions
  * ============================================================================ */
@@ -313,7 +330,8 @@ typedef struct ibd_row_data* ibd_row_t;
  * Open a table for reading rows.
  * @param reader Reader handle
  * @param ibd_path Path to the .ibd file
- * @param sdi_json_path Path to SDI JSON file (from ibd2sdi)
+ * @param sdi_json_path Path to SDI JSON file (from ibd2sdi), or NULL to read
+ *                      the table definition from the tablespace's SDI pages
  * @param table_out Output table iterator handle
  * @return IBD_SUCCESS on success, error code otherwise
  */
@@ -350,6 +368,133 @@ IBD_API ibd_result_t ibd_get_column_info(ibd_table_t table,
                                           size_t name_size,
                                           ibd_column_type_t* type);
 
+/**
+ * Restrict the rows returned by ibd_read_row() and ibd_read_batch() to the
+ * named columns, in table order. Columns left out are skipped over without
+ * being decoded. Must be called before the first row is read.
+ * @param table Table handle
+ * @param names Column names
+ * @param count Number of names; 0 selects every column again
+ * @return IBD_SUCCESS, or IBD_ERROR_INVALID_PARAM for an unknown name
+ */
+IBD_API ibd_result_t ibd_table_set_columns(ibd_table_t table,
+                                           const char* const* names,
+                                           uint32_t count);
+
+/**
+ * Skip index pages whose FIL_PAGE_LSN is at or below lsn, so that only
+ * pages written since an earlier scan are parsed (0 parses every page).
+ * Pass the max_lsn of that scan's ibd_scan_stats_t. Must be called before
+ * the first row is read.
+ * @param table Table handle
+ * @param lsn Highest LSN already seen
+ * @return IBD_SUCCESS on success, error code otherwise
+ */
+IBD_API ibd_result_t ibd_table_set_since_lsn(ibd_table_t table, uint64_t lsn);
+
+/* Where a scan stands; rows returned so far end just before this point */
+typedef struct {
+    uint64_t page;          /* Page the next row comes from (or is looked for) */
+    uint64_t rows_on_page;  /* Live rows of that page already returned */
+    uint64_t rows;          /* Rows returned in total (ibd_get_row_count()) */
+} ibd_table_position_t;
+
+/**
+ * Get the position of a scan, to be saved and passed to ibd_table_seek()
+ * on a table later opened on the same tablespace and columns.
+ * @param table Table handle
+ * @param pos Output position
+ * @return IBD_SUCCESS on success, error code otherwise
+ */
+IBD_API ibd_result_t ibd_table_get_position(ibd_table_t table,
+                                            ibd_table_position_t* pos);
+
+/**
+ * Continue a scan from a position returned by ibd_table_get_position().
+ * Rows buffered by the previous position are dropped.
+ * @param table Table handle
+ * @param pos Position to resume at
+ * @return IBD_SUCCESS, IBD_ERROR_INVALID_PARAM for a page past the end, or
+ *         IBD_ERROR_INVALID_FORMAT if the page is no longer a leaf of the index
+ */
+IBD_API ibd_result_t ibd_table_seek(ibd_table_t table,
+                                    const ibd_table_position_t* pos);
+
+/* Pages [first_page, end_page) of a tablespace */
+typedef struct {
+    uint64_t first_page;
+    uint64_t end_page;
+} ibd_scan_range_t;
+
+/**
+ * Use a page map for this table (what every page is, as ib_parser mode 3
+ * --page-map keeps it): read from the sidecar file at sidecar_path (NULL:
+ * the tablespace path plus ".pagemap") when it matches the tablespace,
+ * otherwise built with one sequential pass over the file and saved there
+ * ("" builds without saving). From then on rows are read without touching
+ * the pages that hold no leaf of the table's index, and ibd_table_split()
+ * gives ranges with equal numbers of leaves. Scans opened afterwards share
+ * the map.
+ * @param table Table handle from ibd_open_table()
+ * @param sidecar_path Sidecar file, NULL for the default, "" for none
+ * @return IBD_SUCCESS, or IBD_ERROR_FILE_READ if the tablespace cannot be read
+ */
+IBD_API ibd_result_t ibd_table_load_page_map(ibd_table_t table, const char* sidecar_path);
+
+/**
+ * Split a table into up to n disjoint page ranges that cover it, for
+ * ibd_open_scan(). Fewer ranges are returned for tables with fewer pages
+ * (with a page map: fewer leaves).
+ * @param table Table handle
+ * @param n Ranges wanted (e.g. one per core)
+ * @param ranges Output array of at least n entries
+ * @param count Number of ranges filled in
+ * @return IBD_SUCCESS on success, error code otherwise
+ */
+IBD_API ibd_result_t ibd_table_split(ibd_table_t table, uint32_t n,
+                                     ibd_scan_range_t* ranges, uint32_t* count);
+
+/**
+ * Page range of shard index of count: the table cut on extent boundaries
+ * into count disjoint ranges that cover it, the ranges ib_parser mode 3
+ * --shard=index/count sweeps (balanced by leaves with a page map, by
+ * extents without; give every shard the same choice). Unlike
+ * ibd_table_split() the count is fixed, so each of several processes or
+ * machines can work out its own range; some may be empty. Every row is
+ * in exactly one shard.
+ * @param table Table handle
+ * @param index Shard wanted, 0 <= index < count
+ * @param count Number of shards
+ * @param range Output range, for ibd_open_scan()
+ * @return IBD_SUCCESS, or IBD_ERROR_INVALID_PARAM when index >= count
+ */
+IBD_API ibd_result_t ibd_table_shard(ibd_table_t table, uint32_t index, uint32_t count,
+                                     ibd_scan_range_t* range);
+
+/**
+ * Open a cursor over the rows of one page range of a table. The cursor
+ * shares the table's schema and file but has its own page buffers, row
+ * queue and statistics, so each of several cursors can be driven by its
+ * own thread (one cursor must not be used by two threads at once). It
+ * takes the table's ibd_table_set_columns(), ibd_table_set_since_lsn() and
+ * ibd_table_load_page_map() settings as they are now, works with every ibd_table_t function and is
+ * released with ibd_close_table(), before or after the table itself.
+ * Errors on a cursor are reported by ibd_table_get_error() only.
+ * @param table Table handle from ibd_open_table()
+ * @param range Pages to read, usually from ibd_table_split()
+ * @param scan_out Output cursor handle
+ * @return IBD_SUCCESS, or IBD_ERROR_INVALID_PARAM for a range outside the table
+ */
+IBD_API ibd_result_t ibd_open_scan(ibd_table_t table, const ibd_scan_range_t* range,
+                                   ibd_table_t* scan_out);
+
+/**
+ * Get the last error message of a table or scan cursor.
+ * @param table Table handle
+ * @return Error message string (do not free); empty if none
+ */
+IBD_API const char* ibd_table_get_error(ibd_table_t table);
+
 /**
  * Read the next row from the table.
  * @param table Table handle
@@ -391,6 +536,66 @@ IBD_API size_t ibd_row_to_string(ibd_row_t row, char* buffer, size_t buffer_size
  */
 IBD_API void ibd_free_row(ibd_row_t row);
 
+/* ============================================================================
+ * Batch Row API
+ * ============================================================================ */
+
+/* Numeric value of one cell; the member in use follows the column type */
+typedef union {
+    int64_t int_val;            /* IBD_COL_INT */
+    uint64_t uint_val;          /* IBD_COL_UINT */
+    double float_val;           /* IBD_COL_FLOAT, IBD_COL_DOUBLE */
+} ibd_batch_value_t;
+
+/* Location of one cell's formatted value in ibd_batch_t.data */
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+} ibd_batch_span_t;
+
+/* One column of a batch; every array holds ibd_batch_t.row_count entries */
+typedef struct {
+    const char* name;                 /* Column name (do not free) */
+    ibd_column_type_t type;           /* Value type */
+    const uint8_t* nulls;             /* nulls[r] is 1 if row r is NULL */
+    const ibd_batch_value_t* values;  /* Numeric value of row r (0 for other types) */
+    const ibd_batch_span_t* text;     /* Formatted value of row r (empty if NULL) */
+} ibd_batch_column_t;
+
+/* Rows returned by ibd_read_batch(), stored column by column */
+typedef struct {
+    uint32_t row_count;                 /* Rows in this batch */
+    uint32_t column_count;              /* User columns (internal ones skipped) */
+    const ibd_batch_column_t* columns;  /* [column_count] */
+    const char* data;                   /* Formatted values back to back, not NUL-terminated */
+    uint64_t data_size;
+    void* internal;                     /* Library-owned buffers; leave alone */
+} ibd_batch_t;
+
+/**
+ * Read up to max_rows rows into a batch.
+ *
+ * Rows are decoded straight into per-column arrays sized to the table's
+ * schema, so a call costs no per-row allocation or copy; the buffers are
+ * kept in the batch and reused by the next call. Zero-initialise the batch
+ * before its first use and release it with ibd_free_batch(). Everything it
+ * points to stays valid until the next ibd_read_batch() or ibd_free_batch()
+ * on the same batch.
+ *
+ * @param table Table handle
+ * @param max_rows Maximum rows to return (e.g. 4096)
+ * @param batch In/out batch
+ * @return IBD_SUCCESS with row_count > 0, IBD_END_OF_STREAM once no rows remain
+ */
+IBD_API ibd_result_t ibd_read_batch(ibd_table_t table, uint32_t max_rows,
+                                    ibd_batch_t* batch);
+
+/**
+ * Release the buffers of a batch and reset it to zero.
+ * @param batch Batch filled by ibd_read_batch()
+ */
+IBD_API void ibd_free_batch(ibd_batch_t* batch);
+
 /**
  * Close a table iterator and free resources.
  * @param table Table handle to close
@@ -404,6 +609,54 @@ IBD_API void ibd_close_table(ibd_table_t table);
  */
 IBD_API uint64_t ibd_get_row_count(ibd_table_t table);
 
+/* ============================================================================
+ * Scan Statistics
+ * ============================================================================ */
+
+/* Stages timed while reading a table; indexes the stage arrays below */
+typedef enum {
+    IBD_STAGE_READ = 0,         /* pread()/mmap copies */
+    IBD_STAGE_XDES = 1,         /* extent descriptor checks (unused by the API) */
+    IBD_STAGE_DECOMPRESS = 2,   /* page_zip inflation */
+    IBD_STAGE_PARSE = 3,        /* record walk, validation and decoding */
+    IBD_STAGE_LOB = 4,          /* external LOB chains */
+    IBD_STAGE_FORMAT = 5,       /* (unused by the API) */
+    IBD_STAGE_WRITE = 6,        /* (unused by the API) */
+    IBD_STAGE_COUNT = 7
+} ibd_stage_t;
+
+/* Counters accumulated by ibd_read_row() / ibd_read_batch() on one table */
+typedef struct {
+    uint64_t pages_read;        /* Pages read from the tablespace */
+    uint64_t bytes_read;        /* Bytes read (LOB pages included) */
+    uint64_t index_pages;       /* FIL_PAGE_INDEX pages among pages_read */
+    uint64_t leaf_pages;        /* Leaf pages of the table's index parsed */
+    uint64_t pages_unreadable;  /* Short reads and pages that failed to decompress */
+    uint64_t lob_pages;         /* LOB pages fetched (page cache hits included) */
+    uint64_t records_valid;     /* Live records that passed validation */
+    uint64_t records_invalid;   /* Records that failed validation */
+    uint64_t records_deleted;   /* Delete-marked records skipped */
+    uint64_t rows;              /* Rows returned (same as ibd_get_row_count()) */
+    double stage_wall_seconds[IBD_STAGE_COUNT];
+    double stage_cpu_seconds[IBD_STAGE_COUNT];  /* CPU time of the calling thread(s) */
+    uint64_t pages_unchanged;   /* Index pages skipped by ibd_table_set_since_lsn() */
+    uint64_t max_lsn;           /* Highest FIL_PAGE_LSN among pages_read */
+    uint64_t pages_skipped;     /* Pages not read per ibd_table_load_page_map() */
+} ibd_scan_stats_t;
+
+/**
+ * Get the read, parse and timing counters of a table so far.
+ *
+ * Stage times are exclusive (LOB reads inside a row are charged to LOB,
+ * their pread() to READ). Pages re-parsed because a batch filled up
+ * part-way count again in leaf_pages and the record counters.
+ *
+ * @param table Table handle
+ * @param stats Output counters
+ * @return IBD_SUCCESS on success, error code otherwise
+ */
+IBD_API ibd_result_t ibd_get_scan_stats(ibd_table_t table, ibd_scan_stats_t* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,7 +5,21 @@
 */
 
 #include "mysql_crc32c.h"
+#include <stdlib.h>   // for getenv
 #include <string.h>   // for memcpy, etc.
+#include <mutex>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_HW_X86 1
+#elif defined(__GNUC__) && defined(__aarch64__)
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#define CRC32C_HW_ARM 1
+#endif
 
 // ---------------------------------------------------------
 // The polynomial 0x1EDC6F41 (Castagnoli), in its bit-reflected form 0x82F63B78.
@@ -19,7 +33,8 @@ static uint32_t crc32_slice8_table[8][256];
 
 /*
   The actual function pointer we export.
-  After initialization, mysql_crc32c points to mysql_crc32c_software().
+  After initialization, mysql_crc32c points to the hardware routine when the
+  CPU has one, otherwise to mysql_crc32c_software().
 */
 uint32_t (*mysql_crc32c)(const unsigned char *buf, size_t len) = NULL;
 
@@ -120,11 +135,225 @@ static uint32_t mysql_crc32c_software(const unsigned char *buf, size_t len)
 }
 
 // ---------------------------------------------------------
-// 3) Our public initialization function
+// 3) Hardware CRC-32C (SSE4.2 crc32q / ARMv8 crc32cx)
+//
+// The crc32 instruction has a latency of ~3 cycles but can issue every
+// cycle, so a single dependency chain leaves two thirds of the unit idle.
+// Like MySQL's ut_crc32 and zlib's crc32c, the hardware path runs three
+// independent chains over adjacent blocks and merges them with a
+// "shift by N zero bytes" table, built once per block length.
 // ---------------------------------------------------------
-void mysql_crc32c_init(void)
+#if defined(CRC32C_HW_X86) || defined(CRC32C_HW_ARM)
+
+// Block lengths per chain; an InnoDB page (~16 KB of checksummed bytes)
+// takes two long rounds and a few short ones.
+static const size_t CRC32C_LONG = 2048;
+static const size_t CRC32C_SHORT = 256;
+
+static uint32_t crc32c_long_shift[4][256];
+static uint32_t crc32c_short_shift[4][256];
+
+/* Multiply a 32x32 GF(2) matrix by vec. */
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+  uint32_t sum = 0;
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+  for (int n = 0; n < 32; n++) {
+    square[n] = gf2_matrix_times(mat, mat[n]);
+  }
+}
+
+/* Operator that feeds len zero bytes (a power of two) through the CRC. */
+static void crc32c_zeros_op(uint32_t *even, size_t len)
+{
+  uint32_t odd[32];
+
+  // One zero bit
+  odd[0] = CRC32C_POLY;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  gf2_matrix_square(even, odd);  // two zero bits
+  gf2_matrix_square(odd, even);  // four zero bits
+
+  // Each squaring doubles the count; the first pair gets us to one byte.
+  do {
+    gf2_matrix_square(even, odd);
+    len >>= 1;
+    if (len == 0) {
+      return;
+    }
+    gf2_matrix_square(odd, even);
+    len >>= 1;
+  } while (len);
+
+  for (int n = 0; n < 32; n++) {
+    even[n] = odd[n];
+  }
+}
+
+static void crc32c_build_shift(uint32_t zeros[][256], size_t len)
+{
+  uint32_t op[32];
+  crc32c_zeros_op(op, len);
+  for (uint32_t n = 0; n < 256; n++) {
+    zeros[0][n] = gf2_matrix_times(op, n);
+    zeros[1][n] = gf2_matrix_times(op, n << 8);
+    zeros[2][n] = gf2_matrix_times(op, n << 16);
+    zeros[3][n] = gf2_matrix_times(op, n << 24);
+  }
+}
+
+static inline uint32_t crc32c_shift(const uint32_t zeros[][256], uint32_t crc)
+{
+  return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF] ^
+         zeros[2][(crc >> 16) & 0xFF] ^ zeros[3][crc >> 24];
+}
+
+#if defined(CRC32C_HW_X86)
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#define CRC32C_U8(crc, v) _mm_crc32_u8((crc), (v))
+#define CRC32C_U64(crc, v) _mm_crc32_u64((crc), (v))
+#else
+#if defined(__clang__)
+#define CRC32C_TARGET __attribute__((target("crc")))
+#else
+#define CRC32C_TARGET __attribute__((target("+crc")))
+#endif
+#define CRC32C_U8(crc, v) __crc32cb((crc), (v))
+#define CRC32C_U64(crc, v) __crc32cd((crc), (v))
+#endif
+
+static inline uint64_t load_u64(const unsigned char *p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/* Three chains over blk-byte blocks while at least 3*blk bytes remain. */
+CRC32C_TARGET
+static inline uint32_t crc32c_hw_3way(uint32_t crc0, const unsigned char **bufp,
+                                      size_t *lenp, size_t blk,
+                                      const uint32_t zeros[][256])
+{
+  const unsigned char *buf = *bufp;
+  size_t len = *lenp;
+  while (len >= 3 * blk) {
+    uint64_t c0 = crc0;
+    uint64_t c1 = 0;
+    uint64_t c2 = 0;
+    const unsigned char *end = buf + blk;
+    do {
+      c0 = CRC32C_U64(c0, load_u64(buf));
+      c1 = CRC32C_U64(c1, load_u64(buf + blk));
+      c2 = CRC32C_U64(c2, load_u64(buf + 2 * blk));
+      buf += 8;
+    } while (buf < end);
+    crc0 = crc32c_shift(zeros, (uint32_t)c0) ^ (uint32_t)c1;
+    crc0 = crc32c_shift(zeros, crc0) ^ (uint32_t)c2;
+    buf += 2 * blk;
+    len -= 3 * blk;
+  }
+  *bufp = buf;
+  *lenp = len;
+  return crc0;
+}
+
+CRC32C_TARGET
+static uint32_t mysql_crc32c_hw(const unsigned char *buf, size_t len)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+
+  while (len > 0 && ((uintptr_t)buf & 7) != 0) {
+    crc = CRC32C_U8(crc, *buf);
+    buf++;
+    len--;
+  }
+
+  crc = crc32c_hw_3way(crc, &buf, &len, CRC32C_LONG, crc32c_long_shift);
+  crc = crc32c_hw_3way(crc, &buf, &len, CRC32C_SHORT, crc32c_short_shift);
+
+  uint64_t c = crc;
+  while (len >= 8) {
+    c = CRC32C_U64(c, load_u64(buf));
+    buf += 8;
+    len -= 8;
+  }
+  crc = (uint32_t)c;
+
+  while (len > 0) {
+    crc = CRC32C_U8(crc, *buf);
+    buf++;
+    len--;
+  }
+
+  return (crc ^ 0xFFFFFFFFU);
+}
+
+static bool crc32c_hw_available(void)
+{
+#if defined(CRC32C_HW_X86)
+  return __builtin_cpu_supports("sse4.2");
+#elif defined(__APPLE__)
+  return true;  // every Apple arm64 core has the CRC extension
+#elif defined(__linux__) && defined(HWCAP_CRC32)
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  return false;
+#endif
+}
+
+#endif  // CRC32C_HW_X86 || CRC32C_HW_ARM
+
+// ---------------------------------------------------------
+// 4) Our public initialization function
+// ---------------------------------------------------------
+static const char *crc32c_impl_name = "software";
+
+static void crc32c_init_once(void)
 {
   build_crc32c_slice8_table();
-  // We skip hardware detection and always use the software version:
   mysql_crc32c = mysql_crc32c_software;
+
+#if defined(CRC32C_HW_X86) || defined(CRC32C_HW_ARM)
+  // IB_PARSER_CRC32C=software pins the table path (benchmarks, debugging).
+  const char *force = getenv("IB_PARSER_CRC32C");
+  if (crc32c_hw_available() &&
+      !(force != NULL && strcmp(force, "software") == 0)) {
+    crc32c_build_shift(crc32c_long_shift, CRC32C_LONG);
+    crc32c_build_shift(crc32c_short_shift, CRC32C_SHORT);
+    mysql_crc32c = mysql_crc32c_hw;
+#if defined(CRC32C_HW_X86)
+    crc32c_impl_name = "sse4.2";
+#else
+    crc32c_impl_name = "armv8-crc";
+#endif
+  }
+#endif
+}
+
+void mysql_crc32c_init(void)
+{
+  static std::once_flag once;
+  std::call_once(once, crc32c_init_once);
+}
+
+const char *mysql_crc32c_implementation(void)
+{
+  return crc32c_impl_name;
 }
@@ -9,22 +9,28 @@ extern "C" {
 #endif
 
 /**
- * Initializes the internal lookup tables used by mysql_crc32c(...).
- * Call this exactly once before your first checksum call.
- * Safe to call multiple times (it just re-initializes).
+ * Initializes the internal lookup tables used by mysql_crc32c(...) and
+ * picks the implementation for this CPU. Call this before your first
+ * checksum call. Safe to call multiple times and from several threads
+ * (only the first call does any work).
  */
 void mysql_crc32c_init(void);
 
 /**
- * Pointer to the CRC-32C function (software version).
- * After you call mysql_crc32c_init(), this function pointer is set
- * to the internal software-based function that MySQL uses.
+ * Pointer to the CRC-32C function.
+ * After you call mysql_crc32c_init(), this points to a hardware routine
+ * (SSE4.2 on x86-64, the CRC extension on ARMv8, three interleaved
+ * streams) when the CPU supports it, otherwise to the slice-by-8 software
+ * routine. IB_PARSER_CRC32C=software forces the latter.
  *
  * Usage:
  *   uint32_t crc = mysql_crc32c(buffer, length);
  */
 extern uint32_t (*mysql_crc32c)(const unsigned char *buf, size_t len);
 
+/** "sse4.2", "armv8-crc" or "software", once mysql_crc32c_init() has run. */
+const char *mysql_crc32c_implementation(void);
+
 #ifdef __cplusplus
 }
 #endif
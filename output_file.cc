@@ -0,0 +1,557 @@
+/**
+ * output_file.cc
+ *
+ * Block-parallel zstd / LZ4 compression and size-based splitting of the
+ * mode 3 text output (see output_file.h).
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "output_file.h"
+
+// Uncompressed bytes per block (and per compressed frame).
+static const size_t kBlockBytes = 4 << 20;
+#ifdef HAVE_ZSTD
+// zstd's own default: about gzip -6 ratios at several times the speed.
+static const int kZstdLevel = 3;
+#endif
+
+namespace {
+
+// fsync path's directory, so that a finished file's rename is on disk.
+bool sync_dir_of(const std::string& path) {
+  const size_t slash = path.rfind('/');
+  const std::string dir =
+      slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+
+struct Block {
+  size_t part = 0;         // file index
+  bool ends_part = false;  // close the file after this block
+  bool ready = false;      // out holds the bytes to write
+  std::string raw;
+  std::string out;
+};
+
+// Per-thread compression state.
+class BlockCompressor {
+ public:
+  explicit BlockCompressor(OutputCompression compression) : compression_(compression) {}
+  ~BlockCompressor() {
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(zstd_);
+#endif
+  }
+  BlockCompressor(const BlockCompressor&) = delete;
+  BlockCompressor& operator=(const BlockCompressor&) = delete;
+
+  /** in as one frame into *out; false with *err on failure. */
+  bool compress(const std::string& in, std::string* out, std::string* err) {
+#ifdef HAVE_ZSTD
+    if (compression_ == OUTPUT_COMPRESS_ZSTD) {
+      if (!zstd_ && !(zstd_ = ZSTD_createCCtx())) {
+        *err = "cannot allocate a zstd context";
+        return false;
+      }
+      out->resize(ZSTD_compressBound(in.size()));
+      const size_t n = ZSTD_compressCCtx(zstd_, &(*out)[0], out->size(), in.data(),
+                                         in.size(), kZstdLevel);
+      if (ZSTD_isError(n)) {
+        *err = std::string("zstd: ") + ZSTD_getErrorName(n);
+        return false;
+      }
+      out->resize(n);
+      return true;
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (compression_ == OUTPUT_COMPRESS_LZ4) {
+      LZ4F_preferences_t prefs;
+      std::memset(&prefs, 0, sizeof(prefs));
+      prefs.frameInfo.contentSize = in.size();
+      out->resize(LZ4F_compressFrameBound(in.size(), &prefs));
+      const size_t n = LZ4F_compressFrame(&(*out)[0], out->size(), in.data(),
+                                          in.size(), &prefs);
+      if (LZ4F_isError(n)) {
+        *err = std::string("lz4: ") + LZ4F_getErrorName(n);
+        return false;
+      }
+      out->resize(n);
+      return true;
+    }
+#endif
+    *err = "compression not available";
+    return false;
+  }
+
+ private:
+  OutputCompression compression_;
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx* zstd_ = nullptr;
+#endif
+};
+
+}  // namespace
+
+/**
+ * The stream side (write(), on whichever thread writes to the stream)
+ * cuts blocks and files; workers compress; one writer thread writes the
+ * blocks in order. blocks_ holds every block not yet written, in order,
+ * so its size bounds the memory in flight.
+ */
+struct OutputFileWriter::Impl {
+  std::string path;
+  OutputFileOptions opts;
+
+  // Stream side.
+  std::string pending;       // the block being filled
+  std::string header;        // the column header, repeated in every file
+  bool capturing = true;     // no header_end() / row_end() yet
+  bool part_open = false;
+  bool any_part = false;
+  size_t part_index = 0;
+  uint64_t part_bytes = 0;
+  size_t part_blocks = 0;
+  uint64_t bytes_in = 0;
+  // During write_rows(): its row ends, as offsets from rows_base.
+  const std::vector<size_t>* row_ends = nullptr;
+  uint64_t rows_base = 0;
+  size_t next_row_end = 0;
+
+  // Shared, under mu.
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::unique_ptr<Block>> blocks;
+  std::deque<Block*> todo;
+  size_t max_in_flight = 2;
+  bool closing = false;
+  bool failed = false;
+  std::string error;
+
+  // Writer thread.
+  int fd = -1;
+  std::string part_name;
+  std::atomic<uint64_t> bytes_out{0};
+  std::vector<std::string> files;
+
+  std::vector<std::thread> workers;
+  std::thread writer;
+
+  std::string file_name(size_t index) const {
+    return opts.split_bytes > 0 ? OutputFileWriter::part_path(path, index) : path;
+  }
+
+  void fail(const std::string& why) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (!failed) {
+      failed = true;
+      error = why;
+    }
+    cv.notify_all();
+  }
+
+  void start_part() {
+    part_open = true;
+    any_part = true;
+    part_bytes = 0;
+    part_blocks = 0;
+    if (part_index > 0 && !header.empty()) {
+      pending.append(header);
+      part_bytes += header.size();
+    }
+  }
+
+  void end_part() {
+    submit(true);
+    part_open = false;
+    part_index++;
+  }
+
+  void append(const char* p, size_t n) {
+    if (!part_open) {
+      start_part();
+    }
+    part_bytes += n;
+    while (n > 0) {
+      const size_t take = std::min(n, kBlockBytes - std::min(pending.size(), kBlockBytes));
+      pending.append(p, take);
+      p += take;
+      n -= take;
+      if (pending.size() >= kBlockBytes) {
+        submit(false);
+      }
+    }
+  }
+
+  void take(const char* p, size_t n) {
+    if (n == 0) {
+      return;  // nothing to start a new file with
+    }
+    if (capturing) {
+      // Until header_end() these bytes may be the header; a header this
+      // long is not one.
+      header.append(p, n);
+      if (header.size() > kBlockBytes) {
+        std::string().swap(header);
+        capturing = false;
+      }
+    }
+    append(p, n);
+  }
+
+  bool write(const char* p, size_t n) {
+    const uint64_t start = bytes_in;
+    bytes_in += n;
+    // Row ends from write_rows() inside these bytes. Only those where the
+    // file may end (or the header is dropped) cut the bytes.
+    size_t done = 0;
+    while (row_ends && next_row_end < row_ends->size()) {
+      const uint64_t end = rows_base + (*row_ends)[next_row_end];
+      if (end > start + n) {
+        break;
+      }
+      next_row_end++;
+      const size_t at = static_cast<size_t>(end - start);
+      if (capturing || (opts.split_bytes > 0 &&
+                        (!part_open || part_bytes + (at - done) >= opts.split_bytes))) {
+        take(p + done, at - done);
+        done = at;
+        row_end();
+      }
+    }
+    take(p + done, n - done);
+    std::lock_guard<std::mutex> lock(mu);
+    return !failed;
+  }
+
+  void header_end() {
+    capturing = false;
+  }
+
+  void row_end() {
+    if (capturing) {
+      // Rows before any header: there is none to repeat.
+      std::string().swap(header);
+      capturing = false;
+    }
+    if (opts.split_bytes > 0 && part_open && part_bytes >= opts.split_bytes) {
+      end_part();
+    }
+  }
+
+  // Queue pending as the next block, waiting while too many are in flight.
+  void submit(bool ends_part) {
+    if (pending.empty() && !ends_part) {
+      return;
+    }
+    std::unique_ptr<Block> block(new Block());
+    block->part = part_index;
+    block->ends_part = ends_part;
+    block->raw.swap(pending);
+    // An empty file still gets one (empty) frame, so it decompresses.
+    const bool nothing = block->raw.empty() && part_blocks > 0;
+    part_blocks++;
+
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return failed || blocks.size() < max_in_flight; });
+    if (opts.compression == OUTPUT_COMPRESS_NONE || nothing) {
+      block->out.swap(block->raw);
+      block->ready = true;
+    } else {
+      todo.push_back(block.get());
+    }
+    blocks.push_back(std::move(block));
+    cv.notify_all();
+  }
+
+  void work() {
+    BlockCompressor compressor(opts.compression);
+    std::unique_lock<std::mutex> lock(mu);
+    while (true) {
+      cv.wait(lock, [&] { return !todo.empty() || closing; });
+      if (todo.empty()) {
+        return;
+      }
+      Block* block = todo.front();
+      todo.pop_front();
+      lock.unlock();
+      std::string err;
+      const bool ok = compressor.compress(block->raw, &block->out, &err);
+      std::string().swap(block->raw);
+      lock.lock();
+      if (!ok && !failed) {
+        failed = true;
+        error = err;
+      }
+      block->ready = true;
+      cv.notify_all();
+    }
+  }
+
+  void write_out() {
+    while (true) {
+      std::unique_ptr<Block> block;
+      bool skip;
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] {
+          return (!blocks.empty() && blocks.front()->ready) || (closing && blocks.empty());
+        });
+        if (blocks.empty()) {
+          break;
+        }
+        block = std::move(blocks.front());
+        blocks.pop_front();
+        skip = failed;
+        cv.notify_all();
+      }
+      if (!skip) {
+        write_block(*block);
+      }
+    }
+    if (fd >= 0) {
+      ::close(fd);
+      ::unlink(part_name.c_str());
+      fd = -1;
+    }
+  }
+
+  void write_block(const Block& block) {
+    if (fd < 0) {
+      const std::string name = file_name(block.part);
+      part_name = name + ".partial";
+      fd = ::open(part_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+        fail("cannot create " + part_name + ": " + std::strerror(errno));
+        return;
+      }
+    }
+    const char* p = block.out.data();
+    size_t left = block.out.size();
+    while (left > 0) {
+      const ssize_t wr = ::write(fd, p, left);
+      if (wr < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fail("cannot write " + part_name + ": " + std::strerror(errno));
+        return;
+      }
+      p += wr;
+      left -= static_cast<size_t>(wr);
+    }
+    bytes_out += block.out.size();
+    if (block.ends_part) {
+      const std::string name = file_name(block.part);
+      const bool synced = ::fsync(fd) == 0;
+      const int rc = ::close(fd);
+      fd = -1;
+      if (!synced || rc != 0 || ::rename(part_name.c_str(), name.c_str()) != 0) {
+        fail("cannot finish " + name + ": " + std::strerror(errno));
+        ::unlink(part_name.c_str());
+        return;
+      }
+      // A loader may take the file as soon as it has its final name.
+      if (!sync_dir_of(name)) {
+        fail("cannot sync the directory of " + name + ": " + std::strerror(errno));
+        return;
+      }
+      files.push_back(name);
+    }
+  }
+
+  // fopencookie() callbacks for stream().
+  static ssize_t cookie_write(void* cookie, const char* buf, size_t size) {
+    auto* impl = static_cast<Impl*>(cookie);
+    return impl->write(buf, size) ? static_cast<ssize_t>(size) : -1;
+  }
+
+  // Only ftell(): the position is the number of bytes written.
+  static int cookie_seek(void* cookie, off64_t* pos, int whence) {
+    auto* impl = static_cast<Impl*>(cookie);
+    if (whence != SEEK_CUR || *pos != 0) {
+      errno = ESPIPE;
+      return -1;
+    }
+    *pos = static_cast<off64_t>(impl->bytes_in);
+    return 0;
+  }
+
+  static int cookie_close(void*) {
+    return 0;
+  }
+};
+
+bool OutputFileWriter::available(OutputCompression compression) {
+  switch (compression) {
+    case OUTPUT_COMPRESS_NONE:
+      return true;
+    case OUTPUT_COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    case OUTPUT_COMPRESS_LZ4:
+#ifdef HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+bool OutputFileWriter::parse_compression(const std::string& name, OutputCompression* out) {
+  if (name == "zstd") {
+    *out = OUTPUT_COMPRESS_ZSTD;
+  } else if (name == "lz4") {
+    *out = OUTPUT_COMPRESS_LZ4;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string OutputFileWriter::part_path(const std::string& path, size_t index) {
+  char num[24];
+  std::snprintf(num, sizeof(num), ".%05zu", index);
+  const size_t slash = path.rfind('/');
+  const size_t base = slash == std::string::npos ? 0 : slash + 1;
+  // A leading dot (".rows") is part of the name, not an extension.
+  const size_t dot = path.find('.', base + 1);
+  if (dot == std::string::npos) {
+    return path + num;
+  }
+  return path.substr(0, dot) + num + path.substr(dot);
+}
+
+std::unique_ptr<OutputFileWriter> OutputFileWriter::create(const std::string& path,
+                                                           const OutputFileOptions& opts,
+                                                           std::string* err) {
+  if (!available(opts.compression)) {
+    *err = std::string("this ib_parser was built without ") +
+           (opts.compression == OUTPUT_COMPRESS_ZSTD ? "libzstd" : "liblz4");
+    return nullptr;
+  }
+  std::unique_ptr<Impl> impl(new Impl());
+  impl->path = path;
+  impl->opts = opts;
+  const unsigned workers =
+      opts.compression == OUTPUT_COMPRESS_NONE ? 0 : std::max(opts.threads, 1u);
+  // Enough blocks queued to keep every worker busy while one is written.
+  impl->max_in_flight = 2 * static_cast<size_t>(workers) + 2;
+
+  cookie_io_functions_t io;
+  std::memset(&io, 0, sizeof(io));
+  io.write = Impl::cookie_write;
+  io.seek = Impl::cookie_seek;
+  io.close = Impl::cookie_close;
+  FILE* stream = fopencookie(impl.get(), "w", io);
+  if (!stream) {
+    *err = std::string("cannot open an output stream: ") + std::strerror(errno);
+    return nullptr;
+  }
+  // The row writer already hands over whole rows or chunks.
+  std::setvbuf(stream, nullptr, _IONBF, 0);
+
+  Impl* raw = impl.get();
+  for (unsigned i = 0; i < workers; i++) {
+    impl->workers.emplace_back([raw] { raw->work(); });
+  }
+  impl->writer = std::thread([raw] { raw->write_out(); });
+
+  std::unique_ptr<OutputFileWriter> writer(new OutputFileWriter(std::move(impl)));
+  writer->stream_ = stream;
+  return writer;
+}
+
+OutputFileWriter::OutputFileWriter(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+OutputFileWriter::~OutputFileWriter() {
+  finish();
+}
+
+bool OutputFileWriter::finish() {
+  if (!stream_) {
+    return error_.empty();
+  }
+  std::fclose(stream_);
+  stream_ = nullptr;
+
+  Impl& impl = *impl_;
+  if (impl.part_open || !impl.any_part) {
+    // The last file, or the only (empty) one.
+    if (!impl.part_open) {
+      impl.start_part();
+    }
+    impl.end_part();
+  }
+  {
+    std::lock_guard<std::mutex> lock(impl.mu);
+    impl.closing = true;
+    impl.cv.notify_all();
+  }
+  for (auto& t : impl.workers) {
+    t.join();
+  }
+  impl.writer.join();
+  if (impl.failed) {
+    error_ = impl.error;
+  }
+  return error_.empty();
+}
+
+void OutputFileWriter::header_end() {
+  impl_->header_end();
+}
+
+void OutputFileWriter::row_end() {
+  impl_->row_end();
+}
+
+bool OutputFileWriter::write_rows(const char* p, size_t n,
+                                  const std::vector<size_t>& row_ends) {
+  // stream() is unbuffered, so its bytes so far have all reached write().
+  impl_->row_ends = &row_ends;
+  impl_->rows_base = impl_->bytes_in;
+  impl_->next_row_end = 0;
+  const bool ok = std::fwrite(p, 1, n, stream_) == n;
+  impl_->row_ends = nullptr;
+  return ok;
+}
+
+uint64_t OutputFileWriter::bytes_in() const {
+  return impl_->bytes_in;
+}
+
+uint64_t OutputFileWriter::bytes_out() const {
+  return impl_->bytes_out;
+}
+
+const std::vector<std::string>& OutputFileWriter::files() const {
+  return impl_->files;
+}
@@ -0,0 +1,108 @@
+#ifndef OUTPUT_FILE_H
+#define OUTPUT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Compressed and split text output for mode 3 (--output-compress,
+ * --output-split).
+ *
+ * stream() is a stdio stream like the one fopen() would give, so the row
+ * writer, the --threads chunk writer and the header code use it
+ * unchanged. Behind it the bytes are cut into blocks that a pool of
+ * threads compresses, each block as one zstd or LZ4 frame (a file of
+ * concatenated frames decompresses as one with the stock tools), and that
+ * a writer thread appends to the output in their original order.
+ *
+ * With split_bytes the output rolls over to a new numbered file at the
+ * first row end after that many uncompressed bytes. Row ends are not
+ * guessed from the bytes (a pipe-format value may hold a newline): the
+ * code writing the stream reports them with row_end(), or hands a buffer
+ * of rows over with write_rows(), and the column header with
+ * header_end(). Each file is complete on its own, starting
+ * with the header when there is one, and is written under a ".partial"
+ * name that is renamed once the file is finished, so a loader can take
+ * each one as soon as it appears.
+ *
+ * The libraries are optional at build time (HAVE_ZSTD, HAVE_LZ4); without
+ * them create() fails with an explanatory error. Splitting alone needs
+ * neither.
+ */
+enum OutputCompression {
+  OUTPUT_COMPRESS_NONE = 0,
+  OUTPUT_COMPRESS_ZSTD,
+  OUTPUT_COMPRESS_LZ4
+};
+
+struct OutputFileOptions {
+  OutputCompression compression = OUTPUT_COMPRESS_NONE;
+  uint64_t split_bytes = 0;    // roll over after this many bytes; 0: one file
+  unsigned threads = 1;        // compression threads
+};
+
+class OutputFileWriter {
+ public:
+  ~OutputFileWriter();
+  OutputFileWriter(const OutputFileWriter&) = delete;
+  OutputFileWriter& operator=(const OutputFileWriter&) = delete;
+
+  /** Whether this build has the library for compression. */
+  static bool available(OutputCompression compression);
+  /** --output-compress value: "zstd" or "lz4"; false for anything else. */
+  static bool parse_compression(const std::string& name, OutputCompression* out);
+
+  /**
+   * File index of a split output: path with ".NNNNN" before its first
+   * extension ("rows.csv.zst" => "rows.00003.csv.zst").
+   */
+  static std::string part_path(const std::string& path, size_t index);
+
+  /** Start writing to path; nullptr (with *err set) on failure. */
+  static std::unique_ptr<OutputFileWriter> create(const std::string& path,
+                                                  const OutputFileOptions& opts,
+                                                  std::string* err);
+
+  /** Unbuffered stream feeding the writer. Valid until finish(). */
+  FILE* stream() const { return stream_; }
+
+  /**
+   * On the thread writing the stream, after a complete write: everything
+   * so far is the column header (repeated at the start of every file), or
+   * ends a row (a file may end here).
+   */
+  void header_end();
+  void row_end();
+
+  /**
+   * fwrite() of n bytes to stream() that hold rows ending at the offsets
+   * row_ends (ascending) into p: what writing each row and calling
+   * row_end() after it does, in one stream write. false if it failed.
+   */
+  bool write_rows(const char* p, size_t n, const std::vector<size_t>& row_ends);
+
+  /**
+   * Close the stream, compress and write what is left, and finish the
+   * last file. false if anything failed since create(), with error().
+   */
+  bool finish();
+
+  uint64_t bytes_in() const;   // bytes written to stream()
+  uint64_t bytes_out() const;  // bytes written to the files
+  const std::vector<std::string>& files() const;
+  const std::string& error() const { return error_; }
+
+ private:
+  struct Impl;
+  explicit OutputFileWriter(std::unique_ptr<Impl> impl);
+
+  std::unique_ptr<Impl> impl_;
+  FILE* stream_ = nullptr;
+  std::string error_;
+};
+
+#endif  // OUTPUT_FILE_H
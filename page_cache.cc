@@ -0,0 +1,75 @@
+/**
+ * page_cache.cc
+ *
+ * LRU page cache used by the LOB/ZLOB readers and the XDES lookups in
+ * mode 3, so chains that revisit the same first/index pages skip both the
+ * pread() and the page_zip decompression.
+ */
+#include <cstring>
+
+#include "page_cache.h"
+
+const unsigned char* PageCache::lookup(uint32_t page_no, Kind kind, size_t* size) {
+  auto it = index_.find(make_key(page_no, kind));
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  if (size) {
+    *size = it->second->size;
+  }
+  return it->second->data.get();
+}
+
+const unsigned char* PageCache::insert(uint32_t page_no, Kind kind,
+                                       const unsigned char* data, size_t size) {
+  if (size == 0 || size > capacity_) {
+    return nullptr;
+  }
+  const uint64_t key = make_key(page_no, kind);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    Entry& entry = *it->second;
+    if (entry.size == size) {
+      std::memcpy(entry.data.get(), data, size);
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return entry.data.get();
+    }
+    used_ -= entry.size;
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+
+  // Evict from the cold end; recycle a same-sized buffer when we can.
+  std::unique_ptr<unsigned char[]> buf;
+  while (used_ + size > capacity_ && !lru_.empty()) {
+    Entry& victim = lru_.back();
+    used_ -= victim.size;
+    index_.erase(victim.key);
+    if (!buf && victim.size == size) {
+      buf = std::move(victim.data);
+    }
+    lru_.pop_back();
+  }
+  if (!buf) {
+    buf.reset(new unsigned char[size]);
+  }
+  std::memcpy(buf.get(), data, size);
+
+  lru_.emplace_front();
+  Entry& entry = lru_.front();
+  entry.key = key;
+  entry.size = size;
+  entry.data = std::move(buf);
+  index_[key] = lru_.begin();
+  used_ += size;
+  return entry.data.get();
+}
+
+void PageCache::clear() {
+  lru_.clear();
+  index_.clear();
+  used_ = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+struct PageCacheCounters {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+/**
+ * Bounded LRU cache of tablespace pages, keyed by page number and kind
+ * (raw on-disk bytes vs. the decompressed logical page).
+ *
+ * Not thread-safe: each parse thread owns its own cache through its
+ * LobReadContext. Pointers returned by lookup()/insert() stay valid until
+ * the next insert() or clear().
+ */
+class PageCache {
+ public:
+  enum Kind { RAW = 0, DECODED = 1 };
+
+  explicit PageCache(size_t capacity_bytes) : capacity_(capacity_bytes) {}
+  PageCache(const PageCache&) = delete;
+  PageCache& operator=(const PageCache&) = delete;
+
+  const unsigned char* lookup(uint32_t page_no, Kind kind, size_t* size);
+  const unsigned char* insert(uint32_t page_no, Kind kind,
+                              const unsigned char* data, size_t size);
+  void clear();
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  PageCacheCounters counters() const { return PageCacheCounters{hits_, misses_}; }
+  size_t bytes_used() const { return used_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Entry {
+    uint64_t key = 0;
+    size_t size = 0;
+    std::unique_ptr<unsigned char[]> data;
+  };
+
+  static uint64_t make_key(uint32_t page_no, Kind kind) {
+    return (static_cast<uint64_t>(page_no) << 1) | static_cast<uint64_t>(kind);
+  }
+
+  size_t capacity_;
+  size_t used_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  std::list<Entry> lru_;  // front = most recently used
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
+#endif  // PAGE_CACHE_H
@@ -0,0 +1,272 @@
+/**
+ * page_checksum.cc
+ *
+ * Page checksum validation for mode 6: crc32 / innodb / none, uncompressed
+ * and page_zip formats, verified on several threads.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <my_sys.h>
+#include <my_thread.h>
+#include "fil0fil.h"
+#include "mach0data.h"
+
+#include "decrypt.h"
+#include "mysql_crc32c.h"
+#include "page_checksum.h"
+
+// Pages read per pread() and handed to a worker at a time.
+static const uint64_t kVerifyChunkPages = 64;
+
+// From buf0checksum.h / ut0rnd.h.
+static const uint32_t kNoChecksumMagic = 0xDEADBEEFUL;
+static const uint64_t kHashRandomMask = 1463735687ULL;
+static const uint64_t kHashRandomMask2 = 1653893711ULL;
+
+const char* page_checksum_status_name(PageChecksumStatus status) {
+  switch (status) {
+    case PAGE_CHECKSUM_CRC32:        return "crc32";
+    case PAGE_CHECKSUM_INNODB:       return "innodb";
+    case PAGE_CHECKSUM_NONE:         return "none";
+    case PAGE_CHECKSUM_EMPTY:        return "empty";
+    case PAGE_CHECKSUM_ENCRYPTED:    return "encrypted";
+    case PAGE_CHECKSUM_LSN_MISMATCH: return "lsn mismatch";
+    case PAGE_CHECKSUM_MISMATCH:     return "checksum mismatch";
+    case PAGE_CHECKSUM_READ_ERROR:   return "read error";
+    default:                         return "unknown";
+  }
+}
+
+/** ut_fold_binary(): the legacy "innodb" checksum hash. */
+static uint64_t fold_binary(const unsigned char* p, size_t len) {
+  uint64_t fold = 0;
+  for (size_t i = 0; i < len; i++) {
+    fold = ((((fold ^ p[i] ^ kHashRandomMask2) << 8) + fold) ^
+            kHashRandomMask) + p[i];
+  }
+  return fold;
+}
+
+static bool page_is_zeroes(const unsigned char* page, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (page[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool page_is_encrypted(const unsigned char* page) {
+  const uint16_t type = mach_read_from_2(page + FIL_PAGE_TYPE);
+  return type == FIL_PAGE_ENCRYPTED ||
+         type == FIL_PAGE_COMPRESSED_AND_ENCRYPTED ||
+         type == FIL_PAGE_ENCRYPTED_RTREE;
+}
+
+/**
+ * page_zip_calc_checksum() for the crc32 and innodb (adler32) cases: the
+ * page number and LSN, the type, and everything from the space id on.
+ */
+static void zip_checksums(const unsigned char* page, size_t size,
+                          PageChecksumInfo* info) {
+  const size_t tail = FIL_PAGE_ARCH_LOG_NO_OR_SPACE_ID;
+  info->crc32 =
+      mysql_crc32c(page + FIL_PAGE_OFFSET, FIL_PAGE_LSN - FIL_PAGE_OFFSET) ^
+      mysql_crc32c(page + FIL_PAGE_TYPE, 2) ^
+      mysql_crc32c(page + tail, size - tail);
+
+  // Seeded with 0 as the server does, not adler32()'s initial 1.
+  uLong adler = adler32(0L, page + FIL_PAGE_OFFSET, FIL_PAGE_LSN - FIL_PAGE_OFFSET);
+  adler = adler32(adler, page + FIL_PAGE_TYPE, 2);
+  adler = adler32(adler, page + tail, static_cast<uInt>(size - tail));
+  info->innodb = static_cast<uint32_t>(adler);
+}
+
+PageChecksumStatus verify_page_checksum(const unsigned char* page,
+                                        size_t physical_size,
+                                        bool compressed,
+                                        PageChecksumInfo* info) {
+  PageChecksumInfo local;
+  if (info == nullptr) {
+    info = &local;
+  }
+  *info = PageChecksumInfo();
+
+  if (page_is_zeroes(page, physical_size)) {
+    return info->status = PAGE_CHECKSUM_EMPTY;
+  }
+  if (page_is_encrypted(page)) {
+    return info->status = PAGE_CHECKSUM_ENCRYPTED;
+  }
+
+  info->stored = mach_read_from_4(page + FIL_PAGE_SPACE_OR_CHKSUM);
+
+  if (compressed) {
+    // The page_zip format keeps one checksum and no trailer LSN.
+    if (info->stored == kNoChecksumMagic) {
+      return info->status = PAGE_CHECKSUM_NONE;
+    }
+    zip_checksums(page, physical_size, info);
+    if (info->stored == info->crc32) {
+      return info->status = PAGE_CHECKSUM_CRC32;
+    }
+    if (info->stored == info->innodb) {
+      return info->status = PAGE_CHECKSUM_INNODB;
+    }
+    return info->status = PAGE_CHECKSUM_MISMATCH;
+  }
+
+  const unsigned char* trailer = page + physical_size - FIL_PAGE_END_LSN_OLD_CHKSUM;
+  info->stored_trailer = mach_read_from_4(trailer);
+  if (mach_read_from_4(page + FIL_PAGE_LSN + 4) != mach_read_from_4(trailer + 4)) {
+    return info->status = PAGE_CHECKSUM_LSN_MISMATCH;
+  }
+
+  if (info->stored == kNoChecksumMagic && info->stored_trailer == kNoChecksumMagic) {
+    return info->status = PAGE_CHECKSUM_NONE;
+  }
+
+  // buf_calc_page_crc32()
+  info->crc32 =
+      mysql_crc32c(page + FIL_PAGE_OFFSET,
+                   FIL_PAGE_FILE_FLUSH_LSN - FIL_PAGE_OFFSET) ^
+      mysql_crc32c(page + FIL_PAGE_DATA,
+                   physical_size - FIL_PAGE_DATA - FIL_PAGE_END_LSN_OLD_CHKSUM);
+  if (info->stored == info->crc32 && info->stored_trailer == info->crc32) {
+    return info->status = PAGE_CHECKSUM_CRC32;
+  }
+
+  // buf_calc_page_new_checksum() in the header; the trailer holds
+  // buf_calc_page_old_checksum(), or the LSN on very old pages.
+  info->innodb = static_cast<uint32_t>(
+      fold_binary(page + FIL_PAGE_OFFSET, FIL_PAGE_FILE_FLUSH_LSN - FIL_PAGE_OFFSET) +
+      fold_binary(page + FIL_PAGE_DATA,
+                  physical_size - FIL_PAGE_DATA - FIL_PAGE_END_LSN_OLD_CHKSUM));
+  const uint32_t old_checksum =
+      static_cast<uint32_t>(fold_binary(page, FIL_PAGE_FILE_FLUSH_LSN));
+  const bool trailer_ok = info->stored_trailer == old_checksum ||
+                          info->stored_trailer == mach_read_from_4(page + FIL_PAGE_LSN);
+  const bool header_ok = info->stored == 0 || info->stored == info->innodb;
+  if (trailer_ok && header_ok) {
+    return info->status = PAGE_CHECKSUM_INNODB;
+  }
+  return info->status = PAGE_CHECKSUM_MISMATCH;
+}
+
+bool verify_tablespace_checksums(int fd, size_t physical_size, bool compressed,
+                                 unsigned n_threads, const PageCipher* cipher,
+                                 PageChecksumReport* report, std::string* err) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    if (err) {
+      *err = std::string("fstat: ") + std::strerror(errno);
+    }
+    return false;
+  }
+  if (physical_size == 0) {
+    if (err) {
+      *err = "page size is 0";
+    }
+    return false;
+  }
+
+  mysql_crc32c_init();
+
+  const uint64_t total_pages = static_cast<uint64_t>(st.st_size) / physical_size;
+  const uint64_t n_chunks = (total_pages + kVerifyChunkPages - 1) / kVerifyChunkPages;
+  n_threads = static_cast<unsigned>(
+      std::max<uint64_t>(1, std::min<uint64_t>(n_threads, n_chunks)));
+
+  *report = PageChecksumReport();
+  report->pages = total_pages;
+
+  std::atomic<uint64_t> next_chunk{0};
+  std::mutex mu;
+
+  auto scan = [&]() {
+    std::unique_ptr<unsigned char[]> buf(
+        new unsigned char[kVerifyChunkPages * physical_size]);
+    PageChecksumReport local;
+
+    while (true) {
+      const uint64_t idx = next_chunk.fetch_add(1);
+      if (idx >= n_chunks) {
+        break;
+      }
+      const uint64_t first = idx * kVerifyChunkPages;
+      const uint64_t count = std::min(kVerifyChunkPages, total_pages - first);
+      const size_t want = static_cast<size_t>(count) * physical_size;
+      const off_t offset = static_cast<off_t>(first * physical_size);
+
+      size_t got = 0;
+      while (got < want) {
+        const ssize_t rd = pread(fd, buf.get() + got, want - got,
+                                 offset + static_cast<off_t>(got));
+        if (rd < 0 && errno == EINTR) {
+          continue;
+        }
+        if (rd <= 0) {
+          break;
+        }
+        got += static_cast<size_t>(rd);
+      }
+
+      for (uint64_t i = 0; i < count; i++) {
+        unsigned char* page = buf.get() + i * physical_size;
+        PageChecksumInfo info;
+        if ((i + 1) * physical_size > got) {
+          info.status = PAGE_CHECKSUM_READ_ERROR;
+        } else {
+          // Checksums cover the plaintext page; a page the key cannot
+          // decrypt is as damaged as one with a bad checksum.
+          if (cipher && page_is_encrypted(page) &&
+              !cipher->decrypt(page, physical_size)) {
+            info.status = PAGE_CHECKSUM_MISMATCH;
+          } else {
+            verify_page_checksum(page, physical_size, compressed, &info);
+          }
+        }
+        local.counts[info.status]++;
+        if (page_checksum_is_corrupt(info.status)) {
+          local.corrupt.emplace_back(first + i, info);
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mu);
+    for (int s = 0; s < PAGE_CHECKSUM_STATUS_COUNT; s++) {
+      report->counts[s] += local.counts[s];
+    }
+    report->corrupt.insert(report->corrupt.end(), local.corrupt.begin(),
+                           local.corrupt.end());
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < n_threads; t++) {
+    threads.emplace_back([&]() {
+      my_thread_init();
+      scan();
+      my_thread_end();
+    });
+  }
+  scan();
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  std::sort(report->corrupt.begin(), report->corrupt.end(),
+            [](const std::pair<uint64_t, PageChecksumInfo>& a,
+               const std::pair<uint64_t, PageChecksumInfo>& b) {
+              return a.first < b.first;
+            });
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef PAGE_CHECKSUM_H
+#define PAGE_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PageCipher;
+
+/**
+ * InnoDB page checksum validation behind mode 6 (verify checksums).
+ *
+ * A page passes if any of the algorithms innodb_checksum_algorithm can
+ * write matches (crc32, innodb, none), the same "accept any" rule the
+ * server applies on read. Uncompressed pages also need the LSN in the
+ * header and the trailer to agree; ROW_FORMAT=COMPRESSED tablespaces use
+ * the page_zip checksum over the physical page.
+ */
+enum PageChecksumStatus {
+  PAGE_CHECKSUM_CRC32 = 0,
+  PAGE_CHECKSUM_INNODB,
+  PAGE_CHECKSUM_NONE,
+  PAGE_CHECKSUM_EMPTY,        // all-zero page, never written
+  PAGE_CHECKSUM_ENCRYPTED,    // encrypted and no key given: not checked
+  PAGE_CHECKSUM_LSN_MISMATCH, // torn write: header/trailer LSN differ
+  PAGE_CHECKSUM_MISMATCH,
+  PAGE_CHECKSUM_READ_ERROR,
+  PAGE_CHECKSUM_STATUS_COUNT
+};
+
+struct PageChecksumInfo {
+  PageChecksumStatus status = PAGE_CHECKSUM_MISMATCH;
+  uint32_t stored = 0;        // FIL_PAGE_SPACE_OR_CHKSUM
+  uint32_t stored_trailer = 0;
+  uint32_t crc32 = 0;         // computed
+  uint32_t innodb = 0;        // computed (adler32 for compressed pages)
+};
+
+const char* page_checksum_status_name(PageChecksumStatus status);
+
+inline bool page_checksum_is_corrupt(PageChecksumStatus status) {
+  return status == PAGE_CHECKSUM_LSN_MISMATCH ||
+         status == PAGE_CHECKSUM_MISMATCH ||
+         status == PAGE_CHECKSUM_READ_ERROR;
+}
+
+/** Check one physical page; compressed selects the page_zip format. */
+PageChecksumStatus verify_page_checksum(const unsigned char* page,
+                                        size_t physical_size,
+                                        bool compressed,
+                                        PageChecksumInfo* info);
+
+struct PageChecksumReport {
+  uint64_t pages = 0;
+  uint64_t counts[PAGE_CHECKSUM_STATUS_COUNT] = {};
+  // Failing pages, in page order.
+  std::vector<std::pair<uint64_t, PageChecksumInfo>> corrupt;
+
+  uint64_t corrupt_pages() const { return corrupt.size(); }
+};
+
+/**
+ * Verify every page of fd on n_threads workers. cipher (may be null)
+ * decrypts encrypted pages before they are checked. false only if the
+ * file cannot be read at all (*err says why); corrupt pages are reported,
+ * not errors.
+ */
+bool verify_tablespace_checksums(int fd, size_t physical_size, bool compressed,
+                                 unsigned n_threads, const PageCipher* cipher,
+                                 PageChecksumReport* report, std::string* err);
+
+#endif  // PAGE_CHECKSUM_H
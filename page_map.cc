@@ -0,0 +1,436 @@
+/**
+ * page_map.cc
+ *
+ * The page map prepass and its sidecar file (see page_map.h).
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+#include "page0size.h"
+#include "page0page.h"  // PAGE_HEADER, PAGE_LEVEL, PAGE_INDEX_ID
+#include "fil0fil.h"
+#include "fsp0fsp.h"    // xdes_calc_descriptor_page(), XDES_FREE_BIT
+#include "mach0data.h"
+
+#include "decrypt.h"
+#include "page_map.h"
+#include "parser_log.h"
+#include "tablespace_map.h"
+
+static const char kSidecarMagic[8] = {'I', 'B', 'P', 'A', 'G', 'M', 'A', 'P'};
+// Bump whenever the entry bits change.
+static const uint32_t kSidecarVersion = 1;
+// magic, version, tablespace size, mtime s, mtime ns, physical and logical
+// page size, flags, pages, index ids, max LSN, body crc32.
+static const size_t kSidecarHeaderSize = 8 + 4 + 8 + 8 + 4 + 4 + 4 + 4 + 8 + 4 + 8 + 4;
+static const uint32_t kSidecarDecrypted = 1;
+// Prepass reads; large enough to stream at device speed.
+static const size_t kPageMapBatchBytes = 8 << 20;
+// Entries encoded per sidecar write or read.
+static const size_t kSidecarChunkEntries = 64 * 1024;
+
+uint32_t PageMap::slot_of(uint64_t index_id) const {
+  for (size_t i = 0; i < index_ids.size(); i++) {
+    if (index_ids[i] == index_id) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+  return kNoSlot;
+}
+
+uint64_t PageMap::count_wanted(uint64_t first, uint64_t end, uint32_t slot,
+                               bool skip_xdes) const {
+  uint64_t n = 0;
+  for (uint64_t page_no = first; page_no < end; page_no++) {
+    n += wanted(page_no, slot, skip_xdes) ? 1 : 0;
+  }
+  return n;
+}
+
+// FSP_EXTENT_SIZE for a tablespace of logical_size pages (compressed ones
+// too): 1 MiB extents up to 16 KiB pages, 2 MiB at 32 KiB, 4 MiB at 64 KiB.
+static uint64_t extent_pages(size_t logical_size) {
+  if (logical_size <= 16384) {
+    return (1u << 20) / logical_size;
+  }
+  return (logical_size <= 32768 ? (2u << 20) : (4u << 20)) / logical_size;
+}
+
+void shard_page_range(const PageMap* pm, uint32_t slot, bool skip_xdes,
+                      uint64_t total_pages, size_t logical_size,
+                      uint64_t index, uint64_t count,
+                      uint64_t* first, uint64_t* end) {
+  const uint64_t extent = extent_pages(logical_size);
+  const uint64_t extents = (total_pages + extent - 1) / extent;
+  const uint64_t wanted = pm ? pm->count_wanted(0, total_pages, slot, skip_xdes) : 0;
+
+  // Start of shard k: the first extent before which a k/count share of
+  // the leaves (or extents) lies. Monotonic in k, so shards never overlap.
+  auto boundary = [&](uint64_t k) -> uint64_t {
+    if (k >= count) {
+      return total_pages;
+    }
+    if (wanted == 0) {
+      return std::min(extents * k / count * extent, total_pages);
+    }
+    const uint64_t target = wanted * k / count;
+    uint64_t seen = 0;
+    uint64_t page_no = 0;
+    while (page_no < total_pages && seen < target) {
+      const uint64_t next = std::min(page_no + extent, total_pages);
+      seen += pm->count_wanted(page_no, next, slot, skip_xdes);
+      page_no = next;
+    }
+    return page_no;
+  };
+  *first = boundary(index);
+  *end = boundary(index + 1);
+}
+
+std::string page_map_sidecar_path(const std::string& ibd_path) {
+  return ibd_path + ".pagemap";
+}
+
+namespace {
+
+/** What a sidecar must agree on with the tablespace to be used. */
+struct SidecarKey {
+  uint64_t file_size = 0;
+  uint64_t mtime_s = 0;
+  uint32_t mtime_ns = 0;
+  uint32_t physical_size = 0;
+  uint32_t logical_size = 0;
+  uint32_t flags = 0;
+};
+
+/**
+ * Fold the page at page_no into the map: its own type, level and index
+ * id, and for extent descriptor pages the free bits of the extents they
+ * describe.
+ */
+class PageMapBuilder {
+ public:
+  PageMapBuilder(const page_size_t& pg_sz, uint64_t pages, PageMap* out)
+      : pg_sz_(pg_sz), out_(out) {
+    out_->index_ids.clear();
+    out_->entries.assign(pages, 0);
+    out_->max_lsn = 0;
+  }
+
+  void add(uint64_t page_no, const unsigned char* page) {
+    const uint16_t type = mach_read_from_2(page + FIL_PAGE_TYPE);
+    out_->max_lsn = std::max<uint64_t>(out_->max_lsn, mach_read_from_8(page + FIL_PAGE_LSN));
+    if ((type == FIL_PAGE_TYPE_FSP_HDR || type == FIL_PAGE_TYPE_XDES) &&
+        xdes_calc_descriptor_page(pg_sz_, page_no) == page_no) {
+      add_descriptor(page_no, page);
+    } else if (type == FIL_PAGE_INDEX) {
+      const uint32_t level =
+          std::min<uint32_t>(mach_read_from_2(page + PAGE_HEADER + PAGE_LEVEL),
+                             PageMap::kMaxLevel);
+      const uint32_t slot = slot_for(mach_read_from_8(page + PAGE_HEADER + PAGE_INDEX_ID));
+      out_->entries[page_no] |= PageMap::kIndex | (level << PageMap::kLevelShift) |
+                                (slot << PageMap::kSlotShift);
+    }
+  }
+
+ private:
+  // The same bits XdesCache::is_free() tests during the sweep.
+  void add_descriptor(uint64_t page_no, const unsigned char* page) {
+    const uint64_t end =
+        std::min<uint64_t>(page_no + pg_sz_.physical(), out_->entries.size());
+    for (uint64_t target = page_no; target < end; target++) {
+      const auto* descr = reinterpret_cast<const xdes_t*>(
+          page + XDES_ARR_OFFSET +
+          XDES_SIZE * xdes_calc_descriptor_index(pg_sz_, static_cast<page_no_t>(target)));
+      if (xdes_get_bit(descr, XDES_FREE_BIT, target % FSP_EXTENT_SIZE)) {
+        out_->entries[target] |= PageMap::kFree;
+      }
+    }
+  }
+
+  uint32_t slot_for(uint64_t index_id) {
+    auto it = slots_.find(index_id);
+    if (it != slots_.end()) {
+      return it->second;
+    }
+    if (out_->index_ids.size() >= PageMap::kAnySlot) {
+      return PageMap::kAnySlot;
+    }
+    const uint32_t slot = static_cast<uint32_t>(out_->index_ids.size());
+    out_->index_ids.push_back(index_id);
+    slots_.emplace(index_id, slot);
+    return slot;
+  }
+
+  const page_size_t& pg_sz_;
+  PageMap* out_;
+  std::unordered_map<uint64_t, uint32_t> slots_;
+};
+
+void put_u32(std::string* buf, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    buf->push_back(static_cast<char>(v >> (8 * i)));
+  }
+}
+
+void put_u64(std::string* buf, uint64_t v) {
+  put_u32(buf, static_cast<uint32_t>(v));
+  put_u32(buf, static_cast<uint32_t>(v >> 32));
+}
+
+uint32_t get_u32(const unsigned char* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t get_u64(const unsigned char* p) {
+  return get_u32(p) | (static_cast<uint64_t>(get_u32(p + 4)) << 32);
+}
+
+uint32_t update_crc(uint32_t crc, const std::string& bytes) {
+  return static_cast<uint32_t>(crc32(crc, reinterpret_cast<const Bytef*>(bytes.data()),
+                                     static_cast<uInt>(bytes.size())));
+}
+
+std::string sidecar_header(const SidecarKey& key, const PageMap& pm, uint32_t body_crc) {
+  std::string h(kSidecarMagic, sizeof(kSidecarMagic));
+  put_u32(&h, kSidecarVersion);
+  put_u64(&h, key.file_size);
+  put_u64(&h, key.mtime_s);
+  put_u32(&h, key.mtime_ns);
+  put_u32(&h, key.physical_size);
+  put_u32(&h, key.logical_size);
+  put_u32(&h, key.flags);
+  put_u64(&h, pm.pages());
+  put_u32(&h, static_cast<uint32_t>(pm.index_ids.size()));
+  put_u64(&h, pm.max_lsn);
+  put_u32(&h, body_crc);
+  return h;
+}
+
+}  // namespace
+
+static bool build_page_map(int fd, const TablespaceMap* map, const PageCipher* cipher,
+                           const page_size_t& pg_sz, uint64_t pages,
+                           PageMap* out, std::string* err) {
+  const size_t physical_size = pg_sz.physical();
+  PageMapBuilder builder(pg_sz, pages, out);
+  const size_t batch_pages = std::max<size_t>(kPageMapBatchBytes / physical_size, 1);
+  std::vector<unsigned char> batch;
+  if (!map || cipher) {
+    batch.resize((map ? 1 : batch_pages) * physical_size);
+  }
+
+  if (map) {
+    map->advise(TablespaceMap::SEQUENTIAL);
+  }
+
+  for (uint64_t first = 0; first < pages; first += batch_pages) {
+    const uint64_t n = std::min<uint64_t>(batch_pages, pages - first);
+    if (map) {
+      for (uint64_t i = 0; i < n; i++) {
+        const unsigned char* page = map->page(first + i, physical_size);
+        if (page && cipher) {
+          std::memcpy(batch.data(), page, physical_size);
+          cipher->decrypt(batch.data(), physical_size);
+          page = batch.data();
+        }
+        if (page) {
+          builder.add(first + i, page);
+        }
+      }
+      continue;
+    }
+
+    const size_t len = static_cast<size_t>(n) * physical_size;
+    size_t done = 0;
+    while (done < len) {
+      const ssize_t rd = pread(fd, batch.data() + done, len - done,
+                               static_cast<off_t>(first * physical_size + done));
+      if (rd <= 0) {
+        if (rd < 0 && errno == EINTR) {
+          continue;
+        }
+        *err = "read failed at page " + std::to_string(first + done / physical_size) +
+               (rd < 0 ? std::string(": ") + std::strerror(errno) : std::string());
+        return false;
+      }
+      done += static_cast<size_t>(rd);
+    }
+    for (uint64_t i = 0; i < n; i++) {
+      unsigned char* page = batch.data() + i * physical_size;
+      // A page that fails to decrypt keeps its encrypted type and is
+      // therefore never an index page, as in the sweep.
+      if (cipher) {
+        cipher->decrypt(page, physical_size);
+      }
+      builder.add(first + i, page);
+    }
+  }
+  return true;
+}
+
+static bool load_sidecar(const std::string& path, const SidecarKey& key, uint64_t pages,
+                         PageMap* out) {
+  FILE* fp = std::fopen(path.c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  unsigned char header[kSidecarHeaderSize];
+  const char* why = nullptr;
+  PageMap pm;
+  uint32_t stored_crc = 0;
+  if (std::fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+    why = "truncated";
+  } else {
+    const uint64_t n_pages = get_u64(header + 44);
+    const uint32_t n_ids = get_u32(header + 52);
+    pm.max_lsn = get_u64(header + 56);
+    stored_crc = get_u32(header + 64);
+    if (n_pages != pages || n_ids > PageMap::kAnySlot) {
+      why = "stale";
+    } else {
+      pm.entries.resize(n_pages);
+      pm.index_ids.resize(n_ids);
+      if (sidecar_header(key, pm, stored_crc) !=
+          std::string(reinterpret_cast<const char*>(header), sizeof(header))) {
+        why = "stale or another format version";
+      }
+    }
+  }
+
+  // Body: the index ids, then the entries, little-endian.
+  uint32_t crc = 0;
+  std::vector<unsigned char> chunk;
+  auto read_chunk = [&](size_t bytes) {
+    chunk.resize(bytes);
+    if (std::fread(chunk.data(), 1, bytes, fp) != bytes) {
+      return false;
+    }
+    crc = static_cast<uint32_t>(crc32(crc, chunk.data(), static_cast<uInt>(bytes)));
+    return true;
+  };
+  for (size_t i = 0; why == nullptr && i < pm.index_ids.size(); i += kSidecarChunkEntries) {
+    const size_t n = std::min(kSidecarChunkEntries, pm.index_ids.size() - i);
+    if (!read_chunk(n * 8)) {
+      why = "truncated";
+      break;
+    }
+    for (size_t j = 0; j < n; j++) {
+      pm.index_ids[i + j] = get_u64(chunk.data() + j * 8);
+    }
+  }
+  for (size_t i = 0; why == nullptr && i < pm.entries.size(); i += kSidecarChunkEntries) {
+    const size_t n = std::min(kSidecarChunkEntries, pm.entries.size() - i);
+    if (!read_chunk(n * 4)) {
+      why = "truncated";
+      break;
+    }
+    for (size_t j = 0; j < n; j++) {
+      pm.entries[i + j] = get_u32(chunk.data() + j * 4);
+    }
+  }
+  if (why == nullptr && (crc != stored_crc || std::fgetc(fp) != EOF)) {
+    why = "corrupt";
+  }
+  std::fclose(fp);
+  if (why != nullptr) {
+    PARSER_LOG(LOG_LEVEL_WARN, "Ignoring page map %s: %s\n", path.c_str(), why);
+    return false;
+  }
+  *out = std::move(pm);
+  return true;
+}
+
+static bool save_sidecar(const std::string& path, const SidecarKey& key,
+                         const PageMap& pm) {
+  const std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+  FILE* fp = std::fopen(tmp.c_str(), "wb");
+  if (fp == nullptr) {
+    std::cerr << "Warning: cannot write page map " << tmp << ": "
+              << std::strerror(errno) << "\n";
+    return false;
+  }
+  // The header goes in last, once the body crc is known.
+  std::string bytes(kSidecarHeaderSize, '\0');
+  bool ok = std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+  uint32_t crc = 0;
+  for (size_t i = 0; ok && i < pm.index_ids.size(); i += kSidecarChunkEntries) {
+    bytes.clear();
+    const size_t n = std::min(kSidecarChunkEntries, pm.index_ids.size() - i);
+    for (size_t j = 0; j < n; j++) {
+      put_u64(&bytes, pm.index_ids[i + j]);
+    }
+    crc = update_crc(crc, bytes);
+    ok = std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+  }
+  for (size_t i = 0; ok && i < pm.entries.size(); i += kSidecarChunkEntries) {
+    bytes.clear();
+    const size_t n = std::min(kSidecarChunkEntries, pm.entries.size() - i);
+    for (size_t j = 0; j < n; j++) {
+      put_u32(&bytes, pm.entries[i + j]);
+    }
+    crc = update_crc(crc, bytes);
+    ok = std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+  }
+  const std::string header = sidecar_header(key, pm, crc);
+  ok = ok && std::fseek(fp, 0, SEEK_SET) == 0 &&
+       std::fwrite(header.data(), 1, header.size(), fp) == header.size();
+  ok = (std::fclose(fp) == 0) && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::cerr << "Warning: cannot write page map " << path << ": "
+              << std::strerror(errno) << "\n";
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool load_or_build_page_map(const std::string& sidecar, int fd,
+                            const TablespaceMap* map, const PageCipher* cipher,
+                            size_t physical_size, size_t logical_size,
+                            PageMap* out, std::string* err) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *err = std::string("fstat: ") + std::strerror(errno);
+    return false;
+  }
+  SidecarKey key;
+  key.file_size = static_cast<uint64_t>(st.st_size);
+  key.mtime_s = static_cast<uint64_t>(st.st_mtim.tv_sec);
+  key.mtime_ns = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+  key.physical_size = static_cast<uint32_t>(physical_size);
+  key.logical_size = static_cast<uint32_t>(logical_size);
+  key.flags = cipher ? kSidecarDecrypted : 0;
+  const uint64_t pages = key.file_size / physical_size;
+
+  if (!sidecar.empty() && load_sidecar(sidecar, key, pages, out)) {
+    PARSER_LOG(LOG_LEVEL_INFO, "Page map: read %s (%llu pages)\n", sidecar.c_str(),
+               static_cast<unsigned long long>(pages));
+    return true;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const page_size_t pg_sz(physical_size, logical_size, physical_size < logical_size);
+  if (!build_page_map(fd, map, cipher, pg_sz, pages, out, err)) {
+    return false;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  PARSER_LOG(LOG_LEVEL_INFO, "Page map: built for %llu pages (%zu indexes) in %.3f s\n",
+             static_cast<unsigned long long>(pages), out->index_ids.size(),
+             elapsed.count());
+  if (!sidecar.empty() && save_sidecar(sidecar, key, *out)) {
+    PARSER_LOG(LOG_LEVEL_INFO, "Page map: wrote %s\n", sidecar.c_str());
+  }
+  return true;
+}
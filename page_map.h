@@ -0,0 +1,101 @@
+#ifndef PAGE_MAP_H
+#define PAGE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TablespaceMap;
+struct PageCipher;
+
+/**
+ * Page map (mode 3 --page-map, ibd_table_load_page_map()): what each page
+ * of a tablespace is, from one prepass that reads the file front to back
+ * in large sequential batches and looks only at the FSP_HDR/XDES extent
+ * descriptors and the FIL and index page headers. Sweeps then skip,
+ * without reading them, the pages that cannot hold rows of the selected
+ * index: everything but its leaves, and leaves in free extents.
+ *
+ * The map is four bytes per page (1/4096 of a 16 KiB-page tablespace) and
+ * can be kept in a sidecar file, by default <tablespace>.pagemap. The
+ * sidecar records the tablespace's size, mtime and page size, whether
+ * pages were decrypted, and a crc32 of its body; one that does not match
+ * is rebuilt. It is written under a temporary name and renamed into place.
+ *
+ * The map only ever rules pages out: pages it keeps are read and filtered
+ * exactly as without it, so the output does not change.
+ */
+struct PageMap {
+  // entries[] bits: extent marked free, FIL_PAGE_INDEX, then the B-tree
+  // level (capped at kMaxLevel) and the slot of the index id in index_ids.
+  static constexpr uint32_t kFree = 1u << 0;
+  static constexpr uint32_t kIndex = 1u << 1;
+  static constexpr uint32_t kLevelShift = 2;
+  static constexpr uint32_t kMaxLevel = 63;
+  static constexpr uint32_t kSlotShift = 8;
+  // Index pages past the (24-bit) slot space; kept for every index.
+  static constexpr uint32_t kAnySlot = 0xffffff;
+  static constexpr uint32_t kNoSlot = 0xffffffff;
+
+  std::vector<uint64_t> index_ids;  // distinct PAGE_INDEX_IDs, by slot
+  std::vector<uint32_t> entries;    // one per page
+  uint64_t max_lsn = 0;             // highest FIL_PAGE_LSN of all pages
+
+  uint64_t pages() const { return entries.size(); }
+
+  /** Slot of index_id, or kNoSlot when no page carries it. */
+  uint32_t slot_of(uint64_t index_id) const;
+
+  /**
+   * Can page_no hold rows of the index in slot: a leaf of it, outside a
+   * free extent unless skip_xdes? Pages past the map are kept.
+   */
+  bool wanted(uint64_t page_no, uint32_t slot, bool skip_xdes) const {
+    if (page_no >= entries.size()) {
+      return true;
+    }
+    const uint32_t e = entries[page_no];
+    if ((e & kIndex) == 0 || ((e >> kLevelShift) & kMaxLevel) != 0 ||
+        (!skip_xdes && (e & kFree) != 0)) {
+      return false;
+    }
+    const uint32_t page_slot = e >> kSlotShift;
+    return page_slot == slot || page_slot == kAnySlot;
+  }
+
+  /** Number of wanted() pages in [first, end). */
+  uint64_t count_wanted(uint64_t first, uint64_t end, uint32_t slot,
+                        bool skip_xdes) const;
+};
+
+/**
+ * Pages [*first, *end) of shard index (0-based) of count: pages
+ * [0, total_pages) cut on extent boundaries into count contiguous ranges
+ * that cover them without overlapping. With pm the ranges hold about
+ * equal numbers of wanted() pages (as extents allow), otherwise equal
+ * numbers of extents; shards can be empty. Extents are sized as InnoDB
+ * sizes them for logical_size pages.
+ */
+void shard_page_range(const PageMap* pm, uint32_t slot, bool skip_xdes,
+                      uint64_t total_pages, size_t logical_size,
+                      uint64_t index, uint64_t count,
+                      uint64_t* first, uint64_t* end);
+
+/** Default sidecar path for a tablespace: ibd_path + ".pagemap". */
+std::string page_map_sidecar_path(const std::string& ibd_path);
+
+/**
+ * The page map of the tablespace open on fd (pages of physical_size
+ * bytes, logical_size once inflated), read from the sidecar when it
+ * matches the file, else built (from map when given, pread() otherwise;
+ * decrypted with cipher when not null) and saved to the sidecar. An empty
+ * sidecar path builds without saving; a sidecar that cannot be written
+ * only warns. false with *err when the tablespace cannot be read.
+ */
+bool load_or_build_page_map(const std::string& sidecar, int fd,
+                            const TablespaceMap* map, const PageCipher* cipher,
+                            size_t physical_size, size_t logical_size,
+                            PageMap* out, std::string* err);
+
+#endif  // PAGE_MAP_H
@@ -0,0 +1,467 @@
+/**
+ * page_pipeline.cc
+ *
+ * Read-ahead and write-behind used by decompress_ibd(), rebuild_uncompressed_ibd()
+ * and the mode 4 decrypt+decompress loop.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "page_pipeline.h"
+
+// Keep a single request well below the 2 GB read() limit.
+static const size_t kMaxBatchBytes = 64u << 20;
+
+static unsigned long env_ulong(const char* name, unsigned long def) {
+  const char* env = std::getenv(name);
+  if (env && *env) {
+    char* end = nullptr;
+    unsigned long val = std::strtoul(env, &end, 10);
+    if (end != env && *end == '\0') {
+      return val;
+    }
+  }
+  return def;
+}
+
+PageIoOptions page_io_options_from_env() {
+  PageIoOptions opts;
+  opts.batch_pages = std::max(1ul, env_ulong("IB_PARSER_IO_BATCH_PAGES", opts.batch_pages));
+  opts.queue_depth = static_cast<unsigned>(
+      std::min(256ul, std::max(1ul, env_ulong("IB_PARSER_IO_DEPTH", opts.queue_depth))));
+  opts.allow_io_uring = env_ulong("IB_PARSER_IO_URING", 1) != 0;
+  return opts;
+}
+
+// ---------------------------------------------------------------------------
+// PageReadAhead
+// ---------------------------------------------------------------------------
+
+PageReadAhead::~PageReadAhead() {
+  stop();
+}
+
+const char* PageReadAhead::backend() const {
+  return uring_ ? "io_uring" : "pread thread";
+}
+
+bool PageReadAhead::start(int fd, size_t page_size, uint64_t num_pages,
+                          const PageIoOptions& opts) {
+  stop();
+  if (fd < 0 || page_size == 0) {
+    failed_ = true;
+    error_ = "invalid file or page size";
+    return false;
+  }
+  fd_ = fd;
+  page_size_ = page_size;
+  num_pages_ = num_pages;
+  batch_pages_ = std::max<size_t>(1, std::min(opts.batch_pages,
+                                              kMaxBatchBytes / page_size));
+  num_batches_ = (num_pages + batch_pages_ - 1) / batch_pages_;
+  const size_t depth = std::max(1u, opts.queue_depth);
+  slots_.clear();
+  slots_.resize(depth);
+  for (Slot& slot : slots_) {
+    slot.buf.reset(new unsigned char[batch_pages_ * page_size_]);
+  }
+  cur_batch_ = 0;
+  cur_page_ = 0;
+  have_cur_ = false;
+  failed_ = false;
+  error_.clear();
+  stopping_ = false;
+  if (num_batches_ == 0) {
+    return true;
+  }
+
+#ifdef HAVE_LIBURING
+  if (opts.allow_io_uring) {
+    io_uring* ring = new io_uring;
+    if (io_uring_queue_init(static_cast<unsigned>(depth), ring, 0) == 0) {
+      ring_ = ring;
+      uring_ = true;
+      const uint64_t first = std::min<uint64_t>(depth, num_batches_);
+      for (uint64_t b = 0; b < first; b++) {
+        init_slot(slots_[b], b);
+        if (!uring_submit(b)) {
+          failed_ = true;
+          error_ = "io_uring submit failed";
+          return false;
+        }
+      }
+      return true;
+    }
+    // No io_uring here (old kernel, seccomp, ...): use the thread.
+    delete ring;
+  }
+#endif
+
+  thread_ = std::thread(&PageReadAhead::reader_loop, this);
+  return true;
+}
+
+void PageReadAhead::stop() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+#ifdef HAVE_LIBURING
+  if (uring_) {
+    io_uring* ring = static_cast<io_uring*>(ring_);
+    // Buffers must outlive any read still in flight.
+    for (Slot& slot : slots_) {
+      while (slot.state == SLOT_BUSY) {
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(ring, &cqe) != 0) {
+          break;
+        }
+        Slot* done = static_cast<Slot*>(io_uring_cqe_get_data(cqe));
+        io_uring_cqe_seen(ring, cqe);
+        done->state = SLOT_FREE;
+      }
+    }
+    io_uring_queue_exit(ring);
+    delete ring;
+    ring_ = nullptr;
+    uring_ = false;
+  }
+#endif
+  for (Slot& slot : slots_) {
+    slot.state = SLOT_FREE;
+  }
+}
+
+void PageReadAhead::init_slot(Slot& slot, uint64_t batch) {
+  const uint64_t first = batch * batch_pages_;
+  const uint64_t pages = std::min<uint64_t>(batch_pages_, num_pages_ - first);
+  slot.batch = batch;
+  slot.bytes = static_cast<size_t>(pages) * page_size_;
+  slot.done = 0;
+  slot.error = false;
+  slot.error_msg.clear();
+  slot.state = SLOT_BUSY;
+}
+
+bool PageReadAhead::fill_sync(Slot& slot) {
+  const off_t base = static_cast<off_t>(slot.batch * batch_pages_) *
+                     static_cast<off_t>(page_size_);
+  while (slot.done < slot.bytes) {
+    const ssize_t rd = pread(fd_, slot.buf.get() + slot.done,
+                             slot.bytes - slot.done,
+                             base + static_cast<off_t>(slot.done));
+    if (rd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      slot.error_msg = std::strerror(errno);
+      return false;
+    }
+    if (rd == 0) {
+      slot.error_msg = "unexpected end of file";
+      return false;
+    }
+    slot.done += static_cast<size_t>(rd);
+  }
+  return true;
+}
+
+void PageReadAhead::reader_loop() {
+  for (uint64_t b = 0; b < num_batches_; b++) {
+    Slot& slot = slots_[b % slots_.size()];
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [&] { return stopping_ || slot.state == SLOT_FREE; });
+      if (stopping_) {
+        return;
+      }
+      init_slot(slot, b);
+    }
+    const bool ok = fill_sync(slot);
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      slot.error = !ok;
+      slot.state = SLOT_READY;
+    }
+    cv_.notify_all();
+    if (!ok) {
+      return;
+    }
+  }
+}
+
+#ifdef HAVE_LIBURING
+bool PageReadAhead::uring_submit(size_t slot_idx) {
+  io_uring* ring = static_cast<io_uring*>(ring_);
+  Slot& slot = slots_[slot_idx];
+  io_uring_sqe* sqe = io_uring_get_sqe(ring);
+  if (sqe == nullptr) {
+    return false;
+  }
+  const off_t offset = static_cast<off_t>(slot.batch * batch_pages_) *
+                       static_cast<off_t>(page_size_) +
+                       static_cast<off_t>(slot.done);
+  io_uring_prep_read(sqe, fd_, slot.buf.get() + slot.done,
+                     static_cast<unsigned>(slot.bytes - slot.done), offset);
+  io_uring_sqe_set_data(sqe, &slot);
+  return io_uring_submit(ring) >= 0;
+}
+
+bool PageReadAhead::uring_wait(size_t slot_idx) {
+  io_uring* ring = static_cast<io_uring*>(ring_);
+  Slot& want = slots_[slot_idx];
+  while (want.state != SLOT_READY) {
+    io_uring_cqe* cqe = nullptr;
+    const int rc = io_uring_wait_cqe(ring, &cqe);
+    if (rc == -EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      error_ = std::string("io_uring wait: ") + std::strerror(-rc);
+      return false;
+    }
+    Slot* slot = static_cast<Slot*>(io_uring_cqe_get_data(cqe));
+    const int res = cqe->res;
+    io_uring_cqe_seen(ring, cqe);
+
+    if (res < 0 && res != -EINTR && res != -EAGAIN) {
+      slot->error = true;
+      slot->error_msg = std::strerror(-res);
+      slot->state = SLOT_READY;
+      continue;
+    }
+    if (res == 0 && slot->done < slot->bytes) {
+      slot->error = true;
+      slot->error_msg = "unexpected end of file";
+      slot->state = SLOT_READY;
+      continue;
+    }
+    if (res > 0) {
+      slot->done += static_cast<size_t>(res);
+    }
+    if (slot->done < slot->bytes) {
+      // Short read: ask for the rest.
+      if (!uring_submit(static_cast<size_t>(slot - slots_.data()))) {
+        slot->error = true;
+        slot->error_msg = "io_uring resubmit failed";
+        slot->state = SLOT_READY;
+      }
+      continue;
+    }
+    slot->state = SLOT_READY;
+  }
+  return true;
+}
+#endif
+
+unsigned char* PageReadAhead::next(uint64_t* page_no) {
+  if (failed_) {
+    return nullptr;
+  }
+  const size_t depth = slots_.size();
+  if (have_cur_) {
+    Slot& cur = slots_[cur_batch_ % depth];
+    if (cur_page_ < cur.bytes / page_size_) {
+      *page_no = cur_batch_ * batch_pages_ + cur_page_;
+      return cur.buf.get() + (cur_page_++) * page_size_;
+    }
+    // Caller is done with this batch; hand the slot back for refilling.
+    if (uring_) {
+#ifdef HAVE_LIBURING
+      const uint64_t refill = cur_batch_ + depth;
+      if (refill < num_batches_) {
+        init_slot(cur, refill);
+        if (!uring_submit(cur_batch_ % depth)) {
+          failed_ = true;
+          error_ = "io_uring submit failed";
+          return nullptr;
+        }
+      } else {
+        cur.state = SLOT_FREE;
+      }
+#endif
+    } else {
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        cur.state = SLOT_FREE;
+      }
+      cv_.notify_all();
+    }
+    cur_batch_++;
+    have_cur_ = false;
+  }
+
+  if (cur_batch_ >= num_batches_) {
+    return nullptr;
+  }
+  Slot& slot = slots_[cur_batch_ % depth];
+  if (uring_) {
+#ifdef HAVE_LIBURING
+    if (!uring_wait(cur_batch_ % depth)) {
+      failed_ = true;
+      return nullptr;
+    }
+#endif
+  } else {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&] {
+      return slot.state == SLOT_READY && slot.batch == cur_batch_;
+    });
+  }
+  if (slot.error) {
+    failed_ = true;
+    error_ = "read failed in pages " +
+             std::to_string(cur_batch_ * batch_pages_) + ".." +
+             std::to_string(cur_batch_ * batch_pages_ + slot.bytes / page_size_ - 1) +
+             ": " + slot.error_msg;
+    return nullptr;
+  }
+  have_cur_ = true;
+  cur_page_ = 1;
+  *page_no = cur_batch_ * batch_pages_;
+  return slot.buf.get();
+}
+
+// ---------------------------------------------------------------------------
+// PageWriteBehind
+// ---------------------------------------------------------------------------
+
+PageWriteBehind::~PageWriteBehind() {
+  finish();
+}
+
+bool PageWriteBehind::start(int fd, size_t batch_bytes,
+                            const PageIoOptions& opts) {
+  finish();
+  fd_ = fd;
+  cap_ = std::max<size_t>(batch_bytes, 4096);
+  max_pending_ = std::max(1u, opts.queue_depth);
+  cur_.data.reset(new unsigned char[cap_]);
+  cur_.cap = cap_;
+  cur_.len = 0;
+  pending_.clear();
+  spare_.clear();
+  stopping_ = false;
+  failed_ = false;
+  error_.clear();
+  thread_ = std::thread(&PageWriteBehind::writer_loop, this);
+  return true;
+}
+
+bool PageWriteBehind::write_all(const unsigned char* p, size_t n) {
+  while (n > 0) {
+    const ssize_t wr = ::write(fd_, p, n);
+    if (wr < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error_ = std::strerror(errno);
+      return false;
+    }
+    p += wr;
+    n -= static_cast<size_t>(wr);
+  }
+  return true;
+}
+
+void PageWriteBehind::writer_loop() {
+  while (true) {
+    Buffer buf;
+    bool skip = false;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        return;
+      }
+      buf = std::move(pending_.front());
+      pending_.pop_front();
+      skip = failed_;
+    }
+    // After a failure keep draining (so producers never block) but stop writing.
+    const bool ok = !skip && write_all(buf.data.get(), buf.len);
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (!ok) {
+        failed_ = true;
+      }
+      if (buf.cap == cap_) {
+        buf.len = 0;
+        spare_.push_back(std::move(buf));
+      }
+    }
+    cv_.notify_all();
+  }
+}
+
+bool PageWriteBehind::submit_current() {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (cur_.len == 0) {
+    return !failed_;
+  }
+  cv_.wait(lock, [&] { return failed_ || pending_.size() < max_pending_; });
+  if (failed_) {
+    return false;
+  }
+  pending_.push_back(std::move(cur_));
+  if (!spare_.empty()) {
+    cur_ = std::move(spare_.back());
+    spare_.pop_back();
+  } else {
+    cur_ = Buffer();
+    cur_.data.reset(new unsigned char[cap_]);
+    cur_.cap = cap_;
+  }
+  cur_.len = 0;
+  cv_.notify_all();
+  return true;
+}
+
+bool PageWriteBehind::write(const unsigned char* p, size_t n) {
+  if (!thread_.joinable()) {
+    return false;
+  }
+  if (cur_.len + n > cap_ && !submit_current()) {
+    return false;
+  }
+  if (n > cap_) {
+    // Oversized record: ship it as its own buffer.
+    Buffer big;
+    big.data.reset(new unsigned char[n]);
+    big.cap = n;
+    big.len = n;
+    std::memcpy(big.data.get(), p, n);
+    std::swap(cur_, big);
+    const bool ok = submit_current();
+    std::swap(cur_, big);  // get the regular buffer back
+    return ok;
+  }
+  std::memcpy(cur_.data.get() + cur_.len, p, n);
+  cur_.len += n;
+  return true;
+}
+
+bool PageWriteBehind::finish() {
+  if (!thread_.joinable()) {
+    return !failed_;
+  }
+  submit_current();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  return !failed_;
+}
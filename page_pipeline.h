@@ -0,0 +1,146 @@
+#ifndef PAGE_PIPELINE_H
+#define PAGE_PIPELINE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Overlapped page I/O for the whole-file rewrite modes (2, 4 and 5).
+ *
+ * PageReadAhead keeps queue_depth batches of batch_pages pages in flight
+ * ahead of the caller, PageWriteBehind collects output pages into batches
+ * that a background thread writes out, so reading, transforming and
+ * writing proceed at the same time.
+ *
+ * Reads use io_uring when the build found liburing (HAVE_LIBURING) and the
+ * kernel accepts the ring; otherwise a reader thread issues pread()s.
+ */
+struct PageIoOptions {
+  size_t batch_pages = 64;    // pages per read / write request
+  unsigned queue_depth = 4;   // batches in flight in each direction
+  bool allow_io_uring = true;
+};
+
+// Defaults, overridden by IB_PARSER_IO_BATCH_PAGES, IB_PARSER_IO_DEPTH and
+// IB_PARSER_IO_URING=0.
+PageIoOptions page_io_options_from_env();
+
+class PageReadAhead {
+ public:
+  PageReadAhead() = default;
+  PageReadAhead(const PageReadAhead&) = delete;
+  PageReadAhead& operator=(const PageReadAhead&) = delete;
+  ~PageReadAhead();
+
+  /** Start reading pages [0, num_pages) of fd. */
+  bool start(int fd, size_t page_size, uint64_t num_pages,
+             const PageIoOptions& opts);
+
+  /**
+   * Next page in file order, or nullptr at the end or after a read error
+   * (see failed()). The page belongs to the caller, who may transform it in
+   * place, until the next call.
+   */
+  unsigned char* next(uint64_t* page_no);
+
+  bool failed() const { return failed_; }
+  const std::string& error() const { return error_; }
+  const char* backend() const;
+
+ private:
+  enum SlotState { SLOT_FREE, SLOT_BUSY, SLOT_READY };
+
+  struct Slot {
+    std::unique_ptr<unsigned char[]> buf;
+    uint64_t batch = 0;
+    size_t bytes = 0;   // bytes this batch should hold
+    size_t done = 0;    // bytes actually read so far
+    SlotState state = SLOT_FREE;
+    bool error = false;
+    std::string error_msg;
+  };
+
+  void stop();
+  void init_slot(Slot& slot, uint64_t batch);
+  bool fill_sync(Slot& slot);
+  void reader_loop();
+#ifdef HAVE_LIBURING
+  bool uring_submit(size_t slot_idx);
+  bool uring_wait(size_t slot_idx);
+#endif
+
+  int fd_ = -1;
+  size_t page_size_ = 0;
+  uint64_t num_pages_ = 0;
+  size_t batch_pages_ = 0;
+  uint64_t num_batches_ = 0;
+  std::vector<Slot> slots_;
+
+  uint64_t cur_batch_ = 0;   // batch the caller is reading from
+  size_t cur_page_ = 0;      // next page index within it
+  bool have_cur_ = false;
+  bool failed_ = false;
+  std::string error_;
+
+  // Thread backend
+  std::thread thread_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+
+  bool uring_ = false;
+  void* ring_ = nullptr;     // struct io_uring*, opaque without liburing
+};
+
+class PageWriteBehind {
+ public:
+  PageWriteBehind() = default;
+  PageWriteBehind(const PageWriteBehind&) = delete;
+  PageWriteBehind& operator=(const PageWriteBehind&) = delete;
+  ~PageWriteBehind();
+
+  /** Write sequentially at fd's current offset in batches of batch_bytes. */
+  bool start(int fd, size_t batch_bytes, const PageIoOptions& opts);
+
+  /** Queue n bytes; false once an earlier background write has failed. */
+  bool write(const unsigned char* p, size_t n);
+
+  /** Write out everything queued and stop the writer; false on any error. */
+  bool finish();
+
+  const std::string& error() const { return error_; }
+
+ private:
+  struct Buffer {
+    std::unique_ptr<unsigned char[]> data;
+    size_t cap = 0;
+    size_t len = 0;
+  };
+
+  bool submit_current();
+  void writer_loop();
+  bool write_all(const unsigned char* p, size_t n);
+
+  int fd_ = -1;
+  size_t cap_ = 0;
+  Buffer cur_;
+  std::deque<Buffer> pending_;   // filled, waiting for the writer
+  std::vector<Buffer> spare_;    // written, ready for reuse
+  unsigned max_pending_ = 0;
+
+  std::thread thread_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+  bool failed_ = false;
+  std::string error_;
+};
+
+#endif  // PAGE_PIPELINE_H
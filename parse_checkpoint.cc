@@ -0,0 +1,299 @@
+/**
+ * parse_checkpoint.cc
+ *
+ * Mode 3 --checkpoint / --resume state files and --shard-manifest files
+ * (see parse_checkpoint.h).
+ */
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <openssl/evp.h>
+
+#include "parse_checkpoint.h"
+#include "parse_stats.h"
+
+static const char kCheckpointMagic[] = "ib_parser checkpoint 1";
+static const char kManifestMagic[] = "ib_parser shard manifest 1";
+// Output read per sha256 update.
+static const size_t kDigestChunkBytes = 1 << 20;
+
+namespace {
+
+struct CounterField {
+  const char* name;
+  uint64_t ParseCheckpoint::*field;
+};
+
+const CounterField kCounterFields[] = {
+    {"next_page", &ParseCheckpoint::next_page},
+    {"output_bytes", &ParseCheckpoint::output_bytes},
+    {"input_size", &ParseCheckpoint::input_size},
+    {"rows", &ParseCheckpoint::rows},
+    {"records_valid", &ParseCheckpoint::records_valid},
+    {"records_invalid", &ParseCheckpoint::records_invalid},
+    {"records_deleted", &ParseCheckpoint::records_deleted},
+    {"records_recovered", &ParseCheckpoint::records_recovered},
+    {"records_carved", &ParseCheckpoint::records_carved},
+    {"records_filtered", &ParseCheckpoint::records_filtered},
+    {"leaf_pages", &ParseCheckpoint::leaf_pages},
+    {"pages_unchanged", &ParseCheckpoint::pages_unchanged},
+    {"max_lsn", &ParseCheckpoint::max_lsn},
+};
+
+}  // namespace
+
+// fsync the directory holding path, so a rename into it survives a crash.
+static bool sync_parent_dir(const std::string& path) {
+  const size_t slash = path.rfind('/');
+  const std::string dir =
+      slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+
+// text to path through a temporary file, fsync and rename.
+static bool write_file_atomically(const std::string& path, const std::string& text,
+                                  std::string* err) {
+  const std::string tmp = path + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    *err = "cannot create " + tmp + ": " + std::strerror(errno);
+    return false;
+  }
+  const char* p = text.data();
+  size_t left = text.size();
+  bool written = true;
+  while (left > 0) {
+    const ssize_t wr = ::write(fd, p, left);
+    if (wr < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      written = false;
+      break;
+    }
+    p += wr;
+    left -= static_cast<size_t>(wr);
+  }
+  written = written && ::fsync(fd) == 0;
+  if (::close(fd) != 0 || !written) {
+    *err = "cannot write " + tmp + ": " + std::strerror(errno);
+    ::unlink(tmp.c_str());
+    return false;
+  }
+  if (::rename(tmp.c_str(), path.c_str()) != 0) {
+    *err = "cannot rename " + tmp + " to " + path + ": " + std::strerror(errno);
+    ::unlink(tmp.c_str());
+    return false;
+  }
+  if (!sync_parent_dir(path)) {
+    *err = "cannot sync the directory of " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void ParseCheckpoint::save_counters(const ParseStats& stats) {
+  rows = stats.rows;
+  records_valid = stats.records_valid;
+  records_invalid = stats.records_invalid;
+  records_deleted = stats.records_deleted;
+  records_recovered = stats.records_recovered;
+  records_carved = stats.records_carved;
+  records_filtered = stats.records_filtered;
+  leaf_pages = stats.leaf_pages;
+  pages_unchanged = stats.pages_unchanged;
+  max_lsn = stats.max_lsn;
+  first_key = stats.first_key;
+  last_key = stats.last_key;
+}
+
+void ParseCheckpoint::restore_counters(ParseStats* stats) const {
+  stats->rows += rows;
+  stats->records_valid += records_valid;
+  stats->records_invalid += records_invalid;
+  stats->records_deleted += records_deleted;
+  stats->records_recovered += records_recovered;
+  stats->records_carved += records_carved;
+  stats->records_filtered += records_filtered;
+  stats->leaf_pages += leaf_pages;
+  stats->pages_unchanged += pages_unchanged;
+  if (max_lsn > stats->max_lsn) {
+    stats->max_lsn = max_lsn;
+  }
+  if (!first_key.empty()) {
+    stats->first_key = first_key;
+    stats->last_key = last_key;
+  }
+}
+
+bool write_parse_checkpoint(const std::string& path, const ParseCheckpoint& ckpt,
+                            std::string* err) {
+  std::string text = kCheckpointMagic;
+  text += "\ninput=" + ckpt.input;
+  text += "\noptions=" + ckpt.options;
+  text += ckpt.done ? "\ndone=1" : "\ndone=0";
+  if (!ckpt.first_key.empty()) {
+    text += "\nfirst_key=" + ckpt.first_key;
+    text += "\nlast_key=" + ckpt.last_key;
+  }
+  char buf[64];
+  for (const CounterField& f : kCounterFields) {
+    std::snprintf(buf, sizeof(buf), "\n%s=%" PRIu64, f.name, ckpt.*f.field);
+    text += buf;
+  }
+  text += "\n";
+
+  return write_file_atomically(path, text, err);
+}
+
+bool read_parse_checkpoint(const std::string& path, ParseCheckpoint* ckpt,
+                           std::string* err) {
+  std::ifstream in(path);
+  if (!in) {
+    *err = "cannot open " + path;
+    return false;
+  }
+  std::string line;
+  if (!std::getline(in, line) || line != kCheckpointMagic) {
+    *err = path + " is not an ib_parser checkpoint";
+    return false;
+  }
+  *ckpt = ParseCheckpoint();
+  bool have_input = false;
+  bool have_next = false;
+  while (std::getline(in, line)) {
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      continue;
+    }
+    const std::string key = line.substr(0, eq);
+    const std::string value = line.substr(eq + 1);
+    if (key == "input") {
+      ckpt->input = value;
+      have_input = true;
+    } else if (key == "options") {
+      ckpt->options = value;
+    } else if (key == "done") {
+      ckpt->done = value == "1";
+    } else if (key == "first_key") {
+      ckpt->first_key = value;
+    } else if (key == "last_key") {
+      ckpt->last_key = value;
+    } else {
+      for (const CounterField& f : kCounterFields) {
+        if (key != f.name) {
+          continue;
+        }
+        char* end = nullptr;
+        errno = 0;
+        const unsigned long long v = std::strtoull(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0) {
+          *err = path + ": bad value for " + key;
+          return false;
+        }
+        ckpt->*f.field = v;
+        have_next |= key == "next_page";
+      }
+    }
+  }
+  if (!have_input || !have_next) {
+    *err = path + " is incomplete";
+    return false;
+  }
+  return true;
+}
+
+bool digest_shard_output(const std::string& path, bool has_header, ShardManifest* m,
+                         std::string* err) {
+  FILE* in = std::fopen(path.c_str(), "rb");
+  if (!in) {
+    *err = "cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  EVP_MD_CTX* md = EVP_MD_CTX_new();
+  if (!md || EVP_DigestInit_ex(md, EVP_sha256(), nullptr) != 1) {
+    EVP_MD_CTX_free(md);
+    std::fclose(in);
+    *err = "cannot set up sha256";
+    return false;
+  }
+  std::vector<unsigned char> buf(kDigestChunkBytes);
+  uint64_t total = 0;
+  bool header_open = has_header;
+  uint64_t header_bytes = 0;
+  size_t n;
+  while ((n = std::fread(buf.data(), 1, buf.size(), in)) > 0) {
+    EVP_DigestUpdate(md, buf.data(), n);
+    if (header_open) {
+      const void* nl = std::memchr(buf.data(), '\n', n);
+      if (nl) {
+        header_bytes += static_cast<const unsigned char*>(nl) - buf.data() + 1;
+        header_open = false;
+      } else {
+        header_bytes += n;
+      }
+    }
+    total += n;
+  }
+  const bool read_ok = !std::ferror(in);
+  std::fclose(in);
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_len = 0;
+  const bool digest_ok = EVP_DigestFinal_ex(md, digest, &digest_len) == 1;
+  EVP_MD_CTX_free(md);
+  if (!read_ok || !digest_ok) {
+    *err = "cannot read " + path;
+    return false;
+  }
+
+  static const char kHex[] = "0123456789abcdef";
+  m->output = path;
+  m->output_bytes = total;
+  m->header_bytes = total > 0 ? header_bytes : 0;
+  m->output_sha256.clear();
+  for (unsigned int i = 0; i < digest_len; i++) {
+    m->output_sha256.push_back(kHex[digest[i] >> 4]);
+    m->output_sha256.push_back(kHex[digest[i] & 0xf]);
+  }
+  return true;
+}
+
+bool write_shard_manifest(const std::string& path, const ShardManifest& m,
+                          std::string* err) {
+  std::string text = kManifestMagic;
+  text += "\ninput=" + m.input;
+  text += "\noptions=" + m.options;
+  text += "\noutput=" + m.output;
+  text += "\noutput_sha256=" + m.output_sha256;
+  const struct {
+    const char* name;
+    uint64_t value;
+  } counters[] = {
+      {"input_size", m.input_size},     {"total_pages", m.total_pages},
+      {"first_page", m.first_page},     {"end_page", m.end_page},
+      {"output_bytes", m.output_bytes}, {"header_bytes", m.header_bytes},
+      {"rows", m.rows},
+  };
+  char buf[64];
+  for (const auto& c : counters) {
+    std::snprintf(buf, sizeof(buf), "\n%s=%" PRIu64, c.name, c.value);
+    text += buf;
+  }
+  text += "\nfirst_key=" + m.first_key;
+  text += "\nlast_key=" + m.last_key;
+  text += "\n";
+  return write_file_atomically(path, text, err);
+}
@@ -0,0 +1,89 @@
+#ifndef PARSE_CHECKPOINT_H
+#define PARSE_CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+
+struct ParseStats;
+
+/**
+ * Mode 3 --checkpoint / --resume: how far a page sweep got and how much
+ * output it had written, saved every --checkpoint-interval seconds so that
+ * a run killed hours in continues from there instead of starting over.
+ *
+ * The file is a few "key=value" lines. It is only written after the
+ * output it describes has been flushed and synced, and it replaces the
+ * previous one atomically (temporary file, fsync, rename, fsync of the
+ * directory): after a crash
+ * the output holds at least output_bytes good bytes, and whatever follows
+ * them is cut off on --resume.
+ */
+struct ParseCheckpoint {
+  std::string input;          // tablespace path
+  uint64_t input_size = 0;    // its size in bytes
+  std::string options;        // the options that shape the output
+  uint64_t next_page = 0;     // first page not yet written out
+  uint64_t output_bytes = 0;  // output length up to next_page
+  bool done = false;          // the sweep reached the last page
+
+  // ParseStats counters up to next_page, so --stats totals span resumes.
+  uint64_t rows = 0;
+  uint64_t records_valid = 0;
+  uint64_t records_invalid = 0;
+  uint64_t records_deleted = 0;
+  uint64_t records_recovered = 0;
+  uint64_t records_carved = 0;
+  uint64_t records_filtered = 0;
+  uint64_t leaf_pages = 0;
+  uint64_t pages_unchanged = 0;
+  uint64_t max_lsn = 0;
+  std::string first_key;
+  std::string last_key;
+
+  void save_counters(const ParseStats& stats);
+  void restore_counters(ParseStats* stats) const;
+};
+
+/** Write ckpt to path atomically; false with *err on failure. */
+bool write_parse_checkpoint(const std::string& path, const ParseCheckpoint& ckpt,
+                            std::string* err);
+
+/** Read a checkpoint written by write_parse_checkpoint(). */
+bool read_parse_checkpoint(const std::string& path, ParseCheckpoint* ckpt,
+                           std::string* err);
+
+/**
+ * Mode 3 --shard-manifest: what one --shard or --page-range run wrote, so
+ * that scripts/merge_shards.py can check that the shards of a tablespace
+ * cover it exactly once, and their outputs are intact, before joining
+ * them. Same "key=value" layout as a checkpoint, written the same way.
+ */
+struct ShardManifest {
+  std::string input;          // tablespace path
+  uint64_t input_size = 0;    // its size in bytes
+  std::string options;        // the options that shape the output
+  uint64_t total_pages = 0;   // pages in the tablespace
+  uint64_t first_page = 0;    // this shard swept [first_page, end_page)
+  uint64_t end_page = 0;
+  std::string output;         // output path
+  uint64_t output_bytes = 0;
+  uint64_t header_bytes = 0;  // the column header line opening the output
+  std::string output_sha256;  // hex digest of the whole output
+  uint64_t rows = 0;
+  std::string first_key;      // JSON arrays of the key columns of the
+  std::string last_key;       // first and last row; empty without rows
+};
+
+/**
+ * Fill in m's output, output_bytes, output_sha256 and, when the output
+ * starts with a column header line (has_header), header_bytes from the
+ * file at path. false with *err when it cannot be read.
+ */
+bool digest_shard_output(const std::string& path, bool has_header, ShardManifest* m,
+                         std::string* err);
+
+/** Write m to path atomically; false with *err on failure. */
+bool write_shard_manifest(const std::string& path, const ShardManifest& m,
+                          std::string* err);
+
+#endif  // PARSE_CHECKPOINT_H
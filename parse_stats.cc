@@ -0,0 +1,317 @@
+/**
+ * parse_stats.cc
+ *
+ * Stage timers, counters and the --stats / --progress reports (see
+ * parse_stats.h).
+ */
+#include <chrono>
+#include <cinttypes>
+#include <ctime>
+
+#include "parse_stats.h"
+
+// From fil0fil.h.
+static const uint16_t kPageTypeAllocated = 0;
+static const uint16_t kPageTypeInode = 3;
+static const uint16_t kPageTypeFspHdr = 8;
+static const uint16_t kPageTypeXdes = 9;
+static const uint16_t kPageTypeBlob = 10;
+static const uint16_t kPageTypeZblob2 = 12;
+static const uint16_t kPageTypeEncrypted = 15;
+static const uint16_t kPageTypeEncryptedRtree = 17;
+static const uint16_t kPageTypeSdiBlob = 18;
+static const uint16_t kPageTypeSdiZblob = 19;
+static const uint16_t kPageTypeLobIndex = 22;
+static const uint16_t kPageTypeZlobFragEntry = 29;
+static const uint16_t kPageTypeSdi = 17853;
+static const uint16_t kPageTypeIndex = 17855;
+
+static thread_local ParseStats* t_parse_stats = nullptr;
+
+const char* parse_stage_name(int stage) {
+  static const char* const kNames[kParseStageCount] = {
+      "read", "xdes", "decompress", "parse", "lob", "format", "write"};
+  return (stage >= 0 && stage < kParseStageCount) ? kNames[stage] : "?";
+}
+
+PageClass page_class_of(uint16_t page_type) {
+  if (page_type == kPageTypeIndex) {
+    return PAGE_CLASS_INDEX;
+  }
+  if (page_type == kPageTypeSdi) {
+    return PAGE_CLASS_SDI;
+  }
+  if ((page_type >= kPageTypeBlob && page_type <= kPageTypeZblob2) ||
+      page_type == kPageTypeSdiBlob || page_type == kPageTypeSdiZblob ||
+      (page_type >= kPageTypeLobIndex && page_type <= kPageTypeZlobFragEntry)) {
+    return PAGE_CLASS_LOB;
+  }
+  if (page_type == kPageTypeFspHdr || page_type == kPageTypeXdes) {
+    return PAGE_CLASS_XDES;
+  }
+  if (page_type == kPageTypeInode) {
+    return PAGE_CLASS_INODE;
+  }
+  if (page_type == kPageTypeAllocated) {
+    return PAGE_CLASS_ALLOCATED;
+  }
+  if (page_type >= kPageTypeEncrypted && page_type <= kPageTypeEncryptedRtree) {
+    return PAGE_CLASS_ENCRYPTED;
+  }
+  return PAGE_CLASS_OTHER;
+}
+
+const char* page_class_name(int cls) {
+  static const char* const kNames[kPageClassCount] = {
+      "index", "sdi", "lob", "xdes", "inode", "allocated", "encrypted", "other"};
+  return (cls >= 0 && cls < kPageClassCount) ? kNames[cls] : "?";
+}
+
+uint64_t ParseStats::pages_total() const {
+  uint64_t total = 0;
+  for (int i = 0; i < kPageClassCount; i++) {
+    total += pages[i];
+  }
+  return total;
+}
+
+void ParseStats::merge(const ParseStats& other) {
+  for (int i = 0; i < kParseStageCount; i++) {
+    stages[i].wall_ns += other.stages[i].wall_ns;
+    stages[i].cpu_ns += other.stages[i].cpu_ns;
+    stages[i].calls += other.stages[i].calls;
+  }
+  for (int i = 0; i < kPageClassCount; i++) {
+    pages[i] += other.pages[i];
+  }
+  bytes_read += other.bytes_read;
+  bytes_written += other.bytes_written;
+  pages_xdes_free += other.pages_xdes_free;
+  pages_bad += other.pages_bad;
+  pages_unchanged += other.pages_unchanged;
+  pages_skipped += other.pages_skipped;
+  leaf_pages += other.leaf_pages;
+  lob_pages += other.lob_pages;
+  records_valid += other.records_valid;
+  records_invalid += other.records_invalid;
+  records_deleted += other.records_deleted;
+  records_recovered += other.records_recovered;
+  records_carved += other.records_carved;
+  records_filtered += other.records_filtered;
+  rows += other.rows;
+  // Merged in page order, so other's rows come after ours.
+  if (!other.first_key.empty()) {
+    if (first_key.empty()) {
+      first_key = other.first_key;
+    }
+    last_key = other.last_key;
+  }
+  if (other.max_lsn > max_lsn) {
+    max_lsn = other.max_lsn;
+  }
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+int ParseStats::enter(int stage) {
+  const uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+  const uint64_t cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+  if (active >= 0) {
+    stages[active].wall_ns += wall - mark_wall;
+    stages[active].cpu_ns += cpu - mark_cpu;
+  }
+  const int prev = active;
+  active = stage;
+  mark_wall = wall;
+  mark_cpu = cpu;
+  return prev;
+}
+
+void ParseStats::leave(int prev) {
+  const uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+  const uint64_t cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+  if (active >= 0) {
+    stages[active].wall_ns += wall - mark_wall;
+    stages[active].cpu_ns += cpu - mark_cpu;
+    stages[active].calls++;
+  }
+  active = prev;
+  mark_wall = wall;
+  mark_cpu = cpu;
+}
+
+ParseStats* current_parse_stats() {
+  return t_parse_stats;
+}
+
+ParseStatsScope::ParseStatsScope(ParseStats* stats) : prev_(t_parse_stats) {
+  t_parse_stats = stats;
+}
+
+ParseStatsScope::~ParseStatsScope() {
+  t_parse_stats = prev_;
+}
+
+static double mib(uint64_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+static double per_second(uint64_t n, double elapsed_s) {
+  return elapsed_s > 0 ? static_cast<double>(n) / elapsed_s : 0.0;
+}
+
+void print_parse_stats(FILE* out, const ParseStats& s, double elapsed_s,
+                       unsigned threads) {
+  std::fprintf(out, "Stats: %" PRIu64 " pages, %.1f MiB read in %.3f s "
+               "(%.1f MiB/s), %" PRIu64 " rows (%.0f rows/s), "
+               "%.1f MiB written\n",
+               s.pages_total(), mib(s.bytes_read), elapsed_s,
+               per_second(s.bytes_read, elapsed_s) / (1024.0 * 1024.0),
+               s.rows, per_second(s.rows, elapsed_s), mib(s.bytes_written));
+  std::fprintf(out, "  pages:");
+  for (int i = 0; i < kPageClassCount; i++) {
+    if (s.pages[i] > 0) {
+      std::fprintf(out, " %s=%" PRIu64, page_class_name(i), s.pages[i]);
+    }
+  }
+  std::fprintf(out, "; %" PRIu64 " leaves parsed, %" PRIu64
+               " free per XDES, %" PRIu64 " unreadable, %" PRIu64
+               " LOB pages fetched\n",
+               s.leaf_pages, s.pages_xdes_free, s.pages_bad, s.lob_pages);
+  if (s.pages_skipped > 0) {
+    std::fprintf(out, "  page map: %" PRIu64 " pages without rows of the index not read\n",
+                 s.pages_skipped);
+  }
+  std::fprintf(out, "  lsn: highest page LSN %" PRIu64, s.max_lsn);
+  if (s.pages_unchanged > 0) {
+    std::fprintf(out, ", %" PRIu64 " index pages unchanged since --since-lsn",
+                 s.pages_unchanged);
+  }
+  std::fprintf(out, "\n");
+  std::fprintf(out, "  records: %" PRIu64 " valid, %" PRIu64 " invalid, %" PRIu64
+               " deleted, %" PRIu64 " outside --where\n",
+               s.records_valid, s.records_invalid, s.records_deleted,
+               s.records_filtered);
+  if (s.records_recovered > 0 || s.records_carved > 0) {
+    std::fprintf(out, "  recovered: %" PRIu64 " delete-marked or freed, %" PRIu64
+                 " carved from free space\n",
+                 s.records_recovered, s.records_carved);
+  }
+  if (!s.timing) {
+    return;
+  }
+  std::fprintf(out, "  %-10s %10s %10s %12s%s\n", "stage", "wall s", "cpu s",
+               "calls", threads > 1 ? "   (summed over threads)" : "");
+  for (int i = 0; i < kParseStageCount; i++) {
+    const StageTime& t = s.stages[i];
+    std::fprintf(out, "  %-10s %10.3f %10.3f %12" PRIu64 "\n", parse_stage_name(i),
+                 t.wall_ns / 1e9, t.cpu_ns / 1e9, t.calls);
+  }
+}
+
+std::string parse_stats_json(const ParseStats& s, double elapsed_s,
+                             unsigned threads) {
+  char buf[256];
+  std::string out = "{";
+  auto field = [&](const char* name, uint64_t v) {
+    std::snprintf(buf, sizeof(buf), "\"%s\":%" PRIu64 ",", name, v);
+    out += buf;
+  };
+  std::snprintf(buf, sizeof(buf), "\"elapsed_s\":%.6f,\"threads\":%u,",
+                elapsed_s, threads);
+  out += buf;
+  field("pages", s.pages_total());
+  out += "\"pages_by_type\":{";
+  for (int i = 0; i < kPageClassCount; i++) {
+    std::snprintf(buf, sizeof(buf), "%s\"%s\":%" PRIu64, i ? "," : "",
+                  page_class_name(i), s.pages[i]);
+    out += buf;
+  }
+  out += "},";
+  field("bytes_read", s.bytes_read);
+  field("bytes_written", s.bytes_written);
+  field("pages_xdes_free", s.pages_xdes_free);
+  field("pages_unreadable", s.pages_bad);
+  field("leaf_pages", s.leaf_pages);
+  field("pages_unchanged", s.pages_unchanged);
+  field("pages_skipped", s.pages_skipped);
+  field("max_lsn", s.max_lsn);
+  field("lob_pages", s.lob_pages);
+  field("records_valid", s.records_valid);
+  field("records_invalid", s.records_invalid);
+  field("records_deleted", s.records_deleted);
+  field("records_recovered", s.records_recovered);
+  field("records_carved", s.records_carved);
+  field("records_filtered", s.records_filtered);
+  field("rows", s.rows);
+  std::snprintf(buf, sizeof(buf), "\"rows_per_s\":%.1f,\"read_mib_per_s\":%.1f",
+                per_second(s.rows, elapsed_s),
+                per_second(s.bytes_read, elapsed_s) / (1024.0 * 1024.0));
+  out += buf;
+  if (s.timing) {
+    out += ",\"stages\":{";
+    for (int i = 0; i < kParseStageCount; i++) {
+      const StageTime& t = s.stages[i];
+      std::snprintf(buf, sizeof(buf),
+                    "%s\"%s\":{\"wall_s\":%.6f,\"cpu_s\":%.6f,\"calls\":%" PRIu64 "}",
+                    i ? "," : "", parse_stage_name(i), t.wall_ns / 1e9,
+                    t.cpu_ns / 1e9, t.calls);
+      out += buf;
+    }
+    out += "}";
+  }
+  out += "}";
+  return out;
+}
+
+ProgressMeter::ProgressMeter(uint64_t total_pages, unsigned interval_s)
+    : total_pages_(total_pages), interval_s_(interval_s ? interval_s : 1) {
+  thread_ = std::thread([this] { run(); });
+}
+
+ProgressMeter::~ProgressMeter() {
+  stop();
+}
+
+void ProgressMeter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ProgressMeter::run() {
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!cv_.wait_for(lock, std::chrono::seconds(interval_s_),
+                       [this] { return stopping_; })) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    print_line(elapsed.count());
+  }
+}
+
+void ProgressMeter::print_line(double elapsed_s) {
+  const uint64_t pages = pages_.load(std::memory_order_relaxed);
+  const uint64_t rows = rows_.load(std::memory_order_relaxed);
+  const double pct =
+      total_pages_ ? 100.0 * static_cast<double>(pages) / total_pages_ : 0.0;
+  char eta[32] = "";
+  if (pages > 0 && pages < total_pages_) {
+    const double left = elapsed_s * static_cast<double>(total_pages_ - pages) / pages;
+    std::snprintf(eta, sizeof(eta), ", ETA %.0f s", left);
+  }
+  std::fprintf(stderr, "Progress: %" PRIu64 "/%" PRIu64 " pages (%.1f%%), %" PRIu64
+               " rows, %.0f pages/s, %.0f rows/s%s\n",
+               pages, total_pages_, pct, rows, per_second(pages, elapsed_s),
+               per_second(rows, elapsed_s), eta);
+}
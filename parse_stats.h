@@ -0,0 +1,172 @@
+#ifndef PARSE_STATS_H
+#define PARSE_STATS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Per-stage counters for mode 3 (--stats, --progress) and the C API.
+ *
+ * Each parse thread owns a ParseStats and binds it with ParseStatsScope;
+ * the stages time themselves with StageTimer, which does nothing while no
+ * stats are bound or timing is off. Stage times are exclusive: a LOB read
+ * inside the formatting of a row is charged to "lob" (and its pread() to
+ * "read"), not to "format". Threads' stats are merged at the end.
+ */
+enum ParseStage {
+  STAGE_READ = 0,    // pread()/mmap copies and page decryption
+  STAGE_XDES,        // extent descriptor lookups and the free-page check
+  STAGE_DECOMPRESS,  // page_zip inflation (index and LOB pages)
+  STAGE_PARSE,       // record walk and validation
+  STAGE_LOB,         // following external LOB chains
+  STAGE_FORMAT,      // decoding and formatting column values
+  STAGE_WRITE,       // handing row bytes to the output
+  kParseStageCount
+};
+
+const char* parse_stage_name(int stage);
+
+// Coarse page classes for the pages-by-type breakdown.
+enum PageClass {
+  PAGE_CLASS_INDEX = 0,
+  PAGE_CLASS_SDI,
+  PAGE_CLASS_LOB,
+  PAGE_CLASS_XDES,      // FSP_HDR and XDES
+  PAGE_CLASS_INODE,
+  PAGE_CLASS_ALLOCATED,
+  PAGE_CLASS_ENCRYPTED,  // still encrypted (no --keyring, or it failed)
+  PAGE_CLASS_OTHER,
+  kPageClassCount
+};
+
+PageClass page_class_of(uint16_t page_type);
+const char* page_class_name(int cls);
+
+struct StageTime {
+  uint64_t wall_ns = 0;
+  uint64_t cpu_ns = 0;
+  uint64_t calls = 0;
+};
+
+struct ParseStats {
+  bool timing = false;  // run the StageTimers (clock reads per transition)
+
+  StageTime stages[kParseStageCount];
+  uint64_t pages[kPageClassCount] = {};  // pages looked at, by class
+  uint64_t bytes_read = 0;               // tablespace bytes read or mapped
+  uint64_t bytes_written = 0;            // row output bytes
+  uint64_t pages_xdes_free = 0;          // skipped: marked free in the XDES
+  uint64_t pages_bad = 0;                // unreadable or failed to decompress
+  uint64_t pages_unchanged = 0;          // --since-lsn: INDEX pages not modified since
+  uint64_t pages_skipped = 0;            // --page-map: not read, hold no rows of the index
+  uint64_t max_lsn = 0;                  // highest FIL_PAGE_LSN of the pages looked at
+  uint64_t leaf_pages = 0;               // leaves of the selected index parsed
+  uint64_t lob_pages = 0;                // LOB pages fetched (cache hits too)
+  uint64_t records_valid = 0;
+  uint64_t records_invalid = 0;          // failed validation or broke the chain
+  uint64_t records_deleted = 0;
+  uint64_t records_recovered = 0;        // --recover-deleted: delete-marked or freed
+  uint64_t records_carved = 0;           // --recover-deleted: found by the heap scan
+  uint64_t records_filtered = 0;         // dropped by --where
+  uint64_t rows = 0;                     // rows written or returned
+  // RowOutputOptions::key_fields: the key of the first and last row
+  // written, as JSON arrays; empty before the first.
+  std::string first_key;
+  std::string last_key;
+
+  uint64_t pages_total() const;
+  void merge(const ParseStats& other);
+
+  // StageTimer internals: the running stage and when it was last charged.
+  int active = -1;
+  uint64_t mark_wall = 0;
+  uint64_t mark_cpu = 0;
+  int enter(int stage);
+  void leave(int prev);
+};
+
+// Stats bound to the calling thread, or nullptr.
+ParseStats* current_parse_stats();
+
+/** Bind stats to the calling thread for this scope (nullptr unbinds). */
+class ParseStatsScope {
+ public:
+  explicit ParseStatsScope(ParseStats* stats);
+  ~ParseStatsScope();
+  ParseStatsScope(const ParseStatsScope&) = delete;
+  ParseStatsScope& operator=(const ParseStatsScope&) = delete;
+
+ private:
+  ParseStats* prev_;
+};
+
+/** Charges the enclosing scope to stage in the calling thread's stats. */
+class StageTimer {
+ public:
+  explicit StageTimer(ParseStage stage) : stats_(current_parse_stats()) {
+    if (stats_ && stats_->timing) {
+      prev_ = stats_->enter(stage);
+    } else {
+      stats_ = nullptr;
+    }
+  }
+  ~StageTimer() {
+    if (stats_) {
+      stats_->leave(prev_);
+    }
+  }
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+ private:
+  ParseStats* stats_;
+  int prev_ = -1;
+};
+
+/** Human-readable report (threads > 1 notes that stage times are summed). */
+void print_parse_stats(FILE* out, const ParseStats& stats, double elapsed_s,
+                       unsigned threads);
+/** The same counters as one JSON object. */
+std::string parse_stats_json(const ParseStats& stats, double elapsed_s,
+                             unsigned threads);
+
+/**
+ * --progress: a background thread printing pages done, rows and rates to
+ * stderr every interval. Parse threads report with add(); the counters
+ * are relaxed atomics, so this costs a few adds per page.
+ */
+class ProgressMeter {
+ public:
+  ProgressMeter(uint64_t total_pages, unsigned interval_s);
+  ~ProgressMeter();
+  ProgressMeter(const ProgressMeter&) = delete;
+  ProgressMeter& operator=(const ProgressMeter&) = delete;
+
+  void add(uint64_t pages, uint64_t rows) {
+    pages_.fetch_add(pages, std::memory_order_relaxed);
+    rows_.fetch_add(rows, std::memory_order_relaxed);
+  }
+  /** Stop the thread (also done by the destructor). */
+  void stop();
+
+ private:
+  void run();
+  void print_line(double elapsed_s);
+
+  const uint64_t total_pages_;
+  const unsigned interval_s_;
+  std::atomic<uint64_t> pages_{0};
+  std::atomic<uint64_t> rows_{0};
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+#endif  // PARSE_STATS_H
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <charconv>
 #include <cctype>
 #include <ctime>
 #include <limits>
@@ -16,6 +17,11 @@
 // Keep RapidJSON SizeType consistent across translation units.
 #define RAPIDJSON_NO_SIZETYPEDEFINE
 namespace rapidjson { typedef ::std::size_t SizeType; }
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <rapidjson/istreamwrapper.h>
@@ -44,6 +50,10 @@ namespace rapidjson { typedef ::std::size_t SizeType; }
 #include "tables_dict.h"
 #include "undrop_for_innodb.h"
 #include "decompress.h"
+#include "tablespace_map.h"
+#include "decrypt.h"
+#include "parse_stats.h"
+#include "parser_log.h"
 
 struct XdesCache {
   page_no_t page_no = FIL_NULL;
@@ -168,28 +178,18 @@ static std::string decode_sdi_string(const std::string& input) {
   return input;
 }
 
-bool parser_debug_enabled() {
-  static int cached = -1;
-  if (cached != -1) {
-    return cached == 1;
-  }
-  const char* env = std::getenv("IB_PARSER_DEBUG");
-  cached = (env && *env && std::strcmp(env, "0") != 0) ? 1 : 0;
-  return cached == 1;
-}
-
 static void init_parser_timezone() {
-  static bool initialized = false;
-  if (initialized) {
-    return;
-  }
-  const char* tz = std::getenv("IB_PARSER_TZ");
-  if (!tz || *tz == '\0') {
-    tz = "America/Sao_Paulo";
-  }
-  setenv("TZ", tz, 1);
-  tzset();
-  initialized = true;
+  // Function-local static => runs once even when parse workers race here.
+  static const bool initialized = []() {
+    const char* tz = std::getenv("IB_PARSER_TZ");
+    if (!tz || *tz == '\0') {
+      tz = "America/Sao_Paulo";
+    }
+    setenv("TZ", tz, 1);
+    tzset();
+    return true;
+  }();
+  (void)initialized;
 }
 
 static unsigned int max_decimals_from_len(ulint len, ulint base_len) {
@@ -233,6 +233,18 @@ static int pow10_int(int exp) {
   return val;
 }
 
+// v in decimal, zero-padded to width; what "%0<width>u" prints.
+static char* put_padded(char* p, unsigned v, int width) {
+  char digits[10];
+  const std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), v);
+  const int n = static_cast<int>(r.ptr - digits);
+  for (int i = n; i < width; i++) {
+    *p++ = '0';
+  }
+  std::memcpy(p, digits, static_cast<size_t>(n));
+  return p + n;
+}
+
 bool format_innodb_timestamp(const unsigned char* ptr, ulint len,
                              unsigned int dec, std::string& out) {
   if (!ptr || len < 4) {
@@ -255,22 +267,26 @@ bool format_innodb_timestamp(const unsigned char* ptr, ulint len,
     return false;
   }
 
+  // A 32-bit timestamp is at most year 2106 in any zone: never negative.
   char buf[64];
-  int n = std::snprintf(buf, sizeof(buf),
-                        "%04d-%02d-%02d %02d:%02d:%02d",
-                        local_tm.tm_year + 1900,
-                        local_tm.tm_mon + 1,
-                        local_tm.tm_mday,
-                        local_tm.tm_hour,
-                        local_tm.tm_min,
-                        local_tm.tm_sec);
+  char* p = put_padded(buf, static_cast<unsigned>(local_tm.tm_year + 1900), 4);
+  *p++ = '-';
+  p = put_padded(p, static_cast<unsigned>(local_tm.tm_mon + 1), 2);
+  *p++ = '-';
+  p = put_padded(p, static_cast<unsigned>(local_tm.tm_mday), 2);
+  *p++ = ' ';
+  p = put_padded(p, static_cast<unsigned>(local_tm.tm_hour), 2);
+  *p++ = ':';
+  p = put_padded(p, static_cast<unsigned>(local_tm.tm_min), 2);
+  *p++ = ':';
+  p = put_padded(p, static_cast<unsigned>(local_tm.tm_sec), 2);
   if (dec > 0) {
     int scale = pow10_int(6 - static_cast<int>(dec));
     int frac = static_cast<int>(tv.m_tv_usec / scale);
-    n += std::snprintf(buf + n, sizeof(buf) - static_cast<size_t>(n),
-                       ".%0*d", dec, frac);
+    *p++ = '.';
+    p = put_padded(p, static_cast<unsigned>(frac), static_cast<int>(dec));
   }
-  out.assign(buf, static_cast<size_t>(n));
+  out.assign(buf, static_cast<size_t>(p - buf));
   return true;
 }
 
@@ -303,8 +319,12 @@ bool format_innodb_date(const unsigned char* ptr, ulint len, std::string& out) {
   unsigned int month = (raw >> 5) & 15;
   unsigned int year = raw >> 9;
   char buf[16];
-  int n = std::snprintf(buf, sizeof(buf), "%04u-%02u-%02u", year, month, day);
-  out.assign(buf, static_cast<size_t>(n));
+  char* p = put_padded(buf, year, 4);
+  *p++ = '-';
+  p = put_padded(p, month, 2);
+  *p++ = '-';
+  p = put_padded(p, day, 2);
+  out.assign(buf, static_cast<size_t>(p - buf));
   return true;
 }
 
@@ -329,6 +349,80 @@ bool format_innodb_time(const unsigned char* ptr, ulint len,
   return true;
 }
 
+// Days since 1970-01-01 in the proleptic Gregorian calendar.
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static bool civil_date_valid(unsigned year, unsigned month, unsigned day) {
+  return year != 0 && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+bool decode_innodb_date(const unsigned char* ptr, ulint len, int32_t* days) {
+  if (!ptr || len < 3) {
+    return false;
+  }
+  uint32_t raw = static_cast<uint32_t>(read_be_int_signed(ptr, len));
+  unsigned int day = raw & 31;
+  unsigned int month = (raw >> 5) & 15;
+  unsigned int year = raw >> 9;
+  if (!civil_date_valid(year, month, day)) {
+    return false;
+  }
+  *days = static_cast<int32_t>(days_from_civil(year, month, day));
+  return true;
+}
+
+bool decode_innodb_datetime(const unsigned char* ptr, ulint len,
+                            unsigned int dec, int64_t* micros) {
+  if (!ptr || len < 5) {
+    return false;
+  }
+  if (dec > 6) {
+    dec = 6;
+  }
+  unsigned int max_dec = max_decimals_from_len(len, 5);
+  if (dec > max_dec) {
+    dec = max_dec;
+  }
+  longlong packed = my_datetime_packed_from_binary(ptr, dec);
+  MYSQL_TIME tm{};
+  TIME_from_longlong_datetime_packed(&tm, packed);
+  if (!civil_date_valid(tm.year, tm.month, tm.day)) {
+    return false;
+  }
+  const int64_t secs = days_from_civil(tm.year, tm.month, tm.day) * 86400 +
+                       tm.hour * 3600 + tm.minute * 60 + tm.second;
+  *micros = secs * 1000000 + static_cast<int64_t>(tm.second_part);
+  return true;
+}
+
+bool decode_innodb_timestamp(const unsigned char* ptr, ulint len,
+                             unsigned int dec, int64_t* micros) {
+  if (!ptr || len < 4) {
+    return false;
+  }
+  if (dec > 6) {
+    dec = 6;
+  }
+  unsigned int max_dec = max_decimals_from_len(len, 4);
+  if (dec > max_dec) {
+    dec = max_dec;
+  }
+  my_timeval tv{};
+  my_timestamp_from_binary(&tv, ptr, dec);
+  if (tv.m_tv_sec == 0 && tv.m_tv_usec == 0) {
+    return false;  // 0000-00-00 00:00:00
+  }
+  *micros = static_cast<int64_t>(tv.m_tv_sec) * 1000000 + tv.m_tv_usec;
+  return true;
+}
+
 static void set_target_index_id(parser_context_t* ctx, uint64_t id) {
   if (ctx == nullptr) {
     return;
@@ -594,15 +688,15 @@ extern const unsigned char*
 void debug_print_table_def(const table_def_t *table)
 {
     if (!table) {
-        printf("[debug_print_table_def] table is NULL\n");
+        log_write(LOG_LEVEL_DEBUG, "[debug_print_table_def] table is NULL\n");
         return;
     }
 
-    printf("=== Table Definition for '%s' ===\n", (table->name ? table->name : "(null)"));
-    printf("fields_count=%u, n_nullable=%u\n", table->fields_count, table->n_nullable);
+    log_write(LOG_LEVEL_DEBUG, "=== Table Definition for '%s' ===\n", (table->name ? table->name : "(null)"));
+    log_write(LOG_LEVEL_DEBUG, "fields_count=%u, n_nullable=%u\n", table->fields_count, table->n_nullable);
 
     // Possibly also print data_min_size / data_max_size if your code uses them:
-    // e.g. printf("data_min_size=%d, data_max_size=%ld\n",
+    // e.g. log_write(LOG_LEVEL_DEBUG, "data_min_size=%d, data_max_size=%ld\n",
     //              table->data_min_size, table->data_max_size);
 
     for (int i = 0; i < table->fields_count; i++) {
@@ -635,17 +729,17 @@ void debug_print_table_def(const table_def_t *table)
         default:            type_str = "FT_???";      break;
         }
 
-        printf(" Field #%u:\n", i);
-        printf("   name=%s\n", (fld->name ? fld->name : "(null)"));
-        printf("   type=%s\n", type_str);
-        printf("   can_be_null=%s\n", (fld->can_be_null ? "true" : "false"));
-        printf("   fixed_length=%u\n", fld->fixed_length);
-        printf("   min_length=%u, max_length=%u\n", fld->min_length, fld->max_length);
-        printf("   decimal_precision=%d, decimal_digits=%d\n",
+        log_write(LOG_LEVEL_DEBUG, " Field #%u:\n", i);
+        log_write(LOG_LEVEL_DEBUG, "   name=%s\n", (fld->name ? fld->name : "(null)"));
+        log_write(LOG_LEVEL_DEBUG, "   type=%s\n", type_str);
+        log_write(LOG_LEVEL_DEBUG, "   can_be_null=%s\n", (fld->can_be_null ? "true" : "false"));
+        log_write(LOG_LEVEL_DEBUG, "   fixed_length=%u\n", fld->fixed_length);
+        log_write(LOG_LEVEL_DEBUG, "   min_length=%u, max_length=%u\n", fld->min_length, fld->max_length);
+        log_write(LOG_LEVEL_DEBUG, "   decimal_precision=%d, decimal_digits=%d\n",
                fld->decimal_precision, fld->decimal_digits);
-        printf("   time_precision=%d\n", fld->time_precision);
+        log_write(LOG_LEVEL_DEBUG, "   time_precision=%d\n", fld->time_precision);
     }
-    printf("=== End of Table Definition ===\n\n");
+    log_write(LOG_LEVEL_DEBUG, "=== End of Table Definition ===\n\n");
 }
 
 // --------------------------------------------------------------------
@@ -663,12 +757,12 @@ void debug_print_compact_row(const page_t* page,
                              const ulint* offsets)
 {
     if (!page || !rec || !table || !offsets) {
-        printf("[debug_print_compact_row] invalid pointer(s)\n");
+        log_write(LOG_LEVEL_TRACE, "[debug_print_compact_row] invalid pointer(s)\n");
         return;
     }
 
     // Print a header line or something
-    printf("Row at rec=%p => columns:\n", (const void*)rec);
+    log_write(LOG_LEVEL_TRACE, "Row at rec=%p => columns:\n", (const void*)rec);
 
     // For each field
     for (ulint i = 0; i < (ulint)table->fields_count; i++) {
@@ -679,7 +773,7 @@ void debug_print_compact_row(const page_t* page,
 
         // If length is UNIV_SQL_NULL => print "NULL"
         if (field_len == UNIV_SQL_NULL) {
-            printf("  [%2lu] %-15s => NULL\n", i, table->fields[i].name);
+            log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => NULL\n", i, table->fields[i].name);
             continue;
         }
 
@@ -691,23 +785,23 @@ void debug_print_compact_row(const page_t* page,
             if (field_len > 0 && field_len <= 8) {
                 if (table->fields[i].type == FT_UINT) {
                     uint64_t val = read_be_uint(field_ptr, field_len);
-                    printf("  [%2lu] %-15s => (UINT) %llu\n",
+                    log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (UINT) %llu\n",
                            i, table->fields[i].name,
                            static_cast<unsigned long long>(val));
                 } else {
                     int64_t val = read_be_int_signed(field_ptr, field_len);
-                    printf("  [%2lu] %-15s => (INT) %lld\n",
+                    log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (INT) %lld\n",
                            i, table->fields[i].name,
                            static_cast<long long>(val));
                 }
             } else {
                 // length isn't 4 => just hex-dump or do naive printing
-                printf("  [%2lu] %-15s => (INT?) length=%lu => ",
+                log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (INT?) length=%lu => ",
                        i, table->fields[i].name, (unsigned long)field_len);
                 for (ulint k=0; k<field_len && k<16; k++) {
-                    printf("%02X ", field_ptr[k]);
+                    log_write(LOG_LEVEL_TRACE, "%02X ", field_ptr[k]);
                 }
-                printf("\n");
+                log_write(LOG_LEVEL_TRACE, "\n");
             }
             break;
 
@@ -716,7 +810,7 @@ void debug_print_compact_row(const page_t* page,
             // Treat as textual => do a naive printing (limit ~200 bytes for safety)
             {
                 ulint to_print = (field_len < 200 ? field_len : 200);
-                printf("  [%2lu] %-15s => (CHAR) len=%lu => \"", 
+                log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (CHAR) len=%lu => \"", 
                        i, table->fields[i].name, (unsigned long)field_len);
                 for (ulint k=0; k<to_print; k++) {
                     unsigned char c = field_ptr[k];
@@ -724,11 +818,11 @@ void debug_print_compact_row(const page_t* page,
                         putchar((int)c);
                     } else {
                         // print as \xNN
-                        printf("\\x%02X", c);
+                        log_write(LOG_LEVEL_TRACE, "\\x%02X", c);
                     }
                 }
-                if (field_len > 200) printf("...(truncated)...");
-                printf("\"\n");
+                if (field_len > 200) log_write(LOG_LEVEL_TRACE, "...(truncated)...");
+                log_write(LOG_LEVEL_TRACE, "\"\n");
             }
             break;
 
@@ -744,49 +838,49 @@ void debug_print_compact_row(const page_t* page,
                     ok = format_innodb_timestamp(field_ptr, field_len, dec, formatted);
                 }
                 if (ok) {
-                    printf("  [%2lu] %-15s => (%s) %s\n",
+                    log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (%s) %s\n",
                            i, table->fields[i].name,
                            table->fields[i].type == FT_DATETIME ? "DATETIME" : "TIMESTAMP",
                            formatted.c_str());
                 } else {
-                    printf("  [%2lu] %-15s => (%s) length=%lu => raw hex ",
+                    log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (%s) length=%lu => raw hex ",
                            i, table->fields[i].name,
                            table->fields[i].type == FT_DATETIME ? "DATETIME" : "TIMESTAMP",
                            (unsigned long)field_len);
                     for (ulint k = 0; k < field_len && k < 16; k++) {
-                        printf("%02X ", field_ptr[k]);
+                        log_write(LOG_LEVEL_TRACE, "%02X ", field_ptr[k]);
                     }
-                    printf("\n");
+                    log_write(LOG_LEVEL_TRACE, "\n");
                 }
             }
             break;
 
         case FT_INTERNAL:
             // e.g. DB_TRX_ID(6 bytes) or DB_ROLL_PTR(7 bytes)
-            printf("  [%2lu] %-15s => (INTERNAL) length=%lu => ", 
+            log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (INTERNAL) length=%lu => ", 
                    i, table->fields[i].name, (unsigned long)field_len);
             for (ulint k=0; k<field_len && k<16; k++) {
-                printf("%02X ", field_ptr[k]);
+                log_write(LOG_LEVEL_TRACE, "%02X ", field_ptr[k]);
             }
-            printf("\n");
+            log_write(LOG_LEVEL_TRACE, "\n");
             break;
 
         // ... other types (FLOAT, DOUBLE, DECIMAL, BLOB, etc.)
         default:
             // fallback => hex-dump
-            printf("  [%2lu] %-15s => (type=%d) length=%lu => ",
+            log_write(LOG_LEVEL_TRACE, "  [%2lu] %-15s => (type=%d) length=%lu => ",
                    i, table->fields[i].name, table->fields[i].type,
                    (unsigned long)field_len);
             for (ulint k=0; k<field_len && k<16; k++) {
-                printf("%02X ", field_ptr[k]);
+                log_write(LOG_LEVEL_TRACE, "%02X ", field_ptr[k]);
             }
-            if (field_len>16) printf("...(truncated)...");
-            printf("\n");
+            if (field_len>16) log_write(LOG_LEVEL_TRACE, "...(truncated)...");
+            log_write(LOG_LEVEL_TRACE, "\n");
             break;
         } // switch
     }
 
-    printf("End of row\n\n");
+    log_write(LOG_LEVEL_TRACE, "End of row\n\n");
 }
 
 /**
@@ -799,7 +893,9 @@ void debug_print_compact_row(const page_t* page,
  *   Returns 0 if success, non-0 if error.
  */
 
-int discover_target_index_id(int fd, parser_context_t* ctx)
+int discover_target_index_id(int fd, parser_context_t* ctx,
+                             const TablespaceMap* map,
+                             const PageCipher* cipher)
 {
   if (ctx == nullptr) {
     fprintf(stderr, "discover_target_index_id: parser context is null.\n");
@@ -824,26 +920,41 @@ int discover_target_index_id(int fd, parser_context_t* ctx)
   if (tablespace_compressed) {
     logical_buf.resize(logical_size);
   }
-  if (pread(fd, page_buf.data(), physical_size, 0) != (ssize_t)physical_size) {
-    perror("pread page0");
-    return 1;
+  const unsigned char* page0 = map ? map->page(0, physical_size) : nullptr;
+  if (page0 == nullptr) {
+    if (pread(fd, page_buf.data(), physical_size, 0) != (ssize_t)physical_size) {
+      perror("pread page0");
+      return 1;
+    }
+    page0 = page_buf.data();
   }
-  uint32_t space_id = mach_read_from_4(page_buf.data() + FSP_HEADER_OFFSET + FSP_SPACE_ID);
+  uint32_t space_id = mach_read_from_4(page0 + FSP_HEADER_OFFSET + FSP_SPACE_ID);
 
   // 4) loop over each page
   for (int i = 0; i < block_num; i++) {
-    off_t offset = (off_t) i * physical_size;
-    if (pread(fd, page_buf.data(), physical_size, offset) != (ssize_t)physical_size) {
-      // partial read => break or return error
-      break;
+    const unsigned char* raw = map ? map->page(i, physical_size) : nullptr;
+    if (raw != nullptr && cipher != nullptr) {
+      // Never decrypt inside the shared mapping.
+      memcpy(page_buf.data(), raw, physical_size);
+      raw = page_buf.data();
+    } else if (raw == nullptr) {
+      off_t offset = (off_t) i * physical_size;
+      if (pread(fd, page_buf.data(), physical_size, offset) != (ssize_t)physical_size) {
+        // partial read => break or return error
+        break;
+      }
+      raw = page_buf.data();
+    }
+    if (cipher != nullptr && !cipher->decrypt(page_buf.data(), physical_size)) {
+      continue;
     }
 
     // check if FIL_PAGE_INDEX
-    if (fil_page_get_type(page_buf.data()) == FIL_PAGE_INDEX) {
-      const unsigned char* page_data = page_buf.data();
+    if (fil_page_get_type(raw) == FIL_PAGE_INDEX) {
+      const unsigned char* page_data = raw;
       if (tablespace_compressed) {
         size_t actual_size = 0;
-        if (!decompress_page_inplace(page_buf.data(),
+        if (!decompress_page_inplace(raw,
                                      physical_size,
                                      logical_size,
                                      logical_buf.data(),
@@ -1131,8 +1242,16 @@ int build_table_def_from_json(table_def_t* table,
         return 1;
     }
 
-    // 1) Zero out "table_def_t"
-    std::memset(table, 0, sizeof(table_def_t));
+    // 1) Reset the table header. The field array is ~500 fields of 512KB
+    //    (inline enum value tables), so only the entries filled in below are
+    //    cleared, one at a time.
+    table->name = nullptr;
+    table->fields_count = 0;
+    table->data_min_size = 0;
+    table->data_max_size = 0;
+    table->n_nullable = 0;
+    table->min_rec_header_len = 0;
+    table->plan = nullptr;
 
     // 2) Copy the table name
     table->name = strdup(tbl_name);
@@ -1404,9 +1523,16 @@ int build_table_def_from_json(table_def_t* table,
     // optionally set data_max_size, data_min_size
     // or do so in your calling code if you want consistent row checks.
 
+    // 7) Decoder plan for check_for_a_record() / process_ibrec()
+    compile_record_plan(table);
+
     return 0;
 }
 
+static int load_sdi_table_columns(const rapidjson::Value& table_obj,
+                                  std::string& table_name,
+                                  parser_context_t* ctx);
+
 /**
  * load_ib2sdi_table_columns():
  *   Parses an ib2sdi-generated JSON file (like the one you pasted),
@@ -1443,10 +1569,10 @@ int load_ib2sdi_table_columns(const char* json_path,
         std::fclose(fp);
         return 1;
     }
+    std::fclose(fp);
 
     if (!d.IsArray()) {
         std::cerr << "[Error] Top-level JSON is not an array.\n";
-        std::fclose(fp);
         return 1;
     }
 
@@ -1478,23 +1604,37 @@ int load_ib2sdi_table_columns(const char* json_path,
 
     if (!table_obj) {
         std::cerr << "[Error] Could not find any array element with dd_object_type=='Table'.\n";
-        std::fclose(fp);
         return 1;
     }
 
+    return load_sdi_table_columns(*table_obj, table_name, ctx);
+}
+
+/**
+ * load_sdi_table_columns():
+ *   Fills ctx (columns, index definitions) and table_name from one Table
+ *   SDI object, {"dd_object_type": "Table", "dd_object": {...}}, whether
+ *   it came from an ibd2sdi file or from the tablespace itself.
+ *
+ * Returns 0 on success, non-0 on error.
+ */
+static int load_sdi_table_columns(const rapidjson::Value& table_obj,
+                                  std::string& table_name,
+                                  parser_context_t* ctx)
+{
     // 4) Inside that "object", we want "dd_object" => "columns"
-    //    i.e. table_obj->HasMember("dd_object") => columns in table_obj["dd_object"]["columns"]
-    if (!table_obj->HasMember("dd_object")) {
+    //    i.e. table_obj.HasMember("dd_object") => columns in table_obj["dd_object"]["columns"]
+    if (!table_obj.HasMember("dd_object")) {
         std::cerr << "[Error] Table object is missing 'dd_object' member.\n";
-        std::fclose(fp);
         return 1;
     }
-    const rapidjson::Value& dd_obj = (*table_obj)["dd_object"];
+    const rapidjson::Value& dd_obj = table_obj["dd_object"];
 
     // Extract table name from dd_object
     if (dd_obj.HasMember("name") && dd_obj["name"].IsString()) {
         table_name = dd_obj["name"].GetString();
-        std::cout << "[Debug] Extracted table name: " << table_name << "\n";
+        PARSER_LOG(LOG_LEVEL_DEBUG, "[Debug] Extracted table name: %s\n",
+                   table_name.c_str());
     } else {
         std::cerr << "[Warning] 'dd_object' is missing 'name'. Using default 'UNKNOWN_TABLE'.\n";
         table_name = "UNKNOWN_TABLE";
@@ -1502,7 +1642,6 @@ int load_ib2sdi_table_columns(const char* json_path,
 
     if (!dd_obj.HasMember("columns") || !dd_obj["columns"].IsArray()) {
         std::cerr << "[Error] 'dd_object' is missing 'columns' array.\n";
-        std::fclose(fp);
         return 1;
     }
 
@@ -1582,13 +1721,14 @@ int load_ib2sdi_table_columns(const char* json_path,
 
         ctx->columns_by_opx[i] = def;
 
-        std::cout << "[Debug] Added column: name='" << def.name
-                  << "', type='" << def.type_utf8
-                  << "', char_length=" << def.char_length
-                  << ", ordinal=" << def.ordinal_position
-                  << ", opx=" << def.column_opx
-                  << (def.is_virtual ? " (virtual)" : "")
-                  << "\n";
+        PARSER_LOG(LOG_LEVEL_DEBUG,
+                   "[Debug] Added column: name='%s', type='%s', char_length=%llu, "
+                   "ordinal=%d, opx=%d%s\n",
+                   def.name.c_str(), def.type_utf8.c_str(),
+                   static_cast<unsigned long long>(def.char_length),
+                   static_cast<int>(def.ordinal_position),
+                   static_cast<int>(def.column_opx),
+                   def.is_virtual ? " (virtual)" : "");
     }
 
     bool have_indexes = parse_index_defs(dd_obj, ctx);
@@ -1596,8 +1736,9 @@ int load_ib2sdi_table_columns(const char* json_path,
         std::string err;
         if (select_index_for_parsing(ctx, "PRIMARY", &err) &&
             !ctx->columns.empty()) {
-            std::cout << "[Debug] Using PRIMARY index order for record parsing ("
-                      << ctx->columns.size() << " columns).\n";
+            PARSER_LOG(LOG_LEVEL_DEBUG,
+                       "[Debug] Using PRIMARY index order for record parsing "
+                       "(%zu columns).\n", ctx->columns.size());
         } else {
             std::cerr << "[Warn] PRIMARY index order not found: " << err << "\n";
         }
@@ -1622,13 +1763,39 @@ int load_ib2sdi_table_columns(const char* json_path,
                              return a_pos < b_pos;
                          });
         ctx->columns.swap(ordered);
-        std::cout << "[Warn] PRIMARY index order not found; using ordinal_position order.\n";
+        PARSER_LOG(LOG_LEVEL_WARN,
+                   "[Warn] PRIMARY index order not found; using ordinal_position order.\n");
     }
 
-    std::fclose(fp);
     return 0;
 }
 
+int load_sdi_table_object(const char* json, size_t len,
+                          std::string& table_name,
+                          parser_context_t* ctx)
+{
+    if (ctx == nullptr) {
+        std::cerr << "[Error] Parser context is null.\n";
+        return 1;
+    }
+
+    rapidjson::Document d;
+    d.Parse(json, len);
+    if (d.HasParseError()) {
+        std::cerr << "[Error] SDI JSON parse error: "
+                  << rapidjson::GetParseError_En(d.GetParseError())
+                  << " at offset " << d.GetErrorOffset() << std::endl;
+        return 1;
+    }
+    if (!d.IsObject() || !d.HasMember("dd_object_type") ||
+        !d["dd_object_type"].IsString() ||
+        std::strcmp(d["dd_object_type"].GetString(), "Table") != 0) {
+        std::cerr << "[Error] SDI object is not a Table.\n";
+        return 1;
+    }
+    return load_sdi_table_columns(d, table_name, ctx);
+}
+
 /**
  * Example: parse and print records from a leaf page.
  * Very minimal, ignoring many corner cases.
@@ -1671,42 +1838,420 @@ static bool next_compact_rec_offset(const page_t* page,
   return true;
 }
 
-void parse_records_on_page(const unsigned char* page,
+bool selected_index_is_clustered(const parser_context_t* ctx) {
+  if (ctx == nullptr || ctx->index_defs.empty()) {
+    return true;  // legacy SDI without index list => PRIMARY layout
+  }
+  const IndexDef* def = find_index_by_name(ctx, ctx->target_index_name);
+  return def == nullptr || def->is_primary;
+}
+
+// Fields in a node pointer's key: the PK columns for the clustered index
+// (everything before DB_TRX_ID), every column for a secondary index.
+ulint index_key_fields(const table_def_t* table, bool clustered) {
+  ulint n_key = static_cast<ulint>(table->fields_count);
+  if (clustered) {
+    for (ulint i = 0; i < n_key; i++) {
+      if (table->fields[i].name &&
+          std::strcmp(table->fields[i].name, "DB_TRX_ID") == 0) {
+        return i;
+      }
+    }
+  }
+  return n_key;
+}
+
+// Child page of the node pointer at rec_offset: the key prefix is followed
+// by the page number as 4 bytes.
+static page_no_t node_ptr_rec_child(const unsigned char* page,
+                                    size_t page_size,
+                                    ulint rec_offset,
+                                    const table_def_t* table,
+                                    ulint n_key)
+{
+  const rec_t* rec = reinterpret_cast<const rec_t*>(page + rec_offset);
+  const unsigned char* nulls = reinterpret_cast<const unsigned char*>(rec) -
+                               (REC_N_NEW_EXTRA_BYTES + 1);
+  const unsigned char* lens = nulls - ((table->n_nullable + 7) / 8);
+  unsigned char null_mask = 1;
+  ulint data_len = 0;
+
+  for (ulint i = 0; i < n_key; i++) {
+    const field_def_t& fld = table->fields[i];
+    if (fld.can_be_null) {
+      if (null_mask == 0) {
+        nulls--;
+        null_mask = 1;
+      }
+      const bool is_null = (*nulls & null_mask) != 0;
+      null_mask <<= 1;
+      if (is_null) {
+        continue;
+      }
+    }
+    if (fld.fixed_length > 0) {
+      data_len += static_cast<ulint>(fld.fixed_length);
+      continue;
+    }
+    ulint len = *lens--;
+    if ((fld.max_length > 255 || fld.type == FT_BLOB ||
+         fld.type == FT_TEXT || fld.type == FT_JSON) &&
+        (len & 0x80)) {
+      len = ((len & 0x3f) << 8) | *lens--;
+    }
+    data_len += len;
+  }
+
+  if (rec_offset + data_len + 4 > page_size) {
+    return FIL_NULL;
+  }
+  return mach_read_from_4(reinterpret_cast<const unsigned char*>(rec) + data_len);
+}
+
+page_no_t first_node_ptr_child(const unsigned char* page,
+                               size_t page_size,
+                               const table_def_t* table,
+                               bool clustered)
+{
+  if (table == nullptr || table->fields_count <= 0) {
+    return FIL_NULL;
+  }
+  const ulint n_key = index_key_fields(table, clustered);
+  if (n_key == 0) {
+    return FIL_NULL;
+  }
+
+  ulint rec_offset = 0;
+  if (!next_compact_rec_offset((const page_t*)page, PAGE_NEW_INFIMUM,
+                               page_size, &rec_offset)) {
+    return FIL_NULL;
+  }
+  const rec_t* rec = reinterpret_cast<const rec_t*>(page + rec_offset);
+  if (rec_get_status(rec) != REC_STATUS_NODE_PTR) {
+    return FIL_NULL;
+  }
+  return node_ptr_rec_child(page, page_size, rec_offset, table, n_key);
+}
+
+bool record_leading_key(const unsigned char* rec,
+                        const table_def_t* table,
+                        const KeyRange& range,
+                        bool raw_integers,
+                        uint64_t* key)
+{
+  if (range.field != 0 || table->fields_count <= 0) {
+    return false;
+  }
+  const field_def_t& fld = table->fields[0];
+  // The first nullable field owns bit 0 of the first null-bitmap byte.
+  if (fld.can_be_null && (*(rec - (REC_N_NEW_EXTRA_BYTES + 1)) & 1)) {
+    return false;
+  }
+  *key = key_range_value(range, rec, static_cast<size_t>(fld.fixed_length),
+                         raw_integers);
+  return true;
+}
+
+page_no_t range_node_ptr_child(const unsigned char* page,
+                               size_t page_size,
+                               const table_def_t* table,
+                               bool clustered,
+                               const KeyRange& range,
+                               bool raw_integers)
+{
+  if (table == nullptr || table->fields_count <= 0) {
+    return FIL_NULL;
+  }
+  const ulint n_key = index_key_fields(table, clustered);
+  if (n_key == 0) {
+    return FIL_NULL;
+  }
+
+  // Child i holds keys from node pointer i up to node pointer i+1. Rows
+  // equal to range.lo can sit in the last child that starts below it (the
+  // key may repeat across children of a secondary index), so stop at the
+  // first pointer whose key is >= lo and take the one before it.
+  page_no_t child = FIL_NULL;
+  ulint rec_offset = PAGE_NEW_INFIMUM;
+  const ulint max_steps = static_cast<ulint>(page_size / (REC_N_NEW_EXTRA_BYTES + 1));
+  for (ulint steps = 0; steps < max_steps; steps++) {
+    ulint next = 0;
+    if (!next_compact_rec_offset((const page_t*)page, rec_offset, page_size, &next) ||
+        next == rec_offset) {
+      return FIL_NULL;
+    }
+    rec_offset = next;
+    const unsigned char* rec = page + rec_offset;
+    const ulint status = rec_get_status(reinterpret_cast<const rec_t*>(rec));
+    if (status == REC_STATUS_SUPREMUM) {
+      return child;
+    }
+    if (status != REC_STATUS_NODE_PTR) {
+      return FIL_NULL;
+    }
+    // The first pointer is always a candidate (on the leftmost page of a
+    // level it stands for -infinity); a NULL key sorts below any value.
+    uint64_t key = 0;
+    if (child != FIL_NULL &&
+        record_leading_key(rec, table, range, raw_integers, &key) &&
+        key >= range.lo) {
+      return child;
+    }
+    child = node_ptr_rec_child(page, page_size, rec_offset, table, n_key);
+    if (child == FIL_NULL) {
+      return FIL_NULL;
+    }
+  }
+  return FIL_NULL;
+}
+
+// ----------------------------------------------------------------------------
+// --recover-deleted
+//
+// Besides the delete-marked records still in the chain, a leaf keeps whole
+// records it no longer links to: the PAGE_FREE list of purged records and,
+// once their slots are reused or the list is rebuilt, stale copies in the
+// heap. covered[] holds the bytes of every record already accounted for on
+// the page, so each is reported once whichever way it was found.
+// ----------------------------------------------------------------------------
+
+// Validate the record at rec_offset and claim its bytes; false if it fails
+// validation or overlaps a record claimed before.
+static bool claim_record(const unsigned char* page,
+                         size_t page_size,
+                         ulint rec_offset,
+                         table_def_t* table,
+                         ulint* offsets,
+                         std::vector<unsigned char>& covered)
+{
+  if (!check_for_a_record((page_t*)page, (rec_t*)(page + rec_offset), table, offsets)) {
+    return false;
+  }
+  // The whole record, its null bitmap and length bytes included, so a
+  // candidate cannot sit on another record's header (or on the supremum).
+  const ulint extra = record_extra_size((const rec_t*)(page + rec_offset), table, offsets);
+  const ulint end = rec_offset + record_data_size(offsets);
+  if (rec_offset < PAGE_NEW_SUPREMUM_END + extra || end > page_size) {
+    return false;
+  }
+  const ulint begin = rec_offset - extra;
+  if (std::find(covered.begin() + begin, covered.begin() + end, 1) !=
+      covered.begin() + end) {
+    return false;
+  }
+  std::fill(covered.begin() + begin, covered.begin() + end, 1);
+  return true;
+}
+
+static void emit_recovered_record(const unsigned char* page,
+                                  uint64_t page_no,
+                                  ulint rec_offset,
+                                  table_def_t* table,
+                                  ulint* offsets)
+{
+  RowMeta meta;
+  meta.page_no = page_no;
+  meta.rec_offset = rec_offset;
+  meta.deleted = true;
+  process_ibrec((page_t*)page, (rec_t*)(page + rec_offset), table, offsets, false, &meta);
+}
+
+// Records on the PAGE_FREE list (purged, space not yet reused).
+static ulint recover_free_list(const unsigned char* page,
+                               size_t page_size,
+                               uint64_t page_no,
+                               table_def_t* table,
+                               std::vector<unsigned char>& covered)
+{
+  ulint n_recovered = 0;
+  ulint rec_offset = mach_read_from_2(page + PAGE_HEADER + PAGE_FREE);
+  const ulint max_steps = static_cast<ulint>(page_size / (REC_N_NEW_EXTRA_BYTES + 1));
+  for (ulint steps = 0; rec_offset != 0 && steps < max_steps; steps++) {
+    if (rec_offset < PAGE_NEW_SUPREMUM_END + REC_N_NEW_EXTRA_BYTES ||
+        rec_offset >= page_size) {
+      break;
+    }
+    const rec_t* rec = reinterpret_cast<const rec_t*>(page + rec_offset);
+    ulint offsets[MAX_TABLE_FIELDS + 2];
+    if (rec_get_status(rec) == REC_STATUS_ORDINARY &&
+        claim_record(page, page_size, rec_offset, table, offsets, covered)) {
+      n_recovered++;
+      emit_recovered_record(page, page_no, rec_offset, table, offsets);
+    }
+    ulint next = 0;
+    if (!next_compact_rec_offset((const page_t*)page, rec_offset, page_size, &next) ||
+        next == rec_offset) {
+      break;
+    }
+    rec_offset = next;
+  }
+  return n_recovered;
+}
+
+// Bit i set => the header of a record with its origin at o + i could be
+// that of an ordinary leaf record: status 0, no min-rec flag, n_owned <= 8.
+// Checks 16 origins at once; the full check is carve_header_plausible().
+static unsigned carve_candidates16(const unsigned char* page, ulint o)
+{
+#if defined(__SSE2__)
+  const __m128i info = _mm_loadu_si128(reinterpret_cast<const __m128i*>(page + o - 5));
+  const __m128i status = _mm_loadu_si128(reinterpret_cast<const __m128i*>(page + o - 3));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i ok = _mm_cmpeq_epi8(_mm_and_si128(status, _mm_set1_epi8(0x07)), zero);
+  ok = _mm_and_si128(ok, _mm_cmpeq_epi8(
+      _mm_and_si128(info, _mm_set1_epi8(REC_INFO_MIN_REC_FLAG)), zero));
+  const __m128i max_owned = _mm_set1_epi8(PAGE_DIR_SLOT_MAX_N_OWNED);
+  ok = _mm_and_si128(ok, _mm_cmpeq_epi8(
+      _mm_max_epu8(_mm_and_si128(info, _mm_set1_epi8(0x0F)), max_owned), max_owned));
+  return static_cast<unsigned>(_mm_movemask_epi8(ok));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static const uint8_t kLaneBits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                        1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t info = vld1q_u8(page + o - 5);
+  const uint8x16_t status = vld1q_u8(page + o - 3);
+  uint8x16_t ok = vceqq_u8(vandq_u8(status, vdupq_n_u8(0x07)), vdupq_n_u8(0));
+  ok = vandq_u8(ok, vceqq_u8(vandq_u8(info, vdupq_n_u8(REC_INFO_MIN_REC_FLAG)),
+                             vdupq_n_u8(0)));
+  ok = vandq_u8(ok, vcleq_u8(vandq_u8(info, vdupq_n_u8(0x0F)),
+                             vdupq_n_u8(PAGE_DIR_SLOT_MAX_N_OWNED)));
+  const uint8x16_t bits = vandq_u8(ok, vld1q_u8(kLaneBits));
+  return static_cast<unsigned>(vaddv_u8(vget_low_u8(bits))) |
+         (static_cast<unsigned>(vaddv_u8(vget_high_u8(bits))) << 8);
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < 16; i++) {
+    const unsigned char info = page[o + i - 5];
+    if ((page[o + i - 3] & 0x07) == 0 && (info & REC_INFO_MIN_REC_FLAG) == 0 &&
+        (info & 0x0F) <= PAGE_DIR_SLOT_MAX_N_OWNED) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+static bool carve_header_plausible(const unsigned char* page,
+                                   size_t page_size,
+                                   ulint o,
+                                   ulint n_heap)
+{
+  const ulint heap_no = mach_read_from_2(page + o - 4) >> REC_HEAP_NO_SHIFT;
+  if (heap_no < PAGE_HEAP_NO_USER_LOW || heap_no >= n_heap) {
+    return false;
+  }
+  const ulint delta = mach_read_from_2(page + o - REC_NEXT);
+  if (delta == 0) {
+    return true;  // end of the free list
+  }
+  const ulint next = (o + delta) % page_size;
+  return next == PAGE_NEW_SUPREMUM ||
+         (next >= PAGE_NEW_SUPREMUM_END + REC_N_NEW_EXTRA_BYTES &&
+          next < page_size - PAGE_DIR);
+}
+
+// Probe every offset between the supremum and the page directory for a
+// record header that validates against the table and overlaps nothing
+// already found.
+static ulint carve_page_heap(const unsigned char* page,
+                             size_t page_size,
+                             uint64_t page_no,
+                             table_def_t* table,
+                             std::vector<unsigned char>& covered)
+{
+  const ulint n_heap = mach_read_from_2(page + PAGE_HEADER + PAGE_N_HEAP) & 0x7fff;
+  const ulint n_slots = mach_read_from_2(page + PAGE_HEADER + PAGE_N_DIR_SLOTS);
+  const ulint dir_bytes = PAGE_DIR + PAGE_DIR_SLOT_SIZE * n_slots;
+  const ulint lo = PAGE_NEW_SUPREMUM_END + REC_N_NEW_EXTRA_BYTES;
+  // Every index page has the infimum and supremum slots. Fewer means the
+  // header is damaged, and the block loads below would pass the page end.
+  if (n_slots < 2 || page_size < dir_bytes + lo) {
+    return 0;
+  }
+  const ulint hi = page_size - dir_bytes;
+
+  ulint n_carved = 0;
+  for (ulint o = lo; o < hi; o += 16) {
+    // The last block may look at up to 15 origins past hi; they are
+    // dropped below. Its loads end at byte hi + 11, inside the two
+    // directory slots and the page trailer.
+    unsigned mask = carve_candidates16(page, o);
+    while (mask != 0) {
+      const ulint rec_offset = o + static_cast<ulint>(__builtin_ctz(mask));
+      mask &= mask - 1;
+      if (rec_offset >= hi || covered[rec_offset] ||
+          !carve_header_plausible(page, page_size, rec_offset, n_heap)) {
+        continue;
+      }
+      ulint offsets[MAX_TABLE_FIELDS + 2];
+      if (claim_record(page, page_size, rec_offset, table, offsets, covered)) {
+        n_carved++;
+        PARSER_LOG(LOG_LEVEL_TRACE, "  - Carved record at offset %lu (page %llu)\n",
+                   static_cast<unsigned long>(rec_offset),
+                   static_cast<unsigned long long>(page_no));
+        emit_recovered_record(page, page_no, rec_offset, table, offsets);
+      }
+    }
+  }
+  return n_carved;
+}
+
+bool parse_records_on_page(const unsigned char* page,
                            size_t page_size,
                            uint64_t page_no,
                            const parser_context_t* ctx)
 {
   // 1) Check if this page belongs to the selected index
   if (!is_target_index(page, ctx)) {
-    return; // Not selected index => skip
+    return false; // Not selected index => skip
   }
 
   // 2) Check if it’s a LEAF page
   ulint page_level = mach_read_from_2(page + PAGE_HEADER + PAGE_LEVEL);
   if (page_level != 0) {
     // Non-leaf => skip
-    return;
+    return false;
   }
 
-  const std::string index_name = ctx ? ctx->target_index_name : std::string();
-  std::cout << "Page " << page_no
-            << " is index '" << index_name
-            << "' leaf. Parsing records.\n";
+  StageTimer timer(STAGE_PARSE);
+  // Rows go through the calling thread's row context so parallel workers
+  // can buffer them per chunk.
+  table_def_t* table = current_row_table();
+
+  PARSER_LOG(LOG_LEVEL_DEBUG, "Page %llu is index '%s' leaf. Parsing records.\n",
+             static_cast<unsigned long long>(page_no),
+             ctx ? ctx->target_index_name.c_str() : "");
 
   // 3) Check if COMPACT or REDUNDANT
   bool is_compact = page_is_comp(page);
   if (!is_compact) {
     // Skip old REDUNDANT format (not supported).
-    return;
+    return false;
   }
 
-  const bool include_deleted = false;
+  // --where on the leading key column: records are in key order, so rows
+  // below the range are passed over unparsed and the first one above it
+  // ends the page.
+  const RowOutputOptions& row_opts = current_row_worker_context().output;
+  const KeyRange* leading = row_opts.where.range_for(0);
+  // --recover-deleted: the chain walk claims every record and prints only
+  // the delete-marked ones, then the free list and the heap are searched.
+  // Those are in no key order, so --where never ends the page (or scan).
+  const bool recover = row_opts.recover_deleted;
+  thread_local std::vector<unsigned char> covered;
+  if (recover) {
+    covered.assign(page_size, 0);
+  }
 
   // 4) Loop from infimum -> supremum using COMPACT offsets
   const ulint inf_offset = PAGE_NEW_INFIMUM;
   ulint n_records  = 0;
+  ulint n_valid    = 0;
   ulint n_deleted  = 0;
   ulint n_invalid  = 0;
+  ulint n_filtered = 0;
+  ulint n_recovered = 0;
+  ulint n_carved = 0;
+  bool past_range = false;
   ulint rec_offset = inf_offset;
   ulint steps = 0;
   ulint max_steps = static_cast<ulint>(
@@ -1723,16 +2268,47 @@ void parse_records_on_page(const unsigned char* page,
       break;
     }
 
-    if (status == REC_STATUS_ORDINARY) {
+    bool in_range = true;
+    if (status == REC_STATUS_ORDINARY && leading) {
+      uint64_t key = 0;
+      if (!record_leading_key(page + rec_offset, table, *leading,
+                              row_opts.raw_integers, &key)) {
+        in_range = false;  // NULL
+      } else if (key > leading->hi) {
+        if (!recover) {
+          past_range = true;
+          break;
+        }
+        in_range = false;  // still claimed, so the heap scan skips it
+      } else if (key < leading->lo) {
+        in_range = false;
+      }
+      if (!in_range) {
+        n_filtered++;
+      }
+    }
+
+    if (status == REC_STATUS_ORDINARY && recover) {
       const bool deleted = rec_get_deleted_flag(rec, true);
-      if (!deleted || include_deleted) {
+      ulint offsets[MAX_TABLE_FIELDS + 2];
+      if (claim_record(page, page_size, rec_offset, table, offsets, covered)) {
+        if (deleted && in_range) {
+          n_recovered++;
+          emit_recovered_record(page, page_no, rec_offset, table, offsets);
+        }
+      } else if (deleted) {
+        n_invalid++;
+      }
+    } else if (status == REC_STATUS_ORDINARY && in_range) {
+      const bool deleted = rec_get_deleted_flag(rec, true);
+      if (!deleted) {
         n_records++;
-        std::cout << "  - Found record at offset "
-                  << rec_offset << " (page " << page_no << ")\n";
+        PARSER_LOG(LOG_LEVEL_TRACE, "  - Found record at offset %lu (page %llu)\n",
+                   static_cast<unsigned long>(rec_offset),
+                   static_cast<unsigned long long>(page_no));
 
         // (A) We'll do the undrop approach: check_for_a_record() => if valid => process_ibrec()
         ulint offsets[MAX_TABLE_FIELDS + 2];
-        table_def_t* table = &table_definitions[0];
 
         bool valid = check_for_a_record(
             (page_t*)page,
@@ -1741,7 +2317,8 @@ void parse_records_on_page(const unsigned char* page,
             offsets);
 
         if (valid) {
-          if (parser_debug_enabled()) {
+          n_valid++;
+          if (log_enabled(LOG_LEVEL_TRACE)) {
             debug_print_compact_row(page, rec, table, offsets);
           }
           bool hex_output = false;
@@ -1776,13 +2353,35 @@ void parse_records_on_page(const unsigned char* page,
     steps++;
   }
 
-  std::cout << "Leaf Page " << page_no
-            << " had " << n_records << " user records";
-  if (n_deleted > 0 || n_invalid > 0) {
-    std::cout << " (" << n_deleted << " deleted, "
-              << n_invalid << " invalid)";
-  }
-  std::cout << ".\n";
+  if (recover) {
+    n_recovered += recover_free_list(page, page_size, page_no, table, covered);
+    n_carved = carve_page_heap(page, page_size, page_no, table, covered);
+    PARSER_LOG(LOG_LEVEL_INFO,
+               "Leaf Page %llu: recovered %lu delete-marked or freed records, "
+               "carved %lu.\n",
+               static_cast<unsigned long long>(page_no),
+               static_cast<unsigned long>(n_recovered),
+               static_cast<unsigned long>(n_carved));
+  } else {
+    PARSER_LOG(LOG_LEVEL_INFO,
+               "Leaf Page %llu had %lu user records (%lu deleted, %lu invalid, "
+               "%lu outside --where).\n",
+               static_cast<unsigned long long>(page_no),
+               static_cast<unsigned long>(n_records),
+               static_cast<unsigned long>(n_deleted),
+               static_cast<unsigned long>(n_invalid),
+               static_cast<unsigned long>(n_filtered));
+  }
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->leaf_pages++;
+    stats->records_valid += n_valid;
+    stats->records_invalid += n_invalid;
+    stats->records_deleted += n_deleted;
+    stats->records_filtered += n_filtered;
+    stats->records_recovered += n_recovered;
+    stats->records_carved += n_carved;
+  }
+  return past_range;
 }
 
 // ============================================================================
@@ -1830,18 +2429,23 @@ bool extract_record_data(const page_t* page,
                          uint64_t page_no,
                          ulint rec_offset,
                          bool deleted,
-                         parsed_row_t* out_row) {
+                         parsed_row_t* out_row,
+                         const std::vector<bool>* column_mask) {
   if (!out_row || !table || !rec || !offsets) {
     return false;
   }
 
-  memset(out_row, 0, sizeof(*out_row));
+  // Only the header: every column up to column_count is filled below, and
+  // zeroing all MAX_TABLE_FIELDS columns would cost ~270 KB per record.
   out_row->page_no = page_no;
   out_row->rec_offset = rec_offset;
   out_row->deleted = deleted;
   out_row->column_count = 0;
 
   for (ulint i = 0; i < (ulint)table->fields_count && i < MAX_TABLE_FIELDS; i++) {
+    if (column_mask && (i >= column_mask->size() || !(*column_mask)[i])) {
+      continue;
+    }
     parsed_column_t& col = out_row->columns[out_row->column_count];
     const field_def_t& field = table->fields[i];
 
@@ -2133,7 +2737,8 @@ int parse_records_with_callback(const unsigned char* page,
                                 table_def_t* table,
                                 const parser_context_t* ctx,
                                 record_callback_t callback,
-                                void* user_data) {
+                                void* user_data,
+                                const std::vector<bool>* column_mask) {
   if (!page || !table || !callback) {
     return 0;
   }
@@ -2166,6 +2771,15 @@ int parse_records_with_callback(const unsigned char* page,
     max_steps = n_recs + 2;
   }
 
+  StageTimer timer(STAGE_PARSE);
+  ParseStats* stats = current_parse_stats();
+  if (stats) {
+    stats->leaf_pages++;
+  }
+
+  // One row buffer for the whole page; extract_record_data() refills it.
+  parsed_row_t row;
+
   while (steps < max_steps) {
     const rec_t* rec = reinterpret_cast<const rec_t*>(page + rec_offset);
     const ulint status = rec_get_status(rec);
@@ -2179,11 +2793,20 @@ int parse_records_with_callback(const unsigned char* page,
       // Validate record
       ulint offsets[MAX_TABLE_FIELDS + 2];
       bool valid = check_for_a_record((page_t*)page, (rec_t*)rec, table, offsets);
+      if (stats) {
+        if (!valid) {
+          stats->records_invalid++;
+        } else if (deleted) {
+          stats->records_deleted++;
+        } else {
+          stats->records_valid++;
+        }
+      }
 
       if (valid) {
-        parsed_row_t row;
         if (extract_record_data((page_t*)page, rec, table, offsets,
-                                page_no, rec_offset, deleted, &row)) {
+                                page_no, rec_offset, deleted, &row,
+                                column_mask)) {
           // Call the callback
           if (!callback(&row, user_data)) {
             // Callback returned false - stop iteration
@@ -11,6 +11,7 @@
 #include <vector>
 #include "page0page.h"
 #include "tables_dict.h"
+#include "row_filter.h"
 
 /** A minimal column-definition struct */
 struct MyColumnDef {
@@ -59,18 +60,60 @@ struct parser_context_t {
   parser_context_t();
 };
 
-void parse_records_on_page(const unsigned char* page,
+// Returns true when a --where range on the leading key column ended the
+// page early: this leaf, and every leaf after it, sorts above the range.
+bool parse_records_on_page(const unsigned char* page,
                            size_t page_size,
                            uint64_t page_no,
                            const parser_context_t* ctx);
 
-int discover_target_index_id(int fd, parser_context_t* ctx);
+class TablespaceMap;
+struct PageCipher;
+
+// Pages come from map when given (--mmap), otherwise from pread() on fd;
+// cipher decrypts them first for encrypted tablespaces.
+int discover_target_index_id(int fd, parser_context_t* ctx,
+                             const TablespaceMap* map = nullptr,
+                             const PageCipher* cipher = nullptr);
+
+// B-tree descent helpers for --scan=btree.
+bool selected_index_is_clustered(const parser_context_t* ctx);
+// Leading fields of table that make up the index key: the PK columns of
+// the clustered index, every column of a secondary index.
+ulint index_key_fields(const table_def_t* table, bool clustered);
+// Child page of the first node pointer on a non-leaf page, or FIL_NULL.
+page_no_t first_node_ptr_child(const unsigned char* page,
+                               size_t page_size,
+                               const table_def_t* table,
+                               bool clustered);
+
+// --where on the index's first column (range.field == 0): the child of the
+// last node pointer whose key sorts below range.lo, i.e. the leftmost
+// subtree that can hold a matching row. FIL_NULL on a malformed page.
+page_no_t range_node_ptr_child(const unsigned char* page,
+                               size_t page_size,
+                               const table_def_t* table,
+                               bool clustered,
+                               const KeyRange& range,
+                               bool raw_integers);
+// Ordered key of field 0 of a COMPACT record (leaf or node pointer) for
+// range; false when the value is NULL or range is not on field 0.
+bool record_leading_key(const unsigned char* rec,
+                        const table_def_t* table,
+                        const KeyRange& range,
+                        bool raw_integers,
+                        uint64_t* key);
 
 bool is_target_index(const unsigned char* page, const parser_context_t* ctx);
 
 int load_ib2sdi_table_columns(const char* json_path,
                               std::string& table_name,
                               parser_context_t* ctx);
+// The same from one Table SDI object ({"dd_object_type": "Table", ...}),
+// e.g. a record read from the tablespace by read_tablespace_sdi().
+int load_sdi_table_object(const char* json, size_t len,
+                          std::string& table_name,
+                          parser_context_t* ctx);
 
 int build_table_def_from_json(table_def_t* table,
                               const char* tbl_name,
@@ -84,8 +127,6 @@ const std::string& selected_index_name(const parser_context_t* ctx);
 bool target_index_is_set(const parser_context_t* ctx);
 void set_target_index_id_from_value(parser_context_t* ctx, uint64_t id);
 
-bool parser_debug_enabled();
-
 bool format_innodb_datetime(const unsigned char* ptr, ulint len,
                             unsigned int dec, std::string& out);
 bool format_innodb_timestamp(const unsigned char* ptr, ulint len,
@@ -94,6 +135,14 @@ bool format_innodb_date(const unsigned char* ptr, ulint len, std::string& out);
 bool format_innodb_time(const unsigned char* ptr, ulint len,
                         unsigned int dec, std::string& out);
 
+// Native values for typed output: days / microseconds since the Unix epoch
+// (DATETIME as if it were UTC). false for zero dates and short fields.
+bool decode_innodb_date(const unsigned char* ptr, ulint len, int32_t* days);
+bool decode_innodb_datetime(const unsigned char* ptr, ulint len,
+                            unsigned int dec, int64_t* micros);
+bool decode_innodb_timestamp(const unsigned char* ptr, ulint len,
+                             unsigned int dec, int64_t* micros);
+
 void debug_print_table_def(const table_def_t *table);
 
 void debug_print_compact_row(const page_t* page,
@@ -142,14 +191,17 @@ struct parsed_row_t {
 typedef bool (*record_callback_t)(const parsed_row_t* row, void* user_data);
 
 // Parse records on a page with callback
-// Returns number of valid records parsed
+// Returns number of valid records parsed. With column_mask (indexed like
+// table->fields), rows carry only the selected columns; the others are
+// skipped over without being decoded.
 int parse_records_with_callback(const unsigned char* page,
                                 size_t page_size,
                                 uint64_t page_no,
                                 table_def_t* table,
                                 const parser_context_t* ctx,
                                 record_callback_t callback,
-                                void* user_data);
+                                void* user_data,
+                                const std::vector<bool>* column_mask = nullptr);
 
 // Extract a single record's data
 bool extract_record_data(const page_t* page,
@@ -159,4 +211,5 @@ bool extract_record_data(const page_t* page,
                          uint64_t page_no,
                          ulint rec_offset,
                          bool deleted,
-                         parsed_row_t* out_row);
+                         parsed_row_t* out_row,
+                         const std::vector<bool>* column_mask = nullptr);
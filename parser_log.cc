@@ -0,0 +1,129 @@
+/**
+ * parser_log.cc
+ *
+ * Per-thread buffered, leveled diagnostics (see parser_log.h).
+ */
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "parser_log.h"
+
+// Buffered messages are written out once this much has accumulated.
+static const size_t kLogBufferBytes = 32 * 1024;
+
+static int initial_log_level() {
+  const char* level = std::getenv("IB_PARSER_LOG_LEVEL");
+  LogLevel parsed;
+  if (level && parse_log_level(level, &parsed)) {
+    return parsed;
+  }
+  const char* debug = std::getenv("IB_PARSER_DEBUG");
+  if (debug && *debug && std::strcmp(debug, "0") != 0) {
+    return LOG_LEVEL_DEBUG;
+  }
+  return LOG_LEVEL_WARN;
+}
+
+std::atomic<int> g_parser_log_level{initial_log_level()};
+
+namespace {
+
+struct ThreadLog {
+  std::string buf;
+  FILE* stream = nullptr;  // nullptr => stderr
+
+  void flush() {
+    if (!buf.empty()) {
+      std::fwrite(buf.data(), 1, buf.size(), stream ? stream : stderr);
+      buf.clear();
+    }
+  }
+  ~ThreadLog() { flush(); }
+};
+
+thread_local ThreadLog t_log;
+
+}  // namespace
+
+void set_log_level(LogLevel level) {
+  g_parser_log_level.store(level, std::memory_order_relaxed);
+}
+
+LogLevel log_level() {
+  return static_cast<LogLevel>(g_parser_log_level.load(std::memory_order_relaxed));
+}
+
+static const char* const kLevelNames[] = {"error", "warn", "info", "debug", "trace"};
+
+bool parse_log_level(const char* name, LogLevel* out) {
+  for (int i = LOG_LEVEL_ERROR; i <= LOG_LEVEL_TRACE; i++) {
+    if (std::strcmp(name, kLevelNames[i]) == 0) {
+      *out = static_cast<LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* log_level_name(LogLevel level) {
+  return (level >= LOG_LEVEL_ERROR && level <= LOG_LEVEL_TRACE) ? kLevelNames[level]
+                                                                 : "?";
+}
+
+void log_write(LogLevel level, const char* fmt, ...) {
+  char small[512];
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = std::vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) {
+    return;
+  }
+  if (static_cast<size_t>(n) < sizeof(small)) {
+    t_log.buf.append(small, static_cast<size_t>(n));
+  } else {
+    const size_t start = t_log.buf.size();
+    t_log.buf.resize(start + static_cast<size_t>(n) + 1);
+    va_start(ap, fmt);
+    std::vsnprintf(&t_log.buf[start], static_cast<size_t>(n) + 1, fmt, ap);
+    va_end(ap);
+    t_log.buf.resize(start + static_cast<size_t>(n));
+  }
+  // Problems go out at once, in order behind whatever led up to them.
+  if (level <= LOG_LEVEL_WARN || t_log.buf.size() >= kLogBufferBytes) {
+    t_log.flush();
+  }
+}
+
+void log_flush() {
+  t_log.flush();
+}
+
+LogStreamScope::LogStreamScope(FILE* stream) : prev_(t_log.stream) {
+  t_log.flush();
+  t_log.stream = stream;
+}
+
+LogStreamScope::~LogStreamScope() {
+  t_log.flush();
+  t_log.stream = prev_;
+}
+
+bool LogRateLimit::admit(uint64_t* dropped_before) {
+  const uint64_t now = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count()) + 1;
+  uint64_t seen = window.load(std::memory_order_relaxed);
+  if (seen != now && window.compare_exchange_strong(seen, now)) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  if (count.fetch_add(1, std::memory_order_relaxed) < kLogBurst) {
+    *dropped_before = dropped.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
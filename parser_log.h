@@ -0,0 +1,91 @@
+#ifndef PARSER_LOG_H
+#define PARSER_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Leveled diagnostics for the parse path (--log-level, IB_PARSER_DEBUG).
+ *
+ * PARSER_LOG() checks the level before formatting anything, so disabled
+ * messages cost one relaxed load. Enabled ones are formatted into a
+ * per-thread buffer and written to the thread's log stream (stderr unless
+ * bound with LogStreamScope) when it fills, on log_flush(), when the stream
+ * changes, or right away for warnings and errors. PARSER_LOG_LIMITED()
+ * additionally caps each call site at kLogBurst messages per second and
+ * reports how many it dropped. Rows never share the log stream.
+ */
+enum LogLevel {
+  LOG_LEVEL_ERROR = 0,
+  LOG_LEVEL_WARN,   // default
+  LOG_LEVEL_INFO,   // per-page summaries
+  LOG_LEVEL_DEBUG,  // decisions and rejected records (IB_PARSER_DEBUG=1)
+  LOG_LEVEL_TRACE,  // every record and page
+};
+
+extern std::atomic<int> g_parser_log_level;
+
+inline bool log_enabled(LogLevel level) {
+  return static_cast<int>(level) <= g_parser_log_level.load(std::memory_order_relaxed);
+}
+
+void set_log_level(LogLevel level);
+LogLevel log_level();
+// "error", "warn", "info", "debug" or "trace"; false for anything else.
+bool parse_log_level(const char* name, LogLevel* out);
+const char* log_level_name(LogLevel level);
+
+void log_write(LogLevel level, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+// Write the calling thread's buffered messages to its log stream.
+void log_flush();
+
+/** Send the calling thread's messages to stream for this scope. */
+class LogStreamScope {
+ public:
+  explicit LogStreamScope(FILE* stream);
+  ~LogStreamScope();
+  LogStreamScope(const LogStreamScope&) = delete;
+  LogStreamScope& operator=(const LogStreamScope&) = delete;
+
+ private:
+  FILE* prev_;
+};
+
+// Messages per call site per second before PARSER_LOG_LIMITED drops them.
+const uint32_t kLogBurst = 10;
+
+/** One-second message window of a PARSER_LOG_LIMITED call site. */
+struct LogRateLimit {
+  std::atomic<uint64_t> window{0};
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint64_t> dropped{0};
+  // True if this message may go out; *dropped_before is set to the number
+  // suppressed since the last one that did.
+  bool admit(uint64_t* dropped_before);
+};
+
+#define PARSER_LOG(level, ...)        \
+  do {                                \
+    if (log_enabled(level)) {         \
+      log_write(level, __VA_ARGS__);  \
+    }                                 \
+  } while (0)
+
+#define PARSER_LOG_LIMITED(level, ...)                                   \
+  do {                                                                   \
+    if (log_enabled(level)) {                                            \
+      static LogRateLimit parser_log_site_;                              \
+      uint64_t parser_log_dropped_ = 0;                                  \
+      if (parser_log_site_.admit(&parser_log_dropped_)) {                \
+        if (parser_log_dropped_ > 0) {                                   \
+          log_write(level, "(%llu similar messages suppressed)\n",       \
+                    static_cast<unsigned long long>(parser_log_dropped_)); \
+        }                                                                \
+        log_write(level, __VA_ARGS__);                                   \
+      }                                                                  \
+    }                                                                    \
+  } while (0)
+
+#endif  // PARSER_LOG_H
@@ -0,0 +1,39 @@
+/**
+ * row_arena.cc
+ *
+ * Per-row bump allocator (see row_arena.h).
+ */
+#include "row_arena.h"
+
+void* RowArena::alloc_slow(size_t n, size_t align) {
+  // Blocks come from new[], so offsets aligned to align are addresses too.
+  size_t size = blocks_.empty() ? kBlockSize : blocks_.back().size * 2;
+  while (size < n) {
+    size *= 2;
+  }
+  Block block;
+  block.data.reset(new char[size]);
+  block.size = size;
+  blocks_.push_back(std::move(block));
+  pos_ = 0;
+  return alloc(n, align);
+}
+
+void RowArena::reset() {
+  pos_ = 0;
+  if (blocks_.size() <= 1 && (blocks_.empty() || blocks_[0].size <= kMaxKeptBlock)) {
+    return;
+  }
+  // Blocks double, so the last one is the largest.
+  Block kept;
+  for (size_t i = blocks_.size(); i-- > 0;) {
+    if (blocks_[i].size <= kMaxKeptBlock) {
+      kept = std::move(blocks_[i]);
+      break;
+    }
+  }
+  blocks_.clear();
+  if (kept.data) {
+    blocks_.push_back(std::move(kept));
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef ROW_ARENA_H
+#define ROW_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Bump allocator for the temporaries of one row: decimal digit buffers,
+ * LOB values read in whole before they are formatted. Each parse worker
+ * owns one (RowWorkerContext::arena) and process_ibrec() resets it when the
+ * row is done, so a temporary costs a pointer bump instead of a malloc()
+ * and free() per column.
+ *
+ * Nothing is freed on its own. reset() keeps the largest block, up to
+ * kMaxKeptBlock, for the next row and frees the rest, so one outsized LOB
+ * does not pin its memory for the rest of the run.
+ */
+class RowArena {
+ public:
+  static const size_t kBlockSize = 64 * 1024;
+  static const size_t kMaxKeptBlock = 4 * 1024 * 1024;
+
+  RowArena() = default;
+  RowArena(const RowArena&) = delete;
+  RowArena& operator=(const RowArena&) = delete;
+
+  /**
+   * n bytes aligned to align (a power of two, at most max_align_t's);
+   * valid until reset().
+   */
+  void* alloc(size_t n, size_t align = alignof(std::max_align_t)) {
+    if (!blocks_.empty()) {
+      const size_t at = (pos_ + align - 1) & ~(align - 1);
+      if (at + n <= blocks_.back().size) {
+        pos_ = at + n;
+        return blocks_.back().data.get() + at;
+      }
+    }
+    return alloc_slow(n, align);
+  }
+
+  template <typename T>
+  T* alloc_array(size_t n) {
+    return static_cast<T*>(alloc(n * sizeof(T), alignof(T)));
+  }
+
+  void reset();
+
+  /** Frees everything allocated in the enclosing scope when it ends. */
+  class Scope {
+   public:
+    explicit Scope(RowArena& arena) : arena_(arena) {}
+    ~Scope() { arena_.reset(); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    RowArena& arena_;
+  };
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+
+  void* alloc_slow(size_t n, size_t align);
+
+  std::vector<Block> blocks_;  // allocations go to the last one
+  size_t pos_ = 0;             // bytes used in blocks_.back()
+};
+
+#endif  // ROW_ARENA_H
@@ -0,0 +1,312 @@
+/**
+ * row_filter.cc
+ *
+ * Parser and key helpers for --where (see row_filter.h).
+ */
+#include "row_filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const uint64_t kSignFlip = 1ULL << 63;
+
+enum TokenKind { TOK_END, TOK_WORD, TOK_NUMBER, TOK_OP };
+
+struct Token {
+  TokenKind kind = TOK_END;
+  std::string text;
+};
+
+bool tokenize(const std::string& expr, std::vector<Token>* tokens, std::string* err) {
+  size_t i = 0;
+  while (i < expr.size()) {
+    const unsigned char c = static_cast<unsigned char>(expr[i]);
+    if (std::isspace(c)) {
+      i++;
+      continue;
+    }
+    Token tok;
+    if (c == '`') {
+      const size_t close = expr.find('`', i + 1);
+      if (close == std::string::npos) {
+        *err = "unterminated `quoted` column name";
+        return false;
+      }
+      tok.kind = TOK_WORD;
+      tok.text = expr.substr(i + 1, close - i - 1);
+      i = close + 1;
+    } else if (std::isalpha(c) || c == '_' || c == '$') {
+      size_t end = i;
+      while (end < expr.size() &&
+             (std::isalnum(static_cast<unsigned char>(expr[end])) ||
+              expr[end] == '_' || expr[end] == '$')) {
+        end++;
+      }
+      tok.kind = TOK_WORD;
+      tok.text = expr.substr(i, end - i);
+      i = end;
+    } else if (std::isdigit(c) || c == '-' || c == '+') {
+      size_t end = i + 1;
+      while (end < expr.size() && std::isdigit(static_cast<unsigned char>(expr[end]))) {
+        end++;
+      }
+      tok.kind = TOK_NUMBER;
+      tok.text = expr.substr(i, end - i);
+      i = end;
+    } else if (c == '=' || c == '<' || c == '>') {
+      size_t len = 1;
+      if (i + 1 < expr.size() && expr[i + 1] == '=' && c != '=') {
+        len = 2;
+      }
+      tok.kind = TOK_OP;
+      tok.text = expr.substr(i, len);
+      i += len;
+    } else {
+      *err = std::string("unexpected character '") + expr[i] + "'";
+      return false;
+    }
+    tokens->push_back(tok);
+  }
+  tokens->push_back(Token());
+  return true;
+}
+
+bool is_keyword(const Token& tok, const char* word) {
+  if (tok.kind != TOK_WORD || tok.text.size() != std::strlen(word)) {
+    return false;
+  }
+  for (size_t i = 0; i < tok.text.size(); i++) {
+    if (std::toupper(static_cast<unsigned char>(tok.text[i])) != word[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Literal as the column's ordered key.
+bool parse_key(const Token& tok, const field_def_t& fld, bool is_unsigned,
+               uint64_t* key, std::string* err) {
+  if (tok.kind != TOK_NUMBER || tok.text == "-" || tok.text == "+") {
+    *err = std::string("expected an integer for column '") + fld.name + "'";
+    return false;
+  }
+  errno = 0;
+  char* end = nullptr;
+  if (is_unsigned) {
+    if (tok.text[0] == '-') {
+      *err = "negative value " + tok.text + " for unsigned column '" + fld.name + "'";
+      return false;
+    }
+    const unsigned long long v = std::strtoull(tok.text.c_str(), &end, 10);
+    if (errno == ERANGE) {
+      *err = "value " + tok.text + " out of range";
+      return false;
+    }
+    *key = static_cast<uint64_t>(v);
+  } else {
+    const long long v = std::strtoll(tok.text.c_str(), &end, 10);
+    if (errno == ERANGE) {
+      *err = "value " + tok.text + " out of range";
+      return false;
+    }
+    *key = static_cast<uint64_t>(v) ^ kSignFlip;
+  }
+  return true;
+}
+
+void raise_lo(KeyRange* r, uint64_t key) { r->lo = std::max(r->lo, key); }
+void lower_hi(KeyRange* r, uint64_t key) { r->hi = std::min(r->hi, key); }
+void make_empty(KeyRange* r) {
+  r->lo = 1;
+  r->hi = 0;
+}
+
+std::string key_text(const KeyRange& r, uint64_t key) {
+  if (r.is_unsigned) {
+    return std::to_string(key);
+  }
+  return std::to_string(static_cast<int64_t>(key ^ kSignFlip));
+}
+
+}  // namespace
+
+bool RowFilter::unsatisfiable() const {
+  for (const KeyRange& r : ranges) {
+    if (r.lo > r.hi) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const KeyRange* RowFilter::range_for(int field) const {
+  for (const KeyRange& r : ranges) {
+    if (r.field == field) {
+      return &r;
+    }
+  }
+  return nullptr;
+}
+
+bool parse_row_filter(const table_def_t* table, const std::string& expr,
+                      RowFilter* filter, std::string* err) {
+  std::string local_err;
+  if (err == nullptr) {
+    err = &local_err;
+  }
+  filter->ranges.clear();
+  std::vector<Token> tokens;
+  if (!tokenize(expr, &tokens, err)) {
+    return false;
+  }
+
+  size_t pos = 0;
+  while (true) {
+    const Token& name = tokens[pos++];
+    if (name.kind != TOK_WORD) {
+      *err = "expected a column name";
+      return false;
+    }
+    int field = -1;
+    for (int i = 0; i < table->fields_count; i++) {
+      if (table->fields[i].name && name.text == table->fields[i].name) {
+        field = i;
+        break;
+      }
+    }
+    if (field < 0) {
+      *err = "unknown column '" + name.text + "'";
+      return false;
+    }
+    const field_def_t& fld = table->fields[field];
+    // Integers (and the fixed-width internal columns such as DB_ROW_ID)
+    // are stored so that memcmp order is value order; nothing else is.
+    const bool integer = fld.type == FT_INT || fld.type == FT_UINT ||
+                         fld.type == FT_INTERNAL;
+    if (!integer || fld.fixed_length < 1 || fld.fixed_length > 8) {
+      *err = "column '" + name.text + "' is not an integer column";
+      return false;
+    }
+    const bool is_unsigned = fld.type != FT_INT;
+
+    KeyRange* range = nullptr;
+    for (KeyRange& r : filter->ranges) {
+      if (r.field == field) {
+        range = &r;
+      }
+    }
+    if (range == nullptr) {
+      filter->ranges.push_back(KeyRange());
+      range = &filter->ranges.back();
+      range->field = field;
+      range->is_unsigned = is_unsigned;
+    }
+
+    const Token& op = tokens[pos++];
+    uint64_t key = 0;
+    if (is_keyword(op, "BETWEEN")) {
+      uint64_t hi = 0;
+      if (!parse_key(tokens[pos++], fld, is_unsigned, &key, err)) {
+        return false;
+      }
+      if (!is_keyword(tokens[pos++], "AND")) {
+        *err = "expected AND in BETWEEN";
+        return false;
+      }
+      if (!parse_key(tokens[pos++], fld, is_unsigned, &hi, err)) {
+        return false;
+      }
+      raise_lo(range, key);
+      lower_hi(range, hi);
+    } else if (op.kind == TOK_OP) {
+      if (!parse_key(tokens[pos++], fld, is_unsigned, &key, err)) {
+        return false;
+      }
+      if (op.text == "=") {
+        raise_lo(range, key);
+        lower_hi(range, key);
+      } else if (op.text == ">=") {
+        raise_lo(range, key);
+      } else if (op.text == "<=") {
+        lower_hi(range, key);
+      } else if (op.text == ">") {
+        if (key == UINT64_MAX) {
+          make_empty(range);
+        } else {
+          raise_lo(range, key + 1);
+        }
+      } else {  // "<"
+        if (key == 0) {
+          make_empty(range);
+        } else {
+          lower_hi(range, key - 1);
+        }
+      }
+    } else {
+      *err = "expected =, <, <=, >, >= or BETWEEN after '" + name.text + "'";
+      return false;
+    }
+
+    const Token& next = tokens[pos];
+    if (next.kind == TOK_END) {
+      break;
+    }
+    if (!is_keyword(next, "AND")) {
+      *err = "expected AND between conditions";
+      return false;
+    }
+    pos++;
+  }
+  return true;
+}
+
+uint64_t key_range_value(const KeyRange& range, const unsigned char* ptr,
+                         size_t len, bool raw_integers) {
+  if (len == 0 || len > 8) {
+    return 0;
+  }
+  uint64_t val = 0;
+  for (size_t i = 0; i < len; i++) {
+    val = (val << 8) | ptr[i];
+  }
+  if (range.is_unsigned) {
+    return val;
+  }
+  const uint64_t sign_bit = 1ULL << (len * 8 - 1);
+  if (!raw_integers) {
+    val ^= sign_bit;
+  }
+  if ((val & sign_bit) && len < 8) {
+    val |= ~0ULL << (len * 8);
+  }
+  return val ^ kSignFlip;
+}
+
+std::string describe_row_filter(const table_def_t* table, const RowFilter& filter) {
+  std::string out;
+  for (const KeyRange& r : filter.ranges) {
+    const std::string name = table->fields[r.field].name;
+    const bool has_lo = r.lo != 0;
+    const bool has_hi = r.hi != UINT64_MAX;
+    if (!out.empty()) {
+      out += " AND ";
+    }
+    if (r.lo > r.hi) {
+      out += name + " in (empty)";
+    } else if (has_lo && has_hi) {
+      out += name + " in [" + key_text(r, r.lo) + ", " + key_text(r, r.hi) + "]";
+    } else if (has_lo) {
+      out += name + " >= " + key_text(r, r.lo);
+    } else if (has_hi) {
+      out += name + " <= " + key_text(r, r.hi);
+    } else {
+      out += name + " IS NOT NULL";
+    }
+  }
+  return out;
+}
@@ -0,0 +1,62 @@
+#ifndef ROW_FILTER_H
+#define ROW_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tables_dict.h"
+
+/**
+ * --where predicates for mode 3, evaluated on the stored key bytes before
+ * a row is decoded or formatted.
+ *
+ * The grammar is a conjunction of comparisons on integer columns:
+ *
+ *   id BETWEEN 100 AND 200
+ *   id >= 100 AND id < 200 AND k = 7
+ *
+ * (=, <, <=, >, >=; column names may be `quoted`). Every comparison becomes
+ * an inclusive range on an order-preserving 64-bit key, with all ranges on
+ * the same column intersected. InnoDB stores integers big-endian with the
+ * sign bit flipped, so this key sorts exactly like the B-tree does and a
+ * range on the index's first column can prune node pointers and stop leaf
+ * scans early. NULL never matches.
+ */
+struct KeyRange {
+  int field = -1;            // table_def_t field index
+  bool is_unsigned = false;
+  uint64_t lo = 0;           // inclusive bounds on the ordered key
+  uint64_t hi = UINT64_MAX;
+};
+
+struct RowFilter {
+  std::vector<KeyRange> ranges;  // all must hold
+
+  bool empty() const { return ranges.empty(); }
+  /** Some range is empty, so no row can match. */
+  bool unsatisfiable() const;
+  /** The range on field, or nullptr when field is unconstrained. */
+  const KeyRange* range_for(int field) const;
+};
+
+/** Parse expr against table; false with *err describing the problem. */
+bool parse_row_filter(const table_def_t* table, const std::string& expr,
+                      RowFilter* filter, std::string* err);
+
+/**
+ * Ordered key of an integer column as stored in a record (len 1..8).
+ * raw_integers matches --raw-integers: plain two's complement, no sign flip.
+ */
+uint64_t key_range_value(const KeyRange& range, const unsigned char* ptr,
+                         size_t len, bool raw_integers);
+
+inline bool key_range_contains(const KeyRange& range, uint64_t key) {
+  return key >= range.lo && key <= range.hi;
+}
+
+/** "id in [100, 200]" style description for logs. */
+std::string describe_row_filter(const table_def_t* table, const RowFilter& filter);
+
+#endif  // ROW_FILTER_H
@@ -0,0 +1,273 @@
+/**
+ * row_output_sink.cc
+ *
+ * Buffered row writer used by process_ibrec(). The escaping helpers scan
+ * 16 bytes at a time (SSE2 / NEON) for the few bytes that need work and
+ * copy everything else in bulk.
+ */
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "row_output_sink.h"
+#include "output_file.h"
+#include "parse_stats.h"
+
+RowOutputSink::~RowOutputSink() {
+  flush();
+}
+
+void RowOutputSink::grow(size_t need) {
+  size_t cap = cap_ ? cap_ : 64 * 1024;
+  while (cap < need) {
+    cap *= 2;
+  }
+  std::unique_ptr<char[]> next(new char[cap]);
+  if (len_ > 0) {
+    std::memcpy(next.get(), buf_.get(), len_);
+  }
+  buf_.swap(next);
+  cap_ = cap;
+}
+
+void RowOutputSink::bind(FILE* out, bool direct, OutputFileWriter* rows) {
+  direct = direct && out != nullptr && fileno(out) >= 0;
+  if (out == out_ && direct == direct_ && rows == rows_) {
+    return;
+  }
+  flush();
+  out_ = out;
+  direct_ = direct;
+  rows_ = rows;
+}
+
+bool RowOutputSink::flush() {
+  if (len_ == 0 || out_ == nullptr) {
+    len_ = 0;
+    row_ends_.clear();
+    return true;
+  }
+  StageTimer timer(STAGE_WRITE);
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->bytes_written += len_;
+  }
+  bool ok = true;
+  if (direct_) {
+    // Anything printed through stdio (the header) must land first.
+    std::fflush(out_);
+    const int fd = fileno(out_);
+    const char* p = buf_.get();
+    size_t left = len_;
+    while (left > 0) {
+      const ssize_t wr = ::write(fd, p, left);
+      if (wr < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::perror("write");
+        ok = false;
+        break;
+      }
+      p += wr;
+      left -= static_cast<size_t>(wr);
+    }
+  } else if (rows_) {
+    ok = rows_->write_rows(buf_.get(), len_, row_ends_);
+    row_ends_.clear();
+  } else {
+    ok = std::fwrite(buf_.get(), 1, len_, out_) == len_;
+  }
+  len_ = 0;
+  return ok;
+}
+
+void RowOutputSink::append_cstr(const char* s) {
+  append(s, std::strlen(s));
+}
+
+void RowOutputSink::append_uint(uint64_t v) {
+  char tmp[20];
+  char* end = tmp + sizeof(tmp);
+  char* p = end;
+  do {
+    *--p = static_cast<char>('0' + (v % 10));
+    v /= 10;
+  } while (v != 0);
+  append(p, static_cast<size_t>(end - p));
+}
+
+void RowOutputSink::append_int(int64_t v) {
+  if (v < 0) {
+    put('-');
+    append_uint(0 - static_cast<uint64_t>(v));
+    return;
+  }
+  append_uint(static_cast<uint64_t>(v));
+}
+
+#if defined(__SSE2__)
+static inline unsigned csv_mask16(const char* p) {
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8(','));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+  return static_cast<unsigned>(_mm_movemask_epi8(m));
+}
+
+static inline unsigned json_mask16(const char* p) {
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+  // Unsigned c < 0x20  <=>  max(c, 0x1F) == 0x1F
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1F)),
+                                     _mm_set1_epi8(0x1F)));
+  return static_cast<unsigned>(_mm_movemask_epi8(m));
+}
+#elif defined(__ARM_NEON)
+static inline unsigned neon_movemask(uint8x16_t m) {
+  // Narrow each 0x00/0xFF lane to one nibble, then find the first set one.
+  const uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+  const uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(nib), 0);
+  if (bits == 0) {
+    return 0;
+  }
+  return 1u << (__builtin_ctzll(bits) >> 2);
+}
+
+static inline unsigned csv_mask16(const char* p) {
+  const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+  uint8x16_t m = vceqq_u8(v, vdupq_n_u8(','));
+  m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('"')));
+  m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\n')));
+  m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\r')));
+  return neon_movemask(m);
+}
+
+static inline unsigned json_mask16(const char* p) {
+  const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+  uint8x16_t m = vceqq_u8(v, vdupq_n_u8('"'));
+  m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\\')));
+  m = vorrq_u8(m, vcltq_u8(v, vdupq_n_u8(0x20)));
+  return neon_movemask(m);
+}
+#endif
+
+static inline bool is_csv_special(unsigned char c) {
+  return c == ',' || c == '"' || c == '\n' || c == '\r';
+}
+
+static inline bool is_json_special(unsigned char c) {
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+size_t find_csv_special(const char* p, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    const unsigned mask = csv_mask16(p + i);
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (is_csv_special(static_cast<unsigned char>(p[i]))) {
+      return i;
+    }
+  }
+  return n;
+}
+
+size_t find_json_special(const char* p, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    const unsigned mask = json_mask16(p + i);
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (is_json_special(static_cast<unsigned char>(p[i]))) {
+      return i;
+    }
+  }
+  return n;
+}
+
+void RowOutputSink::append_csv_value(const char* p, size_t n) {
+  size_t pos = find_csv_special(p, n);
+  if (pos == n) {
+    // Unquoted cells used to go through fputs(); keep its NUL cut-off.
+    append(p, strnlen(p, n));
+    return;
+  }
+  put('"');
+  append_csv_escaped(p, n);
+  put('"');
+}
+
+size_t json_escape_byte(unsigned char c, char esc[6]) {
+  static const char kHex[] = "0123456789ABCDEF";
+  esc[0] = '\\';
+  switch (c) {
+    case '\\': esc[1] = '\\'; return 2;
+    case '"': esc[1] = '"'; return 2;
+    case '\b': esc[1] = 'b'; return 2;
+    case '\f': esc[1] = 'f'; return 2;
+    case '\n': esc[1] = 'n'; return 2;
+    case '\r': esc[1] = 'r'; return 2;
+    case '\t': esc[1] = 't'; return 2;
+    default:
+      esc[1] = 'u';
+      esc[2] = '0';
+      esc[3] = '0';
+      esc[4] = kHex[c >> 4];
+      esc[5] = kHex[c & 0xF];
+      return 6;
+  }
+}
+
+void RowOutputSink::append_json_string(const char* p, size_t n) {
+  put('"');
+  append_json_escaped(p, n);
+  put('"');
+}
+
+void RowOutputSink::append_json_escaped(const char* p, size_t n) {
+  while (n > 0) {
+    const size_t run = find_json_special(p, n);
+    append(p, run);
+    if (run == n) {
+      break;
+    }
+    char esc[6];
+    append(esc, json_escape_byte(static_cast<unsigned char>(p[run]), esc));
+    p += run + 1;
+    n -= run + 1;
+  }
+}
+
+void RowOutputSink::append_csv_escaped(const char* p, size_t n) {
+  while (n > 0) {
+    const char* q = static_cast<const char*>(std::memchr(p, '"', n));
+    if (q == nullptr) {
+      break;
+    }
+    const size_t at = static_cast<size_t>(q - p);
+    append(p, at + 1);
+    put('"');
+    p += at + 1;
+    n -= at + 1;
+  }
+  append(p, n);
+}
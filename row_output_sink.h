@@ -0,0 +1,110 @@
+#ifndef ROW_OUTPUT_SINK_H
+#define ROW_OUTPUT_SINK_H
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+class OutputFileWriter;
+
+/**
+ * Append buffer that process_ibrec() formats rows into.
+ *
+ * In direct mode (a stream with a descriptor that nothing else prints on
+ * mid-parse; stdout qualifies, diagnostics go to stderr) rows accumulate
+ * until the buffer passes its flush threshold and go out with a single
+ * write(2) on the stream's descriptor. Rows for an OutputFileWriter's
+ * stream accumulate the same way and go to write_rows() with their row
+ * ends, so the writer can split files between rows. Otherwise the buffer
+ * is handed to fwrite() once per row, so rows keep their place relative
+ * to whatever else is printed on the same stream.
+ */
+class RowOutputSink {
+ public:
+  static const size_t kFlushThreshold = 1 << 20;
+
+  RowOutputSink() = default;
+  RowOutputSink(const RowOutputSink&) = delete;
+  RowOutputSink& operator=(const RowOutputSink&) = delete;
+  ~RowOutputSink();
+
+  /**
+   * Switch to a new stream (flushing the old one first). rows, if set, is
+   * the OutputFileWriter whose stream() out is.
+   */
+  void bind(FILE* out, bool direct, OutputFileWriter* rows = nullptr);
+  FILE* stream() const { return out_; }
+
+  void put(char c) {
+    reserve(1);
+    buf_[len_++] = c;
+  }
+  void append(const char* p, size_t n) {
+    reserve(n);
+    std::memcpy(buf_.get() + len_, p, n);
+    len_ += n;
+  }
+  void append(const std::string& s) { append(s.data(), s.size()); }
+  /** Same bytes fputs() would write: stops at the first NUL. */
+  void append_cstr(const char* s);
+  void append_uint(uint64_t v);
+  void append_int(int64_t v);
+
+  /** CSV cell: quoted (with "" doubling) only when it holds , " \n or \r. */
+  void append_csv_value(const char* p, size_t n);
+  void append_csv_value(const std::string& s) { append_csv_value(s.data(), s.size()); }
+  /** JSON string literal including the surrounding quotes. */
+  void append_json_string(const char* p, size_t n);
+  void append_json_string(const std::string& s) { append_json_string(s.data(), s.size()); }
+
+  // The inside of a value written in pieces: the caller adds the quotes
+  // (CSV cells written this way are always quoted).
+  void append_json_escaped(const char* p, size_t n);
+  void append_csv_escaped(const char* p, size_t n);
+
+  /** Row boundary: flushes unless direct mode (or rows) has room left. */
+  void end_row() {
+    if (rows_) {
+      row_ends_.push_back(len_);
+    }
+    if ((!direct_ && !rows_) || len_ >= kFlushThreshold) {
+      flush();
+    }
+  }
+  bool flush();
+  /** Mid-row flush for long values written in pieces: only past the threshold. */
+  void flush_if_full() {
+    if (len_ >= kFlushThreshold) {
+      flush();
+    }
+  }
+
+ private:
+  void reserve(size_t extra) {
+    if (len_ + extra > cap_) {
+      grow(len_ + extra);
+    }
+  }
+  void grow(size_t need);
+
+  std::unique_ptr<char[]> buf_;
+  size_t len_ = 0;
+  size_t cap_ = 0;
+  FILE* out_ = nullptr;
+  bool direct_ = false;
+  OutputFileWriter* rows_ = nullptr;
+  std::vector<size_t> row_ends_;  // offsets into buf_ where rows end
+};
+
+// First byte in [p, p+n) that needs CSV quoting, or n.
+size_t find_csv_special(const char* p, size_t n);
+// First byte in [p, p+n) that needs JSON escaping, or n.
+size_t find_json_special(const char* p, size_t n);
+// Escape sequence for a byte find_json_special() stopped at; returns its length.
+size_t json_escape_byte(unsigned char c, char esc[6]);
+
+#endif  // ROW_OUTPUT_SINK_H
@@ -0,0 +1,394 @@
+/**
+ * schema_cache.cc
+ *
+ * Table definitions from the tablespace's SDI, and their binary artifacts
+ * (see schema_cache.h).
+ */
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+#include "parser.h"
+#include "parser_log.h"
+#include "schema_cache.h"
+#include "sdi_reader.h"
+
+static const char kArtifactMagic[8] = {'I', 'B', 'S', 'C', 'H', 'E', 'M', 'A'};
+// Bump whenever MyColumnDef, IndexDef or parser_context_t change.
+static const uint32_t kArtifactVersion = 1;
+// magic, version, table id, uncompressed_len, compressed_len, SDI crc32,
+// body length, body crc32.
+static const size_t kArtifactHeaderSize = 8 + 4 + 8 + 4 + 4 + 4 + 4 + 4;
+
+namespace {
+
+/** Little-endian fixed-width fields and length-prefixed strings. */
+class ArtifactWriter {
+ public:
+  void u8(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+  void u32(uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+      u8(static_cast<uint8_t>(v >> (8 * i)));
+    }
+  }
+  void u64(uint64_t v) {
+    u32(static_cast<uint32_t>(v));
+    u32(static_cast<uint32_t>(v >> 32));
+  }
+  void i32(int v) { u32(static_cast<uint32_t>(v)); }
+  void str(const std::string& s) {
+    u32(static_cast<uint32_t>(s.size()));
+    buf_.append(s);
+  }
+  std::string& buf() { return buf_; }
+
+ private:
+  std::string buf_;
+};
+
+/** Reads what ArtifactWriter wrote; ok() turns false on any overrun. */
+class ArtifactReader {
+ public:
+  ArtifactReader(const char* p, size_t len)
+      : p_(reinterpret_cast<const unsigned char*>(p)), end_(p_ + len) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return p_ == end_; }
+
+  uint8_t u8() {
+    if (!ok_ || p_ == end_) {
+      ok_ = false;
+      return 0;
+    }
+    return *p_++;
+  }
+  uint32_t u32() {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+      v |= static_cast<uint32_t>(u8()) << (8 * i);
+    }
+    return v;
+  }
+  uint64_t u64() {
+    const uint64_t lo = u32();
+    return lo | (static_cast<uint64_t>(u32()) << 32);
+  }
+  int i32() { return static_cast<int>(u32()); }
+  std::string str() {
+    const uint32_t len = u32();
+    if (!ok_ || len > static_cast<size_t>(end_ - p_)) {
+      ok_ = false;
+      return std::string();
+    }
+    std::string s(reinterpret_cast<const char*>(p_), len);
+    p_ += len;
+    return s;
+  }
+  // An element count, refused when the rest of the body cannot hold that
+  // many elements of at least min_size bytes.
+  size_t count(size_t min_size) {
+    const uint32_t n = u32();
+    if (!ok_ || static_cast<uint64_t>(n) * min_size >
+                    static_cast<uint64_t>(end_ - p_)) {
+      ok_ = false;
+      return 0;
+    }
+    return n;
+  }
+
+ private:
+  const unsigned char* p_;
+  const unsigned char* end_;
+  bool ok_ = true;
+};
+
+}  // namespace
+
+static void encode_column(ArtifactWriter& w, const MyColumnDef& col) {
+  w.str(col.name);
+  w.str(col.type_utf8);
+  w.u32(col.char_length);
+  w.u32(col.collation_id);
+  w.u8(static_cast<uint8_t>((col.is_nullable ? 1 : 0) | (col.is_unsigned ? 2 : 0) |
+                            (col.is_virtual ? 4 : 0) |
+                            (col.elements_complete ? 8 : 0)));
+  w.i32(col.hidden);
+  w.i32(col.ordinal_position);
+  w.i32(col.column_opx);
+  w.i32(col.numeric_precision);
+  w.i32(col.numeric_scale);
+  w.i32(col.datetime_precision);
+  w.u64(col.elements_count);
+  w.u32(static_cast<uint32_t>(col.elements.size()));
+  for (const std::string& e : col.elements) {
+    w.str(e);
+  }
+}
+
+static void decode_column(ArtifactReader& r, MyColumnDef* col) {
+  col->name = r.str();
+  col->type_utf8 = r.str();
+  col->char_length = r.u32();
+  col->collation_id = r.u32();
+  const uint8_t flags = r.u8();
+  col->is_nullable = (flags & 1) != 0;
+  col->is_unsigned = (flags & 2) != 0;
+  col->is_virtual = (flags & 4) != 0;
+  col->elements_complete = (flags & 8) != 0;
+  col->hidden = r.i32();
+  col->ordinal_position = r.i32();
+  col->column_opx = r.i32();
+  col->numeric_precision = r.i32();
+  col->numeric_scale = r.i32();
+  col->datetime_precision = r.i32();
+  col->elements_count = static_cast<size_t>(r.u64());
+  col->elements.resize(r.count(4));
+  for (std::string& e : col->elements) {
+    e = r.str();
+  }
+}
+
+static void encode_columns(ArtifactWriter& w, const std::vector<MyColumnDef>& cols) {
+  w.u32(static_cast<uint32_t>(cols.size()));
+  for (const MyColumnDef& col : cols) {
+    encode_column(w, col);
+  }
+}
+
+static void decode_columns(ArtifactReader& r, std::vector<MyColumnDef>* cols) {
+  cols->resize(r.count(8));
+  for (MyColumnDef& col : *cols) {
+    decode_column(r, &col);
+  }
+}
+
+static std::string encode_schema(const std::string& table_name,
+                                 const parser_context_t& ctx) {
+  ArtifactWriter w;
+  w.str(table_name);
+  w.u64(ctx.target_index_id);
+  w.u8(ctx.target_index_set ? 1 : 0);
+  w.str(ctx.target_index_name);
+  w.u32(ctx.target_index_root);
+  encode_columns(w, ctx.columns);
+  encode_columns(w, ctx.columns_by_opx);
+  w.u32(static_cast<uint32_t>(ctx.index_defs.size()));
+  for (const IndexDef& idx : ctx.index_defs) {
+    w.str(idx.name);
+    w.u64(idx.id);
+    w.u32(idx.root);
+    w.u8(idx.is_primary ? 1 : 0);
+    w.u32(static_cast<uint32_t>(idx.elements.size()));
+    for (const IndexElementDef& el : idx.elements) {
+      w.i32(el.column_opx);
+      w.u32(el.length);
+      w.i32(el.ordinal_position);
+      w.u8(el.hidden ? 1 : 0);
+    }
+  }
+  return std::move(w.buf());
+}
+
+static bool decode_schema(const char* body, size_t len, std::string* table_name,
+                          parser_context_t* ctx) {
+  ArtifactReader r(body, len);
+  *table_name = r.str();
+  ctx->target_index_id = r.u64();
+  ctx->target_index_set = r.u8() != 0;
+  ctx->target_index_name = r.str();
+  ctx->target_index_root = r.u32();
+  decode_columns(r, &ctx->columns);
+  decode_columns(r, &ctx->columns_by_opx);
+  ctx->index_defs.resize(r.count(8));
+  for (IndexDef& idx : ctx->index_defs) {
+    idx.name = r.str();
+    idx.id = r.u64();
+    idx.root = r.u32();
+    idx.is_primary = r.u8() != 0;
+    idx.elements.resize(r.count(13));
+    for (IndexElementDef& el : idx.elements) {
+      el.column_opx = r.i32();
+      el.length = r.u32();
+      el.ordinal_position = r.i32();
+      el.hidden = r.u8() != 0;
+    }
+  }
+  return r.ok() && r.at_end();
+}
+
+static uint32_t body_crc32(const std::string& body) {
+  return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(body.data()),
+                                     static_cast<uInt>(body.size())));
+}
+
+static std::string artifact_path(const char* cache_dir, const SdiRecord& rec) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "/%llu-%08x.ibschema",
+                static_cast<unsigned long long>(rec.id), rec.crc32);
+  return std::string(cache_dir) + name;
+}
+
+// Header of the artifact holding body for rec.
+static std::string artifact_header(const SdiRecord& rec, const std::string& body) {
+  ArtifactWriter w;
+  w.buf().append(kArtifactMagic, sizeof(kArtifactMagic));
+  w.u32(kArtifactVersion);
+  w.u64(rec.id);
+  w.u32(rec.uncompressed_len);
+  w.u32(rec.compressed_len);
+  w.u32(rec.crc32);
+  w.u32(static_cast<uint32_t>(body.size()));
+  w.u32(body_crc32(body));
+  return std::move(w.buf());
+}
+
+static bool read_file(const std::string& path, std::string* out) {
+  FILE* fp = std::fopen(path.c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  out->clear();
+  char buf[1 << 16];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), fp)) > 0) {
+    out->append(buf, n);
+  }
+  const bool ok = !std::ferror(fp);
+  std::fclose(fp);
+  return ok;
+}
+
+// The cached definition for rec, if path holds a sound artifact for it.
+static bool load_artifact(const std::string& path, const SdiRecord& rec,
+                          std::string* table_name, parser_context_t* ctx) {
+  std::string data;
+  if (!read_file(path, &data)) {
+    return false;
+  }
+  if (data.size() < kArtifactHeaderSize) {
+    PARSER_LOG(LOG_LEVEL_WARN, "Ignoring truncated schema artifact %s\n", path.c_str());
+    return false;
+  }
+  const std::string body = data.substr(kArtifactHeaderSize);
+  if (data.compare(0, kArtifactHeaderSize, artifact_header(rec, body)) != 0) {
+    PARSER_LOG(LOG_LEVEL_WARN,
+               "Ignoring schema artifact %s: stale, corrupt or another format "
+               "version\n", path.c_str());
+    return false;
+  }
+  parser_context_t cached;
+  if (!decode_schema(body.data(), body.size(), table_name, &cached)) {
+    PARSER_LOG(LOG_LEVEL_WARN, "Ignoring undecodable schema artifact %s\n",
+               path.c_str());
+    return false;
+  }
+  *ctx = std::move(cached);
+  return true;
+}
+
+static bool save_artifact(const char* cache_dir, const std::string& path,
+                          const SdiRecord& rec, const std::string& table_name,
+                          const parser_context_t& ctx) {
+  if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+    std::cerr << "Warning: cannot create --sdi-cache directory " << cache_dir
+              << ": " << std::strerror(errno) << "\n";
+    return false;
+  }
+  const std::string body = encode_schema(table_name, ctx);
+  const std::string header = artifact_header(rec, body);
+  const std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+
+  FILE* fp = std::fopen(tmp.c_str(), "wb");
+  if (fp == nullptr) {
+    std::cerr << "Warning: cannot write schema artifact " << tmp << ": "
+              << std::strerror(errno) << "\n";
+    return false;
+  }
+  bool ok = std::fwrite(header.data(), 1, header.size(), fp) == header.size() &&
+            std::fwrite(body.data(), 1, body.size(), fp) == body.size();
+  ok = (std::fclose(fp) == 0) && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::cerr << "Warning: cannot write schema artifact " << path << ": "
+              << std::strerror(errno) << "\n";
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+int load_table_schema_from_ibd(const char* ibd_path,
+                               const PageCipher* cipher,
+                               const char* cache_dir,
+                               std::string& table_name,
+                               parser_context_t* ctx) {
+  if (ctx == nullptr) {
+    std::cerr << "[Error] Parser context is null.\n";
+    return 1;
+  }
+
+  const int fd = ::open(ibd_path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "[Error] Could not open " << ibd_path << ": "
+              << std::strerror(errno) << "\n";
+    return 1;
+  }
+  std::vector<SdiRecord> records;
+  std::string err;
+  const bool read_ok = read_tablespace_sdi(fd, cipher, &records, &err);
+  ::close(fd);
+  if (!read_ok) {
+    std::cerr << "[Error] Cannot read SDI from " << ibd_path << ": " << err << "\n";
+    return 1;
+  }
+
+  const SdiRecord* table = nullptr;
+  size_t n_tables = 0;
+  for (const SdiRecord& rec : records) {
+    if (rec.type == SDI_TYPE_TABLE) {
+      if (table == nullptr) {
+        table = &rec;
+      }
+      n_tables++;
+    }
+  }
+  if (table == nullptr) {
+    std::cerr << "[Error] " << ibd_path << " has no Table SDI record.\n";
+    return 1;
+  }
+  if (n_tables > 1) {
+    std::cerr << "Warning: " << ibd_path << " holds " << n_tables
+              << " tables; using table id " << table->id
+              << " (pass ibd2sdi JSON to choose another).\n";
+  }
+
+  std::string path;
+  if (cache_dir != nullptr) {
+    path = artifact_path(cache_dir, *table);
+    if (load_artifact(path, *table, &table_name, ctx)) {
+      PARSER_LOG(LOG_LEVEL_INFO, "SDI schema cache hit: %s\n", path.c_str());
+      return 0;
+    }
+  }
+
+  std::string json;
+  if (!inflate_sdi_record(*table, &json, &err)) {
+    std::cerr << "[Error] " << err << "\n";
+    return 1;
+  }
+  if (load_sdi_table_object(json.data(), json.size(), table_name, ctx) != 0) {
+    return 1;
+  }
+
+  if (cache_dir != nullptr && save_artifact(cache_dir, path, *table, table_name, *ctx)) {
+    PARSER_LOG(LOG_LEVEL_INFO, "SDI schema cache: wrote %s\n", path.c_str());
+  }
+  return 0;
+}
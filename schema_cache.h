@@ -0,0 +1,35 @@
+#ifndef SCHEMA_CACHE_H
+#define SCHEMA_CACHE_H
+
+#include <string>
+
+struct PageCipher;
+struct parser_context_t;
+
+/**
+ * Table definitions from the tablespace's own SDI (no ibd2sdi JSON),
+ * optionally cached as compact binary artifacts (--sdi-cache=DIR) so that
+ * repeat runs skip the inflate and the JSON parse as well.
+ *
+ * An artifact holds the parser_context_t that load_sdi_table_object()
+ * built, keyed by the table id and the crc32 of the compressed bytes of
+ * its SDI record. Both are in the file name and the header, next to a
+ * crc32 of the body. Any DDL rewrites the SDI record and so misses the
+ * cache; a damaged, foreign or older-format file is ignored and replaced.
+ * Artifacts are written under a temporary name and renamed into place, so
+ * concurrent runs can share one directory.
+ */
+
+/**
+ * Table definition of the tablespace at ibd_path, read from its SDI pages
+ * (decrypted with cipher when not null) and through the artifact cache in
+ * cache_dir unless that is null. A tablespace holding several tables
+ * gives the first one, with a warning. Returns 0 on success.
+ */
+int load_table_schema_from_ibd(const char* ibd_path,
+                               const PageCipher* cipher,
+                               const char* cache_dir,
+                               std::string& table_name,
+                               parser_context_t* ctx);
+
+#endif  // SCHEMA_CACHE_H
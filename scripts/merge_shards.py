@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Check and join the outputs of a sharded ib_parser mode 3 run.
+
+Each shard is run with --shard=I/N (or --page-range=START:END) and
+--shard-manifest, which writes OUTPUT.manifest next to its --output. Given
+the manifests of all shards, this checks that they were made from the same
+tablespace with the same output options, that their page ranges cover the
+tablespace exactly once, and that every output still has the size and
+sha256 its manifest recorded. Only then are the outputs concatenated in
+page order, keeping the first column header line (pipe, CSV): the result
+is the output of one unsharded run, without missing or duplicated rows.
+
+  merge_shards.py [--check] [--output=PATH] SHARD.manifest...
+
+An output that is not where its manifest says is looked for next to the
+manifest. Without --output the joined rows go to stdout; --check only
+verifies. Exits 1, listing every problem, when any check fails.
+"""
+import hashlib
+import os
+import sys
+
+MAGIC = "ib_parser shard manifest 1"
+COUNTERS = ("input_size", "total_pages", "first_page", "end_page",
+            "output_bytes", "header_bytes", "rows")
+CHUNK = 1 << 20
+
+
+def read_manifest(path):
+    with open(path) as f:
+        lines = f.read().splitlines()
+    if not lines or lines[0] != MAGIC:
+        raise ValueError("%s is not an ib_parser shard manifest" % path)
+    m = {"manifest": path}
+    for line in lines[1:]:
+        key, sep, value = line.partition("=")
+        if sep:
+            m[key] = value
+    for key in COUNTERS:
+        if key not in m:
+            raise ValueError("%s has no %s" % (path, key))
+        m[key] = int(m[key])
+    return m
+
+
+def locate_output(m):
+    if os.path.isfile(m["output"]):
+        return m["output"]
+    beside = os.path.join(os.path.dirname(m["manifest"]),
+                          os.path.basename(m["output"]))
+    return beside if os.path.isfile(beside) else None
+
+
+def check_output(path, m):
+    digest = hashlib.sha256()
+    size = 0
+    with open(path, "rb") as f:
+        while True:
+            block = f.read(CHUNK)
+            if not block:
+                break
+            digest.update(block)
+            size += len(block)
+    if size != m["output_bytes"]:
+        return "%s: %d bytes, manifest says %d" % (path, size, m["output_bytes"])
+    if digest.hexdigest() != m["output_sha256"]:
+        return "%s: sha256 differs from its manifest" % path
+    return None
+
+
+def main(argv):
+    check_only = False
+    out_path = None
+    paths = []
+    for arg in argv:
+        if arg == "--check":
+            check_only = True
+        elif arg.startswith("--output="):
+            out_path = arg[len("--output="):]
+        elif arg.startswith("--"):
+            sys.stderr.write("Unknown argument: %s\n" % arg)
+            return 1
+        else:
+            paths.append(arg)
+    if not paths:
+        sys.stderr.write(__doc__)
+        return 1
+
+    problems = []
+    shards = []
+    for path in paths:
+        try:
+            shards.append(read_manifest(path))
+        except (OSError, ValueError) as e:
+            problems.append(str(e))
+    if problems:
+        sys.stderr.write("\n".join(problems) + "\n")
+        return 1
+
+    first = shards[0]
+    for m in shards[1:]:
+        for key in ("input_size", "total_pages", "options"):
+            if m[key] != first[key]:
+                problems.append("%s: %s differs from %s" % (m["manifest"], key,
+                                                             first["manifest"]))
+
+    # Page order is the order an unsharded sweep writes rows in.
+    shards.sort(key=lambda m: (m["first_page"], m["end_page"]))
+    next_page = 0
+    for m in shards:
+        if m["first_page"] > next_page:
+            problems.append("pages %d to %d are in no shard" % (next_page, m["first_page"]))
+        elif m["first_page"] < next_page:
+            problems.append("%s: pages %d to %d are in another shard too" %
+                            (m["manifest"], m["first_page"], min(next_page, m["end_page"])))
+        next_page = max(next_page, m["end_page"])
+    if next_page < first["total_pages"]:
+        problems.append("pages %d to %d are in no shard" % (next_page, first["total_pages"]))
+
+    header = None
+    for m in shards:
+        m["path"] = locate_output(m)
+        if m["path"] is None:
+            problems.append("%s: output %s not found" % (m["manifest"], m["output"]))
+            continue
+        problem = check_output(m["path"], m)
+        if problem:
+            problems.append(problem)
+            continue
+        if m["header_bytes"]:
+            with open(m["path"], "rb") as f:
+                text = f.read(m["header_bytes"])
+            if header is None:
+                header = text
+            elif text != header:
+                problems.append("%s: column header differs" % m["path"])
+
+    if problems:
+        sys.stderr.write("\n".join(problems) + "\n")
+        return 1
+
+    rows = sum(m["rows"] for m in shards)
+    keyed = [m for m in shards if m.get("first_key")]
+    sys.stderr.write("%d shards of %s: %d pages, %d rows" %
+                     (len(shards), first["input"], first["total_pages"], rows))
+    if keyed:
+        # The keys of the first and last row in page order; a sweep's rows
+        # are not sorted by key, so these need not be the smallest and
+        # largest (and the manifests do not record those).
+        sys.stderr.write(", key of first row in page order %s, of last %s" %
+                         (keyed[0]["first_key"], keyed[-1]["last_key"]))
+    sys.stderr.write("\n")
+    if check_only:
+        return 0
+
+    out = open(out_path, "wb") if out_path else sys.stdout.buffer
+    if header is not None:
+        out.write(header)
+    for m in shards:
+        with open(m["path"], "rb") as f:
+            f.seek(m["header_bytes"])
+            while True:
+                block = f.read(CHUNK)
+                if not block:
+                    break
+                out.write(block)
+    if out_path:
+        out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,411 @@
+/**
+ * sdi_reader.cc
+ *
+ * SDI records straight from the tablespace's SDI index (see sdi_reader.h).
+ * The write side, for mode 5's rebuilt SDI root, is in decompress.cc.
+ */
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "my_sys.h"
+#include "fil0fil.h"
+#include "fsp0fsp.h"
+#include "fsp0types.h"
+#include "lob0lob.h"
+#include "mach0data.h"
+#include "page0page.h"
+#include "page0size.h"
+#include "rem0rec.h"
+
+#include "decompress.h"
+#include "decrypt.h"
+#include "inflate_backend.h"
+#include "parser_log.h"
+#include "sdi_reader.h"
+
+// SDI record fields, as offsets from the record origin.
+static const ulint kSdiRecOffId = 4;
+static const ulint kSdiRecOffUncompLen = kSdiRecOffId + 8 + DATA_TRX_ID_LEN +
+                                         DATA_ROLL_PTR_LEN;
+static const ulint kSdiRecOffCompLen = kSdiRecOffUncompLen + 4;
+static const ulint kSdiRecOffData = kSdiRecOffCompLen + 4;
+// Node pointers on the upper levels: (type, id, child page no).
+static const ulint kSdiNodePtrOffChild = kSdiRecOffId + 8;
+
+// Upper bound on pages followed in one blob chain or leaf list, and on
+// B-tree levels (BTR_MAX_LEVELS).
+static const size_t kMaxChainPages = 1 << 20;
+static const size_t kMaxSdiLevels = 100;
+
+namespace {
+
+/** pread() pages of one tablespace, decrypted and, for page_zip, inflated. */
+class SdiPageReader {
+ public:
+  SdiPageReader(int fd, const page_size_t& pg_sz, const PageCipher* cipher)
+      : fd_(fd),
+        physical_(pg_sz.physical()),
+        logical_(pg_sz.logical()),
+        cipher_(cipher),
+        raw_(physical_),
+        logical_buf_(logical_) {}
+
+  size_t physical_size() const { return physical_; }
+  size_t logical_size() const { return logical_; }
+  bool compressed() const { return physical_ < logical_; }
+
+  /** Physical page page_no as stored (after decryption), or nullptr. */
+  const unsigned char* raw_page(page_no_t page_no) {
+    const off_t offset = static_cast<off_t>(page_no) * static_cast<off_t>(physical_);
+    if (pread(fd_, raw_.data(), physical_, offset) != static_cast<ssize_t>(physical_)) {
+      return nullptr;
+    }
+    if (cipher_ != nullptr && !cipher_->decrypt(raw_.data(), physical_)) {
+      return nullptr;
+    }
+    return raw_.data();
+  }
+
+  /** SDI index page page_no at its logical size, or nullptr. */
+  const unsigned char* index_page(page_no_t page_no) {
+    const unsigned char* raw = raw_page(page_no);
+    if (raw == nullptr || fil_page_get_type(raw) != FIL_PAGE_SDI) {
+      return nullptr;
+    }
+    if (!compressed()) {
+      return raw;
+    }
+    size_t actual_size = 0;
+    if (!decompress_page_inplace(raw, physical_, logical_, logical_buf_.data(),
+                                 logical_, &actual_size) ||
+        actual_size != logical_) {
+      return nullptr;
+    }
+    return logical_buf_.data();
+  }
+
+ private:
+  int fd_;
+  size_t physical_;
+  size_t logical_;
+  const PageCipher* cipher_;
+  std::vector<unsigned char> raw_;
+  std::vector<unsigned char> logical_buf_;
+};
+
+}  // namespace
+
+// Origin of the record after rec_offset in a COMPACT page, or 0.
+static ulint next_rec_offset(const unsigned char* page, size_t page_size,
+                             ulint rec_offset) {
+  const int16_t delta =
+      static_cast<int16_t>(mach_read_from_2(page + rec_offset - REC_NEXT));
+  if (delta == 0) {
+    return 0;
+  }
+  const ulint next =
+      static_cast<ulint>((static_cast<long>(rec_offset) + delta) &
+                         static_cast<long>(page_size - 1));
+  if (next < PAGE_NEW_INFIMUM || next >= page_size - PAGE_DIR) {
+    return 0;
+  }
+  return next;
+}
+
+// SDI_BLOB chain (old BLOB format): a part length and the next page number
+// in front of each page's share of the data.
+static bool read_sdi_blob(SdiPageReader& reader, page_no_t page_no, ulint offset,
+                          size_t want, std::string* out) {
+  const size_t page_size = reader.physical_size();
+  for (size_t steps = 0; want > 0; steps++) {
+    if (page_no == FIL_NULL || steps >= kMaxChainPages) {
+      return false;
+    }
+    const unsigned char* page = reader.raw_page(page_no);
+    if (page == nullptr || fil_page_get_type(page) != FIL_PAGE_SDI_BLOB ||
+        offset + lob::LOB_HDR_SIZE > page_size) {
+      return false;
+    }
+    const unsigned char* header = page + offset;
+    const size_t part_len = mach_read_from_4(header + lob::LOB_HDR_PART_LEN);
+    if (part_len == 0 || part_len > want ||
+        offset + lob::LOB_HDR_SIZE + part_len > page_size) {
+      return false;
+    }
+    out->append(reinterpret_cast<const char*>(header + lob::LOB_HDR_SIZE), part_len);
+    want -= part_len;
+    page_no = mach_read_from_4(header + lob::LOB_HDR_NEXT_PAGE_NO);
+    offset = FIL_PAGE_DATA;
+  }
+  return true;
+}
+
+// SDI_ZBLOB chain (ROW_FORMAT=COMPRESSED): one zlib stream continued from
+// page to page through FIL_PAGE_NEXT.
+static bool read_sdi_zblob(SdiPageReader& reader, page_no_t page_no, ulint offset,
+                           size_t want, std::string* out) {
+  const size_t page_size = reader.physical_size();
+  const size_t start = out->size();
+  out->resize(start + want);
+
+  z_stream* stream = thread_inflate_stream();
+  if (stream == nullptr) {
+    out->resize(start);
+    return false;
+  }
+  z_stream& strm = *stream;
+  strm.next_out = reinterpret_cast<Bytef*>(&(*out)[start]);
+  strm.avail_out = static_cast<uInt>(want);
+
+  int ret = Z_OK;
+  for (size_t steps = 0; strm.avail_out > 0 && ret != Z_STREAM_END; steps++) {
+    if (page_no == FIL_NULL || steps >= kMaxChainPages) {
+      break;
+    }
+    const unsigned char* page = reader.raw_page(page_no);
+    if (page == nullptr || fil_page_get_type(page) != FIL_PAGE_SDI_ZBLOB) {
+      break;
+    }
+    const ulint data_offset = (offset == FIL_PAGE_NEXT) ? FIL_PAGE_DATA : offset + 4;
+    if (data_offset >= page_size) {
+      break;
+    }
+    page_no = mach_read_from_4(page + FIL_PAGE_NEXT);
+    strm.next_in = const_cast<Bytef*>(page + data_offset);
+    strm.avail_in = static_cast<uInt>(page_size - data_offset);
+    ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      break;
+    }
+    offset = FIL_PAGE_NEXT;
+  }
+  const bool complete = strm.avail_out == 0;
+  if (!complete) {
+    out->resize(start);
+  }
+  return complete;
+}
+
+// One ordinary record of an SDI leaf into *rec; false if it is malformed.
+static bool read_sdi_leaf_record(SdiPageReader& reader, const unsigned char* page,
+                                 ulint rec_offset, SdiRecord* rec,
+                                 std::string* err) {
+  const size_t page_size = reader.logical_size();
+  const unsigned char* r = page + rec_offset;
+  const ulint lens = rec_offset - REC_N_NEW_EXTRA_BYTES;
+
+  // data is the only variable-length column and nothing is nullable.
+  ulint len = page[lens - 1];
+  bool external = false;
+  if (len & 0x80) {
+    external = (len & 0x40) != 0;
+    len = ((len & 0x3f) << 8) | page[lens - 2];
+  }
+  if (rec_offset + kSdiRecOffData + len > page_size - PAGE_DIR) {
+    *err = "SDI record runs off its page";
+    return false;
+  }
+
+  rec->type = mach_read_from_4(r);
+  rec->id = mach_read_from_8(r + kSdiRecOffId);
+  rec->uncompressed_len = mach_read_from_4(r + kSdiRecOffUncompLen);
+  rec->compressed_len = mach_read_from_4(r + kSdiRecOffCompLen);
+
+  const unsigned char* data = r + kSdiRecOffData;
+  rec->compressed.clear();
+  if (!external) {
+    rec->compressed.assign(reinterpret_cast<const char*>(data), len);
+  } else {
+    if (len < BTR_EXTERN_FIELD_REF_SIZE) {
+      *err = "SDI record has a short external reference";
+      return false;
+    }
+    const ulint local_len = len - BTR_EXTERN_FIELD_REF_SIZE;
+    const unsigned char* ref = data + local_len;
+    const page_no_t blob_page = mach_read_from_4(ref + lob::BTR_EXTERN_PAGE_NO);
+    const ulint blob_offset = mach_read_from_4(ref + lob::BTR_EXTERN_OFFSET);
+    const size_t blob_len = mach_read_from_4(ref + lob::BTR_EXTERN_LEN + 4);
+    rec->compressed.reserve(local_len + blob_len);
+    rec->compressed.assign(reinterpret_cast<const char*>(data), local_len);
+    const bool ok = reader.compressed()
+                        ? read_sdi_zblob(reader, blob_page, blob_offset, blob_len,
+                                         &rec->compressed)
+                        : read_sdi_blob(reader, blob_page, blob_offset, blob_len,
+                                        &rec->compressed);
+    if (!ok) {
+      *err = "cannot read the external part of SDI record at page " +
+             std::to_string(blob_page);
+      return false;
+    }
+  }
+
+  if (rec->compressed.size() != rec->compressed_len) {
+    *err = "SDI record " + std::to_string(rec->type) + ":" + std::to_string(rec->id) +
+           " holds " + std::to_string(rec->compressed.size()) +
+           " compressed bytes, header says " + std::to_string(rec->compressed_len);
+    return false;
+  }
+  rec->crc32 = static_cast<uint32_t>(
+      crc32(0L, reinterpret_cast<const Bytef*>(rec->compressed.data()),
+            static_cast<uInt>(rec->compressed.size())));
+  return true;
+}
+
+bool read_tablespace_sdi(int fd, const PageCipher* cipher,
+                         std::vector<SdiRecord>* records, std::string* err) {
+  records->clear();
+
+  unsigned char header[UNIV_ZIP_SIZE_MIN];
+  if (pread(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+    *err = "cannot read page 0";
+    return false;
+  }
+  const uint32_t flags = fsp_header_get_flags(header);
+  if (!fsp_flags_is_valid(flags)) {
+    *err = "page 0 has invalid FSP flags";
+    return false;
+  }
+  if (!FSP_FLAGS_HAS_SDI(flags)) {
+    *err = "tablespace has no SDI (not created by MySQL 8.0?)";
+    return false;
+  }
+  const page_size_t pg_sz(flags);
+  SdiPageReader reader(fd, pg_sz, cipher);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *err = "fstat failed";
+    return false;
+  }
+  const uint64_t n_pages = static_cast<uint64_t>(st.st_size) / pg_sz.physical();
+
+  const unsigned char* page0 = reader.raw_page(0);
+  if (page0 == nullptr) {
+    *err = "cannot read page 0";
+    return false;
+  }
+  const ulint sdi_offset = fsp_header_get_sdi_offset(pg_sz);
+  const uint32_t sdi_version = mach_read_from_4(page0 + sdi_offset);
+  page_no_t page_no = mach_read_from_4(page0 + sdi_offset + 4);
+  if (sdi_version == 0 || page_no == 0 || page_no >= n_pages) {
+    *err = "FSP header names no SDI root page";
+    return false;
+  }
+
+  // Down the leftmost node pointers to the first leaf.
+  const size_t page_size = reader.logical_size();
+  const unsigned char* page = nullptr;
+  for (size_t depth = 0;; depth++) {
+    page = reader.index_page(page_no);
+    if (page == nullptr || !page_is_comp(page)) {
+      *err = "page " + std::to_string(page_no) + " is not a readable SDI index page";
+      return false;
+    }
+    if (mach_read_from_2(page + PAGE_HEADER + PAGE_LEVEL) == 0) {
+      break;
+    }
+    const ulint first = next_rec_offset(page, page_size, PAGE_NEW_INFIMUM);
+    if (first == 0 || first == PAGE_NEW_SUPREMUM || depth >= kMaxSdiLevels) {
+      *err = "malformed SDI node pointer page " + std::to_string(page_no);
+      return false;
+    }
+    page_no = mach_read_from_4(page + first + kSdiNodePtrOffChild);
+  }
+
+  // Then along the leaf list. Each page is copied out of the reader's
+  // buffer first: blob reads reuse it.
+  std::vector<unsigned char> leaf(page, page + page_size);
+  std::unordered_set<page_no_t> visited;
+  while (true) {
+    if (!visited.insert(page_no).second || visited.size() > kMaxChainPages) {
+      *err = "SDI leaf list loops at page " + std::to_string(page_no);
+      return false;
+    }
+    size_t steps = 0;
+    for (ulint rec = next_rec_offset(leaf.data(), page_size, PAGE_NEW_INFIMUM);
+         rec != 0 && rec != PAGE_NEW_SUPREMUM;
+         rec = next_rec_offset(leaf.data(), page_size, rec)) {
+      if (++steps > page_size / REC_N_NEW_EXTRA_BYTES) {
+        *err = "SDI record list loops on page " + std::to_string(page_no);
+        return false;
+      }
+      const rec_t* r = leaf.data() + rec;
+      if (rec_get_status(r) != REC_STATUS_ORDINARY || rec_get_deleted_flag(r, true)) {
+        continue;
+      }
+      SdiRecord sdi;
+      if (!read_sdi_leaf_record(reader, leaf.data(), rec, &sdi, err)) {
+        return false;
+      }
+      PARSER_LOG(LOG_LEVEL_DEBUG,
+                 "[Debug] SDI record type=%llu id=%llu on page %u: %u bytes "
+                 "(%u compressed)\n",
+                 static_cast<unsigned long long>(sdi.type),
+                 static_cast<unsigned long long>(sdi.id),
+                 static_cast<unsigned>(page_no), sdi.uncompressed_len,
+                 sdi.compressed_len);
+      records->push_back(std::move(sdi));
+    }
+
+    page_no = mach_read_from_4(leaf.data() + FIL_PAGE_NEXT);
+    if (page_no == FIL_NULL) {
+      break;
+    }
+    page = reader.index_page(page_no);
+    if (page == nullptr) {
+      *err = "cannot read SDI leaf page " + std::to_string(page_no);
+      return false;
+    }
+    leaf.assign(page, page + page_size);
+  }
+
+  if (records->empty()) {
+    *err = "SDI index holds no records";
+    return false;
+  }
+  std::stable_sort(records->begin(), records->end(),
+                   [](const SdiRecord& a, const SdiRecord& b) {
+                     return a.type != b.type ? a.type < b.type : a.id < b.id;
+                   });
+  return true;
+}
+
+bool inflate_sdi_record(const SdiRecord& rec, std::string* json, std::string* err) {
+  json->resize(rec.uncompressed_len);
+  uLongf out_len = rec.uncompressed_len;
+  const int ret = uncompress(reinterpret_cast<Bytef*>(&(*json)[0]), &out_len,
+                             reinterpret_cast<const Bytef*>(rec.compressed.data()),
+                             static_cast<uLong>(rec.compressed.size()));
+  if (ret != Z_OK || out_len != rec.uncompressed_len) {
+    *err = "cannot inflate SDI record " + std::to_string(rec.type) + ":" +
+           std::to_string(rec.id) + " (zlib " + std::to_string(ret) + ")";
+    json->clear();
+    return false;
+  }
+  return true;
+}
+
+bool sdi_records_to_json(const std::vector<SdiRecord>& records,
+                         std::string* json, std::string* err) {
+  json->assign("[\"ibd2sdi\"");
+  std::string object;
+  for (const SdiRecord& rec : records) {
+    if (!inflate_sdi_record(rec, &object, err)) {
+      return false;
+    }
+    json->append(",{\"type\":");
+    json->append(std::to_string(rec.type));
+    json->append(",\"id\":");
+    json->append(std::to_string(rec.id));
+    json->append(",\"object\":");
+    json->append(object);
+    json->append("}");
+  }
+  json->append("]");
+  return true;
+}
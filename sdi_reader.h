@@ -0,0 +1,55 @@
+#ifndef SDI_READER_H
+#define SDI_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PageCipher;
+
+/**
+ * Serialized dictionary information read straight from a tablespace, the
+ * way ibd2sdi reads it, so a table definition needs no JSON file.
+ *
+ * MySQL 8.0 keeps one SDI record per dictionary object in a B-tree whose
+ * root page the FSP header names. A record is (type, id, DB_TRX_ID,
+ * DB_ROLL_PTR, uncompressed_len, compressed_len, data): data is the
+ * zlib-compressed JSON that ibd2sdi prints under "object", kept on the
+ * leaf or, when large, in an SDI_BLOB (SDI_ZBLOB when ROW_FORMAT=COMPRESSED)
+ * chain. Plain, compressed and, given a cipher, encrypted tablespaces work.
+ */
+enum SdiObjectType {
+  SDI_TYPE_TABLE = 1,
+  SDI_TYPE_TABLESPACE = 2,
+};
+
+struct SdiRecord {
+  uint64_t type = 0;
+  uint64_t id = 0;               // dd id: table id for SDI_TYPE_TABLE
+  uint32_t uncompressed_len = 0;
+  uint32_t compressed_len = 0;
+  uint32_t crc32 = 0;            // zlib crc32 of the compressed bytes
+  std::string compressed;
+};
+
+/**
+ * Every live SDI record of the tablespace open on fd, in (type, id) order,
+ * payloads still compressed. false with *err set when the tablespace has
+ * no SDI (MySQL < 8.0, system tablespace) or it cannot be read.
+ */
+bool read_tablespace_sdi(int fd, const PageCipher* cipher,
+                         std::vector<SdiRecord>* records, std::string* err);
+
+/** The JSON object of rec (what ibd2sdi prints under "object"). */
+bool inflate_sdi_record(const SdiRecord& rec, std::string* json,
+                        std::string* err);
+
+/**
+ * records the way ibd2sdi prints them:
+ * ["ibd2sdi", {"type": 1, "id": N, "object": {...}}, ...]
+ */
+bool sdi_records_to_json(const std::vector<SdiRecord>& records,
+                         std::string* json, std::string* err);
+
+#endif  // SDI_READER_H
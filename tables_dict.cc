@@ -12,23 +12,21 @@ table_def_t table_definitions[1];
 extern bool deleted_pages_only;
 
 /*******************************************************************/
-void init_table_defs(int comp) {
-	int i, j;
-
-	printf("Initializing table definitions...\n");
-	table_definitions_cnt = sizeof(table_definitions) / sizeof(table_def_t);
-	printf("There are %d tables defined\n", table_definitions_cnt);
+void set_record_format(int comp) {
     record_extra_bytes = (comp ? REC_N_NEW_EXTRA_BYTES : REC_N_OLD_EXTRA_BYTES);
-    
-	for (i = 0; i < table_definitions_cnt; i++) {
-		table_def_t *table = &(table_definitions[i]);
-		printf("Processing table: %s\n", table->name);
-		
-		table->n_nullable = 0;
-		table->min_rec_header_len = 0;
-		table->data_min_size = 0;
-		table->data_max_size = 0;
-		
+}
+
+/*******************************************************************/
+void init_table_def(table_def_t *table, bool verbose) {
+	int j;
+
+	if (verbose) printf("Processing table: %s\n", table->name);
+
+	table->n_nullable = 0;
+	table->min_rec_header_len = 0;
+	table->data_min_size = 0;
+	table->data_max_size = 0;
+
         // If fields_count is already set (from builder), honor it.
         if (table->fields_count <= 0 || table->fields_count > MAX_TABLE_FIELDS) {
             // discover until FT_NONE sentinel
@@ -37,7 +35,7 @@ void init_table_defs(int comp) {
             }
         }
         for (j = 0; j < table->fields_count; j++) {
-            if (table->fields[j].name) {
+            if (verbose && table->fields[j].name) {
                 printf("Counting field: %s\n", table->fields[j].name);
             }
 
@@ -50,20 +48,21 @@ void init_table_defs(int comp) {
                     ? static_cast<unsigned int>(table->fields[j].fixed_length)
                     : table->fields[j].max_length;
 
-			if (table->fields[j].can_be_null) {
-				table->n_nullable++;
-			} else {
-    			table->data_min_size += field_min;
-				if (table->fields[j].fixed_length == 0) {
-					table->min_rec_header_len += (field_max > 255 ? 2 : 1);
-				}
+		if (table->fields[j].can_be_null) {
+			table->n_nullable++;
+		} else {
+			table->data_min_size += field_min;
+			if (table->fields[j].fixed_length == 0) {
+				table->min_rec_header_len += (field_max > 255 ? 2 : 1);
 			}
-
-			table->data_max_size += field_max;
 		}
-		
-		table->min_rec_header_len += (table->n_nullable + 7) / 8;
-		
+
+		table->data_max_size += field_max;
+	}
+
+	table->min_rec_header_len += (table->n_nullable + 7) / 8;
+
+	if (verbose) {
 		printf(" - total fields: %i\n", table->fields_count);
 		printf(" - nullable fields: %i\n", table->n_nullable);
 		printf(" - minimum header size: %i\n", table->min_rec_header_len);
@@ -73,6 +72,20 @@ void init_table_defs(int comp) {
 	}
 }
 
+/*******************************************************************/
+void init_table_defs(int comp) {
+	int i;
+
+	printf("Initializing table definitions...\n");
+	table_definitions_cnt = sizeof(table_definitions) / sizeof(table_def_t);
+	printf("There are %d tables defined\n", table_definitions_cnt);
+	set_record_format(comp);
+
+	for (i = 0; i < table_definitions_cnt; i++) {
+		init_table_def(&(table_definitions[i]), true);
+	}
+}
+
 /*******************************************************************/
 int mysql_get_identifier_quote_char(trx_t* trx, const char* name, ulint namelen) {
 	return '"';
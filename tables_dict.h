@@ -63,10 +63,14 @@ typedef enum field_type {
 	FT_BIN			// supported
 } field_type_t;
 
+struct TextConverter;
+
 typedef struct field_def {
 	char *name;
 	char *charset;
 	unsigned int collation_id;
+	// UTF-8 converter for collation_id (compile_record_plan()); shared, not owned
+	const struct TextConverter *text_conv;
 	field_type_t type;
 	unsigned int min_length;
 	unsigned int max_length;
@@ -85,6 +89,8 @@ typedef struct field_def {
 	field_limits_t limits;
 } field_def_t;
 
+struct RecordPlan;
+
 typedef struct table_def {
 	char *name;
 	field_def_t fields[MAX_TABLE_FIELDS];
@@ -93,6 +99,8 @@ typedef struct table_def {
 	long long int data_max_size;
 	int n_nullable;
 	int min_rec_header_len;
+	// Compiled decoder (compile_record_plan()); owned by the table.
+	struct RecordPlan *plan;
 } table_def_t;
 
 extern table_def_t table_definitions[];
@@ -100,5 +108,10 @@ extern int table_definitions_cnt;
 extern int record_extra_bytes;
 
 void init_table_defs(int);
+// record_extra_bytes for COMPACT (comp) or REDUNDANT records.
+void set_record_format(int comp);
+// Record size bounds of one table; init_table_defs() does this for each
+// entry of table_definitions[], printing them.
+void init_table_def(table_def_t *table, bool verbose);
 
 #endif
@@ -0,0 +1,62 @@
+/**
+ * tablespace_map.cc
+ *
+ * mmap() wrapper behind --mmap (mode 3) and ibd_reader_set_mmap() (C API).
+ */
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tablespace_map.h"
+
+TablespaceMap::~TablespaceMap() {
+  close();
+}
+
+bool TablespaceMap::open(int fd, std::string* err) {
+  close();
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    if (err) {
+      *err = std::string("fstat: ") + std::strerror(errno);
+    }
+    return false;
+  }
+  if (st.st_size <= 0) {
+    if (err) {
+      *err = "empty file";
+    }
+    return false;
+  }
+  const size_t len = static_cast<size_t>(st.st_size);
+  void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    if (err) {
+      *err = std::string("mmap: ") + std::strerror(errno);
+    }
+    return false;
+  }
+  base_ = static_cast<unsigned char*>(p);
+  size_ = len;
+  // Until a sweep says otherwise, assume scattered page hops.
+  advise(RANDOM);
+  return true;
+}
+
+void TablespaceMap::close() {
+  if (base_ != nullptr) {
+    munmap(base_, size_);
+    base_ = nullptr;
+    size_ = 0;
+  }
+}
+
+void TablespaceMap::advise(Access access) const {
+  if (base_ == nullptr) {
+    return;
+  }
+  // Advisory only; a failure just leaves the kernel's default read-ahead.
+  (void)madvise(base_, size_,
+                access == SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
@@ -0,0 +1,54 @@
+#ifndef TABLESPACE_MAP_H
+#define TABLESPACE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole tablespace file (--mmap).
+ *
+ * One mapping is shared by the page sweep, XDES lookups, LOB reader and
+ * index discovery, so uncompressed pages are parsed straight out of the
+ * kernel page cache instead of being pread() into private buffers.
+ *
+ * The mapping is MAP_PRIVATE and writable: any accidental store from the
+ * record code lands on a copy-on-write page and never reaches the file.
+ */
+class TablespaceMap {
+ public:
+  enum Access { SEQUENTIAL = 0, RANDOM = 1 };
+
+  TablespaceMap() = default;
+  TablespaceMap(const TablespaceMap&) = delete;
+  TablespaceMap& operator=(const TablespaceMap&) = delete;
+  ~TablespaceMap();
+
+  /** Map the whole of fd; false (with *err set) if it cannot be mapped. */
+  bool open(int fd, std::string* err);
+  void close();
+
+  bool mapped() const { return base_ != nullptr; }
+  size_t size() const { return size_; }
+
+  /** Start of page_no, or nullptr if the page is not entirely mapped. */
+  const unsigned char* page(uint64_t page_no, size_t page_size) const {
+    if (base_ == nullptr || page_size == 0) {
+      return nullptr;
+    }
+    const uint64_t offset = page_no * static_cast<uint64_t>(page_size);
+    if (page_no >= size_ / page_size) {
+      return nullptr;
+    }
+    return base_ + offset;
+  }
+
+  /** madvise() the whole mapping for the access pattern about to start. */
+  void advise(Access access) const;
+
+ private:
+  unsigned char* base_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif  // TABLESPACE_MAP_H
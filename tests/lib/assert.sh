@@ -0,0 +1,54 @@
+# Checks shared by the tests/test_*.sh scripts. Source it after setting
+# PARSER_DIR and IB_PARSER:
+#
+#   . "$(dirname "$0")/lib/assert.sh"
+#
+# Each check prints "OK: ..." or what went wrong, and counts failures;
+# finish_checks reports them and sets the exit status.
+
+VERBOSE=${VERBOSE:-0}
+failures=0
+
+log_verbose() {
+  if [ "$VERBOSE" = "1" ]; then
+    echo -e "\033[0;36m  [CMD] $1\033[0m"
+  fi
+}
+
+# Build ib_parser when the binary is missing.
+require_ib_parser() {
+  if [ ! -f "$IB_PARSER" ]; then
+    echo "ib_parser not found, building..."
+    make -C "$PARSER_DIR/build" -j"$(nproc)"
+  fi
+}
+
+# same EXPECTED ACTUAL MESSAGE: the two files hold the same bytes.
+same() {
+  if cmp -s "$1" "$2"; then
+    echo "OK: $3"
+  else
+    echo "Mismatch: $3 (see $1, $2)"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_grep FILE PATTERN MESSAGE: a line of FILE matches PATTERN.
+expect_grep() {
+  if grep -q "$2" "$1"; then
+    echo "OK: $3"
+  else
+    echo "Missing: $3 (see $1)"
+    failures=$((failures + 1))
+  fi
+}
+
+# finish_checks WHAT: "All WHAT checks passed.", or the failure count and
+# exit status 1.
+finish_checks() {
+  if [ "$failures" -ne 0 ]; then
+    echo "$failures $1 check(s) failed."
+    exit 1
+  fi
+  echo "All $1 checks passed."
+}
@@ -330,6 +330,87 @@ else
 fi
 [ "$JSON_OUTPUT" != "true" ] && echo ""
 
+# Test 15: Parallel parse (--threads output matches serial)
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "PARALLEL_PARSE" "$SCRIPT_DIR/test_parallel_parse.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 16: Verify checksums (mode 6 finds damaged pages)
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "VERIFY_CHECKSUMS" "$SCRIPT_DIR/test_verify_checksums.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 17: Deleted-record recovery (--recover-deleted)
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "RECOVER_DELETED" "$SCRIPT_DIR/test_recover_deleted.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 18: Schema from SDI pages (mode 3 without JSON, --sdi-cache)
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "SDI_FROM_IBD" "$SCRIPT_DIR/test_sdi_from_ibd.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 19: Mode 7 batch parse of a directory and a manifest
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "BATCH_PARSE" "$SCRIPT_DIR/test_batch_parse.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 20: Mode 3 --since-lsn and --checkpoint/--resume
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "INCREMENTAL_RESUME" "$SCRIPT_DIR/test_incremental_resume.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 21: Mode 3 --page-map sidecar
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "PAGE_MAP" "$SCRIPT_DIR/test_page_map.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 22: Mode 3 --shard / --page-range and the shard merge
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "SHARD" "$SCRIPT_DIR/test_shard.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
+# Test 23: Mode 3 --output-compress / --output-split
+TOTAL_TESTS=$((TOTAL_TESTS + 1))
+if run_test "OUTPUT_COMPRESS" "$SCRIPT_DIR/test_output_compress.sh"; then
+    PASSED_TESTS=$((PASSED_TESTS + 1))
+else
+    FAILED_TESTS=$((FAILED_TESTS + 1))
+fi
+[ "$JSON_OUTPUT" != "true" ] && echo ""
+
 SUITE_END_TIME=$(date +%s)
 SUITE_DURATION=$((SUITE_END_TIME - SUITE_START_TIME))
 
@@ -54,7 +54,7 @@ echo ""
 
 # Test 1: Parse rebuilt (uncompressed) file
 echo "Test 1: Parse rebuilt 16KB file"
-RECORD_COUNT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test_rebuilt.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" 2>&1 | grep -c "Found record" || true)
+RECORD_COUNT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test_rebuilt.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" --log-level=trace 2>&1 | grep -c "Found record" || true)
 if [[ "$RECORD_COUNT" -eq 55 ]]; then
     log_pass "Found $RECORD_COUNT records (expected 55)"
 else
@@ -63,7 +63,7 @@ fi
 
 # Test 2: Parse compressed file
 echo "Test 2: Parse compressed 8KB file"
-RECORD_COUNT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" 2>&1 | grep -c "Found record" || true)
+RECORD_COUNT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" --log-level=trace 2>&1 | grep -c "Found record" || true)
 if [[ "$RECORD_COUNT" -eq 55 ]]; then
     log_pass "Found $RECORD_COUNT records (expected 55)"
 else
@@ -109,8 +109,8 @@ fi
 
 # Test 7: Compressed and rebuilt produce same record count
 echo "Test 7: Compressed/rebuilt parity"
-COUNT_REBUILT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test_rebuilt.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" 2>&1 | grep -c "Found record" || true)
-COUNT_COMPRESSED=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" 2>&1 | grep -c "Found record" || true)
+COUNT_REBUILT=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test_rebuilt.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" --log-level=trace 2>&1 | grep -c "Found record" || true)
+COUNT_COMPRESSED=$(${PARSER} 3 "$SCRIPT_DIR/compressed_test.ibd" "$SCRIPT_DIR/compressed_test_sdi.json" --log-level=trace 2>&1 | grep -c "Found record" || true)
 if [[ "$COUNT_REBUILT" -eq "$COUNT_COMPRESSED" ]]; then
     log_pass "Both files yield $COUNT_REBUILT records"
 else
@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 7 over a directory and a manifest of the bundled fixtures: every
+# table's output file must match mode 3 with the same options, at any
+# thread count, and the report must flag the tables that fail.
+# No MySQL needed.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-batch-parse}
+IN_DIR="$OUT_DIR/in"
+
+rm -rf "$OUT_DIR"
+mkdir -p "$IN_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+# types_test keeps its JSON next to it; secondary_index is read from SDI.
+cp "$PARSER_DIR/tests/types_test.ibd" "$PARSER_DIR/tests/types_test_sdi.json" "$IN_DIR/"
+cp "$PARSER_DIR/tests/secondary_index.ibd" "$IN_DIR/"
+
+for name in types_test secondary_index; do
+  "$IB_PARSER" 3 "$PARSER_DIR/tests/$name.ibd" --format=jsonl --with-meta \
+    --output="$OUT_DIR/$name.mode3.jsonl" > /dev/null
+  "$IB_PARSER" 3 "$PARSER_DIR/tests/$name.ibd" --format=csv \
+    --output="$OUT_DIR/$name.mode3.csv" > /dev/null
+done
+
+# Small chunks so both tables are split across the workers.
+for threads in 1 4; do
+  out="$OUT_DIR/dir.t$threads"
+  log_verbose "$IB_PARSER 7 $IN_DIR --output-dir=$out --threads=$threads --format=jsonl --with-meta"
+  IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 7 "$IN_DIR" --output-dir="$out" \
+    --threads="$threads" --format=jsonl --with-meta > "$out.log"
+  for name in types_test secondary_index; do
+    same "$OUT_DIR/$name.mode3.jsonl" "$out/$name.jsonl" "$name: --threads=$threads matches mode 3"
+  done
+  expect_grep "$out/batch_report.json" '"tables":2,"failed":0' "--threads=$threads report totals"
+done
+expect_grep "$OUT_DIR/dir.t4/batch_report.json" '"schema":"sdi"' "secondary_index schema from SDI pages"
+
+# Manifest with a comment, a relative path, a missing file and a name
+# clash: the good tables still come out, the run exits 1.
+mkdir -p "$IN_DIR/other"
+cp "$PARSER_DIR/tests/types_test.ibd" "$IN_DIR/other/"
+cat > "$IN_DIR/tables.manifest" <<MANIFEST
+# table       sdi
+types_test.ibd types_test_sdi.json
+$IN_DIR/secondary_index.ibd
+missing.ibd
+other/types_test.ibd
+MANIFEST
+out="$OUT_DIR/manifest"
+set +e
+"$IB_PARSER" 7 "$IN_DIR/tables.manifest" --output-dir="$out" --format=csv \
+  --report="$OUT_DIR/manifest_report.json" > "$out.log" 2> "$out.err"
+rc=$?
+set -e
+if [ "$rc" -eq 1 ]; then
+  echo "OK: failed tables give exit status 1"
+else
+  echo "Mismatch: exit status $rc, expected 1"
+  failures=$((failures + 1))
+fi
+for name in types_test secondary_index; do
+  same "$OUT_DIR/$name.mode3.csv" "$out/$name.csv" "$name: manifest run matches mode 3"
+done
+expect_grep "$OUT_DIR/manifest_report.json" '"tables":4,"failed":2' "manifest report totals"
+expect_grep "$OUT_DIR/manifest_report.json" 'missing.ibd.*"status":"failed"' "missing table reported"
+expect_grep "$OUT_DIR/manifest_report.json" 'other/types_test.ibd.*another table already writes' "name clash reported"
+
+finish_checks "batch parse"
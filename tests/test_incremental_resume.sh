@@ -0,0 +1,121 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 3 --since-lsn must output exactly the rows on index pages written
+# after the given LSN, and a --checkpoint run resumed from any checkpoint
+# (with junk written after it) must finish with the bytes of an
+# uninterrupted run. No MySQL needed.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-incremental-resume}
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+for name in types_test secondary_index; do
+  ibd="$PARSER_DIR/tests/$name.ibd"
+  base="$OUT_DIR/$name"
+
+  "$IB_PARSER" 3 "$ibd" --format=jsonl --with-meta --stats="$base.stats.json" \
+    --output="$base.full.jsonl" > /dev/null 2>&1
+
+  # One threshold just below each index page's LSN, plus the run's highest
+  # LSN (nothing changed since: no rows). The expected rows are those of
+  # the full run whose page has a newer LSN.
+  thresholds=$(python3 - "$ibd" "$base.stats.json" <<'PY'
+import json, sys
+data = open(sys.argv[1], "rb").read()
+lsns = set()
+for off in range(0, len(data) - 16383, 16384):
+    if int.from_bytes(data[off + 24:off + 26], "big") == 17855:
+        lsns.add(int.from_bytes(data[off + 16:off + 24], "big") - 1)
+lsns.add(json.load(open(sys.argv[2]))["max_lsn"])
+print(" ".join(str(l) for l in sorted(lsns)))
+PY
+)
+  for lsn in $thresholds; do
+    python3 - "$ibd" "$base.full.jsonl" "$lsn" > "$base.expect.$lsn" <<'PY'
+import json, sys
+data = open(sys.argv[1], "rb").read()
+since = int(sys.argv[3])
+for line in open(sys.argv[2]):
+    page = json.loads(line)["page_no"]
+    if int.from_bytes(data[page * 16384 + 16:page * 16384 + 24], "big") > since:
+        sys.stdout.write(line)
+PY
+    log_verbose "$IB_PARSER 3 $ibd --format=jsonl --with-meta --since-lsn=$lsn"
+    for threads in 1 2; do
+      IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" --format=jsonl --with-meta \
+        --since-lsn="$lsn" --threads="$threads" > "$base.since.$lsn.t$threads" 2> /dev/null
+      same "$base.expect.$lsn" "$base.since.$lsn.t$threads" \
+        "$name: --since-lsn=$lsn, $threads thread(s)"
+    done
+  done
+
+  # A checkpoint after every chunk; the last one must say done.
+  for threads in 1 2; do
+    out="$base.ckpt.t$threads.jsonl"
+    IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" --format=jsonl --with-meta \
+      --threads="$threads" --output="$out" --checkpoint --checkpoint-interval=0 \
+      > /dev/null 2>&1
+    same "$base.full.jsonl" "$out" "$name: --checkpoint output, $threads thread(s)"
+    if grep -qx "done=1" "$out.ckpt"; then
+      echo "OK: $name: final checkpoint marked done"
+    else
+      echo "Mismatch: $name: final checkpoint not done (see $out.ckpt)"
+      failures=$((failures + 1))
+    fi
+  done
+
+  # Rewind the checkpoint to the start of every page that has rows (and
+  # to page 0), leave garbage after the recorded length and resume.
+  out="$base.ckpt.t1.jsonl"
+  pages=$(python3 -c '
+import json, sys
+print(" ".join(["0"] + sorted({str(json.loads(l)["page_no"]) for l in open(sys.argv[1])}, key=int)))
+' "$base.full.jsonl")
+  for page in $pages; do
+    resumed="$base.resume.$page.jsonl"
+    python3 - "$base.full.jsonl" "$out.ckpt" "$page" "$resumed" <<'PY'
+import json, sys
+full, ckpt, page, resumed = sys.argv[1], sys.argv[2], int(sys.argv[3]), sys.argv[4]
+kept = b""
+for line in open(full, "rb"):
+    if json.loads(line)["page_no"] >= page:
+        break
+    kept += line
+open(resumed, "wb").write(kept + b'{"half a row": ')
+lines = []
+for line in open(ckpt).read().splitlines():
+    key = line.split("=", 1)[0]
+    if key == "next_page":
+        line = "next_page=%d" % page
+    elif key == "output_bytes":
+        line = "output_bytes=%d" % len(kept)
+    elif key == "done":
+        line = "done=0"
+    elif key in ("rows", "records_valid", "leaf_pages"):
+        line = key + "=0"
+    lines.append(line)
+open(resumed + ".ckpt", "w").write("\n".join(lines) + "\n")
+PY
+    log_verbose "$IB_PARSER 3 $ibd --format=jsonl --with-meta --output=$resumed --resume"
+    "$IB_PARSER" 3 "$ibd" --format=jsonl --with-meta --output="$resumed" \
+      --checkpoint --resume > /dev/null 2>&1
+    same "$base.full.jsonl" "$resumed" "$name: resumed at page $page"
+  done
+
+  # Other options than the checkpoint was written with: refuse.
+  if "$IB_PARSER" 3 "$ibd" --format=csv --output="$out" --resume > /dev/null 2>&1; then
+    echo "Mismatch: $name: --resume with other options was accepted"
+    failures=$((failures + 1))
+  else
+    echo "OK: $name: --resume with other options refused"
+  fi
+done
+
+finish_checks "incremental and resume"
@@ -0,0 +1,165 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 3 --output-compress and --output-split must write the bytes of a
+# plain --output run: decompressed with the stock zstd / lz4 tools, and
+# with the split files joined (minus their repeated header lines). Files
+# must split between rows only, also when a pipe-format value holds a
+# newline (NEWLINE_IBD, or a table made in a local MySQL when the client
+# can connect). No MySQL needed otherwise; compressions whose tool is
+# missing are skipped.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-output-compress}
+NEWLINE_IBD=${NEWLINE_IBD:-}
+MYSQL_DATA_DIR=${MYSQL_DATA_DIR:-/var/lib/mysql}
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+# Join split files back into one: the first keeps its header line.
+join_parts() {
+  local fmt=$1 out=$2
+  shift 2
+  : > "$out"
+  local first=1
+  for part in "$@"; do
+    if [ "$first" = "1" ] || [ "$fmt" = "jsonl" ]; then
+      cat "$part" >> "$out"
+    else
+      tail -n +2 "$part" >> "$out"
+    fi
+    first=0
+  done
+}
+
+# check_split IBD NAME FMT: split at one byte (one row per file), the
+# output has one file per row written, and joins back to the full run.
+check_split() {
+  local ibd=$1 name=$2 fmt=$3
+  local dir="$OUT_DIR/$name.rows.$fmt"
+  mkdir -p "$dir"
+  "$IB_PARSER" 3 "$ibd" --format="$fmt" --output="$dir.full" > /dev/null 2>&1
+  log_verbose "$IB_PARSER 3 $ibd --format=$fmt --output-split=1"
+  "$IB_PARSER" 3 "$ibd" --format="$fmt" --output="$dir/rows.$fmt" --output-split=1 \
+    --stats="$dir.stats.json" > /dev/null 2>&1
+  local parts=()
+  mapfile -t parts < <(ls "$dir"/rows.* | sort -V)
+  local rows
+  rows=$(grep -o '"rows":[0-9]*' "$dir.stats.json" | head -1 | cut -d: -f2)
+  if [ "${#parts[@]}" = "$rows" ]; then
+    echo "OK: $name: $fmt, one file per row ($rows)"
+  else
+    echo "Mismatch: $name: $fmt, ${#parts[@]} files for $rows rows (see $dir)"
+    failures=$((failures + 1))
+  fi
+  join_parts "$fmt" "$dir.joined" "${parts[@]}"
+  same "$dir.full" "$dir.joined" "$name: $fmt, one row per file joins back"
+}
+
+compressions=(none)
+for c in zstd lz4; do
+  if command -v "$c" > /dev/null 2>&1; then
+    compressions+=("$c")
+  else
+    echo "SKIP: $c not installed"
+  fi
+done
+
+for name in types_test secondary_index; do
+  ibd="$PARSER_DIR/tests/$name.ibd"
+  base="$OUT_DIR/$name"
+
+  for fmt in pipe csv jsonl; do
+    "$IB_PARSER" 3 "$ibd" --format="$fmt" --with-meta --output="$base.full.$fmt" \
+      > /dev/null 2>&1
+    size=$(stat -c %s "$base.full.$fmt")
+
+    for c in "${compressions[@]}"; do
+      ext=$fmt
+      copts=""
+      if [ "$c" != "none" ]; then
+        ext="$fmt.$c"
+        copts="--output-compress=$c"
+      fi
+      for threads in 1 2; do
+        # Whole file, then split at about a third (several files) and at
+        # one byte (one row, or one --threads chunk, per file).
+        for split in 0 $((size / 3 + 1)) 1; do
+          dir="$base.$c.$threads.$split"
+          mkdir -p "$dir"
+          sopts=""
+          if [ "$split" != "0" ]; then
+            sopts="--output-split=$split"
+          fi
+          log_verbose "$IB_PARSER 3 $ibd --format=$fmt $copts $sopts --threads=$threads"
+          # shellcheck disable=SC2086
+          IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" --format="$fmt" --with-meta \
+            --output="$dir/rows.$ext" $copts $sopts --threads="$threads" \
+            > /dev/null 2>&1
+          if ls "$dir"/*.partial > /dev/null 2>&1; then
+            echo "Mismatch: $name: .partial files left in $dir"
+            failures=$((failures + 1))
+          fi
+          plain=()
+          while read -r f; do
+            if [ "$c" != "none" ]; then
+              "$c" -dc "$f" > "$f.out"
+              plain+=("$f.out")
+            else
+              plain+=("$f")
+            fi
+          done < <(ls "$dir"/rows.* | sort -V)
+          join_parts "$fmt" "$dir.joined" "${plain[@]}"
+          same "$base.full.$fmt" "$dir.joined" \
+            "$name: $fmt, $c, split $split, ${#plain[@]} file(s), $threads thread(s)"
+        done
+      done
+    done
+    check_split "$ibd" "$name" "$fmt"
+  done
+
+  if "$IB_PARSER" 3 "$ibd" --output-split=1M > /dev/null 2>&1; then
+    echo "Mismatch: $name: --output-split without --output was accepted"
+    failures=$((failures + 1))
+  else
+    echo "OK: $name: --output-split without --output refused"
+  fi
+  if "$IB_PARSER" 3 "$ibd" --output="$base.ckpt.csv" --output-compress=zstd --checkpoint \
+    > /dev/null 2>&1; then
+    echo "Mismatch: $name: --output-compress with --checkpoint was accepted"
+    failures=$((failures + 1))
+  else
+    echo "OK: $name: --output-compress with --checkpoint refused"
+  fi
+done
+
+# Pipe format writes TEXT values raw, newlines included: no file may end
+# inside such a row.
+if [ -z "$NEWLINE_IBD" ] && mysql -uroot -e "SELECT 1" > /dev/null 2>&1; then
+  db=test_output_split_newline
+  log_verbose "CREATE TABLE $db.t (id INT PRIMARY KEY, note TEXT) with newlines"
+  mysql -uroot -e "DROP DATABASE IF EXISTS $db; CREATE DATABASE $db;
+    CREATE TABLE $db.t (id INT PRIMARY KEY, note TEXT);
+    INSERT INTO $db.t VALUES (1, 'one line'), (2, 'two\nlines'),
+      (3, 'three\nmore\nlines'), (4, '\n'), (5, 'last');"
+  # The copy must happen while FOR EXPORT holds the table flushed.
+  NEWLINE_IBD="$OUT_DIR/newline.ibd"
+  mysql -uroot "$db" -e "FLUSH TABLES t FOR EXPORT;
+    system sudo cp $MYSQL_DATA_DIR/$db/t.ibd $NEWLINE_IBD
+    system sudo chmod 644 $NEWLINE_IBD
+    UNLOCK TABLES;"
+  mysql -uroot -e "DROP DATABASE $db"
+fi
+if [ -z "$NEWLINE_IBD" ] || [ ! -f "$NEWLINE_IBD" ]; then
+  echo "SKIP: no table with newlines in TEXT values (set NEWLINE_IBD or run MySQL)"
+else
+  check_split "$NEWLINE_IBD" newline pipe
+  check_split "$NEWLINE_IBD" newline csv
+fi
+
+finish_checks "output compression"
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 3 --page-map must give the bytes of a run without it, on one and
+# two threads and over mmap, while reading fewer pages; the sidecar must
+# be reused, and rebuilt once damaged or once the tablespace changes.
+# No MySQL needed.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-page-map}
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+for name in types_test secondary_index; do
+  # A copy, so the default sidecar lands here and the mtime can change.
+  ibd="$OUT_DIR/$name.ibd"
+  cp "$PARSER_DIR/tests/$name.ibd" "$ibd"
+  base="$OUT_DIR/$name"
+
+  "$IB_PARSER" 3 "$ibd" --format=jsonl --with-meta --output="$base.plain.jsonl" \
+    > /dev/null 2>&1
+
+  log_verbose "$IB_PARSER 3 $ibd --page-map --format=jsonl --with-meta"
+  "$IB_PARSER" 3 "$ibd" --page-map --log-level=info --format=jsonl --with-meta \
+    --stats="$base.stats.json" --output="$base.built.jsonl" 2> "$base.built.log" > /dev/null
+  same "$base.plain.jsonl" "$base.built.jsonl" "$name: output with a new page map"
+  expect_grep "$base.built.log" "Page map: wrote $ibd.pagemap" "$name: sidecar written"
+  skipped=$(python3 -c 'import json, sys; print(json.load(open(sys.argv[1]))["pages_skipped"])' \
+    "$base.stats.json")
+  if [ "$skipped" -gt 0 ]; then
+    echo "OK: $name: $skipped pages not read"
+  else
+    echo "Mismatch: $name: the page map skipped no page (see $base.stats.json)"
+    failures=$((failures + 1))
+  fi
+
+  for opts in "--threads=1" "--threads=2" "--threads=2 --mmap" "--mmap"; do
+    tag=$(echo "$opts" | tr -d ' -=')
+    # shellcheck disable=SC2086
+    IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" --page-map --log-level=info \
+      --format=jsonl --with-meta $opts --output="$base.$tag.jsonl" \
+      2> "$base.$tag.log" > /dev/null
+    same "$base.plain.jsonl" "$base.$tag.jsonl" "$name: sidecar reused, $opts"
+    expect_grep "$base.$tag.log" "Page map: read $ibd.pagemap" "$name: sidecar read, $opts"
+  done
+
+  # Flip one byte of the body: ignored, output unchanged, rewritten.
+  python3 - "$ibd.pagemap" <<'PY'
+import sys
+path = sys.argv[1]
+data = bytearray(open(path, "rb").read())
+data[-1] ^= 0xff
+open(path, "wb").write(data)
+PY
+  "$IB_PARSER" 3 "$ibd" --page-map --log-level=info --format=jsonl --with-meta \
+    --output="$base.damaged.jsonl" 2> "$base.damaged.log" > /dev/null
+  same "$base.plain.jsonl" "$base.damaged.jsonl" "$name: damaged sidecar, output unchanged"
+  expect_grep "$base.damaged.log" "Ignoring page map" "$name: damaged sidecar ignored"
+  expect_grep "$base.damaged.log" "Page map: wrote" "$name: damaged sidecar rewritten"
+
+  # A tablespace touched since the map was made: stale, rebuilt.
+  touch -d "+1 minute" "$ibd"
+  "$IB_PARSER" 3 "$ibd" --page-map="$base.other.pagemap" --log-level=info \
+    --format=jsonl --with-meta --output="$base.path.jsonl" 2> "$base.path.log" > /dev/null
+  same "$base.plain.jsonl" "$base.path.jsonl" "$name: --page-map=PATH output"
+  expect_grep "$base.path.log" "Page map: wrote $base.other.pagemap" "$name: --page-map=PATH written"
+  "$IB_PARSER" 3 "$ibd" --page-map --log-level=info --format=jsonl --with-meta \
+    --output="$base.stale.jsonl" 2> "$base.stale.log" > /dev/null
+  same "$base.plain.jsonl" "$base.stale.jsonl" "$name: stale sidecar, output unchanged"
+  expect_grep "$base.stale.log" "Ignoring page map" "$name: stale sidecar ignored"
+done
+
+finish_checks "page map"
@@ -0,0 +1,133 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Compare single-threaded mode 3 output against --threads runs on the
+# bundled fixtures. No MySQL needed.
+
+VERBOSE=${VERBOSE:-0}
+log_verbose() {
+  if [ "$VERBOSE" = "1" ]; then
+    echo -e "\033[0;36m  [CMD] $1\033[0m"
+  fi
+}
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-parallel-parse}
+THREADS=${THREADS:-4}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$IB_PARSER" ]; then
+  echo "ib_parser not found, building..."
+  make -C "$PARSER_DIR/build" -j"$(nproc)"
+fi
+
+# fixture ibd, sdi json, extra parser args
+FIXTURES=(
+  "$PARSER_DIR/tests/types_test.ibd|$PARSER_DIR/tests/types_test_sdi.json|"
+  "$PARSER_DIR/tests/secondary_index.ibd|$PARSER_DIR/tests/secondary_index_sdi.json|--index=idx_ab"
+)
+
+failures=0
+for entry in "${FIXTURES[@]}"; do
+  IFS='|' read -r ibd sdi extra <<< "$entry"
+  name=$(basename "$ibd" .ibd)
+  for fmt in pipe csv jsonl; do
+    base="$OUT_DIR/${name}.${fmt}"
+    # shellcheck disable=SC2086
+    log_verbose "$IB_PARSER 3 $ibd $sdi $extra --format=$fmt --with-meta"
+    "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format="$fmt" --with-meta \
+      --log-level=info --output="$base.serial" > /dev/null 2> "$base.serial.log"
+
+    # One page per chunk so the ordered merge is actually exercised.
+    # shellcheck disable=SC2086
+    IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format="$fmt" --with-meta \
+      --log-level=info --threads="$THREADS" --output="$base.threads" \
+      > /dev/null 2> "$base.threads.log"
+
+    # shellcheck disable=SC2086
+    IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format="$fmt" --with-meta \
+      --threads="$THREADS" --unordered --output="$base.unordered" > /dev/null
+
+    if cmp -s "$base.serial" "$base.threads"; then
+      echo "OK: $name $fmt --threads=$THREADS matches serial output"
+    else
+      echo "Mismatch: $name $fmt --threads=$THREADS (see $base.*)"
+      failures=$((failures + 1))
+    fi
+
+    # Every chunk spilled to a temporary file must still give the same bytes.
+    # shellcheck disable=SC2086
+    IB_PARSER_CHUNK_PAGES=1 IB_PARSER_CHUNK_SPILL_BYTES=1 TMPDIR="$OUT_DIR" \
+      "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format="$fmt" --with-meta \
+      --threads="$THREADS" --output="$base.spilled" > /dev/null
+    if cmp -s "$base.serial" "$base.spilled"; then
+      echo "OK: $name $fmt --threads=$THREADS with spilled chunks matches serial output"
+    else
+      echo "Mismatch: $name $fmt --threads=$THREADS with spilled chunks (see $base.*)"
+      failures=$((failures + 1))
+    fi
+
+    if cmp -s "$base.serial.log" "$base.threads.log"; then
+      echo "OK: $name $fmt --threads=$THREADS log matches serial log"
+    else
+      echo "Mismatch: $name $fmt --threads=$THREADS log (see $base.*.log)"
+      failures=$((failures + 1))
+    fi
+
+    if cmp -s <(sort "$base.serial") <(sort "$base.unordered"); then
+      echo "OK: $name $fmt --unordered has the same rows"
+    else
+      echo "Mismatch: $name $fmt --unordered rows (see $base.*)"
+      failures=$((failures + 1))
+    fi
+  done
+
+  # Without --output, stdout carries the rows and nothing else from the parse.
+  base="$OUT_DIR/${name}.stdout"
+  # shellcheck disable=SC2086
+  "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format=jsonl --log-level=trace \
+    > "$base.out" 2> "$base.log"
+  if grep -q "Found record" "$base.log" && \
+     ! grep -v -e '^{' -e '^Parse-only complete' "$base.out" | grep -q .; then
+    echo "OK: $name diagnostics stay off stdout"
+  else
+    echo "Mismatch: $name stdout has non-row lines (see $base.out)"
+    failures=$((failures + 1))
+  fi
+
+  # --stats: serial and threaded runs must count the same rows and records,
+  # and the row count must match the JSONL output.
+  base="$OUT_DIR/${name}.stats"
+  # shellcheck disable=SC2086
+  "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format=jsonl --output="$base.serial.jsonl" \
+    --stats="$base.serial.json" > /dev/null
+  # shellcheck disable=SC2086
+  IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" "$sdi" $extra --format=jsonl \
+    --threads="$THREADS" --output="$base.threads.jsonl" \
+    --stats="$base.threads.json" > /dev/null
+  if python3 - "$base.serial.json" "$base.threads.json" "$base.serial.jsonl" <<'PY'
+import json, sys
+serial, threads = (json.load(open(p)) for p in sys.argv[1:3])
+rows = sum(1 for _ in open(sys.argv[3]))
+keys = ("pages", "leaf_pages", "records_valid", "records_invalid",
+        "records_deleted", "rows", "bytes_written")
+ok = serial["rows"] == rows and all(serial[k] == threads[k] for k in keys)
+ok = ok and set(serial["stages"]) == {"read", "xdes", "decompress", "parse",
+                                      "lob", "format", "write"}
+sys.exit(0 if ok else 1)
+PY
+  then
+    echo "OK: $name --stats counters agree (serial, --threads, output rows)"
+  else
+    echo "Mismatch: $name --stats counters (see $base.*.json)"
+    failures=$((failures + 1))
+  fi
+done
+
+if [ "$failures" -ne 0 ]; then
+  echo "$failures parallel parse comparison(s) failed."
+  exit 1
+fi
+echo "All parallel parse comparisons passed."
@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 3 without a JSON file reads the table definition from the
+# tablespace's SDI pages; the output must match the ibd2sdi JSON run, with
+# and without --sdi-cache, and a damaged cache artifact must be ignored.
+# No MySQL needed.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-sdi-from-ibd}
+CACHE_DIR="$OUT_DIR/cache"
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+for name in types_test secondary_index; do
+  ibd="$PARSER_DIR/tests/$name.ibd"
+  sdi="$PARSER_DIR/tests/${name}_sdi.json"
+  base="$OUT_DIR/$name"
+
+  "$IB_PARSER" 3 "$ibd" "$sdi" --format=jsonl > "$base.json.rows"
+  log_verbose "$IB_PARSER 3 $ibd --format=jsonl"
+  "$IB_PARSER" 3 "$ibd" --format=jsonl > "$base.sdi.rows"
+  same "$base.json.rows" "$base.sdi.rows" "$name: SDI pages give the JSON rows"
+
+  "$IB_PARSER" 3 "$ibd" "$sdi" --list-indexes > "$base.json.indexes"
+  "$IB_PARSER" 3 "$ibd" --list-indexes > "$base.sdi.indexes"
+  same "$base.json.indexes" "$base.sdi.indexes" "$name: same index list"
+
+  log_verbose "$IB_PARSER 3 $ibd --sdi-cache=$CACHE_DIR --format=jsonl"
+  "$IB_PARSER" 3 "$ibd" --sdi-cache="$CACHE_DIR" --log-level=info \
+    --format=jsonl --output="$base.miss.rows" 2> "$base.miss.log"
+  same "$base.json.rows" "$base.miss.rows" "$name: cache miss output"
+  expect_grep "$base.miss.log" "SDI schema cache: wrote" "$name: artifact written"
+
+  "$IB_PARSER" 3 "$ibd" --sdi-cache="$CACHE_DIR" --log-level=info \
+    --format=jsonl --output="$base.hit.rows" 2> "$base.hit.log"
+  same "$base.json.rows" "$base.hit.rows" "$name: cache hit output"
+  expect_grep "$base.hit.log" "SDI schema cache hit" "$name: artifact reused"
+done
+
+# Flip one byte in the body of every artifact: each must be ignored,
+# the output unchanged, and the artifact rewritten.
+artifacts=$(find "$CACHE_DIR" -name '*.ibschema' | wc -l)
+if [ "$artifacts" -ne 2 ]; then
+  echo "Mismatch: expected 2 artifacts in $CACHE_DIR, found $artifacts"
+  failures=$((failures + 1))
+fi
+for artifact in "$CACHE_DIR"/*.ibschema; do
+  python3 - "$artifact" <<'PY'
+import sys
+path = sys.argv[1]
+data = bytearray(open(path, "rb").read())
+data[-1] ^= 0xff
+open(path, "wb").write(data)
+PY
+done
+
+ibd="$PARSER_DIR/tests/types_test.ibd"
+base="$OUT_DIR/types_test"
+"$IB_PARSER" 3 "$ibd" --sdi-cache="$CACHE_DIR" --log-level=info \
+  --format=jsonl --output="$base.corrupt.rows" 2> "$base.corrupt.log"
+same "$base.json.rows" "$base.corrupt.rows" "damaged artifact: output unchanged"
+expect_grep "$base.corrupt.log" "Ignoring schema artifact" "damaged artifact ignored"
+expect_grep "$base.corrupt.log" "SDI schema cache: wrote" "damaged artifact rewritten"
+
+"$IB_PARSER" 3 "$ibd" --sdi-cache="$CACHE_DIR" --log-level=info \
+  --format=jsonl --output="$base.rewritten.rows" 2> "$base.rewritten.log"
+expect_grep "$base.rewritten.log" "SDI schema cache hit" "rewritten artifact reused"
+
+finish_checks "SDI-from-tablespace"
@@ -86,6 +86,19 @@ else
 fi
 echo ""
 
+# Step 3b: Single-threaded rebuild must give the same bytes
+echo -e "${YELLOW}Step 3b: Comparing with a --threads=1 rebuild${NC}"
+echo -e "${CYAN}  [CMD] ./build/ib_parser 5 $SOURCE_IBD $OUTPUT_FILE.serial --sdi-json=$SOURCE_SDI --threads=1${NC}"
+if ./build/ib_parser 5 "$SOURCE_IBD" "$OUTPUT_FILE.serial" --sdi-json="$SOURCE_SDI" --threads=1 >/dev/null 2>&1 &&
+   cmp -s "$OUTPUT_FILE" "$OUTPUT_FILE.serial"; then
+    echo -e "${GREEN}  ✓ Parallel and serial rebuilds are identical${NC}"
+    rm -f "$OUTPUT_FILE.serial"
+else
+    echo -e "${RED}  ✗ Parallel rebuild differs from --threads=1 ($OUTPUT_FILE.serial)${NC}"
+    exit 1
+fi
+echo ""
+
 # Step 4: Test with ibd2sdi
 echo -e "${YELLOW}Step 4: Testing with ibd2sdi${NC}"
 echo -e "${CYAN}  [CMD] ibd2sdi $OUTPUT_FILE${NC}"
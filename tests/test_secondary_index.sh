@@ -126,6 +126,76 @@ else
   exit 1
 fi
 
+echo "==> Parsing secondary index with --scan=btree (key order)"
+btree_out="$OUT_DIR/ib_parser_btree.jsonl"
+"$IB_PARSER" 3 "$OUT_IBD" "$OUT_SDI" \
+  --index="$INDEX_NAME" \
+  --scan=btree \
+  --format=jsonl \
+  --output="$btree_out" \
+  > "$OUT_DIR/ib_parser_btree.log" 2>&1
+
+if grep -q "B-tree scan aborted" "$OUT_DIR/ib_parser_btree.log"; then
+  echo "B-tree scan fell back to sweep: see $OUT_DIR/ib_parser_btree.log"
+  exit 1
+fi
+
+python3 - "$btree_out" "$OUT_DIR/ib_parser_btree.norm" <<'PY'
+import json
+import sys
+
+inp, outp = sys.argv[1], sys.argv[2]
+with open(inp, "r", encoding="utf-8") as f, open(outp, "w", encoding="utf-8") as out:
+    for line in f:
+        line = line.strip()
+        if not line:
+            continue
+        obj = json.loads(line)
+        out.write(json.dumps(obj, sort_keys=True, separators=(",", ":")) + "\n")
+PY
+
+# Leaf-chain order is index key order, i.e. MySQL's ORDER BY a, b, id.
+if diff -u "$OUT_DIR/mysql.norm" "$OUT_DIR/ib_parser_btree.norm"; then
+  echo "OK: --scan=btree output matches MySQL in key order."
+else
+  echo "Mismatch: --scan=btree output differs, see $OUT_DIR for details."
+  exit 1
+fi
+
+echo "==> Parsing secondary index with --scan=btree --where (key range)"
+where_out="$OUT_DIR/ib_parser_where.jsonl"
+"$IB_PARSER" 3 "$OUT_IBD" "$OUT_SDI" \
+  --index="$INDEX_NAME" \
+  --scan=btree \
+  --where="a BETWEEN 15 AND 20" \
+  --format=jsonl \
+  --output="$where_out" \
+  > "$OUT_DIR/ib_parser_where.log" 2>&1
+
+"${MYSQL[@]}" -N -B \
+  -e "SELECT JSON_OBJECT('a', a, 'b', b, 'id', id)
+      FROM ${DB_NAME}.${TABLE_NAME}
+      WHERE a BETWEEN 15 AND 20
+      ORDER BY a, b, id;" \
+  > "$OUT_DIR/mysql_where.jsonl"
+
+python3 - "$where_out" "$OUT_DIR/mysql_where.jsonl" <<'PY'
+import json
+import sys
+
+def norm(path):
+    with open(path, "r", encoding="utf-8") as f:
+        return [json.dumps(json.loads(l), sort_keys=True) for l in f if l.strip()]
+
+got, want = norm(sys.argv[1]), norm(sys.argv[2])
+if got != want:
+    print("Mismatch: --where output differs")
+    print("  got: ", got)
+    print("  want:", want)
+    sys.exit(1)
+PY
+echo "OK: --where output matches MySQL WHERE a BETWEEN 15 AND 20."
+
 echo "==> Fixture written to:"
 echo "    $OUT_IBD"
 echo "    $OUT_SDI"
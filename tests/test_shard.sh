@@ -0,0 +1,110 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 3 --page-range / --shard runs, joined by scripts/merge_shards.py
+# from their --shard-manifest files, must give the bytes of one unsharded
+# run for any split; the merge must refuse a missing shard, overlapping
+# ranges and a changed output. No MySQL needed.
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+MERGE=${MERGE:-$PARSER_DIR/scripts/merge_shards.py}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-shard}
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+
+. "$(dirname "$0")/lib/assert.sh"
+require_ib_parser
+
+refused() {
+  if python3 "$MERGE" --check "${@:2}" > /dev/null 2>&1; then
+    echo "Mismatch: merge accepted $1"
+    failures=$((failures + 1))
+  else
+    echo "OK: merge refuses $1"
+  fi
+}
+
+for name in types_test secondary_index; do
+  ibd="$PARSER_DIR/tests/$name.ibd"
+  base="$OUT_DIR/$name"
+  pages=$(( $(stat -c %s "$ibd") / 16384 ))
+
+  for fmt in csv jsonl; do
+    "$IB_PARSER" 3 "$ibd" --format="$fmt" --with-meta --output="$base.full.$fmt" \
+      > /dev/null 2>&1
+
+    # --shard=I/N for several N, with and without the page map (which
+    # moves the cuts), on one and two threads.
+    for opts in "" "--page-map" "--threads=2" "--page-map --threads=2"; do
+      tag=$(echo "$opts" | tr -d ' -=')
+      for n in 1 2 3 5; do
+        manifests=()
+        for ((i = 0; i < n; i++)); do
+          out="$base.shard$tag.$n.$i.$fmt"
+          log_verbose "$IB_PARSER 3 $ibd --shard=$i/$n $opts --format=$fmt --shard-manifest"
+          # shellcheck disable=SC2086
+          IB_PARSER_CHUNK_PAGES=1 "$IB_PARSER" 3 "$ibd" --shard="$i/$n" $opts \
+            --format="$fmt" --with-meta --output="$out" --shard-manifest > /dev/null 2>&1
+          manifests+=("$out.manifest")
+        done
+        python3 "$MERGE" --output="$base.merged$tag.$n.$fmt" "${manifests[@]}" 2> /dev/null
+        same "$base.full.$fmt" "$base.merged$tag.$n.$fmt" "$name: $fmt, $n shards $opts"
+      done
+    done
+
+    # --page-range cut at every page: each row exactly once.
+    for ((cut = 0; cut <= pages; cut++)); do
+      "$IB_PARSER" 3 "$ibd" --page-range="0:$cut" --format="$fmt" --with-meta \
+        --output="$base.head.$cut.$fmt" --shard-manifest > /dev/null 2>&1
+      "$IB_PARSER" 3 "$ibd" --page-range="$cut:" --format="$fmt" --with-meta \
+        --output="$base.tail.$cut.$fmt" --shard-manifest > /dev/null 2>&1
+      python3 "$MERGE" --output="$base.cut.$cut.$fmt" \
+        "$base.head.$cut.$fmt.manifest" "$base.tail.$cut.$fmt.manifest" 2> /dev/null
+      same "$base.full.$fmt" "$base.cut.$cut.$fmt" "$name: $fmt, pages cut at $cut"
+    done
+  done
+
+  # Row counts and keys: the manifests of a two-way cut add up to the
+  # full run, and the keys are those of its first and last row.
+  cut=$((pages / 2))
+  python3 - "$base.full.jsonl" "$base.head.$cut.jsonl.manifest" \
+    "$base.tail.$cut.jsonl.manifest" <<'PY' || failures=$((failures + 1))
+import json, sys
+rows = [json.loads(l) for l in open(sys.argv[1])]
+shards = []
+for path in sys.argv[2:]:
+    m = dict(l.split("=", 1) for l in open(path).read().splitlines()[1:])
+    shards.append(m)
+if sum(int(m["rows"]) for m in shards) != len(rows):
+    sys.exit("Mismatch: manifest row counts do not add up to %d" % len(rows))
+keyed = [m for m in shards if m["first_key"]]
+first_key = json.loads(keyed[0]["first_key"])
+last_key = json.loads(keyed[-1]["last_key"])
+first_row = list(rows[0].values())[3:3 + len(first_key)]
+last_row = list(rows[-1].values())[3:3 + len(last_key)]
+if first_key != first_row or last_key != last_row:
+    sys.exit("Mismatch: manifest keys %s..%s, rows %s..%s" %
+             (first_key, last_key, first_row, last_row))
+print("OK: manifest rows and keys")
+PY
+
+  # Gaps, overlaps and damaged outputs.
+  head="$base.head.$cut.csv.manifest"
+  tail="$base.tail.$cut.csv.manifest"
+  refused "a missing shard" "$head"
+  refused "overlapping ranges" "$head" "$base.tail.0.csv.manifest"
+  refused "shards of different formats" "$head" "$base.tail.$cut.jsonl.manifest"
+  echo "1,2,3" >> "$base.tail.$cut.csv"
+  refused "a changed output" "$head" "$tail"
+
+  if "$IB_PARSER" 3 "$ibd" --shard=2/2 --output="$base.bad.csv" > /dev/null 2>&1; then
+    echo "Mismatch: $name: --shard=2/2 was accepted"
+    failures=$((failures + 1))
+  else
+    echo "OK: $name: --shard=2/2 refused"
+  fi
+done
+
+finish_checks "shard"
@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Mode 6 checksum scan: the bundled fixtures must verify clean, and copies
+# with a flipped byte / torn trailer must report exactly those pages.
+# A ROW_FORMAT=COMPRESSED tablespace (COMPRESSED_IBD, or one exported from
+# a local MySQL when the client can connect) must verify clean too and
+# report a flipped byte; that case is skipped when neither is available.
+
+VERBOSE=${VERBOSE:-0}
+log_verbose() {
+  if [ "$VERBOSE" = "1" ]; then
+    echo -e "\033[0;36m  [CMD] $1\033[0m"
+  fi
+}
+
+PARSER_DIR=${PARSER_DIR:-/home/cslog/mysql/innodb-parser}
+IB_PARSER=${IB_PARSER:-$PARSER_DIR/build/ib_parser}
+OUT_DIR=${OUT_DIR:-/tmp/ibd-verify-checksums}
+THREADS=${THREADS:-4}
+PAGE_SIZE=16384
+COMPRESSED_IBD=${COMPRESSED_IBD:-}
+ZIP_PAGE_SIZE=${ZIP_PAGE_SIZE:-8192}
+MYSQL_DATA_DIR=${MYSQL_DATA_DIR:-/var/lib/mysql}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$IB_PARSER" ]; then
+  echo "ib_parser not found, building..."
+  make -C "$PARSER_DIR/build" -j"$(nproc)"
+fi
+
+failures=0
+for ibd in "$PARSER_DIR/tests/types_test.ibd" "$PARSER_DIR/tests/secondary_index.ibd"; do
+  name=$(basename "$ibd" .ibd)
+
+  log_verbose "$IB_PARSER 6 $ibd --threads=$THREADS"
+  if "$IB_PARSER" 6 "$ibd" --threads="$THREADS" > "$OUT_DIR/$name.clean.log"; then
+    echo "OK: $name verifies clean"
+  else
+    echo "FAIL: $name reported corrupt pages (see $OUT_DIR/$name.clean.log)"
+    failures=$((failures + 1))
+  fi
+
+  # Page 3: flip a body byte. Page 4: break the trailer LSN.
+  damaged="$OUT_DIR/$name.damaged.ibd"
+  cp "$ibd" "$damaged"
+  printf '\xff' | dd of="$damaged" bs=1 seek=$((3 * PAGE_SIZE + 200)) conv=notrunc 2>/dev/null
+  printf '\x01' | dd of="$damaged" bs=1 seek=$((5 * PAGE_SIZE - 1)) conv=notrunc 2>/dev/null
+
+  log_verbose "$IB_PARSER --verify-checksums $damaged --threads=$THREADS"
+  if "$IB_PARSER" --verify-checksums "$damaged" --threads="$THREADS" > "$OUT_DIR/$name.damaged.log"; then
+    echo "FAIL: $name damaged copy verified clean"
+    failures=$((failures + 1))
+    continue
+  fi
+  reported=$(grep -o '^Page [0-9]*' "$OUT_DIR/$name.damaged.log" | awk '{print $2}' | tr '\n' ' ')
+  if [ "$reported" = "3 4 " ]; then
+    echo "OK: $name damaged copy reports pages 3 and 4"
+  else
+    echo "FAIL: $name damaged copy reported '$reported' (see $OUT_DIR/$name.damaged.log)"
+    failures=$((failures + 1))
+  fi
+done
+
+# ROW_FORMAT=COMPRESSED: page_zip_calc_checksum() over ZIP_PAGE_SIZE pages.
+if [ -z "$COMPRESSED_IBD" ] && mysql -uroot -e "SELECT 1" > /dev/null 2>&1; then
+  db=test_verify_zip_checksums
+  log_verbose "CREATE TABLE $db.t ... ROW_FORMAT=COMPRESSED"
+  mysql -uroot -e "DROP DATABASE IF EXISTS $db; CREATE DATABASE $db;
+    CREATE TABLE $db.t (id INT PRIMARY KEY AUTO_INCREMENT, data VARCHAR(255))
+      ROW_FORMAT=COMPRESSED KEY_BLOCK_SIZE=$((ZIP_PAGE_SIZE / 1024));
+    INSERT INTO $db.t (data) VALUES (REPEAT('a', 200)), (REPEAT('b', 200));"
+  for _ in 1 2 3 4 5 6 7 8; do
+    mysql -uroot -e "INSERT INTO $db.t (data) SELECT data FROM $db.t"
+  done
+  # The copy must happen while FOR EXPORT holds the table flushed.
+  COMPRESSED_IBD="$OUT_DIR/zip.ibd"
+  mysql -uroot "$db" -e "FLUSH TABLES t FOR EXPORT;
+    system sudo cp $MYSQL_DATA_DIR/$db/t.ibd $COMPRESSED_IBD
+    system sudo chmod 644 $COMPRESSED_IBD
+    UNLOCK TABLES;"
+  mysql -uroot -e "DROP DATABASE $db"
+fi
+
+if [ -z "$COMPRESSED_IBD" ] || [ ! -f "$COMPRESSED_IBD" ]; then
+  echo "SKIP: no ROW_FORMAT=COMPRESSED tablespace (set COMPRESSED_IBD or run MySQL)"
+else
+  log_verbose "$IB_PARSER 6 $COMPRESSED_IBD --threads=$THREADS"
+  if "$IB_PARSER" 6 "$COMPRESSED_IBD" --threads="$THREADS" > "$OUT_DIR/zip.clean.log"; then
+    echo "OK: compressed tablespace verifies clean"
+  else
+    echo "FAIL: compressed tablespace reported corrupt pages (see $OUT_DIR/zip.clean.log)"
+    failures=$((failures + 1))
+  fi
+
+  # Page 3: flip a byte of the compressed stream.
+  damaged="$OUT_DIR/zip.damaged.ibd"
+  cp "$COMPRESSED_IBD" "$damaged"
+  printf '\xff' | dd of="$damaged" bs=1 seek=$((3 * ZIP_PAGE_SIZE + 200)) conv=notrunc 2>/dev/null
+  "$IB_PARSER" 6 "$damaged" --threads="$THREADS" > "$OUT_DIR/zip.damaged.log" || true
+  reported=$(grep -o '^Page [0-9]*' "$OUT_DIR/zip.damaged.log" | awk '{print $2}' | tr '\n' ' ')
+  if [ "$reported" = "3 " ]; then
+    echo "OK: compressed damaged copy reports page 3"
+  else
+    echo "FAIL: compressed damaged copy reported '$reported' (see $OUT_DIR/zip.damaged.log)"
+    failures=$((failures + 1))
+  fi
+fi
+
+if [ "$failures" -ne 0 ]; then
+  echo "$failures checksum verification check(s) failed."
+  exit 1
+fi
+echo "All checksum verification checks passed."
@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <charconv>
 #include <unistd.h>
 #include <zlib.h>
 
@@ -33,6 +34,13 @@
 #include "rem0rec.h"
 #include "parser.h"
 #include "undrop_for_innodb.h"
+#include "row_output_sink.h"
+#include "output_file.h"
+#include "parse_stats.h"
+#include "parser_log.h"
+#include "charset_convert.h"
+#include "decrypt.h"
+#include "inflate_backend.h"
 #include "my_time.h"
 #include "my_sys.h"
 #include "my_byteorder.h"
@@ -138,6 +146,24 @@ my_rec_get_nth_field(const rec_t* rec, const ulint* offsets,
   return (const unsigned char*)rec + start;
 }
 
+// Shared default context; parallel workers bind their own per thread so
+// the header flag, output stream and LOB reader never cross threads.
+static RowWorkerContext g_default_row_ctx;
+static thread_local RowWorkerContext* t_row_ctx = nullptr;
+
+void bind_row_worker_context(RowWorkerContext* ctx) {
+  t_row_ctx = ctx;
+}
+
+RowWorkerContext& current_row_worker_context() {
+  return t_row_ctx ? *t_row_ctx : g_default_row_ctx;
+}
+
+table_def_t* current_row_table() {
+  RowWorkerContext& ctx = current_row_worker_context();
+  return ctx.table ? ctx.table : &table_definitions[0];
+}
+
 /** check_fields_sizes() => minimal check for each field. */
 static bool trace_offsets_enabled() {
   static int cached = -1;
@@ -150,7 +176,7 @@ static bool trace_offsets_enabled() {
 }
 
 static bool should_trace_offsets() {
-  if (!parser_debug_enabled() || !trace_offsets_enabled()) {
+  if (!log_enabled(LOG_LEVEL_DEBUG) || !trace_offsets_enabled()) {
     return false;
   }
   static int remaining = -1;
@@ -290,23 +316,34 @@ static void debug_trace_offsets(const rec_t* rec, const table_def_t* table) {
   std::fprintf(stderr, "=== End offset trace ===\n");
 }
 
-inline bool check_fields_sizes(const rec_t* rec, table_def_t* table, ulint* offsets)
-{
-  // remove "ulint n = offsets[0]" since we don't use it
-  // remove "field_ptr" or cast to (void) if not used
+// The table's compiled plan (built on first use for tables that were
+// filled in by hand; compile before sharing a table between threads).
+static const RecordPlan& record_plan(table_def_t* table) {
+  if (table->plan == nullptr) {
+    compile_record_plan(table);
+  }
+  return *table->plan;
+}
 
-  for (ulint i = 0; i < (ulint)table->fields_count; i++) {
+inline bool check_fields_sizes(const rec_t* rec, table_def_t* table,
+                               const RecordPlan& plan, ulint* offsets)
+{
+  for (ulint i = 0; i < plan.fields.size(); i++) {
+    const FieldPlan& fp = plan.fields[i];
+    // Fixed-length fields within their bounds cannot fail.
+    if (!fp.check_len) {
+      continue;
+    }
     ulint field_len;
-    (void)my_rec_get_nth_field(rec, offsets, i, &field_len); // if we don't actually need 'field_ptr'
+    (void)my_rec_get_nth_field(rec, offsets, i, &field_len);
 
     // Check range
     if (field_len != UNIV_SQL_NULL) {
-      ulint minL = (ulint)table->fields[i].min_length;
-      ulint maxL = (ulint)table->fields[i].max_length;
-      if (field_len < minL || field_len > maxL) {
-        printf("ERROR: field #%lu => length %lu out of [%u..%u]\n",
-               (unsigned long)i, (unsigned long)field_len,
-               table->fields[i].min_length, table->fields[i].max_length);
+      if (field_len < fp.min_len || field_len > fp.max_len) {
+        PARSER_LOG_LIMITED(LOG_LEVEL_DEBUG,
+                           "ERROR: field #%lu => length %lu out of [%u..%u]\n",
+                           (unsigned long)i, (unsigned long)field_len,
+                           fp.min_len, fp.max_len);
         debug_trace_offsets(rec, table);
         return false;
       }
@@ -318,15 +355,16 @@ inline bool check_fields_sizes(const rec_t* rec, table_def_t* table, ulint* offs
 /** ibrec_init_offsets_new() => fill offsets array for a COMPACT record. */
 inline bool ibrec_init_offsets_new(const page_t* page,
                                    const rec_t* rec,
-                                   table_def_t* table,
+                                   const RecordPlan& plan,
                                    ulint* offsets)
 {
   ulint status = rec_get_status((rec_t*)rec);
   if (status != REC_STATUS_ORDINARY) {
     return false;
   }
+  const ulint n_fields = plan.fields.size();
   // set #fields
-  my_rec_offs_set_n_fields(offsets, (ulint)table->fields_count);
+  my_rec_offs_set_n_fields(offsets, n_fields);
 
   const unsigned char* nulls = (const unsigned char*)rec - (REC_N_NEW_EXTRA_BYTES + 1);
   ulint info_bits = rec_get_info_bits(rec, true);
@@ -339,62 +377,47 @@ inline bool ibrec_init_offsets_new(const page_t* page,
     }
     nulls -= len;
   }
-  const unsigned char* lens  = nulls - ((table->n_nullable + 7) / 8);
+  const unsigned char* lens  = nulls - plan.null_bytes;
+  const ulint rec_pos = (ulint)((const unsigned char*)rec - (const unsigned char*)page);
 
+  // Leading NOT NULL fixed-length fields sit at the same offsets in every
+  // record; the prefix is only compiled while those keep increasing.
   ulint offs = 0;
-  unsigned char null_mask = 1;
-
-  for (ulint i = 0; i < (ulint)table->fields_count; i++) {
-    field_def_t* fld = &table->fields[i];
-    bool is_null = false;
-
-    if (fld->can_be_null) {
-      if (null_mask == 0) {
-        nulls--;
-        null_mask = 1;
-      }
-      if ((*nulls & null_mask) != 0) {
-        is_null = true;
-      }
-      null_mask <<= 1;
+  ulint i = plan.fixed_prefix;
+  if (i > 0) {
+    std::memcpy(offsets + 1, plan.prefix_offsets.data(), i * sizeof(ulint));
+    offs = plan.prefix_offsets[i - 1];
+    if (rec_pos + offs > (ulint)UNIV_PAGE_SIZE) {
+      PARSER_LOG_LIMITED(LOG_LEVEL_DEBUG, "Invalid offset => field %lu => %lu\n",
+                         (unsigned long)(i - 1), (unsigned long)offs);
+      return false;
     }
+  }
 
+  for (; i < n_fields; i++) {
+    const FieldPlan& fp = plan.fields[i];
     ulint len_val;
-    if (is_null) {
+    if (fp.null_mask != 0 && (*(nulls - fp.null_byte) & fp.null_mask) != 0) {
       len_val = offs | REC_OFFS_SQL_NULL;
+    } else if (fp.fixed_len != 0) {
+      offs += fp.fixed_len;
+      len_val = offs;
     } else {
-      if (fld->fixed_length == 0) {
-        ulint lenbyte = *lens--;
-        if (fld->max_length > 255
-            || fld->type == FT_BLOB
-            || fld->type == FT_TEXT
-            || fld->type == FT_JSON) {
-          if (lenbyte & 0x80) {
-            lenbyte <<= 8;
-            lenbyte |= *lens--;
-            offs += (lenbyte & 0x3fff);
-            if (lenbyte & 0x4000) {
-              len_val = offs | REC_OFFS_EXTERNAL;
-              goto store_len;
-            } else {
-              len_val = offs;
-              goto store_len;
-            }
-          }
-        }
-        offs += lenbyte;
-        len_val = offs;
+      ulint lenbyte = *lens--;
+      if (fp.long_len && (lenbyte & 0x80)) {
+        lenbyte <<= 8;
+        lenbyte |= *lens--;
+        offs += (lenbyte & 0x3fff);
+        len_val = (lenbyte & 0x4000) ? (offs | REC_OFFS_EXTERNAL) : offs;
       } else {
-        offs += (ulint)fld->fixed_length;
+        offs += lenbyte;
         len_val = offs;
       }
     }
-store_len:
     offs &= 0xffff;
-    ulint diff = (ulint)((const unsigned char*)rec + offs - (const unsigned char*)page);
-    if (diff > (ulint)UNIV_PAGE_SIZE) {
-      printf("Invalid offset => field %lu => %lu\n",
-             (unsigned long)i, (unsigned long)offs);
+    if (rec_pos + offs > (ulint)UNIV_PAGE_SIZE) {
+      PARSER_LOG_LIMITED(LOG_LEVEL_DEBUG, "Invalid offset => field %lu => %lu\n",
+                         (unsigned long)i, (unsigned long)offs);
       return false;
     }
     offsets[i+1] = len_val;
@@ -411,45 +434,71 @@ bool check_for_a_record(page_t *page, rec_t *rec, table_def_t *table, ulint *off
     return false;
   }
 
-  if (!ibrec_init_offsets_new(page, rec, table, offsets)) {
+  const RecordPlan& plan = record_plan(table);
+  if (!ibrec_init_offsets_new(page, rec, plan, offsets)) {
     return false;
   }
 
   ulint data_sz = my_rec_offs_data_size(offsets);
   if (data_sz > (ulint)table->data_max_size) {
-    printf("DATA_SIZE=FAIL(%lu > %ld)\n",
-           (unsigned long)data_sz, (long)table->data_max_size);
+    PARSER_LOG_LIMITED(LOG_LEVEL_DEBUG, "DATA_SIZE=FAIL(%lu > %ld)\n",
+                       (unsigned long)data_sz, (long)table->data_max_size);
     return false;
   }
   if (data_sz < (ulint)table->data_min_size) {
-    printf("DATA_SIZE=FAIL(%lu < %d)\n",
-           (unsigned long)data_sz, table->data_min_size);
+    PARSER_LOG_LIMITED(LOG_LEVEL_DEBUG, "DATA_SIZE=FAIL(%lu < %d)\n",
+                       (unsigned long)data_sz, table->data_min_size);
     return false;
   }
 
-  if (!check_fields_sizes(rec, table, offsets)) {
+  if (!check_fields_sizes(rec, table, plan, offsets)) {
     return false;
   }
 
   return true;
 }
 
-// global so we can print header once
-static bool g_printed_header = false;
-static RowOutputOptions g_row_output;
-static LobReadContext g_lob_ctx;
+ulint record_data_size(const ulint *offsets) {
+  return my_rec_offs_data_size(offsets);
+}
+
+ulint record_extra_size(const rec_t *rec, table_def_t *table, const ulint *offsets) {
+  const RecordPlan& plan = record_plan(table);
+  ulint extra = REC_N_NEW_EXTRA_BYTES + plan.null_bytes;
+  // The same version / instant field-count bytes ibrec_init_offsets_new() skips.
+  const ulint info_bits = rec_get_info_bits(rec, true);
+  if (info_bits & REC_INFO_VERSION_FLAG) {
+    extra += 1;
+  } else if (info_bits & REC_INFO_INSTANT_FLAG) {
+    const unsigned char* n_fields = (const unsigned char*)rec - (REC_N_NEW_EXTRA_BYTES + 1);
+    extra += (*n_fields & REC_N_FIELDS_TWO_BYTES_FLAG) ? 2 : 1;
+  }
+  for (ulint i = 0; i < plan.fields.size(); i++) {
+    const FieldPlan& fp = plan.fields[i];
+    if (fp.fixed_len != 0 || (offsets[i + 1] & REC_OFFS_SQL_NULL)) {
+      continue;
+    }
+    // Long columns take two length bytes past 127 bytes or when stored externally.
+    const ulint len = my_rec_offs_nth_size(offsets, i);
+    extra += (fp.long_len && (len > 127 || my_rec_offs_nth_extern(offsets, i))) ? 2 : 1;
+  }
+  return extra;
+}
 
 void set_row_output_options(const RowOutputOptions& opts) {
-  g_row_output = opts;
-  g_printed_header = false;
+  flush_row_output();
+  RowWorkerContext& ctx = current_row_worker_context();
+  ctx.output = opts;
+  ctx.printed_header = false;
 }
 
-void set_lob_read_context(const LobReadContext& ctx) {
-  g_lob_ctx = ctx;
+void set_lob_read_context(const LobReadContext& lob) {
+  current_row_worker_context().lob = lob;
 }
 
 static FILE* output_stream() {
-  return g_row_output.out ? g_row_output.out : stdout;
+  const RowWorkerContext& ctx = current_row_worker_context();
+  return ctx.output.out ? ctx.output.out : stdout;
 }
 
 static uint64_t read_be_uint(const unsigned char* ptr, size_t len) {
@@ -463,13 +512,14 @@ static uint64_t read_be_uint(const unsigned char* ptr, size_t len) {
 // Read signed big-endian integer with InnoDB sign-bit decoding
 // InnoDB stores signed integers with the high bit flipped for B-tree ordering
 static int64_t read_be_int_signed(const unsigned char* ptr, size_t len) {
+  const RowOutputOptions& row_opts = current_row_worker_context().output;
   if (len == 0 || len > 8) {
     return 0;
   }
   uint64_t val = read_be_uint(ptr, len);
 
   // If raw_integers mode, skip InnoDB sign-bit decoding
-  if (g_row_output.raw_integers) {
+  if (row_opts.raw_integers) {
     // Treat as plain signed big-endian
     uint64_t sign_bit = 1ULL << (len * 8 - 1);
     if (val & sign_bit) {
@@ -627,6 +677,35 @@ struct ZlobIndexEntry {
   uint32_t lob_version = 0;
 };
 
+// Where the LOB readers put a value: one page's payload (or one inflated
+// chunk) per call, in order.
+class LobChunkSink {
+ public:
+  virtual void consume(const unsigned char* p, size_t n) = 0;
+
+ protected:
+  ~LobChunkSink() = default;
+};
+
+// Collects a value into a buffer sized for all of it up front.
+class LobBufferSink final : public LobChunkSink {
+ public:
+  LobBufferSink(unsigned char* buf, size_t cap) : buf_(buf), cap_(cap) {}
+  void consume(const unsigned char* p, size_t n) override {
+    if (n > cap_ - len_) {
+      n = cap_ - len_;
+    }
+    std::memcpy(buf_ + len_, p, n);
+    len_ += n;
+  }
+  size_t size() const { return len_; }
+
+ private:
+  unsigned char* buf_;
+  size_t cap_;
+  size_t len_ = 0;
+};
+
 static fil_addr_t read_fil_addr(const unsigned char* ptr) {
   fil_addr_t addr;
   addr.page = mach_read_from_4(ptr + FIL_ADDR_PAGE);
@@ -658,19 +737,25 @@ static bool should_decompress_lob_page(uint16_t page_type) {
 
 static bool decompress_zip_page(const unsigned char* src,
                                 std::vector<unsigned char>& buf) {
-  const size_t logical = g_lob_ctx.logical_page_size;
+  StageTimer timer(STAGE_DECOMPRESS);
+  RowWorkerContext& ctx = current_row_worker_context();
+  const LobReadContext& lob_ctx = ctx.lob;
+  const size_t logical = lob_ctx.logical_page_size;
   if (logical == 0 || buf.size() < logical) {
     buf.resize(logical);
   }
 
-  std::vector<unsigned char> temp(logical * 2);
+  std::vector<unsigned char>& temp = ctx.lob_zip_scratch;
+  if (temp.size() < logical * 2) {
+    temp.resize(logical * 2);
+  }
   unsigned char* aligned = align_ptr(temp.data(), logical);
   std::memset(aligned, 0, logical);
 
   page_zip_des_t page_zip;
   std::memset(&page_zip, 0, sizeof(page_zip));
   page_zip.data = reinterpret_cast<page_zip_t*>(const_cast<unsigned char*>(src));
-  page_zip.ssize = page_size_to_ssize_local(g_lob_ctx.physical_page_size);
+  page_zip.ssize = page_size_to_ssize_local(lob_ctx.physical_page_size);
 
   if (!page_zip_decompress_low(&page_zip, aligned, true)) {
     return false;
@@ -679,19 +764,71 @@ static bool decompress_zip_page(const unsigned char* src,
   return true;
 }
 
+static bool pread_physical_page(const LobReadContext& lob_ctx,
+                                page_no_t page_no, unsigned char* out) {
+  StageTimer timer(STAGE_READ);
+  const size_t physical = lob_ctx.physical_page_size;
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->bytes_read += physical;
+  }
+  if (lob_ctx.map) {
+    const unsigned char* mapped = lob_ctx.map->page(page_no, physical);
+    if (mapped == nullptr) {
+      return false;
+    }
+    std::memcpy(out, mapped, physical);
+  } else {
+    const off_t offset =
+        static_cast<off_t>(page_no) * static_cast<off_t>(physical);
+    const ssize_t rd = pread(lob_ctx.fd, out, physical, offset);
+    if (rd != static_cast<ssize_t>(physical)) {
+      return false;
+    }
+  }
+  return lob_ctx.cipher == nullptr || lob_ctx.cipher->decrypt(out, physical);
+}
+
+bool read_raw_page_cached(page_no_t page_no, unsigned char* out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
+  if (lob_ctx.fd < 0 || lob_ctx.physical_page_size == 0) {
+    return false;
+  }
+  const size_t physical = lob_ctx.physical_page_size;
+  // A mapping already is a page cache, unless every hit still needs AES.
+  PageCache* cache =
+      (lob_ctx.map && !lob_ctx.cipher) ? nullptr : lob_ctx.cache.get();
+  if (cache) {
+    size_t cached_size = 0;
+    const unsigned char* hit =
+        cache->lookup(page_no, PageCache::RAW, &cached_size);
+    if (hit && cached_size == physical) {
+      std::memcpy(out, hit, physical);
+      return true;
+    }
+  }
+  if (!pread_physical_page(lob_ctx, page_no, out)) {
+    return false;
+  }
+  if (cache) {
+    cache->insert(page_no, PageCache::RAW, out, physical);
+  }
+  return true;
+}
+
 static bool read_tablespace_page_raw(page_no_t page_no,
                                      std::vector<unsigned char>& buf) {
-  if (g_lob_ctx.fd < 0 || g_lob_ctx.physical_page_size == 0) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
+  if (lob_ctx.fd < 0 || lob_ctx.physical_page_size == 0) {
     return false;
   }
-  const size_t physical = g_lob_ctx.physical_page_size;
+  const size_t physical = lob_ctx.physical_page_size;
   if (buf.size() < physical) {
     buf.resize(physical);
   }
-  const off_t offset =
-      static_cast<off_t>(page_no) * static_cast<off_t>(physical);
-  const ssize_t rd = pread(g_lob_ctx.fd, buf.data(), physical, offset);
-  return rd == static_cast<ssize_t>(physical);
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->lob_pages++;
+  }
+  return read_raw_page_cached(page_no, buf.data());
 }
 
 static ulint zlob_first_index_entries(size_t physical_size) {
@@ -738,38 +875,62 @@ static ulint zlob_first_data_begin(size_t physical_size) {
 
 static bool read_tablespace_page(page_no_t page_no,
                                  std::vector<unsigned char>& buf) {
-  if (g_lob_ctx.fd < 0 || g_lob_ctx.physical_page_size == 0) {
+  RowWorkerContext& ctx = current_row_worker_context();
+  const LobReadContext& lob_ctx = ctx.lob;
+  if (lob_ctx.fd < 0 || lob_ctx.physical_page_size == 0) {
     return false;
   }
-  const size_t physical = g_lob_ctx.physical_page_size;
-  const size_t logical = g_lob_ctx.tablespace_compressed
-                             ? g_lob_ctx.logical_page_size
-                             : g_lob_ctx.physical_page_size;
+  const size_t physical = lob_ctx.physical_page_size;
+  const size_t logical = lob_ctx.tablespace_compressed
+                             ? lob_ctx.logical_page_size
+                             : lob_ctx.physical_page_size;
 
   if (buf.size() < logical) {
     buf.resize(logical);
   }
+  if (ParseStats* stats = current_parse_stats()) {
+    stats->lob_pages++;
+  }
 
-  const off_t offset =
-      static_cast<off_t>(page_no) * static_cast<off_t>(physical);
+  if (!lob_ctx.tablespace_compressed) {
+    return read_raw_page_cached(page_no, buf.data());
+  }
 
-  if (!g_lob_ctx.tablespace_compressed) {
-    const ssize_t rd = pread(g_lob_ctx.fd, buf.data(), physical, offset);
-    return rd == static_cast<ssize_t>(physical);
+  // Compressed tablespace: cache the page as handed back (decompressed for
+  // ZLOB pages), so a hit skips both the read and page_zip inflation.
+  PageCache* cache = lob_ctx.cache.get();
+  if (cache) {
+    size_t cached_size = 0;
+    const unsigned char* hit =
+        cache->lookup(page_no, PageCache::DECODED, &cached_size);
+    if (hit && cached_size <= buf.size()) {
+      std::memcpy(buf.data(), hit, cached_size);
+      return true;
+    }
   }
 
-  std::vector<unsigned char> phys_buf(physical);
-  if (!read_tablespace_page_raw(page_no, phys_buf)) {
+  std::vector<unsigned char>& phys_buf = ctx.lob_raw_scratch;
+  if (phys_buf.size() < physical) {
+    phys_buf.resize(physical);
+  }
+  if (!pread_physical_page(lob_ctx, page_no, phys_buf.data())) {
     return false;
   }
 
   const uint16_t page_type = mach_read_from_2(phys_buf.data() + FIL_PAGE_TYPE);
+  size_t out_size = physical;
   if (!should_decompress_lob_page(page_type)) {
     std::memcpy(buf.data(), phys_buf.data(), physical);
-    return true;
+  } else if (decompress_zip_page(phys_buf.data(), buf)) {
+    out_size = logical;
+  } else {
+    return false;
   }
 
-  return decompress_zip_page(phys_buf.data(), buf);
+  if (cache) {
+    cache->insert(page_no, PageCache::DECODED, buf.data(), out_size);
+  }
+  return true;
 }
 
 static size_t clamp_page_copy(size_t page_size, size_t start, size_t want) {
@@ -782,11 +943,12 @@ static size_t clamp_page_copy(size_t page_size, size_t start, size_t want) {
 
 static size_t read_lob_old_chain(const LobRef& ref,
                                  size_t want,
-                                 std::string& out) {
+                                 LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (want == 0 || ref.page_no == FIL_NULL) {
     return 0;
   }
-  std::vector<unsigned char> page_buf(g_lob_ctx.physical_page_size);
+  std::vector<unsigned char> page_buf(lob_ctx.physical_page_size);
   page_no_t page_no = ref.page_no;
   ulint offset = ref.offset;
   size_t remaining = want;
@@ -794,7 +956,7 @@ static size_t read_lob_old_chain(const LobRef& ref,
   size_t steps = 0;
   const size_t max_steps = 100000;
 
-  if (offset < FIL_PAGE_DATA || offset >= g_lob_ctx.physical_page_size) {
+  if (offset < FIL_PAGE_DATA || offset >= lob_ctx.physical_page_size) {
     offset = FIL_PAGE_DATA;
   }
 
@@ -807,7 +969,7 @@ static size_t read_lob_old_chain(const LobRef& ref,
         page_type != FIL_PAGE_SDI_BLOB) {
       break;
     }
-    if (offset + lob::LOB_HDR_SIZE > g_lob_ctx.physical_page_size) {
+    if (offset + lob::LOB_HDR_SIZE > lob_ctx.physical_page_size) {
       break;
     }
     const unsigned char* header = page_buf.data() + offset;
@@ -818,12 +980,12 @@ static size_t read_lob_old_chain(const LobRef& ref,
     if (copy_len > remaining) {
       copy_len = remaining;
     }
-    copy_len = clamp_page_copy(g_lob_ctx.physical_page_size,
+    copy_len = clamp_page_copy(lob_ctx.physical_page_size,
                                offset + lob::LOB_HDR_SIZE, copy_len);
     if (copy_len == 0) {
       break;
     }
-    out.append(reinterpret_cast<const char*>(header + lob::LOB_HDR_SIZE), copy_len);
+    out.consume(header + lob::LOB_HDR_SIZE, copy_len);
     total += copy_len;
     remaining -= copy_len;
 
@@ -839,39 +1001,42 @@ static size_t read_lob_old_chain(const LobRef& ref,
 
 static size_t read_lob_first_page(const unsigned char* page,
                                   size_t want,
-                                  std::string& out) {
+                                  LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   const uint32_t data_len = mach_read_from_4(page + LOB_FIRST_OFFSET_DATA_LEN);
   const size_t max_data =
-      clamp_page_copy(g_lob_ctx.physical_page_size, LOB_FIRST_DATA_BEGIN, data_len);
+      clamp_page_copy(lob_ctx.physical_page_size, LOB_FIRST_DATA_BEGIN, data_len);
   size_t copy_len = want < max_data ? want : max_data;
   if (copy_len == 0) {
     return 0;
   }
-  out.append(reinterpret_cast<const char*>(page + LOB_FIRST_DATA_BEGIN), copy_len);
+  out.consume(page + LOB_FIRST_DATA_BEGIN, copy_len);
   return copy_len;
 }
 
 static size_t read_lob_data_page(const unsigned char* page,
                                  size_t want,
-                                 std::string& out) {
+                                 LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   const uint32_t data_len = mach_read_from_4(page + LOB_DATA_OFFSET_DATA_LEN);
   const size_t max_data =
-      clamp_page_copy(g_lob_ctx.physical_page_size, LOB_DATA_DATA, data_len);
+      clamp_page_copy(lob_ctx.physical_page_size, LOB_DATA_DATA, data_len);
   size_t copy_len = want < max_data ? want : max_data;
   if (copy_len == 0) {
     return 0;
   }
-  out.append(reinterpret_cast<const char*>(page + LOB_DATA_DATA), copy_len);
+  out.consume(page + LOB_DATA_DATA, copy_len);
   return copy_len;
 }
 
 static size_t read_lob_new_format(const LobRef& ref,
                                   size_t want,
-                                  std::string& out) {
+                                  LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (want == 0 || ref.page_no == FIL_NULL) {
     return 0;
   }
-  std::vector<unsigned char> first_page(g_lob_ctx.physical_page_size);
+  std::vector<unsigned char> first_page(lob_ctx.physical_page_size);
   if (!read_tablespace_page(ref.page_no, first_page)) {
     return 0;
   }
@@ -887,14 +1052,14 @@ static size_t read_lob_new_format(const LobRef& ref,
   size_t steps = 0;
   const size_t max_steps = 100000;
 
-  std::vector<unsigned char> index_buf(g_lob_ctx.physical_page_size);
-  std::vector<unsigned char> data_buf(g_lob_ctx.physical_page_size);
+  std::vector<unsigned char> index_buf(lob_ctx.physical_page_size);
+  std::vector<unsigned char> data_buf(lob_ctx.physical_page_size);
 
   while (!addr.is_null() && remaining > 0 && steps++ < max_steps) {
     if (!read_tablespace_page(addr.page, index_buf)) {
       break;
     }
-    if (addr.boffset + LOB_INDEX_ENTRY_SIZE > g_lob_ctx.physical_page_size) {
+    if (addr.boffset + LOB_INDEX_ENTRY_SIZE > lob_ctx.physical_page_size) {
       break;
     }
     const unsigned char* node = index_buf.data() + addr.boffset;
@@ -993,6 +1158,7 @@ static bool read_zlob_frag_payload(const unsigned char* page,
 static bool read_zlob_stream(const ZlobIndexEntry& entry,
                              unsigned char* buf,
                              size_t buf_size) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (buf_size == 0 || entry.z_page_no == FIL_NULL) {
     return false;
   }
@@ -1003,7 +1169,7 @@ static bool read_zlob_stream(const ZlobIndexEntry& entry,
   size_t steps = 0;
   const size_t max_steps = 100000;
 
-  std::vector<unsigned char> page_buf(g_lob_ctx.logical_page_size);
+  std::vector<unsigned char> page_buf(lob_ctx.logical_page_size);
 
   while (remaining > 0 && page_no != FIL_NULL && steps++ < max_steps) {
     if (!read_tablespace_page(page_no, page_buf)) {
@@ -1018,19 +1184,19 @@ static bool read_zlob_stream(const ZlobIndexEntry& entry,
     if (page_type == FIL_PAGE_TYPE_ZLOB_FIRST) {
       const uint32_t len = mach_read_from_4(page_buf.data() +
                                             ZLOB_FIRST_OFFSET_DATA_LEN);
-      const ulint begin = zlob_first_data_begin(g_lob_ctx.physical_page_size);
-      data_len = clamp_page_copy(g_lob_ctx.physical_page_size, begin, len);
+      const ulint begin = zlob_first_data_begin(lob_ctx.physical_page_size);
+      data_len = clamp_page_copy(lob_ctx.physical_page_size, begin, len);
       data = page_buf.data() + begin;
     } else if (page_type == FIL_PAGE_TYPE_ZLOB_DATA) {
       const uint32_t len = mach_read_from_4(page_buf.data() +
                                             ZLOB_DATA_OFFSET_DATA_LEN);
-      data_len = clamp_page_copy(g_lob_ctx.physical_page_size,
+      data_len = clamp_page_copy(lob_ctx.physical_page_size,
                                  ZLOB_DATA_OFFSET_DATA_BEGIN,
                                  len);
       data = page_buf.data() + ZLOB_DATA_OFFSET_DATA_BEGIN;
     } else if (page_type == FIL_PAGE_TYPE_ZLOB_FRAG) {
       if (!read_zlob_frag_payload(page_buf.data(),
-                                  g_lob_ctx.physical_page_size,
+                                  lob_ctx.physical_page_size,
                                   entry.z_frag_id,
                                   &data,
                                   &data_len)) {
@@ -1056,57 +1222,29 @@ static bool read_zlob_stream(const ZlobIndexEntry& entry,
 
 static size_t read_zlob_chunk(const ZlobIndexEntry& entry,
                               size_t want,
-                              std::string& out) {
+                              LobChunkSink& out) {
   if (entry.z_page_no == FIL_NULL || entry.data_len == 0 || entry.zdata_len == 0) {
     return 0;
   }
 
-  std::vector<unsigned char> zbuf(entry.zdata_len);
+  // Reused across chunks and rows on this thread. InnoDB compresses a ZLOB
+  // chunk by chunk, so these hold one chunk, never the whole value.
+  thread_local std::vector<unsigned char> zbuf;
+  thread_local std::vector<unsigned char> tmp;
+  zbuf.resize(entry.zdata_len);
   if (!read_zlob_stream(entry, zbuf.data(), zbuf.size())) {
     return 0;
   }
 
-  z_stream strm;
-  std::memset(&strm, 0, sizeof(strm));
-  if (inflateInit(&strm) != Z_OK) {
-    return 0;
-  }
-
-  strm.avail_in = static_cast<uInt>(zbuf.size());
-  strm.next_in = zbuf.data();
-
-  size_t copied = 0;
   const size_t full_len = entry.data_len;
   const size_t target = (want < full_len) ? want : full_len;
-
-  if (target == full_len) {
-    const size_t out_pos = out.size();
-    out.resize(out_pos + full_len);
-    strm.avail_out = static_cast<uInt>(full_len);
-    strm.next_out = reinterpret_cast<unsigned char*>(&out[out_pos]);
-    const int ret = inflate(&strm, Z_FINISH);
-    if (ret != Z_STREAM_END) {
-      inflateEnd(&strm);
-      out.resize(out_pos);
-      return 0;
-    }
-    copied = static_cast<size_t>(strm.total_out);
-    out.resize(out_pos + copied);
-  } else {
-    std::vector<unsigned char> tmp(full_len);
-    strm.avail_out = static_cast<uInt>(full_len);
-    strm.next_out = tmp.data();
-    const int ret = inflate(&strm, Z_FINISH);
-    if (ret != Z_STREAM_END) {
-      inflateEnd(&strm);
-      return 0;
-    }
-    const size_t produced = static_cast<size_t>(strm.total_out);
-    copied = (target < produced) ? target : produced;
-    out.append(reinterpret_cast<const char*>(tmp.data()), copied);
+  size_t produced = 0;
+  tmp.resize(full_len);
+  if (!inflate_whole(zbuf.data(), zbuf.size(), tmp.data(), full_len, &produced)) {
+    return 0;
   }
-
-  inflateEnd(&strm);
+  const size_t copied = (target < produced) ? target : produced;
+  out.consume(tmp.data(), copied);
   return copied;
 }
 
@@ -1114,6 +1252,7 @@ static bool read_zlob_visible_entry(const ZlobIndexEntry& current,
                                     const unsigned char* node,
                                     uint32_t ref_version,
                                     ZlobIndexEntry& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (current.lob_version <= ref_version) {
     out = current;
     return true;
@@ -1123,13 +1262,13 @@ static bool read_zlob_visible_entry(const ZlobIndexEntry& current,
       read_fil_addr(node + ZLOB_INDEX_ENTRY_OFFSET_VERSIONS + 4);
   size_t steps = 0;
   const size_t max_steps = 100000;
-  std::vector<unsigned char> page_buf(g_lob_ctx.logical_page_size);
+  std::vector<unsigned char> page_buf(lob_ctx.logical_page_size);
 
   while (!addr.is_null() && steps++ < max_steps) {
     if (!read_tablespace_page(addr.page, page_buf)) {
       break;
     }
-    if (addr.boffset + ZLOB_INDEX_ENTRY_SIZE > g_lob_ctx.physical_page_size) {
+    if (addr.boffset + ZLOB_INDEX_ENTRY_SIZE > lob_ctx.physical_page_size) {
       break;
     }
     const unsigned char* ver_node = page_buf.data() + addr.boffset;
@@ -1148,12 +1287,13 @@ static bool read_zlob_visible_entry(const ZlobIndexEntry& current,
 
 static size_t read_zlob_new_format(const LobRef& ref,
                                    size_t want,
-                                   std::string& out) {
+                                   LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (want == 0 || ref.page_no == FIL_NULL) {
     return 0;
   }
 
-  std::vector<unsigned char> first_page(g_lob_ctx.logical_page_size);
+  std::vector<unsigned char> first_page(lob_ctx.logical_page_size);
   if (!read_tablespace_page(ref.page_no, first_page)) {
     return 0;
   }
@@ -1169,13 +1309,13 @@ static size_t read_zlob_new_format(const LobRef& ref,
   size_t steps = 0;
   const size_t max_steps = 100000;
 
-  std::vector<unsigned char> index_buf(g_lob_ctx.logical_page_size);
+  std::vector<unsigned char> index_buf(lob_ctx.logical_page_size);
 
   while (!addr.is_null() && remaining > 0 && steps++ < max_steps) {
     if (!read_tablespace_page(addr.page, index_buf)) {
       break;
     }
-    if (addr.boffset + ZLOB_INDEX_ENTRY_SIZE > g_lob_ctx.physical_page_size) {
+    if (addr.boffset + ZLOB_INDEX_ENTRY_SIZE > lob_ctx.physical_page_size) {
       break;
     }
     const unsigned char* node = index_buf.data() + addr.boffset;
@@ -1203,31 +1343,30 @@ static size_t read_zlob_new_format(const LobRef& ref,
 
 static size_t read_zblob_external(const LobRef& ref,
                                   size_t want,
-                                  std::string& out) {
+                                  LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
   if (want == 0 || ref.page_no == FIL_NULL) {
     return 0;
   }
 
-  std::vector<unsigned char> page_buf(g_lob_ctx.physical_page_size);
+  std::vector<unsigned char> page_buf(lob_ctx.physical_page_size);
   page_no_t page_no = ref.page_no;
   ulint offset = ref.offset;
   size_t steps = 0;
   const size_t max_steps = 100000;
 
-  const size_t out_pos = out.size();
-  out.resize(out_pos + want);
-  unsigned char* out_ptr = reinterpret_cast<unsigned char*>(&out[out_pos]);
-
-  z_stream strm;
-  std::memset(&strm, 0, sizeof(strm));
-  if (inflateInit(&strm) != Z_OK) {
-    out.resize(out_pos);
+  z_stream* stream = thread_inflate_stream();
+  if (stream == nullptr) {
     return 0;
   }
-  strm.next_out = out_ptr;
-  strm.avail_out = static_cast<uInt>(want);
+  z_stream& strm = *stream;
+  // Inflated a page at a time, so a long value never sits in memory whole.
+  thread_local std::vector<unsigned char> chunk;
+  chunk.resize(lob_ctx.logical_page_size);
+  size_t remaining = want;
+  bool done = false;
 
-  while (page_no != FIL_NULL && strm.avail_out > 0 && steps++ < max_steps) {
+  while (!done && page_no != FIL_NULL && remaining > 0 && steps++ < max_steps) {
     if (!read_tablespace_page_raw(page_no, page_buf)) {
       break;
     }
@@ -1247,29 +1386,35 @@ static size_t read_zblob_external(const LobRef& ref,
       data_offset += 4;
     }
 
-    if (data_offset >= g_lob_ctx.physical_page_size) {
+    if (data_offset >= lob_ctx.physical_page_size) {
       break;
     }
 
     strm.next_in = page_buf.data() + data_offset;
     strm.avail_in =
-        static_cast<uInt>(g_lob_ctx.physical_page_size - data_offset);
-
-    const int ret = inflate(&strm, Z_NO_FLUSH);
-    if (ret == Z_STREAM_END) {
-      break;
-    }
-    if (ret != Z_OK && ret != Z_BUF_ERROR) {
-      break;
-    }
+        static_cast<uInt>(lob_ctx.physical_page_size - data_offset);
+
+    // Until this page's input is used up (output space left over) or the
+    // value is complete.
+    do {
+      const size_t room = remaining < chunk.size() ? remaining : chunk.size();
+      strm.next_out = chunk.data();
+      strm.avail_out = static_cast<uInt>(room);
+      const int ret = inflate(&strm, Z_NO_FLUSH);
+      const size_t produced = room - strm.avail_out;
+      if (produced > 0) {
+        out.consume(chunk.data(), produced);
+        remaining -= produced;
+      }
+      if (ret == Z_STREAM_END || (ret != Z_OK && ret != Z_BUF_ERROR)) {
+        done = true;
+      }
+    } while (!done && strm.avail_out == 0 && remaining > 0);
 
     offset = FIL_PAGE_NEXT;
   }
 
-  const size_t produced = want - strm.avail_out;
-  inflateEnd(&strm);
-  out.resize(out_pos + produced);
-  return produced;
+  return want - remaining;
 }
 
 [[maybe_unused]] static unsigned int max_decimals_from_len(ulint len, ulint base_len) {
@@ -1289,11 +1434,12 @@ static size_t read_zblob_external(const LobRef& ref,
 
 static size_t read_lob_external(const LobRef& ref,
                                 size_t want,
-                                std::string& out) {
-  if (g_lob_ctx.fd < 0) {
+                                LobChunkSink& out) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
+  if (lob_ctx.fd < 0) {
     return 0;
   }
-  std::vector<unsigned char> page_buf(g_lob_ctx.logical_page_size);
+  std::vector<unsigned char> page_buf(lob_ctx.logical_page_size);
   if (!read_tablespace_page(ref.page_no, page_buf)) {
     return 0;
   }
@@ -1315,19 +1461,29 @@ static size_t read_lob_external(const LobRef& ref,
   return 0;
 }
 
-static bool read_external_lob_value(const unsigned char* field_ptr,
-                                    ulint field_len,
-                                    std::string& out,
-                                    bool& truncated) {
-  truncated = false;
-  if (field_len < BTR_EXTERN_FIELD_REF_SIZE || g_lob_ctx.fd < 0) {
+// An external value as the row formats read it: the in-row prefix, then
+// the rest from the LOB pages, lob_max_bytes in all at most.
+struct ExternLob {
+  LobRef ref;
+  size_t local_len = 0;  // bytes of the in-row prefix to use
+  size_t want = 0;       // bytes to read from the LOB pages
+  bool truncated = false;
+  size_t size() const { return local_len + want; }
+};
+
+static bool prepare_external_lob(const unsigned char* field_ptr,
+                                 ulint field_len,
+                                 ExternLob& lob) {
+  const LobReadContext& lob_ctx = current_row_worker_context().lob;
+  const RowOutputOptions& row_opts = current_row_worker_context().output;
+  if (field_len < BTR_EXTERN_FIELD_REF_SIZE || lob_ctx.fd < 0) {
     return false;
   }
 
   const ulint local_len = field_len - BTR_EXTERN_FIELD_REF_SIZE;
   const unsigned char* ref_ptr = field_ptr + local_len;
 
-  LobRef ref{};
+  LobRef& ref = lob.ref;
   ref.space_id = mach_read_from_4(ref_ptr + lob::BTR_EXTERN_SPACE_ID);
   ref.page_no = mach_read_from_4(ref_ptr + lob::BTR_EXTERN_PAGE_NO);
   ref.offset = mach_read_from_4(ref_ptr + lob::BTR_EXTERN_OFFSET);
@@ -1342,38 +1498,58 @@ static bool read_external_lob_value(const unsigned char* field_ptr,
   }
 
   const size_t total_len = static_cast<size_t>(local_len) + ref.length;
-  size_t limit = g_row_output.lob_max_bytes;
+  size_t limit = row_opts.lob_max_bytes;
   size_t target_total = total_len;
+  lob.truncated = false;
   if (limit > 0 && total_len > limit) {
     target_total = limit;
-    truncated = true;
+    lob.truncated = true;
   }
 
-  out.clear();
-  out.reserve(target_total);
-  if (local_len > 0) {
-    size_t copy_len = local_len;
-    if (limit > 0 && copy_len > target_total) {
-      copy_len = target_total;
-      truncated = true;
+  lob.local_len = local_len < target_total ? local_len : target_total;
+  lob.want = 0;
+  if (ref.length > 0 && lob.local_len < target_total) {
+    lob.want = target_total - lob.local_len;
+    if (lob.want > ref.length) {
+      lob.want = ref.length;
     }
-    out.append(reinterpret_cast<const char*>(field_ptr), copy_len);
   }
+  return true;
+}
 
-  if (ref.length == 0 || out.size() >= target_total) {
-    return true;
+// false when the LOB pages ran out before lob.want bytes.
+static bool read_external_lob(const unsigned char* field_ptr,
+                              const ExternLob& lob,
+                              LobChunkSink& out) {
+  StageTimer timer(STAGE_LOB);
+  if (lob.local_len > 0) {
+    out.consume(field_ptr, lob.local_len);
   }
-
-  size_t want = ref.length;
-  if (limit > 0 && out.size() + want > target_total) {
-    want = target_total - out.size();
+  if (lob.want == 0) {
+    return true;
   }
+  return read_lob_external(lob.ref, lob.want, out) == lob.want;
+}
 
-  size_t read_bytes = read_lob_external(ref, want, out);
-  if (read_bytes != want) {
+// The whole value, in the row arena: valid until the row is done.
+static bool read_external_lob_value(const unsigned char* field_ptr,
+                                    ulint field_len,
+                                    const unsigned char** data,
+                                    size_t* data_len,
+                                    bool& truncated) {
+  ExternLob lob;
+  truncated = false;
+  if (!prepare_external_lob(field_ptr, field_len, lob)) {
     return false;
   }
-  return true;
+  truncated = lob.truncated;
+  unsigned char* buf =
+      current_row_worker_context().arena.alloc_array<unsigned char>(lob.size());
+  LobBufferSink sink(buf, lob.size());
+  const bool ok = read_external_lob(field_ptr, lob, sink);
+  *data = buf;
+  *data_len = sink.size();
+  return ok;
 }
 
 static bool format_decimal_value(const field_def_t& field,
@@ -1393,10 +1569,10 @@ static bool format_decimal_value(const field_def_t& field,
   if (buf_len <= 0) {
     return false;
   }
-  std::vector<decimal_digit_t> digits(static_cast<size_t>(buf_len));
+  RowArena& arena = current_row_worker_context().arena;
   decimal_t dec{};
   dec.len = buf_len;
-  dec.buf = digits.data();
+  dec.buf = arena.alloc_array<decimal_digit_t>(static_cast<size_t>(buf_len));
   dec.intg = precision - scale;
   dec.frac = scale;
   int err = bin2decimal(ptr, &dec, precision, scale, false);
@@ -1407,14 +1583,13 @@ static bool format_decimal_value(const field_def_t& field,
   if (str_len <= 0) {
     return false;
   }
-  std::string tmp(static_cast<size_t>(str_len), '\0');
+  char* str = arena.alloc_array<char>(static_cast<size_t>(str_len));
   int out_len = str_len;
-  err = decimal2string(&dec, &tmp[0], &out_len);
+  err = decimal2string(&dec, str, &out_len);
   if (err & E_DEC_FATAL_ERROR || out_len <= 0) {
     return false;
   }
-  tmp.resize(static_cast<size_t>(out_len));
-  out.swap(tmp);
+  out.assign(str, static_cast<size_t>(out_len));
   return true;
 }
 
@@ -1448,8 +1623,9 @@ static bool format_set_value(const field_def_t& field,
   if (field.limits.set_values_count > 64) {
     return false;
   }
+  // out is left partly written on failure; callers overwrite it then.
+  out.clear();
   bool first = true;
-  std::string tmp;
   for (int i = 0; i < field.limits.set_values_count; i++) {
     if (mask & (1ULL << i)) {
       const char* value = field.limits.set_values[i];
@@ -1457,101 +1633,73 @@ static bool format_set_value(const field_def_t& field,
         return false;
       }
       if (!first) {
-        tmp.push_back(',');
+        out.push_back(',');
       }
-      tmp.append(value);
+      out.append(value);
       first = false;
     }
   }
-  out.swap(tmp);
   return true;
 }
 
-static std::string format_hex(const unsigned char* ptr, ulint len, ulint max_len = 64) {
-  std::string out;
-  ulint to_print = (len < max_len) ? len : max_len;
-  out.reserve(static_cast<size_t>(to_print) * 2 + 4);
-  char buf[3];
-  for (ulint i = 0; i < to_print; i++) {
-    std::snprintf(buf, sizeof(buf), "%02X", ptr[i]);
-    out.append(buf);
-  }
-  if (len > max_len) {
-    out.append("...");
-  }
-  return out;
+static void append_decimal(std::string& out, uint64_t v) {
+  char tmp[20];
+  const std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+  out.append(tmp, static_cast<size_t>(r.ptr - tmp));
 }
 
-static std::string format_text(const unsigned char* ptr, ulint len, ulint max_len = 256) {
-  std::string out;
-  ulint to_print = (len < max_len) ? len : max_len;
-  out.reserve(static_cast<size_t>(to_print) + 16);
-  for (ulint i = 0; i < to_print; i++) {
-    unsigned char c = ptr[i];
-    if (std::isprint(c)) {
-      out.push_back(static_cast<char>(c));
-    } else {
-      char buf[5];
-      std::snprintf(buf, sizeof(buf), "\\x%02X", c);
-      out.append(buf);
-    }
-  }
-  if (len > max_len) {
-    out.append("...(truncated)");
-  }
-  return out;
+static void append_decimal(std::string& out, int64_t v) {
+  char tmp[20];
+  const std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+  out.append(tmp, static_cast<size_t>(r.ptr - tmp));
 }
 
-static std::string escape_control_bytes(const char* ptr, ulint len) {
-  std::string out;
-  out.reserve(static_cast<size_t>(len) + 16);
-  for (ulint i = 0; i < len; i++) {
-    unsigned char c = static_cast<unsigned char>(ptr[i]);
-    if (c >= 0x20 && c != 0x7F) {
-      out.push_back(static_cast<char>(c));
-    } else {
-      char buf[5];
-      std::snprintf(buf, sizeof(buf), "\\x%02X", c);
-      out.append(buf);
-    }
-  }
-  return out;
+// printf("%f") without the format parsing: the same digits.
+static void append_fixed6(std::string& out, double v) {
+  char tmp[400];  // DBL_MAX has 309 integer digits
+  const std::to_chars_result r =
+      std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::fixed, 6);
+  out.append(tmp, static_cast<size_t>(r.ptr - tmp));
 }
 
-static std::string format_text_with_charset(const unsigned char* ptr,
-                                            ulint len,
-                                            unsigned int collation_id,
-                                            ulint max_len = 256) {
-  ulint to_convert = (len < max_len) ? len : max_len;
-  if (to_convert == 0) {
-    return std::string();
-  }
+static const char kHexDigits[] = "0123456789ABCDEF";
 
-  const CHARSET_INFO* from_cs = nullptr;
-  if (collation_id != 0) {
-    from_cs = get_charset(collation_id, MYF(0));
+// Up to max_len bytes as uppercase hex, then "..." if len was longer.
+static void append_hex(std::string& out, const unsigned char* ptr, ulint len,
+                       ulint max_len = 64) {
+  const size_t to_print = static_cast<size_t>((len < max_len) ? len : max_len);
+  const size_t start = out.size();
+  out.resize(start + to_print * 2);
+  char* p = &out[start];
+  for (size_t i = 0; i < to_print; i++) {
+    p[2 * i] = kHexDigits[ptr[i] >> 4];
+    p[2 * i + 1] = kHexDigits[ptr[i] & 0xF];
   }
-  if (!from_cs) {
-    std::string out = format_text(ptr, len, max_len);
-    return out;
+  if (len > max_len) {
+    out.append("...");
   }
+}
 
-  const CHARSET_INFO* to_cs = &my_charset_utf8mb4_bin;
-  size_t out_cap = static_cast<size_t>(to_convert) * to_cs->mbmaxlen + 1;
-  std::string converted(out_cap, '\0');
-  uint errors = 0;
-  size_t out_len = my_convert(converted.data(), out_cap, to_cs,
-                              reinterpret_cast<const char*>(ptr),
-                              static_cast<size_t>(to_convert),
-                              from_cs, &errors);
-  converted.resize(out_len);
+static void assign_hex(std::string& out, const unsigned char* ptr, ulint len,
+                       ulint max_len = 64) {
+  out.clear();
+  append_hex(out, ptr, len, max_len);
+}
 
-  std::string out = escape_control_bytes(converted.data(),
-                                         static_cast<ulint>(converted.size()));
-  if (len > max_len) {
-    out.append("...(truncated)");
-  }
-  return out;
+// The column's converter; compile_record_plan() caches it in text_conv.
+static const TextConverter& field_text_converter(const field_def_t& field) {
+  return field.text_conv ? *field.text_conv : *text_converter(field.collation_id);
+}
+
+// Character data as the text formats print it: UTF-8 with control bytes
+// escaped, at most max_len source bytes.
+static void format_text_with_charset(const field_def_t& field,
+                                     const unsigned char* ptr,
+                                     ulint len,
+                                     std::string& out,
+                                     ulint max_len = 256) {
+  append_text_escaped(field_text_converter(field), ptr, static_cast<size_t>(len),
+                      static_cast<size_t>(max_len), out);
 }
 
 constexpr uint8_t JSONB_TYPE_SMALL_OBJECT = 0x0;
@@ -1634,26 +1782,16 @@ static void json_append_string(std::string& out,
                                const char* data,
                                size_t len) {
   out.push_back('"');
-  for (size_t i = 0; i < len; i++) {
-    unsigned char c = static_cast<unsigned char>(data[i]);
-    switch (c) {
-      case '\\': out.append("\\\\"); break;
-      case '"': out.append("\\\""); break;
-      case '\b': out.append("\\b"); break;
-      case '\f': out.append("\\f"); break;
-      case '\n': out.append("\\n"); break;
-      case '\r': out.append("\\r"); break;
-      case '\t': out.append("\\t"); break;
-      default:
-        if (c < 0x20) {
-          char buf[7];
-          std::snprintf(buf, sizeof(buf), "\\u%04X", c);
-          out.append(buf);
-        } else {
-          out.push_back(static_cast<char>(c));
-        }
-        break;
+  while (len > 0) {
+    const size_t run = find_json_special(data, len);
+    out.append(data, run);
+    if (run == len) {
+      break;
     }
+    char esc[6];
+    out.append(esc, json_escape_byte(static_cast<unsigned char>(data[run]), esc));
+    data += run + 1;
+    len -= run + 1;
   }
   out.push_back('"');
 }
@@ -1701,37 +1839,37 @@ static bool json_decode_scalar(uint8_t type,
       if (len < 2) {
         return false;
       }
-      out.append(std::to_string(static_cast<long long>(sint2korr(data))));
+      append_decimal(out, static_cast<int64_t>(sint2korr(data)));
       return true;
     case JSONB_TYPE_INT32:
       if (len < 4) {
         return false;
       }
-      out.append(std::to_string(static_cast<long long>(sint4korr(data))));
+      append_decimal(out, static_cast<int64_t>(sint4korr(data)));
       return true;
     case JSONB_TYPE_INT64:
       if (len < 8) {
         return false;
       }
-      out.append(std::to_string(static_cast<long long>(sint8korr(data))));
+      append_decimal(out, static_cast<int64_t>(sint8korr(data)));
       return true;
     case JSONB_TYPE_UINT16:
       if (len < 2) {
         return false;
       }
-      out.append(std::to_string(static_cast<unsigned long long>(uint2korr(data))));
+      append_decimal(out, static_cast<uint64_t>(uint2korr(data)));
       return true;
     case JSONB_TYPE_UINT32:
       if (len < 4) {
         return false;
       }
-      out.append(std::to_string(static_cast<unsigned long long>(uint4korr(data))));
+      append_decimal(out, static_cast<uint64_t>(uint4korr(data)));
       return true;
     case JSONB_TYPE_UINT64:
       if (len < 8) {
         return false;
       }
-      out.append(std::to_string(static_cast<unsigned long long>(uint8korr(data))));
+      append_decimal(out, static_cast<uint64_t>(uint8korr(data)));
       return true;
     case JSONB_TYPE_DOUBLE: {
       if (len < 8) {
@@ -1739,7 +1877,7 @@ static bool json_decode_scalar(uint8_t type,
       }
       double val = float8get(data);
       if (!json_append_double(val, out)) {
-        out.append(std::to_string(val));
+        append_fixed6(out, val);
       }
       return true;
     }
@@ -1768,9 +1906,12 @@ static bool json_decode_scalar(uint8_t type,
       if (len < 1 + static_cast<size_t>(n) + val_len) {
         return false;
       }
-      std::string hex = format_hex(data + 1 + n, val_len, val_len);
-      std::string opaque = "opaque(" + std::to_string(type_byte) + "):" + hex;
-      json_append_string(out, opaque.c_str(), opaque.size());
+      // "opaque(<type>):<hex>", which needs no escaping.
+      out.append("\"opaque(");
+      append_decimal(out, static_cast<uint64_t>(type_byte));
+      out.append("):");
+      append_hex(out, data + 1 + n, val_len, val_len);
+      out.push_back('"');
       return true;
     }
     default:
@@ -1946,37 +2087,219 @@ static bool json_decode_binary(const unsigned char* data,
                            data + 1, len - 1, out, 0);
 }
 
-static std::string format_extern(const unsigned char* ptr, ulint len, ulint max_len = 32) {
-  std::string out = "<extern:";
-  out.append(std::to_string(static_cast<unsigned long long>(len)));
+bool json_binary_to_text(const unsigned char* data, size_t len, std::string& out) {
+  return json_decode_binary(data, len, out);
+}
+
+static void assign_extern(std::string& out, const unsigned char* ptr, ulint len,
+                          ulint max_len = 32) {
+  out.assign("<extern:");
+  append_decimal(out, static_cast<uint64_t>(len));
   out.push_back(':');
-  out.append(format_hex(ptr, len, max_len));
+  append_hex(out, ptr, len, max_len);
   out.push_back('>');
-  return out;
 }
 
-struct FieldOutput {
-  bool is_null = false;
-  bool is_numeric = false;
-  bool is_json = false;
-  std::string value;
-};
-
 static void rstrip_spaces(std::string& value) {
   while (!value.empty() && value.back() == ' ') {
     value.pop_back();
   }
 }
 
-static FieldOutput format_field_value(const field_def_t& field,
-                                      const unsigned char* field_ptr,
-                                      ulint field_len,
-                                      bool is_extern,
-                                      bool hex) {
-  FieldOutput out;
+// Per-type formatters behind FieldPlan::format. Each gets a present,
+// in-row value; NULL, external and --hex values are handled by the caller.
+static void format_int_field(const field_def_t&, const unsigned char* ptr,
+                             ulint len, FieldOutput& out) {
+  out.is_numeric = true;
+  append_decimal(out.value, read_be_int_signed(ptr, len));
+}
+
+static void format_uint_field(const field_def_t&, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  out.is_numeric = true;
+  append_decimal(out.value, read_be_uint(ptr, len));
+}
+
+static void format_float_field(const field_def_t&, const unsigned char* ptr,
+                               ulint len, FieldOutput& out) {
+  if (len != 4) {
+    assign_hex(out.value, ptr, len);
+    return;
+  }
+  uint32_t raw = static_cast<uint32_t>(read_be_uint(ptr, 4));
+  float f = 0.0f;
+  std::memcpy(&f, &raw, sizeof(f));
+  out.is_numeric = true;
+  append_fixed6(out.value, static_cast<double>(f));
+}
+
+static void format_double_field(const field_def_t&, const unsigned char* ptr,
+                                ulint len, FieldOutput& out) {
+  if (len != 8) {
+    assign_hex(out.value, ptr, len);
+    return;
+  }
+  uint64_t raw = read_be_uint(ptr, 8);
+  double d = 0.0;
+  std::memcpy(&d, &raw, sizeof(d));
+  out.is_numeric = true;
+  append_fixed6(out.value, d);
+}
+
+static void format_text_field(const field_def_t& field, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  format_text_with_charset(field, ptr, len, out.value);
+  if (field.type == FT_CHAR && field.char_rstrip_spaces) {
+    rstrip_spaces(out.value);
+  }
+}
+
+static void format_json_field(const field_def_t&, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  if (json_decode_binary(ptr, len, out.value)) {
+    out.is_json = true;
+  } else {
+    assign_hex(out.value, ptr, len, len);
+  }
+}
+
+static void format_binary_field(const field_def_t&, const unsigned char* ptr,
+                                ulint len, FieldOutput& out) {
+  assign_hex(out.value, ptr, len, len);
+}
+
+static void format_date_field(const field_def_t&, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  if (!format_innodb_date(ptr, len, out.value)) {
+    assign_hex(out.value, ptr, len);
+  }
+}
+
+static void format_time_field(const field_def_t& field, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  unsigned int dec = static_cast<unsigned int>(field.time_precision);
+  if (!format_innodb_time(ptr, len, dec, out.value)) {
+    assign_hex(out.value, ptr, len);
+  }
+}
+
+static void format_datetime_field(const field_def_t& field, const unsigned char* ptr,
+                                  ulint len, FieldOutput& out) {
+  unsigned int dec = static_cast<unsigned int>(field.time_precision);
+  if (!format_innodb_datetime(ptr, len, dec, out.value)) {
+    assign_hex(out.value, ptr, len);
+  }
+}
+
+static void format_timestamp_field(const field_def_t& field, const unsigned char* ptr,
+                                   ulint len, FieldOutput& out) {
+  unsigned int dec = static_cast<unsigned int>(field.time_precision);
+  if (!format_innodb_timestamp(ptr, len, dec, out.value)) {
+    assign_hex(out.value, ptr, len);
+  }
+}
+
+static void format_year_field(const field_def_t&, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  if (len != 1) {
+    assign_hex(out.value, ptr, len);
+    return;
+  }
+  if (ptr[0] == 0) {
+    out.value.assign("0000");
+    return;
+  }
+  append_decimal(out.value, static_cast<uint64_t>(1900 + ptr[0]));
+}
+
+static void format_decimal_field(const field_def_t& field, const unsigned char* ptr,
+                                 ulint len, FieldOutput& out) {
+  if (format_decimal_value(field, ptr, len, out.value)) {
+    out.is_numeric = true;
+  } else {
+    assign_hex(out.value, ptr, len);
+  }
+}
+
+static void format_enum_field(const field_def_t& field, const unsigned char* ptr,
+                              ulint len, FieldOutput& out) {
+  uint64_t idx = read_be_uint(ptr, len);
+  if (!format_enum_value(field, idx, out.value)) {
+    out.is_numeric = true;
+    out.value.clear();
+    append_decimal(out.value, idx);
+  }
+}
+
+static void format_set_field(const field_def_t& field, const unsigned char* ptr,
+                             ulint len, FieldOutput& out) {
+  if (len > 8) {
+    assign_hex(out.value, ptr, len);
+    return;
+  }
+  uint64_t mask = read_be_uint(ptr, len);
+  if (!format_set_value(field, mask, out.value)) {
+    out.is_numeric = true;
+    out.value.clear();
+    append_decimal(out.value, mask);
+  }
+}
+
+static void format_bit_field(const field_def_t&, const unsigned char* ptr,
+                             ulint len, FieldOutput& out) {
+  if (len > 8) {
+    assign_hex(out.value, ptr, len);
+    return;
+  }
+  out.is_numeric = true;
+  append_decimal(out.value, read_be_uint(ptr, len));
+}
+
+static void format_hex_field(const field_def_t&, const unsigned char* ptr,
+                             ulint len, FieldOutput& out) {
+  assign_hex(out.value, ptr, len);
+}
+
+static FieldFormatFn field_formatter(field_type_t type) {
+  switch (type) {
+    case FT_INT:       return format_int_field;
+    case FT_UINT:      return format_uint_field;
+    case FT_FLOAT:     return format_float_field;
+    case FT_DOUBLE:    return format_double_field;
+    case FT_CHAR:
+    case FT_TEXT:      return format_text_field;
+    case FT_JSON:      return format_json_field;
+    case FT_BLOB:
+    case FT_BIN:       return format_binary_field;
+    case FT_DATE:      return format_date_field;
+    case FT_TIME:      return format_time_field;
+    case FT_DATETIME:  return format_datetime_field;
+    case FT_TIMESTAMP: return format_timestamp_field;
+    case FT_YEAR:      return format_year_field;
+    case FT_DECIMAL:   return format_decimal_field;
+    case FT_ENUM:      return format_enum_field;
+    case FT_SET:       return format_set_field;
+    case FT_BIT:       return format_bit_field;
+    default:           return format_hex_field;
+  }
+}
+
+// Fills `out` in place; callers keep one FieldOutput per row loop so the
+// value buffer's capacity is reused instead of reallocated per column.
+static void format_field_value(const field_def_t& field,
+                               FieldFormatFn format,
+                               const unsigned char* field_ptr,
+                               ulint field_len,
+                               bool is_extern,
+                               bool hex,
+                               FieldOutput& out) {
+  out.is_null = false;
+  out.is_numeric = false;
+  out.is_json = false;
+  out.value.clear();
   if (field_len == UNIV_SQL_NULL) {
     out.is_null = true;
-    return out;
+    return;
   }
 
   if (is_extern) {
@@ -1984,35 +2307,29 @@ static FieldOutput format_field_value(const field_def_t& field,
         (field.type == FT_TEXT || field.type == FT_BLOB ||
          field.type == FT_CHAR || field.type == FT_BIN ||
          field.type == FT_JSON)) {
-      std::string lob_data;
+      const RowOutputOptions& row_opts = current_row_worker_context().output;
+      const unsigned char* lob_data = nullptr;
+      size_t lob_len = 0;
       bool truncated = false;
-      if (read_external_lob_value(field_ptr, field_len, lob_data, truncated)) {
-        size_t max_len = lob_data.size();
-        if (g_row_output.lob_max_bytes > 0 && max_len > g_row_output.lob_max_bytes) {
-          max_len = g_row_output.lob_max_bytes;
+      if (read_external_lob_value(field_ptr, field_len, &lob_data, &lob_len, truncated)) {
+        size_t max_len = lob_len;
+        if (row_opts.lob_max_bytes > 0 && max_len > row_opts.lob_max_bytes) {
+          max_len = row_opts.lob_max_bytes;
         }
         if (field.type == FT_BLOB || field.type == FT_BIN) {
-          out.value = format_hex(reinterpret_cast<const unsigned char*>(lob_data.data()),
-                                 lob_data.size(), max_len);
+          append_hex(out.value, lob_data, lob_len, max_len);
         } else if (field.type == FT_JSON) {
-          if (!truncated &&
-              json_decode_binary(
-                  reinterpret_cast<const unsigned char*>(lob_data.data()),
-                  lob_data.size(), out.value)) {
+          if (!truncated && json_decode_binary(lob_data, lob_len, out.value)) {
             out.is_json = true;
           } else {
-            out.value = format_hex(
-                reinterpret_cast<const unsigned char*>(lob_data.data()),
-                lob_data.size(), max_len);
+            assign_hex(out.value, lob_data, lob_len, max_len);
             if (truncated) {
               out.value.append("...(truncated)");
             }
           }
         } else {
-          out.value = format_text_with_charset(
-              reinterpret_cast<const unsigned char*>(lob_data.data()),
-              static_cast<ulint>(lob_data.size()),
-              field.collation_id, static_cast<ulint>(max_len));
+          format_text_with_charset(field, lob_data, static_cast<ulint>(lob_len),
+                                   out.value, static_cast<ulint>(max_len));
           if (field.type == FT_CHAR && field.char_rstrip_spaces) {
             rstrip_spaces(out.value);
           }
@@ -2020,216 +2337,583 @@ static FieldOutput format_field_value(const field_def_t& field,
         if (truncated) {
           out.value.append("...(truncated)");
         }
-        return out;
+        return;
       }
     }
-    out.value = format_extern(field_ptr, field_len);
-    return out;
+    assign_extern(out.value, field_ptr, field_len);
+    return;
   }
   if (hex) {
-    out.value = format_hex(field_ptr, field_len);
-    return out;
+    append_hex(out.value, field_ptr, field_len);
+    return;
+  }
+  format(field, field_ptr, field_len, out);
+}
+
+// Large external TEXT/BLOB values in the text formats are never built up
+// in a FieldOutput: the LOB readers hand each page to a LobOutputStream,
+// which escapes it for the row format straight into the sink and lets the
+// sink flush mid-row, so a value costs a few pages of memory however long
+// it is. Smaller values, JSON (decoded as a whole) and CHAR (right-trimmed)
+// take format_field_value() as before.
+static const size_t kLobStreamMinBytes = 64 * 1024;
+
+class LobOutputStream final : public LobChunkSink {
+ public:
+  LobOutputStream(RowOutputSink& sink, RowOutputFormat format,
+                  const field_def_t& field)
+      : sink_(sink),
+        format_(format),
+        hex_(field.type == FT_BLOB || field.type == FT_BIN),
+        text_(field_text_converter(field)) {
+    // CSV cannot know in advance whether the value needs quoting, so
+    // streamed text is always quoted. Hex never does.
+    quoted_ = format_ == ROW_OUTPUT_JSONL || (format_ == ROW_OUTPUT_CSV && !hex_);
+    if (quoted_) {
+      sink_.put('"');
+    }
+  }
+
+  void consume(const unsigned char* p, size_t n) override {
+    StageTimer timer(STAGE_FORMAT);
+    piece_.clear();
+    if (hex_) {
+      append_hex(piece_, p, n, n);
+    } else {
+      text_.append(p, n, piece_);
+    }
+    write_piece();
   }
 
-  switch (field.type) {
-    case FT_INT: {
-      int64_t val = read_be_int_signed(field_ptr, field_len);
-      out.is_numeric = true;
-      out.value = std::to_string(static_cast<long long>(val));
-      break;
+  // The value ends here; "...(truncated)" when it was cut at lob_max_bytes
+  // or its pages ended early.
+  void finish(bool truncated) {
+    piece_.clear();
+    if (!hex_) {
+      text_.finish(piece_);
     }
-    case FT_UINT: {
-      uint64_t val = read_be_uint(field_ptr, field_len);
-      out.is_numeric = true;
-      out.value = std::to_string(static_cast<unsigned long long>(val));
-      break;
+    if (truncated) {
+      piece_.append("...(truncated)");
     }
-    case FT_FLOAT: {
-      if (field_len == 4) {
-        uint32_t raw = static_cast<uint32_t>(read_be_uint(field_ptr, 4));
-        float f = 0.0f;
-        std::memcpy(&f, &raw, sizeof(f));
-        char buf[64];
-        std::snprintf(buf, sizeof(buf), "%f", f);
-        out.is_numeric = true;
-        out.value = buf;
-      } else {
-        out.value = format_hex(field_ptr, field_len);
-      }
-      break;
+    write_piece();
+    if (quoted_) {
+      sink_.put('"');
     }
-    case FT_DOUBLE: {
-      if (field_len == 8) {
-        uint64_t raw = read_be_uint(field_ptr, 8);
-        double d = 0.0;
-        std::memcpy(&d, &raw, sizeof(d));
-        char buf[64];
-        std::snprintf(buf, sizeof(buf), "%f", d);
-        out.is_numeric = true;
-        out.value = buf;
+  }
+
+ private:
+  void write_piece() {
+    if (format_ == ROW_OUTPUT_JSONL) {
+      sink_.append_json_escaped(piece_.data(), piece_.size());
+    } else if (quoted_) {
+      sink_.append_csv_escaped(piece_.data(), piece_.size());
+    } else {
+      sink_.append(piece_);  // escaped text never holds a NUL
+    }
+    sink_.flush_if_full();
+  }
+
+  RowOutputSink& sink_;
+  RowOutputFormat format_;
+  bool hex_;
+  bool quoted_;
+  TextEscapeStream text_;
+  std::string piece_;
+};
+
+// Writes an external value through LobOutputStream when it qualifies (see
+// above); false, with nothing written, when format_field_value() should.
+static bool write_streamed_lob(RowOutputSink& sink, RowOutputFormat format,
+                               const field_def_t& field,
+                               const unsigned char* field_ptr, ulint field_len) {
+  if (field.type != FT_BLOB && field.type != FT_BIN &&
+      (field.type != FT_TEXT ||
+       !TextEscapeStream::supported(field_text_converter(field)))) {
+    return false;
+  }
+  ExternLob lob;
+  if (!prepare_external_lob(field_ptr, field_len, lob) ||
+      lob.size() < kLobStreamMinBytes) {
+    return false;
+  }
+  LobOutputStream stream(sink, format, field);
+  const bool complete = read_external_lob(field_ptr, lob, stream);
+  stream.finish(lob.truncated || !complete);
+  return true;
+}
+
+void compile_record_plan(table_def_t* table) {
+  std::unique_ptr<RecordPlan> plan(new RecordPlan());
+  const ulint n = table->fields_count > 0 ? (ulint)table->fields_count : 0;
+  plan->fields.resize(n);
+
+  ulint n_nullable = 0;
+  bool in_prefix = true;
+  ulint prefix_end = 0;
+  for (ulint i = 0; i < n; i++) {
+    const field_def_t& fld = table->fields[i];
+    FieldPlan& fp = plan->fields[i];
+    fp.def = &fld;
+    fp.format = field_formatter(fld.type);
+    table->fields[i].text_conv = text_converter(fld.collation_id);
+    fp.fixed_len = fld.fixed_length > 0 ? (uint32_t)fld.fixed_length : 0;
+    fp.min_len = fld.min_length;
+    fp.max_len = fld.max_length;
+    if (fld.can_be_null) {
+      fp.null_byte = (uint16_t)(n_nullable / 8);
+      fp.null_mask = (uint8_t)(1u << (n_nullable % 8));
+      n_nullable++;
+    }
+    fp.long_len = fld.max_length > 255 || fld.type == FT_BLOB ||
+                  fld.type == FT_TEXT || fld.type == FT_JSON;
+    if (fp.fixed_len != 0) {
+      fp.check_len = fp.fixed_len < fp.min_len || fp.fixed_len > fp.max_len;
+    } else {
+      // In-row lengths never exceed 0x3fff.
+      fp.check_len = fp.min_len > 0 || fp.max_len < 0x3fff;
+    }
+    fp.internal = fld.type == FT_INTERNAL;
+
+    const char* name = fld.name ? fld.name : "";
+    fp.json_key.push_back('"');
+    for (const char* c = name; *c; c++) {
+      const size_t special = find_json_special(c, 1);
+      if (special == 1) {
+        fp.json_key.push_back(*c);
       } else {
-        out.value = format_hex(field_ptr, field_len);
+        char esc[6];
+        fp.json_key.append(esc, json_escape_byte(static_cast<unsigned char>(*c), esc));
       }
-      break;
     }
-    case FT_CHAR:
-    case FT_TEXT:
-      out.value = format_text_with_charset(field_ptr, field_len,
-                                           field.collation_id);
-      if (field.type == FT_CHAR && field.char_rstrip_spaces) {
-        rstrip_spaces(out.value);
+    fp.json_key.append("\":");
+
+    if (in_prefix && !fld.can_be_null && fp.fixed_len != 0 &&
+        prefix_end + fp.fixed_len <= 0xffff) {
+      prefix_end += fp.fixed_len;
+      plan->prefix_offsets.push_back(prefix_end);
+    } else {
+      in_prefix = false;
+    }
+  }
+  plan->null_bytes = (n_nullable + 7) / 8;
+  plan->fixed_prefix = plan->prefix_offsets.size();
+
+  free_record_plan(table);
+  table->plan = plan.release();
+}
+
+void free_record_plan(table_def_t* table) {
+  delete table->plan;
+  table->plan = nullptr;
+}
+
+// Whether field i is output: the --columns selection when there is one,
+// otherwise every column but the internal ones (shown with --debug).
+static bool field_is_output(const RowOutputOptions& opts, const table_def_t* table,
+                            ulint i) {
+  if (!opts.column_mask.empty()) {
+    return i < opts.column_mask.size() && opts.column_mask[i];
+  }
+  return table->fields[i].type != FT_INTERNAL || log_enabled(LOG_LEVEL_DEBUG);
+}
+
+// Same, reading the packed plan instead of the field definition.
+static bool field_is_output(const RowOutputOptions& opts, const FieldPlan& fp,
+                            ulint i) {
+  if (!opts.column_mask.empty()) {
+    return i < opts.column_mask.size() && opts.column_mask[i];
+  }
+  return !fp.internal || log_enabled(LOG_LEVEL_DEBUG);
+}
+
+// --where on the stored key bytes; NULL never matches.
+static bool row_passes_filter(const RowOutputOptions& opts, const rec_t* rec,
+                              const ulint* offsets) {
+  for (const KeyRange& range : opts.where.ranges) {
+    ulint len;
+    const unsigned char* ptr = my_rec_get_nth_field(rec, offsets,
+                                                    static_cast<ulint>(range.field), &len);
+    if (len == UNIV_SQL_NULL ||
+        !key_range_contains(range, key_range_value(range, ptr, len,
+                                                   opts.raw_integers))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parse_column_selection(const table_def_t* table, const std::string& list,
+                            std::vector<bool>* mask, std::string* err) {
+  mask->assign(static_cast<size_t>(table->fields_count), false);
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = list.size();
+    }
+    const std::string name = list.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (name.empty()) {
+      continue;
+    }
+    int found = -1;
+    for (int i = 0; i < table->fields_count; i++) {
+      if (table->fields[i].name && name == table->fields[i].name) {
+        found = i;
+        break;
       }
-      break;
-    case FT_JSON: {
-      std::string decoded;
-      if (json_decode_binary(field_ptr, field_len, decoded)) {
-        out.value.swap(decoded);
-        out.is_json = true;
-      } else {
-        out.value = format_hex(field_ptr, field_len, field_len);
+    }
+    if (found < 0) {
+      if (err) {
+        *err = "unknown column '" + name + "'";
       }
-      break;
+      return false;
     }
+    (*mask)[static_cast<size_t>(found)] = true;
+  }
+  if (std::find(mask->begin(), mask->end(), true) == mask->end()) {
+    if (err) {
+      *err = "no columns selected";
+    }
+    return false;
+  }
+  return true;
+}
+
+// Character data as UTF-8 without the control-byte escaping and length
+// cap the text formats apply; typed output keeps values verbatim.
+static void convert_text_utf8(const field_def_t& field, const unsigned char* ptr,
+                              size_t len, std::string& out) {
+  out.clear();
+  append_text_utf8(field_text_converter(field), ptr, len, out);
+}
+
+static ColumnKind columnar_kind(const field_def_t& field) {
+  switch (field.type) {
+    case FT_INT:
+    case FT_YEAR:
+      return COLUMN_INT64;
+    case FT_UINT:
+    case FT_BIT:
+      return COLUMN_UINT64;
+    case FT_FLOAT:
+      return COLUMN_FLOAT;
+    case FT_DOUBLE:
+      return COLUMN_DOUBLE;
+    case FT_DECIMAL:
+      // decimal128 holds 38 digits; MySQL allows 65.
+      return field.decimal_precision > 0 && field.decimal_precision <= 38
+                 ? COLUMN_DECIMAL : COLUMN_UTF8;
+    case FT_DATE:
+      return COLUMN_DATE;
+    case FT_DATETIME:
+      return COLUMN_DATETIME;
+    case FT_TIMESTAMP:
+      return COLUMN_TIMESTAMP;
     case FT_BLOB:
     case FT_BIN:
-      out.value = format_hex(field_ptr, field_len, field_len);
-      break;
-    case FT_DATE: {
-      std::string formatted;
-      bool ok = format_innodb_date(field_ptr, field_len, formatted);
-      out.value = ok ? formatted : format_hex(field_ptr, field_len);
-      break;
+    case FT_INTERNAL:
+      return COLUMN_BINARY;
+    default:
+      // CHAR, TEXT, JSON, TIME, ENUM, SET
+      return COLUMN_UTF8;
+  }
+}
+
+std::vector<ColumnSpec> columnar_schema(const table_def_t* table,
+                                        const RowOutputOptions& opts) {
+  std::vector<ColumnSpec> cols;
+  if (opts.include_meta) {
+    cols.push_back({"page_no", COLUMN_UINT64, 0, 0});
+    cols.push_back({"rec_offset", COLUMN_UINT64, 0, 0});
+    cols.push_back({"rec_deleted", COLUMN_BOOL, 0, 0});
+  }
+  for (ulint i = 0; i < (ulint)table->fields_count; i++) {
+    const field_def_t& field = table->fields[i];
+    if (!field_is_output(opts, table, i)) {
+      continue;
     }
-    case FT_TIME: {
-      std::string formatted;
-      unsigned int dec = static_cast<unsigned int>(field.time_precision);
-      bool ok = format_innodb_time(field_ptr, field_len, dec, formatted);
-      out.value = ok ? formatted : format_hex(field_ptr, field_len);
-      break;
+    ColumnSpec spec;
+    spec.name = field.name;
+    spec.kind = columnar_kind(field);
+    if (spec.kind == COLUMN_DECIMAL) {
+      spec.precision = field.decimal_precision;
+      spec.scale = field.decimal_digits;
     }
-    case FT_DATETIME:
-    case FT_TIMESTAMP: {
-      std::string formatted;
-      unsigned int dec = static_cast<unsigned int>(field.time_precision);
-      bool ok = false;
-      if (field.type == FT_DATETIME) {
-        ok = format_innodb_datetime(field_ptr, field_len, dec, formatted);
-      } else {
-        ok = format_innodb_timestamp(field_ptr, field_len, dec, formatted);
+    cols.push_back(spec);
+  }
+  return cols;
+}
+
+// One column of process_ibrec() for RowOutputOptions::columnar. Values the
+// text formats would fall back to hex for (bad lengths, unreadable LOBs,
+// zero dates) become nulls.
+static void append_columnar_value(ColumnarWriter& w, size_t col,
+                                  const field_def_t& field,
+                                  const unsigned char* field_ptr,
+                                  ulint field_len, bool is_extern,
+                                  FieldOutput& scratch) {
+  if (field_len == UNIV_SQL_NULL) {
+    w.append_null(col);
+    return;
+  }
+
+  const ColumnKind kind = columnar_kind(field);
+  if (is_extern) {
+    const unsigned char* data = nullptr;
+    size_t data_len = 0;
+    bool truncated = false;
+    if ((kind != COLUMN_UTF8 && kind != COLUMN_BINARY) ||
+        !read_external_lob_value(field_ptr, field_len, &data, &data_len, truncated) ||
+        (field.type == FT_JSON && truncated)) {
+      w.append_null(col);
+      return;
+    }
+    if (field.type == FT_JSON) {
+      if (!json_decode_binary(data, data_len, scratch.value)) {
+        w.append_null(col);
+        return;
+      }
+    } else if (kind == COLUMN_BINARY) {
+      w.append_bytes(col, data, data_len);
+      return;
+    } else {
+      convert_text_utf8(field, data, data_len, scratch.value);
+      if (field.type == FT_CHAR && field.char_rstrip_spaces) {
+        rstrip_spaces(scratch.value);
       }
-      out.value = ok ? formatted : format_hex(field_ptr, field_len);
-      break;
     }
-    case FT_YEAR: {
-      if (field_len == 1) {
-        unsigned int year = field_ptr[0] == 0 ? 0 : 1900 + field_ptr[0];
-        char buf[5];
-        std::snprintf(buf, sizeof(buf), "%04u", year);
-        out.value = buf;
-      } else {
-        out.value = format_hex(field_ptr, field_len);
+    w.append_bytes(col, scratch.value.data(), scratch.value.size());
+    return;
+  }
+
+  switch (field.type) {
+    case FT_INT:
+      w.append_int(col, read_be_int_signed(field_ptr, field_len));
+      return;
+    case FT_UINT:
+      w.append_uint(col, read_be_uint(field_ptr, field_len));
+      return;
+    case FT_BIT:
+      if (field_len > 8) {
+        break;
       }
-      break;
+      w.append_uint(col, read_be_uint(field_ptr, field_len));
+      return;
+    case FT_YEAR:
+      if (field_len != 1) {
+        break;
+      }
+      w.append_int(col, field_ptr[0] == 0 ? 0 : 1900 + field_ptr[0]);
+      return;
+    case FT_FLOAT: {
+      if (field_len != 4) {
+        break;
+      }
+      uint32_t raw = static_cast<uint32_t>(read_be_uint(field_ptr, 4));
+      float f = 0.0f;
+      std::memcpy(&f, &raw, sizeof(f));
+      w.append_double(col, f);
+      return;
     }
-    case FT_DECIMAL: {
-      std::string formatted;
-      bool ok = format_decimal_value(field, field_ptr, field_len, formatted);
-      if (ok) {
-        out.is_numeric = true;
-        out.value = formatted;
+    case FT_DOUBLE: {
+      if (field_len != 8) {
+        break;
+      }
+      uint64_t raw = read_be_uint(field_ptr, 8);
+      double d = 0.0;
+      std::memcpy(&d, &raw, sizeof(d));
+      w.append_double(col, d);
+      return;
+    }
+    case FT_DECIMAL:
+      if (!format_decimal_value(field, field_ptr, field_len, scratch.value)) {
+        break;
+      }
+      if (kind == COLUMN_DECIMAL) {
+        w.append_decimal(col, scratch.value);
       } else {
-        out.value = format_hex(field_ptr, field_len);
+        w.append_bytes(col, scratch.value.data(), scratch.value.size());
       }
-      break;
+      return;
+    case FT_DATE: {
+      int32_t days = 0;
+      if (!decode_innodb_date(field_ptr, field_len, &days)) {
+        break;
+      }
+      w.append_int(col, days);
+      return;
     }
-    case FT_ENUM: {
-      uint64_t idx = read_be_uint(field_ptr, field_len);
-      std::string formatted;
-      bool ok = format_enum_value(field, idx, formatted);
-      if (ok) {
-        out.value = formatted;
-      } else {
-        out.is_numeric = true;
-        out.value = std::to_string(static_cast<unsigned long long>(idx));
+    case FT_DATETIME:
+    case FT_TIMESTAMP: {
+      const unsigned int dec = static_cast<unsigned int>(field.time_precision);
+      int64_t micros = 0;
+      const bool ok = field.type == FT_DATETIME
+                          ? decode_innodb_datetime(field_ptr, field_len, dec, &micros)
+                          : decode_innodb_timestamp(field_ptr, field_len, dec, &micros);
+      if (!ok) {
+        break;
       }
-      break;
+      w.append_int(col, micros);
+      return;
     }
-    case FT_SET: {
-      if (field_len > 8) {
-        out.value = format_hex(field_ptr, field_len);
+    case FT_CHAR:
+    case FT_TEXT:
+      convert_text_utf8(field, field_ptr, field_len, scratch.value);
+      if (field.type == FT_CHAR && field.char_rstrip_spaces) {
+        rstrip_spaces(scratch.value);
+      }
+      w.append_bytes(col, scratch.value.data(), scratch.value.size());
+      return;
+    case FT_JSON:
+      if (!json_decode_binary(field_ptr, field_len, scratch.value)) {
         break;
       }
-      uint64_t mask = read_be_uint(field_ptr, field_len);
-      std::string formatted;
-      bool ok = format_set_value(field, mask, formatted);
-      if (ok) {
-        out.value = formatted;
+      w.append_bytes(col, scratch.value.data(), scratch.value.size());
+      return;
+    case FT_BLOB:
+    case FT_BIN:
+    case FT_INTERNAL:
+      w.append_bytes(col, field_ptr, field_len);
+      return;
+    default:
+      // TIME, ENUM, SET: the same text the other formats print.
+      format_field_value(field, field_formatter(field.type), field_ptr, field_len,
+                         false, false, scratch);
+      if (scratch.is_null) {
+        w.append_null(col);
       } else {
-        out.is_numeric = true;
-        out.value = std::to_string(static_cast<unsigned long long>(mask));
+        w.append_bytes(col, scratch.value.data(), scratch.value.size());
       }
-      break;
+      return;
+  }
+  w.append_null(col);
+}
+
+static void append_columnar_row(ColumnarWriter& w, rec_t* rec, table_def_t* table,
+                                ulint* offsets, const RowMeta* meta) {
+  RowWorkerContext& ctx = current_row_worker_context();
+  size_t col = 0;
+  if (ctx.output.include_meta) {
+    // The schema was built with the meta columns, so fill them even for
+    // callers that pass no RowMeta.
+    if (meta) {
+      w.append_uint(col++, static_cast<uint64_t>(meta->page_no));
+      w.append_uint(col++, static_cast<uint64_t>(meta->rec_offset));
+      w.append_bool(col++, meta->deleted);
+    } else {
+      w.append_null(col++);
+      w.append_null(col++);
+      w.append_null(col++);
     }
-    case FT_BIT: {
-      if (field_len <= 8) {
-        uint64_t mask = read_be_uint(field_ptr, field_len);
-        out.is_numeric = true;
-        out.value = std::to_string(static_cast<unsigned long long>(mask));
-      } else {
-        out.value = format_hex(field_ptr, field_len);
-      }
-      break;
+  }
+  const RecordPlan& plan = record_plan(table);
+  for (ulint i = 0; i < plan.fields.size(); i++) {
+    const FieldPlan& fp = plan.fields[i];
+    if (!field_is_output(ctx.output, fp, i)) {
+      continue;
     }
-    default:
-      out.value = format_hex(field_ptr, field_len);
-      break;
+    ulint field_len;
+    const unsigned char* field_ptr = my_rec_get_nth_field(rec, offsets, i, &field_len);
+    bool is_extern = my_rec_offs_nth_extern(offsets, i);
+    append_columnar_value(w, col++, *fp.def, field_ptr, field_len,
+                          is_extern, ctx.field_scratch);
   }
+  w.end_row();
+}
 
-  return out;
+// Bind the calling thread's sink to its current output stream. Nothing
+// else prints there while rows are written (diagnostics go to the log
+// stream), so rows are buffered across calls. An OutputFileWriter's
+// stream gets the rows with their ends, to split files between rows.
+static RowOutputSink& row_sink() {
+  RowWorkerContext& ctx = current_row_worker_context();
+  FILE* out = output_stream();
+  OutputFileWriter* writer = ctx.output.file_writer;
+  ctx.sink.bind(out, true, writer && out == writer->stream() ? writer : nullptr);
+  return ctx.sink;
 }
 
-static bool csv_needs_quotes(const std::string& value) {
-  return value.find_first_of(",\"\n\r") != std::string::npos;
+void flush_row_output() {
+  RowWorkerContext& ctx = current_row_worker_context();
+  ctx.sink.flush();
+  ctx.sink.bind(nullptr, false);
 }
 
-static void write_csv_value(FILE* out, const std::string& value) {
-  if (!csv_needs_quotes(value)) {
-    std::fputs(value.c_str(), out);
-    return;
+static void write_row_header(RowOutputSink& sink, const RowOutputOptions& row_opts,
+                             const table_def_t* table, bool with_meta) {
+  const char sep = row_opts.format == ROW_OUTPUT_CSV ? ',' : '|';
+  ulint printed = 0;
+  if (with_meta) {
+    sink.append_cstr("page_no");
+    sink.put(sep);
+    sink.append_cstr("rec_offset");
+    sink.put(sep);
+    sink.append_cstr("rec_deleted");
+    printed += 3;
+  }
+
+  for (ulint i = 0; i < (ulint)table->fields_count; i++) {
+    if (!field_is_output(row_opts, table, i)) {
+      continue;
+    }
+    if (printed > 0) {
+      sink.put(sep);
+    }
+    sink.append_cstr(table->fields[i].name);
+    printed++;
   }
-  std::fputc('"', out);
-  for (char c : value) {
-    if (c == '"') {
-      std::fputc('"', out);
-      std::fputc('"', out);
+  sink.put('\n');
+}
+
+void print_row_header(const table_def_t* table, bool with_meta) {
+  RowWorkerContext& ctx = current_row_worker_context();
+  if (ctx.output.format != ROW_OUTPUT_JSONL) {
+    RowOutputSink& sink = row_sink();
+    sink.flush();
+    FILE* out = output_stream();
+    ctx.header_begin = std::ftell(out);
+    write_row_header(sink, ctx.output, table,
+                     ctx.output.include_meta && with_meta);
+    sink.flush();
+    ctx.header_end = std::ftell(out);
+    if (ctx.output.file_writer && out == ctx.output.file_writer->stream()) {
+      ctx.output.file_writer->header_end();
+    }
+  }
+  ctx.printed_header = true;
+}
+
+/**
+ * The first n columns of rec as a JSON array, into stats' last_key (and
+ * first_key for the first row).
+ */
+static void note_row_key(ParseStats& stats, const RecordPlan& plan, const rec_t* rec,
+                         const ulint* offsets, unsigned n, FieldOutput& value)
+{
+  std::string& key = stats.last_key;
+  key.assign(1, '[');
+  for (ulint i = 0; i < n && i < plan.fields.size(); i++) {
+    const FieldPlan& fp = plan.fields[i];
+    ulint field_len;
+    const unsigned char* field_ptr = my_rec_get_nth_field(rec, offsets, i, &field_len);
+    format_field_value(*fp.def, fp.format, field_ptr, field_len,
+                       my_rec_offs_nth_extern(offsets, i), false, value);
+    if (i > 0) {
+      key.push_back(',');
+    }
+    if (value.is_null) {
+      key.append("null");
+    } else if (value.is_json || value.is_numeric) {
+      key.append(value.value);
     } else {
-      std::fputc(c, out);
-    }
-  }
-  std::fputc('"', out);
-}
-
-static void write_json_string(FILE* out, const std::string& value) {
-  std::fputc('"', out);
-  for (unsigned char c : value) {
-    switch (c) {
-      case '\\': std::fputs("\\\\", out); break;
-      case '"': std::fputs("\\\"", out); break;
-      case '\b': std::fputs("\\b", out); break;
-      case '\f': std::fputs("\\f", out); break;
-      case '\n': std::fputs("\\n", out); break;
-      case '\r': std::fputs("\\r", out); break;
-      case '\t': std::fputs("\\t", out); break;
-      default:
-        if (c < 0x20) {
-          std::fprintf(out, "\\u%04X", c);
-        } else {
-          std::fputc(c, out);
-        }
-        break;
+      json_append_string(key, value.value.data(), value.value.size());
     }
   }
-  std::fputc('"', out);
+  key.push_back(']');
+  if (stats.first_key.empty()) {
+    stats.first_key = key;
+  }
 }
 
 /** process_ibrec() => print columns in selected format. */
@@ -2237,126 +2921,129 @@ ulint process_ibrec(page_t *page, rec_t *rec, table_def_t *table, ulint *offsets
                     bool hex, const RowMeta* meta)
 {
   (void)page; // not used here
-  const bool show_internal = parser_debug_enabled();
-  FILE* out = output_stream();
-
-  if (g_row_output.format != ROW_OUTPUT_JSONL) {
-    if (!g_printed_header) {
-      ulint printed = 0;
-      if (g_row_output.include_meta && meta) {
-        std::fputs("page_no", out);
-        std::fputs(g_row_output.format == ROW_OUTPUT_CSV ? "," : "|", out);
-        std::fputs("rec_offset", out);
-        std::fputs(g_row_output.format == ROW_OUTPUT_CSV ? "," : "|", out);
-        std::fputs("rec_deleted", out);
-        printed += 3;
-      }
+  RowWorkerContext& ctx = current_row_worker_context();
+  const RowOutputOptions& row_opts = ctx.output;
 
-      for (ulint i = 0; i < (ulint)table->fields_count; i++) {
-        if (!show_internal && table->fields[i].type == FT_INTERNAL) {
-          continue;
-        }
-        if (printed > 0) {
-          std::fputs(g_row_output.format == ROW_OUTPUT_CSV ? "," : "|", out);
-        }
-        std::fputs(table->fields[i].name, out);
-        printed++;
-      }
-      std::fputc('\n', out);
-      g_printed_header = true;
+  ParseStats* stats = current_parse_stats();
+  if (!row_opts.where.empty() && !row_passes_filter(row_opts, rec, offsets)) {
+    if (stats) {
+      stats->records_filtered++;
     }
+    return my_rec_offs_data_size(offsets);
+  }
+  if (stats) {
+    stats->rows++;
+  }
+  StageTimer timer(STAGE_FORMAT);
+  // Decimal buffers and whole LOB values of this row; freed when it is done.
+  RowArena::Scope row_temporaries(ctx.arena);
+  if (row_opts.key_fields > 0 && stats) {
+    note_row_key(*stats, record_plan(table), rec, offsets, row_opts.key_fields,
+                 ctx.field_scratch);
+  }
+
+  if (row_opts.columnar) {
+    // Write errors are sticky; the caller gets them from finish().
+    append_columnar_row(*row_opts.columnar, rec, table, offsets, meta);
+    return my_rec_offs_data_size(offsets);
   }
 
+  if (row_opts.format != ROW_OUTPUT_JSONL && !ctx.printed_header) {
+    print_row_header(table, meta != nullptr);
+  }
+
+  RowOutputSink& sink = row_sink();
+  FieldOutput& value = ctx.field_scratch;
   ulint data_size = my_rec_offs_data_size(offsets);
+  const RecordPlan& plan = record_plan(table);
 
-  if (g_row_output.format == ROW_OUTPUT_JSONL) {
+  if (row_opts.format == ROW_OUTPUT_JSONL) {
     bool first = true;
-    std::fputc('{', out);
-    if (g_row_output.include_meta && meta) {
-      std::fputs("\"page_no\":", out);
-      std::fprintf(out, "%llu", static_cast<unsigned long long>(meta->page_no));
-      std::fputs(",\"rec_offset\":", out);
-      std::fprintf(out, "%lu", static_cast<unsigned long>(meta->rec_offset));
-      std::fputs(",\"rec_deleted\":", out);
-      std::fputs(meta->deleted ? "true" : "false", out);
+    sink.put('{');
+    if (row_opts.include_meta && meta) {
+      sink.append_cstr("\"page_no\":");
+      sink.append_uint(static_cast<uint64_t>(meta->page_no));
+      sink.append_cstr(",\"rec_offset\":");
+      sink.append_uint(static_cast<uint64_t>(meta->rec_offset));
+      sink.append_cstr(",\"rec_deleted\":");
+      sink.append_cstr(meta->deleted ? "true" : "false");
       first = false;
     }
 
-    for (ulint i = 0; i < (ulint)table->fields_count; i++) {
-      if (!show_internal && table->fields[i].type == FT_INTERNAL) {
+    for (ulint i = 0; i < plan.fields.size(); i++) {
+      const FieldPlan& fp = plan.fields[i];
+      // Unselected fields are skipped over by offsets, never decoded.
+      if (!field_is_output(row_opts, fp, i)) {
         continue;
       }
       ulint field_len;
       const unsigned char* field_ptr = my_rec_get_nth_field(rec, offsets, i, &field_len);
       bool is_extern = my_rec_offs_nth_extern(offsets, i);
-      FieldOutput value = format_field_value(table->fields[i], field_ptr, field_len, is_extern, hex);
 
       if (!first) {
-        std::fputc(',', out);
+        sink.put(',');
       }
-      write_json_string(out, table->fields[i].name);
-      std::fputc(':', out);
+      sink.append(fp.json_key);
+      first = false;
+      if (is_extern && !hex && field_len != UNIV_SQL_NULL &&
+          write_streamed_lob(sink, row_opts.format, *fp.def, field_ptr, field_len)) {
+        continue;
+      }
+      format_field_value(*fp.def, fp.format, field_ptr, field_len, is_extern, hex, value);
       if (value.is_null) {
-        std::fputs("null", out);
-      } else if (value.is_json) {
-        std::fputs(value.value.c_str(), out);
-      } else if (value.is_numeric) {
-        std::fputs(value.value.c_str(), out);
+        sink.append_cstr("null");
+      } else if (value.is_json || value.is_numeric) {
+        sink.append_cstr(value.value.c_str());
       } else {
-        write_json_string(out, value.value);
+        sink.append_json_string(value.value);
       }
-      first = false;
     }
-    std::fputs("}\n", out);
+    sink.append("}\n", 2);
+    sink.end_row();
     return data_size;
   }
 
+  const char sep = row_opts.format == ROW_OUTPUT_CSV ? ',' : '|';
   ulint printed = 0;
-  if (g_row_output.include_meta && meta) {
-    if (g_row_output.format == ROW_OUTPUT_CSV) {
-      write_csv_value(out, std::to_string(static_cast<unsigned long long>(meta->page_no)));
-      std::fputc(',', out);
-      write_csv_value(out, std::to_string(static_cast<unsigned long>(meta->rec_offset)));
-      std::fputc(',', out);
-      write_csv_value(out, meta->deleted ? "true" : "false");
-    } else {
-      std::fprintf(out, "%llu|%lu|%s",
-                   static_cast<unsigned long long>(meta->page_no),
-                   static_cast<unsigned long>(meta->rec_offset),
-                   meta->deleted ? "true" : "false");
-    }
+  if (row_opts.include_meta && meta) {
+    // Numbers and true/false never need CSV quoting, so pipe and CSV agree.
+    sink.append_uint(static_cast<uint64_t>(meta->page_no));
+    sink.put(sep);
+    sink.append_uint(static_cast<uint64_t>(meta->rec_offset));
+    sink.put(sep);
+    sink.append_cstr(meta->deleted ? "true" : "false");
     printed += 3;
   }
 
-  for (ulint i = 0; i < (ulint)table->fields_count; i++) {
-    if (!show_internal && table->fields[i].type == FT_INTERNAL) {
+  for (ulint i = 0; i < plan.fields.size(); i++) {
+    const FieldPlan& fp = plan.fields[i];
+    if (!field_is_output(row_opts, fp, i)) {
       continue;
     }
     ulint field_len;
     const unsigned char* field_ptr = my_rec_get_nth_field(rec, offsets, i, &field_len);
     bool is_extern = my_rec_offs_nth_extern(offsets, i);
-    FieldOutput value = format_field_value(table->fields[i], field_ptr, field_len, is_extern, hex);
 
     if (printed > 0) {
-      std::fputc(g_row_output.format == ROW_OUTPUT_CSV ? ',' : '|', out);
+      sink.put(sep);
     }
+    printed++;
+    if (is_extern && !hex && field_len != UNIV_SQL_NULL &&
+        write_streamed_lob(sink, row_opts.format, *fp.def, field_ptr, field_len)) {
+      continue;
+    }
+    format_field_value(*fp.def, fp.format, field_ptr, field_len, is_extern, hex, value);
 
     if (value.is_null) {
-      if (g_row_output.format == ROW_OUTPUT_CSV) {
-        write_csv_value(out, "NULL");
-      } else {
-        std::fputs("NULL", out);
-      }
+      sink.append_cstr("NULL");
+    } else if (row_opts.format == ROW_OUTPUT_CSV) {
+      sink.append_csv_value(value.value);
     } else {
-      if (g_row_output.format == ROW_OUTPUT_CSV) {
-        write_csv_value(out, value.value);
-      } else {
-        std::fputs(value.value.c_str(), out);
-      }
+      sink.append_cstr(value.value.c_str());
     }
-    printed++;
   }
-  std::fputc('\n', out);
+  sink.put('\n');
+  sink.end_row();
 
   return data_size;
 }
@@ -3,8 +3,19 @@
 
 #include <cstdio>
 #include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
 #include "page0page.h"
 #include "tables_dict.h"
+#include "page_cache.h"
+#include "tablespace_map.h"
+#include "row_output_sink.h"
+#include "row_arena.h"
+#include "columnar_output.h"
+#include "row_filter.h"
+
+class OutputFileWriter;
 
 enum RowOutputFormat {
   ROW_OUTPUT_PIPE = 0,
@@ -18,6 +29,23 @@ struct RowOutputOptions {
   FILE* out = nullptr;
   size_t lob_max_bytes = 4 * 1024 * 1024;
   bool raw_integers = false;  // Skip InnoDB sign-bit decoding for test files
+  // --format=arrow|parquet: rows go to this writer as typed values and
+  // format/out are ignored. Not owned.
+  ColumnarWriter* columnar = nullptr;
+  // --output-compress / --output-split: the writer behind out, told where
+  // the header and each row end so files split between rows. Not owned.
+  OutputFileWriter* file_writer = nullptr;
+  // --columns: fields (by table_def_t index) to output; empty => all but
+  // the internal ones. Unselected fields are never decoded or fetched.
+  std::vector<bool> column_mask;
+  // --where: rows outside these key ranges are dropped before decoding.
+  RowFilter where;
+  // --recover-deleted: print delete-marked, freed and carved records
+  // instead of the live ones (see parse_records_on_page()).
+  bool recover_deleted = false;
+  // --shard-manifest: keep the first key_fields columns of the first and
+  // last row written in the bound ParseStats (first_key, last_key).
+  unsigned key_fields = 0;
 };
 
 struct RowMeta {
@@ -26,17 +54,127 @@ struct RowMeta {
   bool deleted = false;
 };
 
+struct PageCipher;
+
 struct LobReadContext {
   int fd = -1;
   size_t physical_page_size = 0;
   size_t logical_page_size = 0;
   bool tablespace_compressed = false;
+  // LRU of raw and decompressed pages (--lob-cache-mb); nullptr disables it.
+  // PageCache is not thread-safe, so every parse worker gets its own.
+  std::shared_ptr<PageCache> cache;
+  // --mmap: pages are copied out of this mapping instead of pread() (and
+  // bypass the cache, which would only duplicate the kernel's, unless they
+  // also need decrypting).
+  const TablespaceMap* map = nullptr;
+  // Encrypted tablespace: pages are decrypted right after they are read.
+  const PageCipher* cipher = nullptr;
+};
+
+// One formatted column value.
+struct FieldOutput {
+  bool is_null = false;
+  bool is_numeric = false;
+  bool is_json = false;
+  std::string value;
+};
+
+// Formats one present (non-NULL, in-row) value of a given field type.
+typedef void (*FieldFormatFn)(const field_def_t& field,
+                              const unsigned char* ptr,
+                              ulint len,
+                              FieldOutput& out);
+
+// One column of a RecordPlan, packed so the per-record loops never touch
+// the (very large) field_def_t except to format a value.
+struct FieldPlan {
+  const field_def_t* def = nullptr;
+  FieldFormatFn format = nullptr;
+  uint32_t fixed_len = 0;       // 0 => length byte(s) in the record header
+  uint32_t min_len = 0;
+  uint32_t max_len = 0;
+  uint16_t null_byte = 0;       // null-bitmap byte, counted back from the first
+  uint8_t null_mask = 0;        // 0 => NOT NULL
+  bool long_len = false;        // length may take two bytes (and be external)
+  bool check_len = false;       // length can fall outside [min_len, max_len]
+  bool internal = false;        // DB_TRX_ID and friends
+  std::string json_key;         // "name": for JSONL, already escaped
+};
+
+/**
+ * Record decoder compiled once per table definition: the null bit, length
+ * encoding and formatter of every column, plus the offsets of the leading
+ * NOT NULL fixed-length columns, which are the same in every record.
+ * build_table_def_from_json() compiles it into table->plan; compile again
+ * after editing the fields by hand.
+ */
+struct RecordPlan {
+  std::vector<FieldPlan> fields;
+  ulint null_bytes = 0;              // size of the null bitmap
+  ulint fixed_prefix = 0;            // leading fields with constant offsets
+  std::vector<ulint> prefix_offsets;  // offsets[1..fixed_prefix]
+};
+
+// (Re)build table->plan from table->fields; the table owns the plan.
+void compile_record_plan(table_def_t* table);
+void free_record_plan(table_def_t* table);
+
+// Everything the record decoder keeps between calls. By default all threads
+// share one process-wide context; parallel parse workers bind their own so
+// each has private output, LOB reader and table definition (their log
+// stream is bound separately, see parser_log.h).
+struct RowWorkerContext {
+  RowOutputOptions output;
+  LobReadContext lob;
+  bool printed_header = false;
+  table_def_t* table = nullptr;  // nullptr => &table_definitions[0]
+  long header_begin = -1;        // stream offsets of the last header written,
+  long header_end = -1;          // so buffered chunks can drop duplicates
+  RowOutputSink sink;            // row bytes pending for output.out
+  FieldOutput field_scratch;     // reused for every column
+  RowArena arena;                // the current row's temporaries
+  std::vector<unsigned char> lob_raw_scratch;  // physical page read buffer
+  std::vector<unsigned char> lob_zip_scratch;  // page_zip decompression target
 };
 
+// Bind ctx to the calling thread (nullptr restores the shared default).
+void bind_row_worker_context(RowWorkerContext* ctx);
+RowWorkerContext& current_row_worker_context();
+table_def_t* current_row_table();
+
+// set_*() update the context bound to the calling thread.
 void set_row_output_options(const RowOutputOptions& opts);
 void set_lob_read_context(const LobReadContext& ctx);
 
+// pread() one physical page (decrypted if lob.cipher is set) through the
+// calling thread's LOB page cache. out must hold lob.physical_page_size bytes.
+bool read_raw_page_cached(page_no_t page_no, unsigned char* out);
+
+// Emit the pipe/CSV column header line now (no-op for JSONL).
+void print_row_header(const table_def_t* table, bool with_meta);
+// Write out buffered rows; call before closing the output stream.
+void flush_row_output();
+// Columns process_ibrec() hands to RowOutputOptions::columnar for table,
+// in the same order as the text formats print them.
+std::vector<ColumnSpec> columnar_schema(const table_def_t* table,
+                                        const RowOutputOptions& opts);
+// Resolve a comma-separated --columns list against table into a mask for
+// RowOutputOptions::column_mask; false with *err naming an unknown column.
+bool parse_column_selection(const table_def_t* table, const std::string& list,
+                            std::vector<bool>* mask, std::string* err);
+
+// MySQL binary JSON (a JSON column's stored bytes) as JSON text; false if
+// the document is malformed.
+bool json_binary_to_text(const unsigned char* data, size_t len, std::string& out);
+
 bool check_for_a_record(page_t *page, rec_t *rec, table_def_t *table, ulint *offsets);
+// Bytes from the origin of a record check_for_a_record() accepted to the
+// end of its last field.
+ulint record_data_size(const ulint *offsets);
+// Bytes of its header in front of the origin: null bitmap, length bytes and
+// the REC_N_NEW_EXTRA_BYTES fixed part.
+ulint record_extra_size(const rec_t *rec, table_def_t *table, const ulint *offsets);
 ulint process_ibrec(page_t *page, rec_t *rec, table_def_t *table, ulint *offsets,
                     bool hex, const RowMeta* meta);
 